@@ -0,0 +1,351 @@
+/*_____________________________________________________________
+ | OSTree TUI Benchmarks
+ |   Measures the load, filter, layout & render hot paths on
+ |   generated repositories, from 1k up to 1M commits, signed
+ |   and unsigned. See scripts/run_benchmarks.sh.
+ |
+ |   Environment:
+ |   - OSTREE_TUI_BENCH_DIR          generated repos are cached here
+ |   - OSTREE_TUI_BENCH_MAX_COMMITS  skip repo sizes above this
+ |   - OSTREE_TUI_BENCH_GPG_KEY      key id to sign commits with
+ |   - OSTREE_TUI_BENCH_GPG_HOME     gpg homedir holding that key
+ |___________________________________________________________*/
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "ftxui/dom/elements.hpp"  // for Element, Render
+#include "ftxui/screen/screen.hpp"  // for Screen, Dimension
+
+#include "../src/core/commit.hpp"
+#include "../src/core/manager.hpp"
+#include "../src/core/ostreetui.hpp"
+#include "../src/util/cpplibostree.hpp"
+#include "../src/util/deployments.hpp"
+#include "../src/util/diskusage.hpp"
+#include "../src/util/signatures.hpp"
+
+/// Access to the private loading stages of OSTreeRepo & OSTreeTUI.
+struct BenchmarkAccess {
+    static cpplibostree::CommitList parseCommitsAllBranches(cpplibostree::OSTreeRepo& repo) {
+        return repo.parseCommitsAllBranches(repo.GetRefs());
+    }
+
+    static void parseVisibleCommitMap(OSTreeTUI& ostreetui) { ostreetui.parseVisibleCommitMap(); }
+};
+
+namespace {
+
+constexpr int BRANCH_COUNT{4};
+constexpr guint64 FIRST_COMMIT_TIME{1700000000};
+constexpr int SCREEN_WIDTH{200};
+constexpr int SCREEN_HEIGHT{60};
+
+std::string getEnv(const char* name, const std::string& fallback = "") {
+    const char* value = std::getenv(name);
+    return value == nullptr ? fallback : std::string(value);
+}
+
+std::filesystem::path benchDir() {
+    return getEnv("OSTREE_TUI_BENCH_DIR", "/tmp/ostree-tui-bench");
+}
+
+std::string branchName(int64_t index) {
+    constexpr std::array<const char*, BRANCH_COUNT> names{
+        "app/x86_64/stable", "app/x86_64/testing", "app/aarch64/stable", "app/aarch64/devel"};
+    return names.at(static_cast<size_t>(index % BRANCH_COUNT));
+}
+
+/**
+ * @brief Generates a repository, similar to `ostree init` followed by scripted
+ * `ostree commit`s distributed round-robin over BRANCH_COUNT branches. Repositories
+ * are cached in benchDir() and only generated once.
+ *
+ * @param commitCount Total amount of commits to create.
+ * @param sign Sign every commit with OSTREE_TUI_BENCH_GPG_KEY.
+ * @param errorMessage Set, if generation failed.
+ * @return Path to the repository, empty on failure.
+ */
+std::string generateRepo(int64_t commitCount, bool sign, std::string& errorMessage) {
+    const std::string keyId = getEnv("OSTREE_TUI_BENCH_GPG_KEY");
+    const std::string gpgHome = getEnv("OSTREE_TUI_BENCH_GPG_HOME");
+    if (sign && keyId.empty()) {
+        errorMessage = "OSTREE_TUI_BENCH_GPG_KEY not set, skipping signed repository";
+        return "";
+    }
+
+    const std::filesystem::path path =
+        benchDir() / std::format("repo-{}-{}", commitCount, sign ? "signed" : "unsigned");
+    const std::filesystem::path completeMarker = path / ".bench-complete";
+    if (std::filesystem::exists(completeMarker)) {
+        return path;
+    }
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+
+    // tiny tree, shared by all commits
+    const std::filesystem::path treePath = benchDir() / "tree";
+    std::filesystem::create_directories(treePath / "usr" / "bin");
+    std::ofstream(treePath / "usr" / "bin" / "app") << "#!/bin/sh\necho ostree-tui-bench\n";
+
+    g_autoptr(GError) error{nullptr};
+    g_autoptr(GFile) repoFile = g_file_new_for_path(path.c_str());
+    g_autoptr(OstreeRepo) repo = ostree_repo_new(repoFile);
+    if (!ostree_repo_create(repo, OSTREE_REPO_MODE_ARCHIVE, nullptr, &error) ||
+        !ostree_repo_prepare_transaction(repo, nullptr, nullptr, &error)) {
+        errorMessage = error->message;
+        return "";
+    }
+
+    g_autoptr(OstreeMutableTree) mtree = ostree_mutable_tree_new();
+    g_autoptr(GFile) treeFile = g_file_new_for_path(treePath.c_str());
+    g_autoptr(GFile) root{nullptr};
+    if (!ostree_repo_write_directory_to_mtree(repo, treeFile, mtree, nullptr, nullptr, &error) ||
+        !ostree_repo_write_mtree(repo, mtree, &root, nullptr, &error)) {
+        errorMessage = error->message;
+        return "";
+    }
+
+    std::vector<std::string> heads(BRANCH_COUNT);
+    std::vector<std::string> allCommits;
+    for (int64_t i{0}; i < commitCount; i++) {
+        const std::string branch = branchName(i);
+        std::string& head = heads.at(static_cast<size_t>(i % BRANCH_COUNT));
+
+        const std::string version = std::format("1.{}.{}", i / 1000, i % 1000);
+        const std::string subject = std::format("Build {} of {}", version, branch);
+        const std::string body =
+            std::format("Changelog for {}:\n- rebuilt all packages\n", version);
+
+        GVariantDict dict;
+        g_variant_dict_init(&dict, nullptr);
+        g_variant_dict_insert(&dict, OSTREE_COMMIT_META_KEY_VERSION, "s", version.c_str());
+        g_autoptr(GVariant) metadata = g_variant_ref_sink(g_variant_dict_end(&dict));
+
+        g_autofree char* checksum{nullptr};
+        if (!ostree_repo_write_commit_with_time(
+                repo, head.empty() ? nullptr : head.c_str(), subject.c_str(), body.c_str(),
+                metadata, OSTREE_REPO_FILE(root), FIRST_COMMIT_TIME + static_cast<guint64>(i) * 60,
+                &checksum, nullptr, &error)) {
+            errorMessage = error->message;
+            return "";
+        }
+        head = checksum;
+        if (sign) {
+            allCommits.emplace_back(checksum);
+        }
+    }
+    for (int64_t i{0}; i < BRANCH_COUNT && i < commitCount; i++) {
+        ostree_repo_transaction_set_ref(repo, nullptr, branchName(i).c_str(),
+                                        heads.at(static_cast<size_t>(i)).c_str());
+    }
+    if (!ostree_repo_commit_transaction(repo, nullptr, nullptr, &error)) {
+        errorMessage = error->message;
+        return "";
+    }
+
+    for (const auto& checksum : allCommits) {
+        if (!ostree_repo_sign_commit(repo, checksum.c_str(), keyId.c_str(),
+                                     gpgHome.empty() ? nullptr : gpgHome.c_str(), nullptr,
+                                     &error)) {
+            errorMessage = error->message;
+            return "";
+        }
+    }
+
+    std::ofstream(completeMarker) << commitCount << "\n";
+    return path;
+}
+
+/// Resolves the benchmark arguments (commits, signed) to a generated repository.
+std::string repoForState(benchmark::State& state) {
+    static std::map<std::pair<int64_t, bool>, std::string> repos;
+
+    const auto key = std::make_pair(state.range(0), state.range(1) != 0);
+    if (!repos.contains(key)) {
+        std::string errorMessage;
+        repos[key] = generateRepo(key.first, key.second, errorMessage);
+        if (repos[key].empty()) {
+            repos.erase(key);
+            state.SkipWithError(errorMessage.c_str());
+            return "";
+        }
+    }
+    state.counters["commits"] = static_cast<double>(key.first);
+    return repos[key];
+}
+
+/// Loaded OSTreeTUI per repository, so that only the measured stage is repeated.
+OSTreeTUI* tuiForState(benchmark::State& state) {
+    static std::map<std::string, std::unique_ptr<OSTreeTUI>> tuis;
+
+    const std::string path = repoForState(state);
+    if (path.empty()) {
+        return nullptr;
+    }
+    if (!tuis.contains(path)) {
+        tuis[path] = std::make_unique<OSTreeTUI>(path);
+    }
+    return tuis[path].get();
+}
+
+/// Repository sizes from 1k to 1M commits, capped by OSTREE_TUI_BENCH_MAX_COMMITS.
+void repoSizes(benchmark::internal::Benchmark* bench) {
+    const int64_t maxCommits = std::stoll(getEnv("OSTREE_TUI_BENCH_MAX_COMMITS", "1000000"));
+    bench->ArgNames({"commits", "signed"});
+    for (int64_t commits{1000}; commits <= maxCommits && commits <= 1000000; commits *= 10) {
+        bench->Args({commits, 0});
+        bench->Args({commits, 1});
+    }
+    bench->Unit(benchmark::kMillisecond);
+}
+
+// LOAD
+
+void BM_UpdateData(benchmark::State& state) {
+    const std::string path = repoForState(state);
+    if (path.empty()) {
+        return;
+    }
+    cpplibostree::OSTreeRepo repo(path);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(repo.UpdateData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateData)->Apply(repoSizes);
+
+void BM_ParseCommitsAllBranches(benchmark::State& state) {
+    const std::string path = repoForState(state);
+    if (path.empty()) {
+        return;
+    }
+    cpplibostree::OSTreeRepo repo(path);
+    for (auto _ : state) {
+        auto commits = BenchmarkAccess::parseCommitsAllBranches(repo);
+        benchmark::DoNotOptimize(commits);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseCommitsAllBranches)->Apply(repoSizes);
+
+// FILTER
+
+void BM_ParseVisibleCommitMap(benchmark::State& state) {
+    OSTreeTUI* ostreetui = tuiForState(state);
+    if (ostreetui == nullptr) {
+        return;
+    }
+    for (auto _ : state) {
+        BenchmarkAccess::parseVisibleCommitMap(*ostreetui);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseVisibleCommitMap)->Apply(repoSizes);
+
+// LAYOUT
+
+void BM_RefreshCommitComponents(benchmark::State& state) {
+    OSTreeTUI* ostreetui = tuiForState(state);
+    if (ostreetui == nullptr) {
+        return;
+    }
+    for (auto _ : state) {
+        ostreetui->RefreshCommitComponents();
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_RefreshCommitComponents)->Apply(repoSizes);
+
+// RENDER
+
+void BM_CommitRender(benchmark::State& state) {
+    OSTreeTUI* ostreetui = tuiForState(state);
+    if (ostreetui == nullptr) {
+        return;
+    }
+    auto screen = ftxui::Screen::Create(ftxui::Dimension::Fixed(SCREEN_WIDTH),
+                                        ftxui::Dimension::Fixed(SCREEN_HEIGHT));
+    for (auto _ : state) {
+        ftxui::Element tree =
+            CommitRender::CommitRender(*ostreetui, ostreetui->GetBranchColorMap());
+        ftxui::Render(screen, tree);
+    }
+}
+BENCHMARK(BM_CommitRender)->Apply(repoSizes);
+
+void BM_RenderInfoView(benchmark::State& state) {
+    OSTreeTUI* ostreetui = tuiForState(state);
+    if (ostreetui == nullptr) {
+        return;
+    }
+    if (ostreetui->GetVisibleCommitViewMap().empty()) {
+        state.SkipWithError("no visible commits");
+        return;
+    }
+    const cpplibostree::OSTreeRepo& repo = ostreetui->GetOstreeRepo();
+    const cpplibostree::Commit& commit =
+        repo.GetCommitList().at(ostreetui->GetVisibleCommitViewMap().front());
+
+    // everything the info view shows, as it is once the background workers finished
+    g_autoptr(GError) error{nullptr};
+    g_autoptr(OstreeRepo) ostreeRepo =
+        ostree_repo_open_at(AT_FDCWD, repo.GetRepoPath().c_str(), nullptr, &error);
+    if (ostreeRepo == nullptr) {
+        state.SkipWithError(error->message);
+        return;
+    }
+    const std::vector<cpplibostree::Signature> signatures =
+        cpplibostree::VerifyCommitSignatures(ostreeRepo, commit.hash);
+    const cpplibostree::DiskUsage diskUsage{.objects = 1200,
+                                            .bytes = 350ULL << 20U,
+                                            .exclusiveObjects = 40,
+                                            .exclusiveBytes = 12ULL << 20U,
+                                            .sharedObjects = 1160,
+                                            .sharedBytes = 338ULL << 20U,
+                                            .hasParent = true};
+    // generated repositories have no deltas
+    const std::vector<std::string> staticDeltas{"", commit.parent};
+    const std::vector<cpplibostree::Deployment> deployments{
+        {.osname = "bench",
+         .checksum = commit.hash,
+         .serial = 0,
+         .refspec = "origin:" + std::string(commit.branch),
+         .role = cpplibostree::DeploymentRole::BOOTED},
+        {.osname = "bench",
+         .checksum = commit.hash,
+         .serial = 1,
+         .refspec = "origin:" + std::string(commit.branch),
+         .role = cpplibostree::DeploymentRole::ROLLBACK,
+         .pinned = true},
+    };
+
+    auto screen = ftxui::Screen::Create(ftxui::Dimension::Fixed(SCREEN_WIDTH / 2),
+                                        ftxui::Dimension::Fixed(SCREEN_HEIGHT));
+    for (auto _ : state) {
+        ftxui::Render(screen, CommitInfoManager::RenderInfoView(
+                                  commit, repo.GetCommitsWithContent(commit.contentChecksum),
+                                  diskUsage, false, staticDeltas, signatures, deployments));
+    }
+}
+BENCHMARK(BM_RenderInfoView)->Apply(repoSizes);
+
+}  // namespace
+
+BENCHMARK_MAIN();
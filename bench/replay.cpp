@@ -0,0 +1,269 @@
+/*_____________________________________________________________
+ | OSTree TUI Replay
+ |   Headless replay runner for event logs recorded with
+ |   `ostree-tui <repo> --record <file>`. Feeds every recorded
+ |   event to the main container, renders it onto a virtual
+ |   screen & reports handler time, render time & allocation
+ |   count per event (p50, p99, max), grouped by event type.
+ |
+ |   The repository is copied to a temporary snapshot first, so
+ |   recorded promotions & drops do not alter it (--in-place
+ |   skips this).
+ |___________________________________________________________*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ftxui/component/event.hpp"  // for Event
+#include "ftxui/dom/elements.hpp"     // for Render
+#include "ftxui/screen/screen.hpp"    // for Screen, Dimension
+
+#include "../src/core/eventlog.hpp"
+#include "../src/core/ostreetui.hpp"
+
+// ALLOCATION COUNTING
+
+namespace {
+std::atomic<size_t> allocationCount{0};
+
+void* countedAlloc(std::size_t size, std::size_t alignment = 0) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    void* ptr = alignment == 0 ? std::malloc(size)
+                               : std::aligned_alloc(alignment, (size + alignment - 1) / alignment *
+                                                                   alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t /*alignment*/) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t /*alignment*/) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+    std::free(ptr);
+}
+
+// REPLAY
+
+namespace {
+
+struct Sample {
+    double handlerMs{0};
+    double renderMs{0};
+    double allocations{0};
+};
+
+struct Percentiles {
+    double p50{0};
+    double p99{0};
+    double max{0};
+};
+
+Percentiles percentiles(std::vector<double> values) {
+    if (values.empty()) {
+        return {};
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double q) {
+        const auto rank = static_cast<size_t>(q * static_cast<double>(values.size()));
+        return values.at(std::min(rank, values.size() - 1));
+    };
+    return {at(0.50), at(0.99), values.back()};
+}
+
+struct Group {
+    size_t count{0};
+    Percentiles handler;
+    Percentiles render;
+    Percentiles allocations;
+};
+
+Group summarize(const std::vector<Sample>& samples) {
+    std::vector<double> handler;
+    std::vector<double> render;
+    std::vector<double> allocations;
+    for (const auto& sample : samples) {
+        handler.push_back(sample.handlerMs);
+        render.push_back(sample.renderMs);
+        allocations.push_back(sample.allocations);
+    }
+    return {samples.size(), percentiles(handler), percentiles(render), percentiles(allocations)};
+}
+
+std::string toJson(const Percentiles& p) {
+    return std::format(R"({{"p50": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})", p.p50, p.p99, p.max);
+}
+
+int usage(const std::string& caller, const std::string& errorMessage = "") {
+    if (!errorMessage.empty()) {
+        std::cerr << errorMessage << "\n";
+    }
+    std::cerr << "Usage: " << caller
+              << " REPOSITORY_PATH EVENT_LOG [--json FILE] [--size WIDTH HEIGHT] [--in-place]\n";
+    return errorMessage.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() < 2) {
+        return usage(argv[0], "no repository or event log provided");
+    }
+    const std::filesystem::path repoPath = args.at(0);
+    const std::string eventLogPath = args.at(1);
+
+    std::string jsonPath;
+    bool inPlace{false};
+    int width{0};
+    int height{0};
+    for (size_t i{2}; i < args.size(); i++) {
+        if (args.at(i) == "--json" && i + 1 < args.size()) {
+            jsonPath = args.at(++i);
+        } else if (args.at(i) == "--size" && i + 2 < args.size()) {
+            width = std::stoi(args.at(++i));
+            height = std::stoi(args.at(++i));
+        } else if (args.at(i) == "--in-place") {
+            inPlace = true;
+        } else {
+            return usage(argv[0], "unknown option " + args.at(i));
+        }
+    }
+
+    // read event log
+    std::ifstream eventLog(eventLogPath);
+    if (!eventLog.is_open()) {
+        return usage(argv[0], "could not open event log " + eventLogPath);
+    }
+    std::vector<ftxui::Event> events;
+    std::string line;
+    while (std::getline(eventLog, line)) {
+        if (line.starts_with(EventLog::HEADER) && width == 0) {
+            std::sscanf(line.c_str() + EventLog::HEADER.size(), "%d %d", &width, &height);
+        }
+        if (auto event = EventLog::Deserialize(line)) {
+            events.push_back(*event);
+        }
+    }
+    width = width > 0 ? width : 160;
+    height = height > 0 ? height : 48;
+
+    // snapshot the repository
+    std::filesystem::path snapshot = repoPath;
+    if (!inPlace) {
+        std::string tmpl = (std::filesystem::temp_directory_path() / "ostree-tui-replay-XXXXXX");
+        if (mkdtemp(tmpl.data()) == nullptr) {
+            return usage(argv[0], "could not create snapshot directory");
+        }
+        snapshot = tmpl;
+        std::filesystem::copy(repoPath, snapshot,
+                              std::filesystem::copy_options::recursive |
+                                  std::filesystem::copy_options::copy_symlinks);
+    }
+
+    std::map<std::string, std::vector<Sample>> samples;
+    {
+        OSTreeTUI ostreetui(snapshot);
+        ftxui::Component& mainContainer = ostreetui.GetMainContainer();
+        auto screen =
+            ftxui::Screen::Create(ftxui::Dimension::Fixed(width), ftxui::Dimension::Fixed(height));
+        // initial frame, to lay out the components for mouse events
+        ftxui::Render(screen, mainContainer->Render());
+
+        using Ms = std::chrono::duration<double, std::milli>;
+        for (const auto& event : events) {
+            const size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+            const auto start = std::chrono::steady_clock::now();
+            mainContainer->OnEvent(event);
+            const auto handled = std::chrono::steady_clock::now();
+            ftxui::Render(screen, mainContainer->Render());
+            const auto rendered = std::chrono::steady_clock::now();
+            const size_t allocationsAfter = allocationCount.load(std::memory_order_relaxed);
+
+            Sample sample{Ms(handled - start).count(), Ms(rendered - handled).count(),
+                          static_cast<double>(allocationsAfter - allocationsBefore)};
+            samples["(all)"].push_back(sample);
+            samples[EventLog::Describe(event)].push_back(sample);
+        }
+    }
+
+    if (!inPlace) {
+        std::filesystem::remove_all(snapshot);
+    }
+
+    // report
+    std::cout << std::format("Replayed {} events on {}x{} against {}\n\n", events.size(), width,
+                             height, repoPath.string());
+    std::cout << std::format("{:<24}{:>7}  {:>26}  {:>26}  {:>20}\n", "event", "count",
+                             "handler ms p50/p99/max", "render ms p50/p99/max",
+                             "allocs p50/p99/max");
+    std::string json = std::format(R"({{"repository": "{}", "events": {}, "groups": [)",
+                                   repoPath.string(), events.size());
+    bool first{true};
+    for (const auto& [name, groupSamples] : samples) {
+        const Group group = summarize(groupSamples);
+        std::cout << std::format(
+            "{:<24}{:>7}  {:>8.3f}/{:>8.3f}/{:>8.3f}  {:>8.3f}/{:>8.3f}/{:>8.3f}  "
+            "{:>6.0f}/{:>6.0f}/{:>6.0f}\n",
+            name, group.count, group.handler.p50, group.handler.p99, group.handler.max,
+            group.render.p50, group.render.p99, group.render.max, group.allocations.p50,
+            group.allocations.p99, group.allocations.max);
+        json += std::format(
+            R"({}{{"name": "{}", "count": {}, "handler_ms": {}, "render_ms": {}, "allocations": {}}})",
+            first ? "" : ", ", name, group.count, toJson(group.handler), toJson(group.render),
+            toJson(group.allocations));
+        first = false;
+    }
+    json += "]}\n";
+
+    if (!jsonPath.empty()) {
+        std::ofstream(jsonPath) << json;
+    }
+    return EXIT_SUCCESS;
+}
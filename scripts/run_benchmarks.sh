@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Builds & runs the ostree-tui-bench target and writes the results as JSON.
+# Generated repositories are cached in $OSTREE_TUI_BENCH_DIR (default /tmp/ostree-tui-bench).
+# A throwaway gpg key is created for the signed repositories, unless
+# OSTREE_TUI_BENCH_GPG_KEY is already set.
+# Execute as follows:
+# ./scripts/run_benchmarks.sh [output.json] [max_commits]
+# Compare two runs with Google Benchmark's tools/compare.py:
+# compare.py benchmarks baseline.json output.json
+
+set -e
+
+OUTPUT="${1:-bench_output.json}"
+export OSTREE_TUI_BENCH_MAX_COMMITS="${2:-${OSTREE_TUI_BENCH_MAX_COMMITS:-1000000}}"
+export OSTREE_TUI_BENCH_DIR="${OSTREE_TUI_BENCH_DIR:-/tmp/ostree-tui-bench}"
+BUILD_DIR="${BUILD_DIR:-build_bench}"
+
+mkdir -p "${OSTREE_TUI_BENCH_DIR}"
+
+if [ -z "${OSTREE_TUI_BENCH_GPG_KEY}" ] && command -v gpg > /dev/null; then
+    export OSTREE_TUI_BENCH_GPG_HOME="${OSTREE_TUI_BENCH_DIR}/gnupg"
+    mkdir -p -m 700 "${OSTREE_TUI_BENCH_GPG_HOME}"
+    if ! gpg --homedir "${OSTREE_TUI_BENCH_GPG_HOME}" --list-keys bench@ostree-tui > /dev/null 2>&1; then
+        printf "🔑  Creating benchmark signing key...\n"
+        gpg --homedir "${OSTREE_TUI_BENCH_GPG_HOME}" --batch --passphrase '' \
+            --quick-gen-key bench@ostree-tui ed25519 sign never
+    fi
+    export OSTREE_TUI_BENCH_GPG_KEY=$(gpg --homedir "${OSTREE_TUI_BENCH_GPG_HOME}" --with-colons \
+        --list-keys bench@ostree-tui | awk -F: '/^fpr/ { print $10; exit }')
+fi
+
+printf "🔨  Building ostree-tui-bench...\n"
+cmake -S . -B "${BUILD_DIR}" -DCMAKE_BUILD_TYPE=Release -DOSTREE_TUI_BUILD_BENCHMARKS=ON
+cmake --build "${BUILD_DIR}" --parallel --target ostree-tui-bench
+
+printf "⏱️  Running benchmarks (up to %s commits)...\n" "${OSTREE_TUI_BENCH_MAX_COMMITS}"
+"${BUILD_DIR}/bin/ostree-tui-bench" --benchmark_out="${OUTPUT}" --benchmark_out_format=json
+
+GREEN='\033[0;32m'
+NC='\033[0m'
+
+printf "✅ ${GREEN}Done. Results written to ${OUTPUT}${NC}\n"
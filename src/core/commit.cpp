@@ -5,7 +5,9 @@
 #include <cstdio>
 #include <format>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -21,6 +23,9 @@
 #include "ftxui/screen/color.hpp"  // for Color
 
 #include "../util/cpplibostree.hpp"
+#include "../util/diskusage.hpp"
+#include "../util/profiler.hpp"
+#include "../util/pruneplan.hpp"
 
 #include "ostreetui.hpp"
 
@@ -82,10 +87,10 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
           hash(std::move(commit)),
           ostreetui(ostreetui),
           commit(ostreetui.GetOstreeRepo().GetCommitList().at(hash)),
-          newVersion(this->commit.version) {
+          newVersion(this->commit.Version()) {
         inner = Renderer([&] {
             return vbox({
-                text(ostreetui.GetOstreeRepo().GetCommitList().at(hash).subject),
+                text(std::string(ostreetui.GetOstreeRepo().GetCommitList().at(hash).Subject())),
                 text(
                     std::format("{:%Y-%m-%d %T %Ez}",
                                 std::chrono::time_point_cast<std::chrono::seconds>(
@@ -95,7 +100,13 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         simpleCommit = inner;
         Add(inner);
 
-        title = hash.substr(0, 8);
+        std::string windowTitle = hash.substr(0, 8);
+        // sysroot mode: mark deployed commits
+        if (const auto* deployment = ostreetui.GetOstreeRepo().GetDeployment(hash)) {
+            const std::string_view role = cpplibostree::RoleName(deployment->role);
+            windowTitle += " ● " + (role.empty() ? std::string("deployed") : std::string(role));
+        }
+        title = windowTitle;
         top = defaultY;
         left = defaultX;
         width = COMMIT_WINDOW_WIDTH;
@@ -110,6 +121,7 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         }
         width() = defaultWidth;
         height() = defaultHeight;
+        duplicateConfirmedFor.clear();
         // reset window contents
         DetachAllChildren();
         Add(simpleCommit);
@@ -149,12 +161,21 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
     }
 
     void executePromotion() {
+        // same content already on the branch: the first press only asks for confirmation
+        const std::string& branch = ostreetui.GetModeBranch();
+        if (ostreetui.GetOstreeRepo().FindContentOnBranch(commit.contentChecksum, branch) !=
+                nullptr &&
+            duplicateConfirmedFor != branch) {
+            duplicateConfirmedFor = branch;
+            return;
+        }
         // promote on the ostree repo
         std::vector<std::string> metadataStrings;
         if (!newVersion.empty()) {
             metadataStrings.push_back("version=" + newVersion);
         }
-        ostreetui.PromoteCommit(hash, ostreetui.GetModeBranch(), metadataStrings, newSubject, true);
+        ostreetui.PromoteCommit(hash, ostreetui.GetModeBranch(), metadataStrings, newSubject, true,
+                                staticDelta);
         resetWindow();
     }
 
@@ -164,6 +185,51 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         resetWindow();
     }
 
+    /// @return Download size for devices on the target branch head, to update to this commit.
+    Element renderUpdateEstimate() {
+        const auto* head = ostreetui.GetOstreeRepo().GetBranchHead(ostreetui.GetModeBranch());
+        if (head == nullptr) {
+            return text("new branch") | dim;
+        }
+        if (head->hash == hash) {
+            return text("already on branch") | dim;
+        }
+        auto& worker = ostreetui.GetDiskUsageWorker();
+        const auto estimate = worker.GetDeltaEstimate(head->hash, hash);
+        return CommitInfoManager::RenderDeltaEstimate(
+            estimate, !estimate && worker.DeltaFailed(head->hash, hash));
+    }
+
+    /// @return Warning, if the content of this commit is already on the target branch.
+    Element renderDuplicateWarning() {
+        const std::string& branch = ostreetui.GetModeBranch();
+        const auto* existing =
+            ostreetui.GetOstreeRepo().FindContentOnBranch(commit.contentChecksum, branch);
+        if (existing == nullptr) {
+            return text(" ┆");
+        }
+        return vbox({text(" ⚠ already on " + branch + " as " + existing->hash.substr(0, 8)),
+                     duplicateConfirmedFor == branch ? text(" ⚠ Promote again to promote anyway")
+                                                     : text(" ┆")}) |
+               color(Color::Yellow);
+    }
+
+    /// @return What dropping this commit frees, from its prune plan.
+    Element renderDropPlan() {
+        using cpplibostree::FormatBytes;
+        auto& planner = ostreetui.GetPrunePlanner();
+        const auto plan = planner.Get(ostreetui.GetOstreeRepo(), commit);
+        if (!plan) {
+            return vbox({planner.Failed(hash)
+                             ? text(" ┆ frees: could not be planned") | color(Color::Red)
+                             : text(" ┆ frees: calculating...") | dim,
+                         text(" ┆")});
+        }
+        return vbox({text(" ┆ frees: " + FormatBytes(plan->bytes)),
+                     text(" ┆ " + std::to_string(plan->commits.size()) + " commits, " +
+                          std::to_string(plan->objects.size()) + " objects")});
+    }
+
     void cancelSpecialWindow() {
         ostreetui.SetViewMode(ViewMode::DEFAULT);
         resetWindow();
@@ -193,8 +259,9 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
         if (commitPosition == ostreetui.GetSelectedCommit()) {  // selected & not in promotion
             element =
                 render ? render(state)
-                       : DefaultRenderState(state, ostreetui.GetBranchColorMap().at(commit.branch),
-                                            ostreetui.GetModeHash() != hash);
+                       : DefaultRenderState(
+                             state, ostreetui.GetBranchColorMap().at(std::string(commit.branch)),
+                             ostreetui.GetModeHash() != hash);
         } else {
             element =
                 render ? render(state)
@@ -267,7 +334,7 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                 if (event.mouse().y > ostreetui.GetScreen().dimy() - 8) {
                     ostreetui.SetViewMode(ViewMode::COMMIT_DROP, hash);
                     ostreetui.SetModeBranch(
-                        ostreetui.GetOstreeRepo().GetCommitList().at(hash).branch);
+                        std::string(ostreetui.GetOstreeRepo().GetCommitList().at(hash).branch));
                     top() = defaultY;
                 }
                 // check if position matches branch & do something if it does
@@ -293,17 +360,12 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                     // calculate which branch currently is hovered over
                     ostreetui.SetModeBranch("");
                     const int branch_pos = event.mouse().x / 2;
-                    int count{0};
-                    for (const auto& [branch, visible] : ostreetui.GetVisibleBranches()) {
-                        if (visible) {
-                            ++count;
-                        }
-                        if (count == branch_pos) {
-                            ostreetui.SetViewMode(ViewMode::COMMIT_PROMOTION, hash);
-                            ostreetui.SetModeBranch(
-                                ostreetui.GetColumnToBranchMap().at(event.mouse().x / 2 - 1));
-                            break;
-                        }
+                    const auto visibleCount =
+                        static_cast<int>(ostreetui.GetVisibleBranches().Count());
+                    if (branch_pos >= 1 && branch_pos <= visibleCount) {
+                        ostreetui.SetViewMode(ViewMode::COMMIT_PROMOTION, hash);
+                        ostreetui.SetModeBranch(
+                            ostreetui.GetColumnToBranchMap().at(event.mouse().x / 2 - 1));
                     }
                 }
             } else {
@@ -335,6 +397,11 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
 
         TakeFocus();
 
+        // dragging promotes or drops, sysroot tabs are read-only
+        if (ostreetui.GetOstreeRepo().IsSysroot()) {
+            return true;
+        }
+
         capturedMouse_ = CaptureMouse(event);
         if (!capturedMouse_) {
             return true;
@@ -376,6 +443,8 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
     cpplibostree::Commit commit;
     std::string newSubject;
     std::string newVersion;
+    bool staticDelta{false};
+    std::string duplicateConfirmedFor;  // branch the user confirmed promoting duplicate content to
     Component simpleCommit = Renderer([] { return text("error in commit window creation"); });
     Component promotionView = Container::Vertical(
         {Renderer([&] {
@@ -389,18 +458,23 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
          Container::Horizontal({Renderer([&] { return text(" ┆ subject: "); }),
                                 Input(&newSubject, "enter new subject...") | underlined}),
          // render version, if available
-         commit.version.empty()
+         commit.Version().empty()
              ? Renderer([] { return filler(); })
-             : Container::Horizontal({Renderer([&] { return text(" ┆ version: "); }),
-                                      Input(&newVersion, commit.version) | underlined}),
+             : Container::Horizontal(
+                   {Renderer([&] { return text(" ┆ version: "); }),
+                    Input(&newVersion, std::string(commit.Version())) | underlined}),
          Renderer([&] {
              return vbox({text(" ┆"), text(" ┆ to branch:"),
-                          text(" ☐ " + ostreetui.GetModeBranch()) | bold, text(" │") | bold});
+                          text(" ☐ " + ostreetui.GetModeBranch()) | bold, text(" │") | bold,
+                          hbox({text(" ┆ update: "), renderUpdateEstimate()}),
+                          renderDuplicateWarning()});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
              Button(" Promote ", [&] { executePromotion(); }) | color(Color::Green) | flex,
-         })});
+         }),
+         // last, keeps the focus sequence of startPromotionWindow() intact
+         Checkbox(" generate static delta", &staticDelta)});
     // deletion view, commit is at head of branch
     Component deletionViewHead = Container::Vertical(
         {Renderer([&] {
@@ -409,9 +483,10 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
                               text(" ✖ ") | color(Color::Red),
                               text(hash.substr(0, 8)) | bold | color(Color::Red),
                           }),
-                          text(" ✖ " + commit.subject) | color(Color::Red),
+                          text(" ✖ " + std::string(commit.Subject())) | color(Color::Red),
                           text(" ✖") | color(Color::Red),
-                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim});
+                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim,
+                          renderDropPlan()});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
@@ -421,18 +496,27 @@ class CommitComponentImpl : public ComponentBase, public WindowOptions {
     Component deletionViewBody = Container::Vertical(
         {Renderer([&] {
              std::string parent = ostreetui.GetOstreeRepo().GetCommitList().at(hash).parent;
-             return vbox({text(" Remove Commit (and preceding)...") | bold, text(""),
-                          text(" ☐ " + ostreetui.GetModeBranch()) | dim, text(" │") | dim,
+             // without a plan, only the commit itself is dropped (see OSTreeTUI::RemoveCommit())
+             const bool onlyThis = ostreetui.GetPrunePlanner().Failed(hash);
+             Element parents = text("");
+             if (parent != "(no parent)") {
+                 parents = onlyThis ? vbox({text(" ☐ " + parent.substr(0, 8)) | dim,
+                                            text(" │ ...") | dim})
+                                    : vbox({
+                                          text(" ✖ " + parent.substr(0, 8)) | color(Color::Red),
+                                          text(" ✖ ...") | color(Color::Red),
+                                      });
+             }
+             return vbox({text(onlyThis ? " Remove Commit (only this one)..."
+                                        : " Remove Commit (and preceding)...") |
+                              bold,
+                          text(""), text(" ☐ " + ostreetui.GetModeBranch()) | dim,
+                          text(" │") | dim,
                           hbox({
                               text(" ✖ ") | color(Color::Red),
                               text(hash.substr(0, 8)) | bold | color(Color::Red),
                           }),
-                          parent == "(no parent)"
-                              ? text("")
-                              : vbox({
-                                    text(" ✖ " + parent.substr(0, 8)) | color(Color::Red),
-                                    text(" ✖ ...") | color(Color::Red),
-                                })});
+                          parents, renderDropPlan()});
          }),
          Container::Horizontal({
              Button(" Cancel ", [&] { cancelSpecialWindow(); }) | color(Color::Red) | flex,
@@ -449,45 +533,91 @@ ftxui::Component CommitComponent(size_t position, const std::string& commit, OST
 ftxui::Element CommitRender(OSTreeTUI& ostreetui,
                             const std::unordered_map<std::string, ftxui::Color>& branchColorMap) {
     using namespace ftxui;
+    OSTREE_TUI_PROFILE_SCOPE("CommitRender");
 
     int scrollOffset = ostreetui.GetScrollOffset();
 
     // check empty commit list
-    if (ostreetui.GetVisibleCommitViewMap().empty() || ostreetui.GetVisibleBranches().empty()) {
+    if (ostreetui.GetVisibleCommitViewMap().empty() || ostreetui.GetVisibleBranches().None()) {
         return color(Color::RedLight, text(" no commits to be shown ") | bold | center);
     }
 
     // stores the dedicated tree-column of each branch, -1 meaning not displayed yet
     std::unordered_map<std::string, int> usedBranches{};
-    for (const auto& branchPair : ostreetui.GetVisibleBranches()) {
-        if (branchPair.second) {
-            usedBranches[branchPair.first] = -1;
+    const auto& branches = ostreetui.GetOstreeRepo().GetBranches();
+    ostreetui.GetVisibleBranches().ForEach(
+        [&](size_t branchId) { usedBranches[branches[branchId]] = -1; });
+    int nextAvailableSpace = static_cast<int>(usedBranches.size() - 1);
+
+    // lineage of the selected commit: visible commits with the same content
+    const auto& viewMap = ostreetui.GetVisibleCommitViewMap();
+    std::vector<bool> lineageMembers(viewMap.size(), false);
+    size_t lineageFirst{viewMap.size()};
+    size_t lineageLast{0};
+    if (ostreetui.GetShowLineage()) {
+        const auto& selected = ostreetui.GetOstreeRepo().GetCommitList().at(
+            viewMap.at(std::min(ostreetui.GetSelectedCommit(), viewMap.size() - 1)));
+        const auto lineage = ostreetui.GetOstreeRepo().GetCommitsWithContent(
+            selected.contentChecksum);
+        if (lineage.size() > 1) {
+            std::unordered_set<std::string_view> lineageHashes;
+            for (const auto* member : lineage) {
+                lineageHashes.insert(member->hash);
+            }
+            for (size_t i{0}; i < viewMap.size(); i++) {
+                if (lineageHashes.contains(viewMap[i])) {
+                    lineageMembers[i] = true;
+                    lineageFirst = std::min(lineageFirst, i);
+                    lineageLast = i;
+                }
+            }
+        }
+        // a single visible member has nothing to connect to
+        if (lineageFirst == lineageLast) {
+            lineageFirst = viewMap.size();
         }
     }
-    int nextAvailableSpace = static_cast<int>(usedBranches.size() - 1);
+    auto lineageColumn = [&](size_t position, bool nodeLine) {
+        if (position < lineageFirst || position > lineageLast) {
+            return text(COMMIT_NONE);
+        }
+        if (!nodeLine || !lineageMembers[position]) {
+            return text(LINEAGE_SPAN) | color(LINEAGE_COLOR);
+        }
+        if (position == lineageFirst) {
+            return text(LINEAGE_FIRST) | color(LINEAGE_COLOR);
+        }
+        return text(position == lineageLast ? LINEAGE_LAST : LINEAGE_MEMBER) |
+               color(LINEAGE_COLOR);
+    };
+    const bool drawLineage = lineageFirst < viewMap.size();
 
     // - RENDER -
     Elements treeElements{};
 
     ostreetui.GetColumnToBranchMap().clear();
-    for (const auto& visibleCommitIndex : ostreetui.GetVisibleCommitViewMap()) {
-        const cpplibostree::Commit commit =
-            ostreetui.GetOstreeRepo().GetCommitList().at(visibleCommitIndex);
+    for (size_t position{0}; position < viewMap.size(); position++) {
+        const cpplibostree::Commit& commit =
+            ostreetui.GetOstreeRepo().GetCommitList().at(viewMap[position]);
         // branch head if it is first branch usage
-        const std::string relevantBranch = commit.branch;
+        const std::string relevantBranch(commit.branch);
         if (usedBranches.at(relevantBranch) == -1) {
             ostreetui.GetColumnToBranchMap().push_back(relevantBranch);
             usedBranches.at(relevantBranch) = nextAvailableSpace--;
         }
         // commit
         if (scrollOffset++ >= 0) {
-            treeElements.push_back(
-                addTreeLine(RenderTree::TREE_LINE_NODE, commit, usedBranches, branchColorMap));
+            Element line = addTreeLine(RenderTree::TREE_LINE_NODE, commit, usedBranches,
+                                       branchColorMap, drawLineage && lineageMembers[position]);
+            treeElements.push_back(drawLineage ? hbox({line, lineageColumn(position, true)})
+                                               : line);
         }
         for (int i{0}; i < 3; i++) {
             if (scrollOffset++ >= 0) {
+                Element line =
+                    addTreeLine(RenderTree::TREE_LINE_TREE, commit, usedBranches, branchColorMap);
                 treeElements.push_back(
-                    addTreeLine(RenderTree::TREE_LINE_TREE, commit, usedBranches, branchColorMap));
+                    drawLineage ? hbox({line, lineageColumn(position, false)}) : line);
             }
         }
     }
@@ -499,12 +629,19 @@ ftxui::Element CommitRender(OSTreeTUI& ostreetui,
 ftxui::Element addTreeLine(const RenderTree& treeLineType,
                            const cpplibostree::Commit& commit,
                            const std::unordered_map<std::string, int>& usedBranches,
-                           const std::unordered_map<std::string, ftxui::Color>& branchColorMap) {
+                           const std::unordered_map<std::string, ftxui::Color>& branchColorMap,
+                           bool lineageConnector) {
     using namespace ftxui;
 
-    const std::string relevantBranch = commit.branch;
+    const std::string relevantBranch(commit.branch);
     // create an empty branch tree line
     Elements tree(usedBranches.size(), text(COMMIT_NONE));
+    // columns right of the commit node carry the lineage connector
+    const int lineageStart = lineageConnector ? usedBranches.at(relevantBranch) + 1
+                                              : static_cast<int>(usedBranches.size());
+    for (int i{lineageStart}; i < static_cast<int>(usedBranches.size()); i++) {
+        tree.at(i) = text(LINEAGE_NONE) | color(LINEAGE_COLOR);
+    }
 
     // populate tree with all displayed branches
     for (const auto& branch : usedBranches) {
@@ -512,9 +649,11 @@ ftxui::Element addTreeLine(const RenderTree& treeLineType,
             continue;
         }
 
-        if (treeLineType == RenderTree::TREE_LINE_TREE ||
-            (treeLineType == RenderTree::TREE_LINE_IGNORE_BRANCH &&
-             branch.first != relevantBranch)) {
+        if (branch.second >= lineageStart) {
+            tree.at(branch.second) = (text(LINEAGE_TREE) | color(LINEAGE_COLOR));
+        } else if (treeLineType == RenderTree::TREE_LINE_TREE ||
+                   (treeLineType == RenderTree::TREE_LINE_IGNORE_BRANCH &&
+                    branch.first != relevantBranch)) {
             tree.at(branch.second) = (text(COMMIT_TREE) | color(branchColorMap.at(branch.first)));
         } else if (treeLineType == RenderTree::TREE_LINE_NODE) {
             if (branch.first == relevantBranch) {
@@ -27,12 +27,20 @@ namespace CommitRender {
 constexpr std::string COMMIT_NODE{" ☐"};
 constexpr std::string COMMIT_TREE{" │"};
 constexpr std::string COMMIT_NONE{"  "};
+// lineage connector characters (commits with the same content)
+constexpr std::string LINEAGE_NONE{"──"};
+constexpr std::string LINEAGE_TREE{"─┼"};
+constexpr std::string LINEAGE_FIRST{"─┐"};
+constexpr std::string LINEAGE_MEMBER{"─┤"};
+constexpr std::string LINEAGE_LAST{"─┘"};
+constexpr std::string LINEAGE_SPAN{" │"};
+const ftxui::Color LINEAGE_COLOR{ftxui::Color::YellowLight};
 // window dimensions
 constexpr int COMMIT_WINDOW_HEIGHT{4};
 constexpr int COMMIT_WINDOW_WIDTH{32};
-constexpr int PROMOTION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 11};
+constexpr int PROMOTION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 16};
 constexpr int PROMOTION_WINDOW_WIDTH{COMMIT_WINDOW_WIDTH + 8};
-constexpr int DELETION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 8};
+constexpr int DELETION_WINDOW_HEIGHT{COMMIT_WINDOW_HEIGHT + 10};
 constexpr int DELETION_WINDOW_WIDTH{COMMIT_WINDOW_WIDTH + 8};
 // render tree types
 enum RenderTree : uint8_t {
@@ -74,12 +82,14 @@ enum RenderTree : uint8_t {
  * @param commit            Commit to get the information from (to render).
  * @param usedBranches      Branches, that should be rendered (visible).
  * @param branchColorMap    Branch colors to use.
+ * @param lineageConnector  Draw a lineage connector from the commit node to the right border.
  * @return UI Element, one commit-tree line.
  */
 [[nodiscard]] ftxui::Element addTreeLine(
     const RenderTree& treeLineType,
     const cpplibostree::Commit& commit,
     const std::unordered_map<std::string, int>& usedBranches,
-    const std::unordered_map<std::string, ftxui::Color>& branchColorMap);
+    const std::unordered_map<std::string, ftxui::Color>& branchColorMap,
+    bool lineageConnector = false);
 
 }  // namespace CommitRender
@@ -0,0 +1,216 @@
+#include "diffview.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ftxui/component/component_base.hpp>  // for Component, ComponentBase
+#include <ftxui/component/event.hpp>           // for Event
+#include "ftxui/component/component.hpp"       // for Make
+#include "ftxui/component/mouse.hpp"           // for Mouse
+#include "ftxui/dom/elements.hpp"  // for operator|, Element, text, hbox, vbox, reflect, inverted
+#include "ftxui/screen/box.hpp"    // for Box
+#include "ftxui/screen/color.hpp"  // for Color
+
+#include "../util/commitdiff.hpp"
+#include "../util/profiler.hpp"
+
+#include "ostreetui.hpp"
+
+namespace DiffRender {
+
+namespace {
+using namespace ftxui;
+
+/// rows rendered at once, only these are copied from the differ
+constexpr size_t VIEWPORT_HEIGHT{20};
+
+class DiffComponentImpl : public ComponentBase {
+   public:
+    DiffComponentImpl(cpplibostree::CommitDiffer& differ, OSTreeTUI& ostreetui)
+        : differ(differ), ostreetui(ostreetui) {}
+
+    Element Render() final {
+        OSTREE_TUI_PROFILE_SCOPE("DiffRender");
+        const auto& viewMap = ostreetui.GetVisibleCommitViewMap();
+        if (viewMap.empty()) {
+            return text(" no commit selected ") | color(Color::RedLight) | reflect(box);
+        }
+        const std::string& to =
+            viewMap.at(std::min(ostreetui.GetSelectedCommit(), viewMap.size() - 1));
+        const auto& commits = ostreetui.GetOstreeRepo().GetCommitList();
+
+        // marked commit, or the parent
+        std::string from = ostreetui.GetDiffBase();
+        const bool marked = !from.empty() && from != to && commits.contains(from);
+        if (!marked) {
+            from = commits.at(to).parent;
+        }
+        if (!commits.contains(from)) {
+            return vbox({text(" " + to.substr(0, 8) + " has no parent to diff with") | dim,
+                         text(" m: mark a commit as diff base") | dim}) |
+                   reflect(box);
+        }
+
+        // restarts (and cancels the running diff), if the selection moved; a failed diff is
+        // only started again on request (r), not by every redraw
+        if (from != shownFrom || to != shownTo) {
+            differ.Start(from, to);
+            cursor = 0;
+            scroll = 0;
+            shownFrom = from;
+            shownTo = to;
+        }
+        const auto status = differ.GetStatus();
+        shownEntries = differ.GetEntryCount();
+        clampCursor();
+
+        Elements lines{text(std::format(" {} → {} ({})", from.substr(0, 8), to.substr(0, 8),
+                                        marked ? "marked" : "parent")) |
+                       bold};
+        const auto entries = differ.GetEntries(scroll, VIEWPORT_HEIGHT);
+        for (size_t i{0}; i < entries.size(); i++) {
+            lines.push_back(renderEntry(entries[i], scroll + i == cursor));
+        }
+        if (entries.empty() && !status.running && !status.failed) {
+            lines.push_back(text(" identical trees") | dim);
+        }
+
+        // scroll position, as the virtualized rows can't use a frame's scroll indicator
+        const std::string position =
+            shownEntries > VIEWPORT_HEIGHT
+                ? std::format(" {}-{} of {} ┆", scroll + 1, scroll + entries.size(), shownEntries)
+                : "";
+        std::string state = std::format(" {} ms", status.duration.count());
+        if (status.running) {
+            state = " diffing...";
+        } else if (status.failed) {
+            state = " failed: " + status.error;
+        }
+        lines.push_back(hbox({text(position) | dim,
+                              text(std::format(" +{}", status.added)) | color(Color::Green),
+                              text(std::format(" -{}", status.removed)) | color(Color::RedLight),
+                              text(std::format(" ~{}", status.modified)) | color(Color::Yellow),
+                              text(" ┆" + state) | dim}));
+        lines.push_back(
+            text(status.failed ? " m: mark commit as diff base ┆ r: retry"
+                               : " m: mark commit as diff base") |
+            dim);
+        return vbox(std::move(lines)) | reflect(box);
+    }
+
+    bool OnEvent(Event event) final {
+        if (event.is_mouse()) {
+            if (!box.Contain(event.mouse().x, event.mouse().y)) {
+                return false;
+            }
+            if (event.mouse().button == Mouse::WheelUp) {
+                return moveCursor(-1);
+            }
+            if (event.mouse().button == Mouse::WheelDown) {
+                return moveCursor(1);
+            }
+            return false;
+        }
+        if (!Focused()) {
+            return false;
+        }
+        if (event == Event::ArrowUp) {
+            return moveCursor(-1);
+        }
+        if (event == Event::ArrowDown) {
+            return moveCursor(1);
+        }
+        if (event == Event::PageUp) {
+            return moveCursor(-static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::PageDown) {
+            return moveCursor(static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::Home) {
+            cursor = 0;
+            return true;
+        }
+        if (event == Event::End && shownEntries > 0) {
+            cursor = shownEntries - 1;
+            return true;
+        }
+        if (event == Event::Character('r') && !shownTo.empty() &&
+            differ.GetStatus().failed) {
+            differ.Start(shownFrom, shownTo);
+            return true;
+        }
+        return false;
+    }
+
+    bool Focusable() const final { return true; }
+
+   private:
+    Element renderEntry(const cpplibostree::DiffEntry& entry, bool selected) {
+        Element line;
+        const std::string path = entry.path + (entry.dir && entry.path != "/" ? "/" : "");
+        switch (entry.kind) {
+            case cpplibostree::DiffKind::ADDED:
+                line = text(" + " + path) | color(Color::Green);
+                break;
+            case cpplibostree::DiffKind::REMOVED:
+                line = text(" - " + path) | color(Color::RedLight);
+                break;
+            case cpplibostree::DiffKind::MODIFIED:
+                line = text(" ~ " + path) | color(Color::Yellow);
+                break;
+        }
+        if (selected) {
+            line = line | (Focused() ? inverted : bold);
+        }
+        return line;
+    }
+
+    bool moveCursor(int delta) {
+        const auto rowCount = static_cast<int>(shownEntries);
+        if (rowCount == 0) {
+            return false;
+        }
+        const auto target =
+            static_cast<size_t>(std::clamp(static_cast<int>(cursor) + delta, 0, rowCount - 1));
+        // at the border -> let the container move the focus
+        if (target == cursor) {
+            return false;
+        }
+        cursor = target;
+        return true;
+    }
+
+    /// @brief Keeps the cursor inside the entries & the viewport around the cursor.
+    void clampCursor() {
+        cursor = std::min(cursor, shownEntries > 0 ? shownEntries - 1 : 0);
+        if (cursor < scroll) {
+            scroll = cursor;
+        } else if (cursor >= scroll + VIEWPORT_HEIGHT) {
+            scroll = cursor - VIEWPORT_HEIGHT + 1;
+        }
+        scroll = std::min(scroll,
+                          shownEntries > VIEWPORT_HEIGHT ? shownEntries - VIEWPORT_HEIGHT : 0);
+    }
+
+    cpplibostree::CommitDiffer& differ;
+    OSTreeTUI& ostreetui;
+    size_t cursor{0};
+    size_t scroll{0};
+    // diff rendered last
+    std::string shownFrom;
+    std::string shownTo;
+    size_t shownEntries{0};
+    Box box;
+};
+
+}  // namespace
+
+ftxui::Component DiffComponent(cpplibostree::CommitDiffer& differ, OSTreeTUI& ostreetui) {
+    return ftxui::Make<DiffComponentImpl>(differ, ostreetui);
+}
+
+}  // namespace DiffRender
@@ -0,0 +1,31 @@
+/*_____________________________________________________________
+ | Diff View
+ |   Files changed by the selected commit (Diff tab), against
+ |   its parent or the commit marked as diff base (m). The diff
+ |   runs in the background (see CommitDiffer) & is restarted,
+ |   whenever the selection moves. Entries stream in, only the
+ |   rows inside the viewport are copied & rendered.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include "ftxui/component/component_base.hpp"  // for Component
+
+#include "../util/commitdiff.hpp"
+
+class OSTreeTUI;
+
+namespace DiffRender {
+
+/**
+ * @brief Creates the virtualized view of the diff of the selected commit.
+ * Keys: arrows / Home / End / PageUp / PageDown navigate.
+ *
+ * @param differ Differ to run the diffs (has to outlive the component).
+ * @param ostreetui OSTreeTUI, holding the selected & marked commit.
+ * @return UI Component
+ */
+[[nodiscard]] ftxui::Component DiffComponent(cpplibostree::CommitDiffer& differ,
+                                             OSTreeTUI& ostreetui);
+
+}  // namespace DiffRender
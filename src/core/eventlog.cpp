@@ -0,0 +1,169 @@
+#include "eventlog.hpp"
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "ftxui/component/component.hpp"  // for CatchEvent
+#include "ftxui/component/event.hpp"      // for Event
+#include "ftxui/component/mouse.hpp"      // for Mouse
+#include "ftxui/screen/terminal.hpp"      // for Terminal::Size
+
+namespace EventLog {
+
+namespace {
+
+std::string toHex(const std::string& input) {
+    std::string hex;
+    hex.reserve(input.size() * 2);
+    for (const unsigned char c : input) {
+        hex += std::format("{:02x}", c);
+    }
+    return hex;
+}
+
+/// @return Decoded bytes, or std::nullopt if the input is no even-length hex string.
+std::optional<std::string> fromHex(const std::string& hex) {
+    if (hex.size() % 2 != 0) {
+        return std::nullopt;
+    }
+    std::string out;
+    out.reserve(hex.size() / 2);
+    for (size_t i{0}; i < hex.size(); i += 2) {
+        unsigned int byte{0};
+        const char* end = hex.data() + i + 2;
+        const auto [next, error] = std::from_chars(hex.data() + i, end, byte, 16);
+        if (error != std::errc() || next != end) {
+            return std::nullopt;
+        }
+        out += static_cast<char>(byte);
+    }
+    return out;
+}
+
+}  // namespace
+
+std::string Serialize(ftxui::Event event, int64_t milliseconds) {
+    if (event.is_cursor_position()) {
+        return "";
+    }
+    if (event.is_mouse()) {
+        const ftxui::Mouse& mouse = event.mouse();
+        return std::format("{} M {} {} {:d} {:d} {:d} {} {} {}", milliseconds,
+                           static_cast<int>(mouse.button), static_cast<int>(mouse.motion),
+                           mouse.shift, mouse.meta, mouse.control, mouse.x, mouse.y,
+                           toHex(event.input()));
+    }
+    return std::format("{} {} {}", milliseconds, event.is_character() ? "C" : "S",
+                       toHex(event.input()));
+}
+
+std::optional<ftxui::Event> Deserialize(const std::string& line) {
+    if (line.empty() || line.at(0) == '#') {
+        return std::nullopt;
+    }
+
+    std::istringstream in(line);
+    int64_t milliseconds{0};
+    std::string type;
+    if (!(in >> milliseconds >> type)) {
+        return std::nullopt;
+    }
+
+    if (type == "M") {
+        int button{0};
+        int motion{0};
+        ftxui::Mouse mouse;
+        std::string hex;
+        if (!(in >> button >> motion >> mouse.shift >> mouse.meta >> mouse.control >> mouse.x >>
+              mouse.y)) {
+            return std::nullopt;
+        }
+        in >> hex;
+        const std::optional<std::string> input = fromHex(hex);
+        if (!input) {
+            return std::nullopt;
+        }
+        mouse.button = static_cast<ftxui::Mouse::Button>(button);
+        mouse.motion = static_cast<ftxui::Mouse::Motion>(motion);
+        return ftxui::Event::Mouse(*input, mouse);
+    }
+
+    std::string hex;
+    in >> hex;
+    const std::optional<std::string> input = fromHex(hex);
+    if (!input) {
+        return std::nullopt;
+    }
+    if (type == "C") {
+        return ftxui::Event::Character(*input);
+    }
+    if (type == "S") {
+        return ftxui::Event::Special(*input);
+    }
+    return std::nullopt;
+}
+
+std::string Describe(ftxui::Event event) {
+    using ftxui::Event;
+
+    if (event.is_mouse()) {
+        constexpr std::array<const char*, 8> buttons{
+            "Left", "Middle", "Right", "None", "WheelUp", "WheelDown", "WheelLeft", "WheelRight"};
+        constexpr std::array<const char*, 3> motions{"Released", "Pressed", "Moved"};
+        const auto button = static_cast<size_t>(event.mouse().button);
+        const auto motion = static_cast<size_t>(event.mouse().motion);
+        return std::format("Mouse {} {}", button < buttons.size() ? buttons.at(button) : "?",
+                           motion < motions.size() ? motions.at(motion) : "?");
+    }
+    if (event.is_character()) {
+        return event.input() == " " ? "Space" : "Character";
+    }
+
+    const std::vector<std::pair<Event, std::string>> specials{
+        {Event::ArrowUp, "ArrowUp"},     {Event::ArrowDown, "ArrowDown"},
+        {Event::ArrowLeft, "ArrowLeft"}, {Event::ArrowRight, "ArrowRight"},
+        {Event::Return, "Return"},       {Event::Escape, "Escape"},
+        {Event::Tab, "Tab"},             {Event::TabReverse, "TabReverse"},
+        {Event::Backspace, "Backspace"}, {Event::PageUp, "PageUp"},
+        {Event::PageDown, "PageDown"},   {Event::Home, "Home"},
+        {Event::End, "End"},             {Event::AltP, "Alt+P"},
+        {Event::AltD, "Alt+D"},          {Event::AltC, "Alt+C"},
+        {Event::AltR, "Alt+R"},          {Event::AltQ, "Alt+Q"},
+        {Event::Custom, "Custom"},
+    };
+    for (const auto& [special, name] : specials) {
+        if (event == special) {
+            return name;
+        }
+    }
+    return "Special";
+}
+
+ftxui::Component Record(ftxui::Component component, std::ostream& out) {
+    const auto dimensions = ftxui::Terminal::Size();
+    out << HEADER << " " << dimensions.dimx << " " << dimensions.dimy << "\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    return ftxui::CatchEvent(std::move(component), [&out, start](const ftxui::Event& event) {
+        const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count();
+        const std::string line = Serialize(event, milliseconds);
+        if (!line.empty()) {
+            out << line << "\n";
+            out.flush();
+        }
+        return false;
+    });
+}
+
+}  // namespace EventLog
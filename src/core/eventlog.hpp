@@ -0,0 +1,61 @@
+/*_____________________________________________________________
+ | Event Log
+ |   Records the ftxui::Event stream sent to the main container
+ |   into a plain text file, to be replayed headless by the
+ |   ostree-tui-replay runner (see bench/replay.cpp).
+ |   Format, one event per line:
+ |     # ostree-tui event log v1 <width> <height>
+ |     <ms> C <hex input>                            character
+ |     <ms> S <hex input>                            special key
+ |     <ms> M <button> <motion> <shift> <meta> <ctrl> <x> <y> <hex input>
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "ftxui/component/component.hpp"  // for Component
+#include "ftxui/component/event.hpp"      // for Event
+
+namespace EventLog {
+
+constexpr std::string_view HEADER{"# ostree-tui event log v1"};
+
+/**
+ * @brief Serializes an event into one event log line (without newline).
+ *
+ * @param event Event to serialize.
+ * @param milliseconds Time since the start of the recording.
+ * @return Serialized event, empty if the event is internal to ftxui & not recorded.
+ */
+[[nodiscard]] std::string Serialize(ftxui::Event event, int64_t milliseconds);
+
+/**
+ * @brief Parses one event log line.
+ *
+ * @param line Line, as written by Serialize().
+ * @return Event, or std::nullopt for comments & malformed lines.
+ */
+[[nodiscard]] std::optional<ftxui::Event> Deserialize(const std::string& line);
+
+/**
+ * @brief Short, human readable name of an event, to group replay statistics by
+ * (e.g. "ArrowDown", "Character", "Mouse Left Moved").
+ */
+[[nodiscard]] std::string Describe(ftxui::Event event);
+
+/**
+ * @brief Wraps a component, writing every event it receives to the output stream,
+ * before passing the event on.
+ *
+ * @param component Component to record the events of.
+ * @param out Stream to write the event log to. Has to outlive the component.
+ * @return Recording component.
+ */
+[[nodiscard]] ftxui::Component Record(ftxui::Component component, std::ostream& out);
+
+}  // namespace EventLog
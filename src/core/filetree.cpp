@@ -0,0 +1,486 @@
+#include "filetree.hpp"
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <ftxui/component/component_base.hpp>  // for Component, ComponentBase
+#include <ftxui/component/event.hpp>           // for Event
+#include "ftxui/component/component.hpp"       // for Make
+#include "ftxui/component/mouse.hpp"           // for Mouse
+#include "ftxui/dom/elements.hpp"  // for operator|, Element, text, hbox, vbox, reflect, inverted
+#include "ftxui/screen/box.hpp"    // for Box
+#include "ftxui/screen/color.hpp"  // for Color
+
+#include "../util/diskusage.hpp"
+#include "../util/filecontent.hpp"
+#include "../util/objectwalk.hpp"
+#include "../util/profiler.hpp"
+#include "../util/treereader.hpp"
+
+#include "fileviewer.hpp"
+#include "ostreetui.hpp"
+
+namespace {
+
+/// @return Entry of a row, (say) for files & (sayay) for directories, see
+/// OSTREE_TREE_GVARIANT_FORMAT.
+GVariant* entryVariant(const FileTree::Row& row) {
+    g_autoptr(GVariant) entries = g_variant_get_child_value(row.dirtree.get(), row.dir ? 1 : 0);
+    return g_variant_get_child_value(entries, row.index);
+}
+
+/// @return Mode like `ls -l`, e.g. drwxr-xr-x.
+std::string formatMode(uint32_t mode) {
+    std::string str = "----------";
+    if (S_ISDIR(mode)) {
+        str[0] = 'd';
+    } else if (S_ISLNK(mode)) {
+        str[0] = 'l';
+    }
+    constexpr std::string_view PERMISSIONS{"rwxrwxrwx"};
+    for (size_t bit{0}; bit < PERMISSIONS.size(); bit++) {
+        if ((mode & (1U << (8 - bit))) != 0) {
+            str[bit + 1] = PERMISSIONS[bit];
+        }
+    }
+    return str;
+}
+
+}  // namespace
+
+// FileTree
+
+FileTree::FileTree(cpplibostree::TreeReader& reader) : reader(reader) {}
+
+bool FileTree::SetCommit(const std::string& hash) {
+    if (hash == commit) {
+        return !failed;
+    }
+    OSTREE_TUI_PROFILE_SCOPE("FileTree::SetCommit");
+    commit = hash;
+    rows.clear();
+    fileInfo.reset();
+
+    const auto root = reader.GetRoot(commit);
+    const auto rootTree = root ? reader.GetDirtree(root->dirtree) : nullptr;
+    failed = !rootTree;
+    if (failed) {
+        return false;
+    }
+    rows = entries(rootTree, 0);
+
+    // re-expand in pre-order, the children of a directory are inserted right behind it
+    std::vector<std::string> parentPaths;  // depth -> path of the expanded parent
+    for (size_t row{0}; row < rows.size(); row++) {
+        parentPaths.resize(rows[row].depth);
+        if (!rows[row].dir) {
+            continue;
+        }
+        std::string path = (parentPaths.empty() ? "" : parentPaths.back()) + "/";
+        path += GetName(row);
+        if (expandedPaths.contains(path) && expand(row)) {
+            parentPaths.push_back(std::move(path));
+        }
+    }
+    return true;
+}
+
+void FileTree::SetExpanded(size_t row, bool expanded) {
+    if (row >= rows.size() || !rows[row].dir || rows[row].expanded == expanded) {
+        return;
+    }
+    if (expanded) {
+        if (expand(row)) {
+            expandedPaths.insert(GetPath(row));
+        }
+        return;
+    }
+    // remove all descendants
+    auto last = std::find_if(rows.begin() + static_cast<std::ptrdiff_t>(row) + 1, rows.end(),
+                             [&](const Row& other) { return other.depth <= rows[row].depth; });
+    rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(row) + 1, last);
+    rows[row].expanded = false;
+    expandedPaths.erase(GetPath(row));
+}
+
+std::string_view FileTree::GetName(size_t row) const {
+    g_autoptr(GVariant) entry = entryVariant(rows.at(row));
+    // points into the serialized dirtree, which is kept alive by the row
+    const char* name{nullptr};
+    g_variant_get_child(entry, 0, "&s", &name);
+    return name;
+}
+
+std::string FileTree::GetPath(size_t row) const {
+    std::vector<std::string_view> names{GetName(row)};
+    uint16_t depth = rows.at(row).depth;
+    for (size_t parent{row}; parent > 0 && depth > 0; parent--) {
+        if (rows[parent - 1].depth < depth) {
+            depth = rows[parent - 1].depth;
+            names.push_back(GetName(parent - 1));
+        }
+    }
+    std::string path;
+    for (auto name = names.rbegin(); name != names.rend(); name++) {
+        path += "/";
+        path += *name;
+    }
+    return path;
+}
+
+cpplibostree::ObjectId FileTree::GetChecksum(size_t row) const {
+    g_autoptr(GVariant) entry = entryVariant(rows.at(row));
+    g_autoptr(GVariant) checksum = g_variant_get_child_value(entry, 1);
+    cpplibostree::ObjectId id{};
+    cpplibostree::ReadObjectId(checksum, id);
+    return id;
+}
+
+std::unique_ptr<cpplibostree::FileContent> FileTree::OpenContent(size_t row) {
+    return rows.at(row).dir ? nullptr : reader.OpenContent(GetChecksum(row));
+}
+
+std::optional<cpplibostree::TreeEntryInfo> FileTree::GetInfo(size_t row) {
+    g_autoptr(GVariant) entry = entryVariant(rows.at(row));
+    if (rows[row].dir) {
+        g_autoptr(GVariant) metaChecksum = g_variant_get_child_value(entry, 2);
+        cpplibostree::ObjectId meta{};
+        if (!cpplibostree::ReadObjectId(metaChecksum, meta)) {
+            return std::nullopt;
+        }
+        return reader.GetDirmeta(meta);
+    }
+    const auto id = GetChecksum(row);
+    if (!fileInfo || fileInfo->first != id) {
+        fileInfo.emplace(id, reader.GetFileInfo(id));
+    }
+    return fileInfo->second;
+}
+
+const std::string& FileTree::GetCommit() const {
+    return commit;
+}
+
+const std::vector<FileTree::Row>& FileTree::GetRows() const {
+    return rows;
+}
+
+std::vector<FileTree::Row> FileTree::entries(const std::shared_ptr<GVariant>& dirtree,
+                                             uint16_t depth) {
+    g_autoptr(GVariant) files = g_variant_get_child_value(dirtree.get(), 0);
+    g_autoptr(GVariant) dirs = g_variant_get_child_value(dirtree.get(), 1);
+    const auto fileCount = static_cast<uint32_t>(g_variant_n_children(files));
+    const auto dirCount = static_cast<uint32_t>(g_variant_n_children(dirs));
+
+    std::vector<Row> children;
+    children.reserve(dirCount + fileCount);
+    for (uint32_t i{0}; i < dirCount; i++) {
+        children.push_back({dirtree, i, depth, true});
+    }
+    for (uint32_t i{0}; i < fileCount; i++) {
+        children.push_back({dirtree, i, depth, false});
+    }
+    return children;
+}
+
+bool FileTree::expand(size_t row) {
+    OSTREE_TUI_PROFILE_SCOPE("FileTree::expand");
+    const auto dirtree = reader.GetDirtree(GetChecksum(row));
+    if (!dirtree) {
+        return false;
+    }
+    auto children = entries(dirtree, rows[row].depth + 1);
+    rows[row].expanded = true;
+    rows.insert(rows.begin() + static_cast<std::ptrdiff_t>(row) + 1,
+                std::make_move_iterator(children.begin()), std::make_move_iterator(children.end()));
+    return true;
+}
+
+// FileTreeRender
+
+namespace FileTreeRender {
+
+namespace {
+using namespace ftxui;
+
+/// rows rendered at once, the tree only renders the rows inside this viewport
+constexpr size_t VIEWPORT_HEIGHT{20};
+/// columns of the expand arrow of each row
+constexpr int ARROW_WIDTH{2};
+
+class FileTreeComponentImpl : public ComponentBase {
+   public:
+    FileTreeComponentImpl(FileTree& tree, OSTreeTUI& ostreetui)
+        : tree(tree), ostreetui(ostreetui) {}
+
+    Element Render() final {
+        OSTREE_TUI_PROFILE_SCOPE("FileTreeRender");
+        const auto& viewMap = ostreetui.GetVisibleCommitViewMap();
+        if (viewMap.empty()) {
+            return text(" no commit selected ") | color(Color::RedLight) | reflect(box);
+        }
+        const std::string& hash =
+            viewMap.at(std::min(ostreetui.GetSelectedCommit(), viewMap.size() - 1));
+        if (!tree.SetCommit(hash)) {
+            return text(" could not read the file tree of " + hash.substr(0, 8) + " ") |
+                   color(Color::RedLight) | reflect(box);
+        }
+        // the opened file belongs to the previously selected commit
+        if (viewer && viewerCommit != hash) {
+            viewer.reset();
+        }
+        if (viewer) {
+            return viewer->Render(Focused()) | reflect(box);
+        }
+        const auto& rows = tree.GetRows();
+        if (rows.empty()) {
+            return text(" empty file tree ") | dim | reflect(box);
+        }
+        clampCursor();
+
+        Elements lines{text(" " + hash.substr(0, 8) + ":/") | bold};
+        const size_t last = std::min(rows.size(), scroll + VIEWPORT_HEIGHT);
+        for (size_t row{scroll}; row < last; row++) {
+            lines.push_back(renderRow(row));
+        }
+        // scroll position, as the virtualized rows can't use a frame's scroll indicator
+        const std::string position =
+            rows.size() > VIEWPORT_HEIGHT
+                ? std::format(" {}-{} of {} rows ", scroll + 1, last, rows.size())
+                : "";
+        lines.push_back(text(position) | dim);
+        lines.push_back(renderDetails());
+        lines.push_back(text(" ⏎ open ┆ ←/→ collapse/expand") | dim);
+        return vbox(std::move(lines)) | reflect(box);
+    }
+
+    bool OnEvent(Event event) final {
+        if (viewer) {
+            return onViewerEvent(event);
+        }
+        if (event.is_mouse()) {
+            return onMouseEvent(event);
+        }
+        if (!Focused()) {
+            return false;
+        }
+        const auto& rows = tree.GetRows();
+        if (rows.empty()) {
+            return false;
+        }
+
+        // navigation
+        if (event == Event::ArrowUp) {
+            return moveCursor(-1);
+        }
+        if (event == Event::ArrowDown) {
+            return moveCursor(1);
+        }
+        if (event == Event::PageUp) {
+            return moveCursor(-static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::PageDown) {
+            return moveCursor(static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::Home) {
+            cursor = 0;
+            return true;
+        }
+        if (event == Event::End) {
+            cursor = rows.size() - 1;
+            return true;
+        }
+        clampCursor();
+
+        // expand & collapse
+        const FileTree::Row& row = rows.at(cursor);
+        if (event == Event::ArrowRight && row.dir) {
+            if (!row.expanded) {
+                tree.SetExpanded(cursor, true);
+            } else {
+                moveCursor(1);
+            }
+            return true;
+        }
+        if (event == Event::ArrowLeft) {
+            if (row.dir && row.expanded) {
+                tree.SetExpanded(cursor, false);
+                return true;
+            }
+            // jump to the parent directory
+            for (size_t other{cursor}; other > 0; other--) {
+                if (rows.at(other - 1).depth < row.depth) {
+                    cursor = other - 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (event == Event::Return && row.dir) {
+            tree.SetExpanded(cursor, !row.expanded);
+            return true;
+        }
+        if (event == Event::Return) {
+            openViewer();
+            return true;
+        }
+        return false;
+    }
+
+    bool Focusable() const final { return true; }
+
+   private:
+    Element renderRow(size_t rowIndex) {
+        const FileTree::Row& row = tree.GetRows().at(rowIndex);
+        const std::string indent(static_cast<size_t>(row.depth) * 2, ' ');
+        std::string arrow = "  ";
+        if (row.dir) {
+            arrow = row.expanded ? "▾ " : "▸ ";
+        }
+        Element name = text(std::string(tree.GetName(rowIndex)) + (row.dir ? "/" : ""));
+        if (row.dir) {
+            name |= bold;
+        }
+        const std::string checksum =
+            cpplibostree::ToChecksum(tree.GetChecksum(rowIndex)).substr(0, 8);
+
+        Element line =
+            hbox({text(indent), text(arrow), name, filler(), text(" " + checksum + " ") | dim});
+        if (rowIndex == cursor) {
+            line = line | (Focused() ? inverted : bold);
+        }
+        return line;
+    }
+
+    /// @return Path & details of the entry under the cursor.
+    Element renderDetails() {
+        const FileTree::Row& row = tree.GetRows().at(cursor);
+        const auto info = tree.GetInfo(cursor);
+        std::string details = " (could not be read)";
+        if (info) {
+            details = std::format(" {} {}:{}", formatMode(info->mode), info->uid, info->gid);
+            if (!row.dir) {
+                details += " " + cpplibostree::FormatBytes(info->size);
+            }
+            if (!info->symlinkTarget.empty()) {
+                details += " → " + info->symlinkTarget;
+            }
+        }
+        return vbox({text(" " + tree.GetPath(cursor)) | bold, text(details) | dim});
+    }
+
+    /// @brief Opens the file under the cursor in the viewer.
+    void openViewer() {
+        const std::string path = tree.GetPath(cursor);
+        auto content = tree.OpenContent(cursor);
+        if (!content) {
+            ostreetui.SetNotificationText(" Could not open " + path + " ");
+            return;
+        }
+        viewer = std::make_unique<FileViewer>(ostreetui, std::move(content),
+                                              tree.GetChecksum(cursor), path);
+        viewerCommit = tree.GetCommit();
+    }
+
+    bool onViewerEvent(Event& event) {
+        if (event.is_mouse()) {
+            return box.Contain(event.mouse().x, event.mouse().y) && viewer->OnEvent(event);
+        }
+        if (!Focused()) {
+            return false;
+        }
+        if (viewer->OnEvent(event)) {
+            return true;
+        }
+        if (event == Event::Escape || event == Event::ArrowLeft) {
+            viewer.reset();
+            return true;
+        }
+        return false;
+    }
+
+    bool onMouseEvent(Event& event) {
+        if (!box.Contain(event.mouse().x, event.mouse().y)) {
+            return false;
+        }
+        if (event.mouse().button == Mouse::WheelUp) {
+            return moveCursor(-1);
+        }
+        if (event.mouse().button == Mouse::WheelDown) {
+            return moveCursor(1);
+        }
+        if (event.mouse().button != Mouse::Left || event.mouse().motion != Mouse::Pressed) {
+            return false;
+        }
+        // first line is the commit header
+        const int line = event.mouse().y - box.y_min - 1;
+        const size_t rowIndex = scroll + static_cast<size_t>(line);
+        if (line < 0 || static_cast<size_t>(line) >= VIEWPORT_HEIGHT ||
+            rowIndex >= tree.GetRows().size()) {
+            return false;
+        }
+        TakeFocus();
+        cursor = rowIndex;
+
+        // clicks on the arrow expand
+        const FileTree::Row& row = tree.GetRows().at(rowIndex);
+        const int column = event.mouse().x - box.x_min - static_cast<int>(row.depth) * 2;
+        if (column >= 0 && column < ARROW_WIDTH && row.dir) {
+            tree.SetExpanded(rowIndex, !row.expanded);
+        }
+        return true;
+    }
+
+    bool moveCursor(int delta) {
+        const auto rowCount = static_cast<int>(tree.GetRows().size());
+        if (rowCount == 0) {
+            return false;
+        }
+        const auto target =
+            static_cast<size_t>(std::clamp(static_cast<int>(cursor) + delta, 0, rowCount - 1));
+        // at the border -> let the container move the focus
+        if (target == cursor) {
+            return false;
+        }
+        cursor = target;
+        return true;
+    }
+
+    /// @brief Keeps the cursor inside the rows & the viewport around the cursor.
+    void clampCursor() {
+        const size_t rowCount = tree.GetRows().size();
+        cursor = std::min(cursor, rowCount - 1);
+        if (cursor < scroll) {
+            scroll = cursor;
+        } else if (cursor >= scroll + VIEWPORT_HEIGHT) {
+            scroll = cursor - VIEWPORT_HEIGHT + 1;
+        }
+        scroll = std::min(scroll, rowCount > VIEWPORT_HEIGHT ? rowCount - VIEWPORT_HEIGHT : 0);
+    }
+
+    FileTree& tree;
+    OSTreeTUI& ostreetui;
+    size_t cursor{0};
+    size_t scroll{0};
+    Box box;
+    std::unique_ptr<FileViewer> viewer;
+    std::string viewerCommit;
+};
+
+}  // namespace
+
+ftxui::Component FileTreeComponent(FileTree& tree, OSTreeTUI& ostreetui) {
+    return ftxui::Make<FileTreeComponentImpl>(tree, ostreetui);
+}
+
+}  // namespace FileTreeRender
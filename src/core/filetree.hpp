@@ -0,0 +1,109 @@
+/*_____________________________________________________________
+ | File Tree
+ |   Browser for the file tree of the selected commit (Files
+ |   tab), without checking it out:
+ |   - directories are only read, once they are expanded (the
+ |     dirtrees come from the TreeReader's LRU, so subtrees
+ |     shared between commits are not read again)
+ |   - rows only reference their entry inside the decoded
+ |     dirtree, names & checksums are read when rendered
+ |   - only the rows inside the viewport are rendered
+ |   Files open in a FileViewer, in place of the tree.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ftxui/component/component_base.hpp"  // for Component
+
+#include "../util/filecontent.hpp"
+#include "../util/objectwalk.hpp"
+#include "../util/treereader.hpp"
+
+class OSTreeTUI;
+
+class FileTree {
+   public:
+    struct Row {
+        std::shared_ptr<GVariant> dirtree;  // directory containing the entry
+        uint32_t index{0};                  // index in the files, or dirs of the dirtree
+        uint16_t depth{0};
+        bool dir{false};
+        bool expanded{false};
+    };
+
+    explicit FileTree(cpplibostree::TreeReader& reader);
+
+    /**
+     * @brief Shows the file tree of a commit. Directories expanded before stay expanded (by
+     * path), as far as they exist in the commit.
+     *
+     * @param commit Commit checksum.
+     * @return false, if the root directory of the commit could not be loaded.
+     */
+    bool SetCommit(const std::string& commit);
+
+    /// @brief Expands (reads) or collapses the directory at row.
+    void SetExpanded(size_t row, bool expanded);
+
+    /// @return Name of the entry, valid as long as the row exists.
+    [[nodiscard]] std::string_view GetName(size_t row) const;
+
+    /// @return Absolute path of the entry.
+    [[nodiscard]] std::string GetPath(size_t row) const;
+
+    /// @return Checksum of the file object, or of the dirtree of a directory.
+    [[nodiscard]] cpplibostree::ObjectId GetChecksum(size_t row) const;
+
+    /// @return Windowed access to the content of the file at row, nullptr if it can't be opened.
+    [[nodiscard]] std::unique_ptr<cpplibostree::FileContent> OpenContent(size_t row);
+
+    /// @return Ownership & mode (& size of files) of the entry, nullopt if it can't be read.
+    [[nodiscard]] std::optional<cpplibostree::TreeEntryInfo> GetInfo(size_t row);
+
+    // GETTER
+    [[nodiscard]] const std::string& GetCommit() const;
+    /// @return Displayed rows (entries of the root & all expanded directories, pre-order).
+    [[nodiscard]] const std::vector<Row>& GetRows() const;
+
+   private:
+    /// @return Rows of all entries of a dirtree, directories first.
+    [[nodiscard]] static std::vector<Row> entries(const std::shared_ptr<GVariant>& dirtree,
+                                                  uint16_t depth);
+
+    /// @return false, if the dirtree of the directory could not be read.
+    bool expand(size_t row);
+
+    cpplibostree::TreeReader& reader;
+    std::string commit;
+    bool failed{false};
+    std::vector<Row> rows;
+    std::unordered_set<std::string> expandedPaths;
+    // last file info, the selected row is rendered every frame
+    std::optional<std::pair<cpplibostree::ObjectId, std::optional<cpplibostree::TreeEntryInfo>>>
+        fileInfo;
+};
+
+namespace FileTreeRender {
+
+/**
+ * @brief Creates the virtualized, navigable view of a FileTree, showing the selected commit.
+ * Keys: arrows / Home / End / PageUp / PageDown navigate, Enter & ←/→ collapse and expand,
+ * Enter opens files (Escape / ← closes them again).
+ *
+ * @param tree Tree to display (has to outlive the component).
+ * @param ostreetui OSTreeTUI, holding the selected commit.
+ * @return UI Component
+ */
+[[nodiscard]] ftxui::Component FileTreeComponent(FileTree& tree, OSTreeTUI& ostreetui);
+
+}  // namespace FileTreeRender
@@ -0,0 +1,510 @@
+#include "fileviewer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <ftxui/component/event.hpp>  // for Event
+#include "ftxui/component/mouse.hpp"  // for Mouse
+#include "ftxui/dom/elements.hpp"     // for operator|, Element, text, hbox, vbox, inverted
+#include "ftxui/screen/color.hpp"     // for Color
+
+#include "../util/diskusage.hpp"
+#include "../util/filecontent.hpp"
+#include "../util/jobqueue.hpp"
+#include "../util/profiler.hpp"
+
+#include "ostreetui.hpp"
+
+namespace {
+using namespace ftxui;
+
+/// lines rendered at once, only these are read
+constexpr size_t VIEWPORT_HEIGHT{20};
+/// bytes per row in the hex view
+constexpr uint64_t HEX_ROW{16};
+/// lines without a line break are split after this many bytes
+constexpr uint64_t MAX_LINE{64 * 1024};
+/// bytes of a line, that are displayed
+constexpr uint64_t DISPLAY_WIDTH{512};
+/// content with a zero byte in its first bytes opens in the hex view
+constexpr size_t BINARY_PROBE{8 * 1024};
+/// lines shown above a search hit
+constexpr int HIT_CONTEXT{3};
+/// lines scrolled per mouse wheel step
+constexpr int WHEEL_LINES{3};
+
+/// @return Displayable text of raw bytes (control characters replaced, tabs expanded).
+std::string printable(std::string_view raw) {
+    std::string str;
+    str.reserve(raw.size());
+    for (const char c : raw) {
+        if (c == '\t') {
+            str += "    ";
+        } else if (c == '\n' || c == '\r') {
+            continue;
+        } else if ((c >= 0 && c < 0x20) || c == 0x7f) {
+            str += '.';
+        } else {
+            str += c;
+        }
+    }
+    return str;
+}
+
+/// @return Line, the part of a search hit in it highlighted.
+Element renderLine(std::string_view raw,
+                   uint64_t offset,
+                   std::optional<uint64_t> hit,
+                   size_t hitLength) {
+    if (!hit || *hit + hitLength <= offset || *hit >= offset + raw.size()) {
+        return text(printable(raw));
+    }
+    const size_t begin = *hit > offset ? *hit - offset : 0;
+    const size_t end = std::min<size_t>(raw.size(), *hit + hitLength - offset);
+    return hbox({text(printable(raw.substr(0, begin))),
+                 text(printable(raw.substr(begin, end - begin))) | inverted |
+                     color(Color::Yellow),
+                 text(printable(raw.substr(end)))});
+}
+
+/// @return Start of the line after the one starting at offset.
+uint64_t nextLine(cpplibostree::FileContent& content, uint64_t offset) {
+    if (offset >= content.GetSize()) {
+        return content.GetSize();
+    }
+    const std::string_view line = content.Read(offset, MAX_LINE);
+    const size_t newline = line.find('\n');
+    return offset + (newline == std::string_view::npos ? line.size() : newline + 1);
+}
+
+/// @return Start of the line containing offset.
+uint64_t lineStart(cpplibostree::FileContent& content, uint64_t offset) {
+    const uint64_t from = offset > MAX_LINE ? offset - MAX_LINE : 0;
+    const std::string_view before = content.Read(from, offset - from);
+    const size_t newline = before.rfind('\n');
+    return newline == std::string_view::npos ? from : from + newline + 1;
+}
+
+/// @return Start of the line before the one starting at offset.
+uint64_t previousLine(cpplibostree::FileContent& content, uint64_t offset) {
+    // the byte before the offset ends the previous line
+    return offset == 0 ? 0 : lineStart(content, offset - 1);
+}
+
+}  // namespace
+
+FileViewer::FileViewer(OSTreeTUI& ostreetui,
+                       std::unique_ptr<cpplibostree::FileContent> content,
+                       const cpplibostree::ObjectId& file,
+                       std::string path)
+    : ostreetui(ostreetui),
+      content(std::move(content)),
+      file(file),
+      path(std::move(path)),
+      size(this->content->GetSize()),
+      mapped(this->content->IsMapped()) {
+    hex = this->content->Read(0, BINARY_PROBE).find('\0') != std::string_view::npos;
+}
+
+FileViewer::~FileViewer() {
+    const std::lock_guard<std::mutex> lock(search->mutex);
+    if (search->cancellable) {
+        g_cancellable_cancel(search->cancellable.get());
+    }
+}
+
+Element FileViewer::Render(bool focused) {
+    OSTREE_TUI_PROFILE_SCOPE("FileViewer::Render");
+    pollSeek();
+    pollSearch();
+
+    // the viewport is only rendered from buffered content, anything else is read by a job
+    Element view;
+    if (content) {
+        content->SetBufferedOnly(true);
+        view = hex ? renderHex() : renderText();
+        content->SetBufferedOnly(false);
+        if (content->TakeMiss()) {
+            startSeek([top = top](cpplibostree::FileContent& /*source*/) { return top; });
+        }
+    }
+    if (!content) {
+        view = text(" seeking…") | dim;
+    }
+
+    const uint64_t percent = size == 0 ? 100 : top * 100 / size;
+    Elements lines{text(" " + path) | bold, view,
+                   text(std::format(" {} ┆ {} / {} ({}%) ┆ {}", hex ? "hex" : "text", top,
+                                    cpplibostree::FormatBytes(size), percent,
+                                    mapped ? "mapped" : "streamed")) |
+                       dim};
+    if (searchActive) {
+        lines.push_back(text(" /" + query) | bold);
+    } else if (!searchStatus.empty()) {
+        lines.push_back(text(searchStatus) | color(Color::Yellow));
+    }
+    if (focused) {
+        lines.push_back(
+            text(" PgUp/PgDn Home/End ┆ x: hex/text ┆ /: search ┆ n: next ┆ Esc: close") | dim);
+    }
+    return vbox(std::move(lines));
+}
+
+bool FileViewer::OnEvent(const Event& event) {
+    if (searchActive) {
+        return handleSearchInput(event);
+    }
+    if (event.is_mouse()) {
+        if (event.mouse().button == Mouse::WheelUp) {
+            return scroll(-WHEEL_LINES);
+        }
+        if (event.mouse().button == Mouse::WheelDown) {
+            return scroll(WHEEL_LINES);
+        }
+        return false;
+    }
+
+    // navigation
+    if (event == Event::ArrowUp) {
+        return scroll(-1);
+    }
+    if (event == Event::ArrowDown) {
+        return scroll(1);
+    }
+    if (event == Event::PageUp) {
+        return scroll(-static_cast<int>(VIEWPORT_HEIGHT));
+    }
+    if (event == Event::PageDown) {
+        return scroll(static_cast<int>(VIEWPORT_HEIGHT));
+    }
+    if (event == Event::Home) {
+        top = 0;
+        return true;
+    }
+    if (event == Event::End) {
+        scrollToEnd();
+        return true;
+    }
+
+    // view & search
+    if (event == Event::Character('x')) {
+        if (!content) {
+            return true;
+        }
+        hex = !hex;
+        if (hex) {
+            top = top / HEX_ROW * HEX_ROW;
+        } else {
+            navigate([top = top](cpplibostree::FileContent& source) {
+                return lineStart(source, top);
+            });
+        }
+        return true;
+    }
+    if (event == Event::Character('/')) {
+        searchActive = true;
+        query.clear();
+        return true;
+    }
+    if (event == Event::Character('n') && !query.empty()) {
+        startSearch(hit ? *hit + 1 : top);
+        return true;
+    }
+    return false;
+}
+
+bool FileViewer::navigate(const Navigation& target) {
+    if (!content) {
+        // a seek is running, its result moves the viewport
+        return true;
+    }
+    content->SetBufferedOnly(true);
+    const uint64_t offset = target(*content);
+    content->SetBufferedOnly(false);
+    if (content->TakeMiss()) {
+        startSeek(target);
+        return true;
+    }
+    if (offset == top) {
+        return false;
+    }
+    top = offset;
+    return true;
+}
+
+void FileViewer::startSeek(Navigation target) {
+    seek = std::make_shared<Seek>();
+    seek->content = std::move(content);
+
+    auto& screen = ostreetui.GetScreen();
+    ostreetui.GetJobQueue().Submit(
+        "seek " + path,
+        [seek = seek, target = std::move(target)](OstreeRepo* /*repo*/,
+                                                  GCancellable* /*cancellable*/,
+                                                  GError** /*error*/) {
+            const uint64_t offset = target(*seek->content);
+            // decompress the viewport too, so rendering it does not miss again
+            (void)seek->content->Read(offset, cpplibostree::FileContent::WINDOW_SIZE);
+            const std::lock_guard<std::mutex> lock(seek->mutex);
+            seek->top = offset;
+            return true;
+        },
+        // also if the job was dropped: the content returns to the viewer
+        [seek = seek, &screen](bool /*success*/) {
+            {
+                const std::lock_guard<std::mutex> lock(seek->mutex);
+                seek->done = true;
+            }
+            screen.Post(Event::Custom);
+        });
+}
+
+void FileViewer::pollSeek() {
+    if (!seek) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(seek->mutex);
+        if (!seek->done) {
+            return;
+        }
+        content = std::move(seek->content);
+        top = seek->top.value_or(top);
+    }
+    seek.reset();
+}
+
+bool FileViewer::scroll(int lines) {
+    if (hex) {
+        const uint64_t lastRow = size == 0 ? 0 : (size - 1) / HEX_ROW * HEX_ROW;
+        const auto delta = static_cast<int64_t>(lines) * static_cast<int64_t>(HEX_ROW);
+        const uint64_t target = delta < 0 ? top - std::min<uint64_t>(top, -delta)
+                                          : std::min<uint64_t>(lastRow, top + delta);
+        // at the border -> let the container move the focus
+        if (target == top) {
+            return false;
+        }
+        top = target;
+        return true;
+    }
+    return navigate([top = top, lines](cpplibostree::FileContent& source) mutable {
+        const uint64_t size = source.GetSize();
+        uint64_t target{top};
+        for (; lines > 0; lines--) {
+            const uint64_t next = nextLine(source, target);
+            if (next >= size) {
+                break;
+            }
+            target = next;
+        }
+        for (; lines < 0 && target > 0; lines++) {
+            target = previousLine(source, target);
+        }
+        return target;
+    });
+}
+
+void FileViewer::scrollToEnd() {
+    if (hex) {
+        const uint64_t lastRow = size == 0 ? 0 : (size - 1) / HEX_ROW * HEX_ROW;
+        top = lastRow - std::min(lastRow, (VIEWPORT_HEIGHT - 1) * HEX_ROW);
+        return;
+    }
+    navigate([](cpplibostree::FileContent& source) {
+        const uint64_t size = source.GetSize();
+        // a trailing line break does not start another line
+        const std::string_view last = source.Read(size > 0 ? size - 1 : 0, 1);
+        uint64_t target = lineStart(source, last == "\n" ? size - 1 : size);
+        for (size_t line{1}; line < VIEWPORT_HEIGHT && target > 0; line++) {
+            target = previousLine(source, target);
+        }
+        return target;
+    });
+}
+
+void FileViewer::showHit(uint64_t offset) {
+    if (hex) {
+        top = offset / HEX_ROW * HEX_ROW;
+        return;
+    }
+    navigate([offset](cpplibostree::FileContent& source) {
+        uint64_t target = lineStart(source, offset);
+        for (int line{0}; line < HIT_CONTEXT && target > 0; line++) {
+            target = previousLine(source, target);
+        }
+        return target;
+    });
+}
+
+void FileViewer::startSearch(uint64_t from) {
+    uint64_t generation{0};
+    std::shared_ptr<GCancellable> cancellable(g_cancellable_new(), g_object_unref);
+    {
+        const std::lock_guard<std::mutex> lock(search->mutex);
+        // a new search stops the previous one
+        if (search->cancellable) {
+            g_cancellable_cancel(search->cancellable.get());
+        }
+        search->cancellable = cancellable;
+        generation = ++search->generation;
+        search->running = true;
+        search->hit.reset();
+        search->error.clear();
+    }
+    hitLength = query.size();
+    searchStatus = " searching \"" + query + "\"...";
+
+    auto& screen = ostreetui.GetScreen();
+    ostreetui.GetJobQueue().Submit(
+        "search " + path,
+        [search = search, generation, cancellable, file = file, needle = query, from](
+            OstreeRepo* repo, GCancellable* jobCancellable, GError** error) {
+            // own handle of the content, the viewer keeps reading its own
+            auto searchContent = cpplibostree::FileContent::Open(repo, file, error);
+            if (!searchContent) {
+                return false;
+            }
+            // stops if the job is cancelled, or the viewer starts another search / closes
+            const gulong handler = g_cancellable_connect(
+                jobCancellable, G_CALLBACK(+[](GCancellable*, gpointer other) {
+                    g_cancellable_cancel(static_cast<GCancellable*>(other));
+                }),
+                cancellable.get(), nullptr);
+            // from the position to the end, then wrap around
+            auto found = searchContent->Find(needle, from, searchContent->GetSize(),
+                                             cancellable.get());
+            if (!found && from > 0) {
+                found = searchContent->Find(needle, 0, from, cancellable.get());
+            }
+            g_cancellable_disconnect(jobCancellable, handler);
+            if (g_cancellable_set_error_if_cancelled(cancellable.get(), error)) {
+                return false;
+            }
+            const std::lock_guard<std::mutex> lock(search->mutex);
+            search->hit = found;
+            return true;
+        },
+        [search = search, generation, &screen](bool success) {
+            {
+                const std::lock_guard<std::mutex> lock(search->mutex);
+                if (search->generation != generation) {
+                    return;
+                }
+                search->running = false;
+                if (!success) {
+                    search->error = "search failed, or was cancelled";
+                }
+            }
+            screen.Post(Event::Custom);
+        },
+        cpplibostree::LockMode::SHARED);
+}
+
+bool FileViewer::handleSearchInput(const Event& event) {
+    if (event.is_mouse()) {
+        return false;
+    }
+    if (event == Event::Escape) {
+        searchActive = false;
+        return true;
+    }
+    if (event == Event::Return) {
+        searchActive = false;
+        if (!query.empty()) {
+            startSearch(top);
+        }
+        return true;
+    }
+    if (event == Event::Backspace) {
+        if (!query.empty()) {
+            query.pop_back();
+        }
+        return true;
+    }
+    if (event.is_character()) {
+        query += event.character();
+    }
+    // the prompt captures all keys
+    return true;
+}
+
+void FileViewer::pollSearch() {
+    const std::lock_guard<std::mutex> lock(search->mutex);
+    // the hit is shown, once a running seek returned the content
+    if (!content || search->running || search->generation == shownGeneration) {
+        return;
+    }
+    shownGeneration = search->generation;
+    if (!search->error.empty()) {
+        searchStatus = " " + search->error;
+        return;
+    }
+    hit = search->hit;
+    if (!hit) {
+        searchStatus = " not found: \"" + query + "\"";
+        return;
+    }
+    searchStatus = std::format(" found at offset {}", *hit);
+    showHit(*hit);
+}
+
+Element FileViewer::renderText() {
+    if (size == 0) {
+        return text(" (empty)") | dim;
+    }
+    Elements lines;
+    uint64_t offset{top};
+    for (size_t line{0}; line < VIEWPORT_HEIGHT && offset < size; line++) {
+        const uint64_t next = nextLine(*content, offset);
+        // read error
+        if (next == offset) {
+            lines.push_back(text(" (could not be read)") | color(Color::RedLight));
+            break;
+        }
+        const std::string_view raw = content->Read(offset, std::min(next - offset, DISPLAY_WIDTH));
+        lines.push_back(renderLine(raw, offset, hit, hitLength));
+        offset = next;
+    }
+    return vbox(std::move(lines));
+}
+
+Element FileViewer::renderHex() {
+    if (size == 0) {
+        return text(" (empty)") | dim;
+    }
+    Elements rows;
+    for (uint64_t offset{top}; offset < size && rows.size() < VIEWPORT_HEIGHT; offset += HEX_ROW) {
+        const std::string_view bytes = content->Read(offset, HEX_ROW);
+        std::string row = std::format("{:08x}  ", offset);
+        std::string ascii;
+        for (size_t i{0}; i < HEX_ROW; i++) {
+            if (i < bytes.size()) {
+                const auto byte = static_cast<unsigned char>(bytes[i]);
+                row += std::format("{:02x} ", byte);
+                ascii += byte >= 0x20 && byte < 0x7f ? static_cast<char>(byte) : '.';
+            } else {
+                row += "   ";
+            }
+            if (i == HEX_ROW / 2 - 1) {
+                row += " ";
+            }
+        }
+        Element line = text(row + " |" + ascii + "|");
+        if (hit && *hit < offset + HEX_ROW && *hit + hitLength > offset) {
+            line = line | color(Color::Yellow);
+        }
+        rows.push_back(line);
+    }
+    return vbox(std::move(rows));
+}
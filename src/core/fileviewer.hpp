@@ -0,0 +1,134 @@
+/*_____________________________________________________________
+ | File Viewer
+ |   Pager for the content of a file object, opened from the
+ |   file tree. Text or hex, only the lines inside the viewport
+ |   are read (the position is a byte offset, no line index is
+ |   built), so multi-GB files open instantly. The search runs
+ |   as a background job on its own handle of the content.
+ |   Streamed (archive) content is only read on the UI thread
+ |   while it is buffered; jumps that need to decompress from
+ |   the start (End, scrolling back far) run as seek job, the
+ |   viewer shows a placeholder meanwhile.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ftxui/component/event.hpp"  // for Event
+#include "ftxui/dom/elements.hpp"     // for Element
+
+#include "../util/filecontent.hpp"
+#include "../util/objectwalk.hpp"
+
+class OSTreeTUI;
+
+class FileViewer {
+   public:
+    /**
+     * @param ostreetui OSTreeTUI, to run the search as job.
+     * @param content Content to display.
+     * @param file Checksum of the file object.
+     * @param path Path of the file, for the header.
+     */
+    FileViewer(OSTreeTUI& ostreetui,
+               std::unique_ptr<cpplibostree::FileContent> content,
+               const cpplibostree::ObjectId& file,
+               std::string path);
+    /// cancels a running search
+    ~FileViewer();
+    FileViewer(const FileViewer&) = delete;
+    FileViewer& operator=(const FileViewer&) = delete;
+
+    /**
+     * @brief Build the viewer Element.
+     *
+     * @param focused Shows the key hints (only in the focused viewer).
+     * @return ftxui::Element
+     */
+    [[nodiscard]] ftxui::Element Render(bool focused);
+
+    /**
+     * @brief Handles navigation, hex toggle (x) & search (/, n).
+     *
+     * @return true, if the event was handled (Escape is not, it closes the viewer).
+     */
+    bool OnEvent(const ftxui::Event& event);
+
+   private:
+    /// search state, shared with the search job
+    struct Search {
+        std::mutex mutex;
+        std::shared_ptr<GCancellable> cancellable;  // of the running search
+        uint64_t generation{0};
+        bool running{false};
+        std::optional<uint64_t> hit;
+        std::string error;
+    };
+
+    /// seek state, shared with the seek job, that owns the content while it runs
+    struct Seek {
+        std::mutex mutex;
+        std::unique_ptr<cpplibostree::FileContent> content;
+        std::optional<uint64_t> top;  // new viewport, once computed
+        bool done{false};
+    };
+
+    /// Computes the new offset of the viewport.
+    using Navigation = std::function<uint64_t(cpplibostree::FileContent&)>;
+
+    /**
+     * @brief Moves the viewport, computed on the buffered content, or in a seek job if the
+     * computation has to decompress more.
+     *
+     * @return false, if the viewport is already there (at a border).
+     */
+    bool navigate(const Navigation& target);
+    /// @brief Hands the content to a seek job, that computes the new viewport.
+    void startSeek(Navigation target);
+    /// @brief Takes the content & viewport back from a finished seek job.
+    void pollSeek();
+
+    /// @brief Moves the viewport by lines (text) or rows of bytes (hex).
+    bool scroll(int lines);
+    /// @brief Moves the viewport to the end, so the last line is at the bottom.
+    void scrollToEnd();
+    /// @brief Moves the viewport to the search hit.
+    void showHit(uint64_t hit);
+
+    /// @brief Starts the search for the query as background job, from the offset on (wraps).
+    void startSearch(uint64_t from);
+    /// @brief Edits the search query while the search prompt is open.
+    bool handleSearchInput(const ftxui::Event& event);
+    /// @brief Takes over the result of a finished search.
+    void pollSearch();
+
+    [[nodiscard]] ftxui::Element renderText();
+    [[nodiscard]] ftxui::Element renderHex();
+
+    OSTreeTUI& ostreetui;
+    std::unique_ptr<cpplibostree::FileContent> content;  // nullptr while a seek job owns it
+    cpplibostree::ObjectId file;
+    std::string path;
+    uint64_t size{0};
+    bool mapped{false};
+    std::shared_ptr<Seek> seek;  // running seek
+
+    bool hex{false};
+    uint64_t top{0};  // offset of the first displayed line (text) or row (hex)
+
+    bool searchActive{false};  // search prompt is open
+    std::string query;
+    std::optional<uint64_t> hit;  // last search hit
+    size_t hitLength{0};
+    uint64_t shownGeneration{0};  // generation of the last taken over search result
+    std::string searchStatus;
+    std::shared_ptr<Search> search = std::make_shared<Search>();
+};
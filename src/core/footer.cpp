@@ -2,21 +2,63 @@
 
 #include "footer.hpp"
 
-ftxui::Element Footer::FooterRender() {
+ftxui::Element Footer::FooterRender(const std::string& jobStatus, bool jobFailed) {
     using namespace ftxui;
 
     return hbox({
         text("OSTree TUI") | bold | hyperlink("https://github.com/AP-Sensing/ostree-tui"),
         separator(),
         text(content) |
-            (content == DEFAULT_CONTENT ? color(Color::White) : color(Color::YellowLight)),
+            (content == defaultContent() ? color(Color::White) : color(Color::YellowLight)),
+        filler(),
+        jobStatus.empty()
+            ? text("")
+            : text(" " + jobStatus + " ") | color(jobFailed ? Color::Red : Color::Cyan),
+    });
+}
+
+ftxui::Element Footer::SearchRender(const std::string& query,
+                                    bool typing,
+                                    const std::string& status) {
+    using namespace ftxui;
+
+    return hbox({
+        text(" / ") | bold | color(Color::YellowLight),
+        text(query),
+        typing ? text(" ") | inverted : text(""),
+        filler(),
+        text(" " + status + " ") | color(Color::GrayLight),
+    });
+}
+
+ftxui::Element Footer::PromptRender(const std::string& label, const std::string& input) {
+    using namespace ftxui;
+
+    return hbox({
+        text(label) | bold | color(Color::YellowLight),
+        text(input),
+        text(" ") | inverted,
+        filler(),
+        text(" Enter : Confirm || Esc : Cancel ") | color(Color::GrayLight),
     });
 }
 
 void Footer::ResetContent() {
-    content = DEFAULT_CONTENT;
+    content = defaultContent();
 }
 
 void Footer::SetContent(std::string content) {
     this->content = content;
 }
+
+void Footer::SetReadOnly(bool readOnly) {
+    const bool showsDefault = content == defaultContent();
+    this->readOnly = readOnly;
+    if (showsDefault) {
+        content = defaultContent();
+    }
+}
+
+const std::string& Footer::defaultContent() const {
+    return readOnly ? READ_ONLY_CONTENT : DEFAULT_CONTENT;
+}
@@ -11,15 +11,51 @@ class Footer {
     /// @brief Resets footer text to default string.
     void ResetContent();
 
-    /// @brief Creates a Renderer for the footer section.
-    [[nodiscard]] ftxui::Element FooterRender();
+    /**
+     * @brief Creates a Renderer for the footer section.
+     *
+     * @param jobStatus Status of the background jobs, shown on the right (if not empty).
+     * @param jobFailed Last background job failed.
+     */
+    [[nodiscard]] ftxui::Element FooterRender(const std::string& jobStatus = "",
+                                              bool jobFailed = false);
+
+    /**
+     * @brief Creates a Renderer for the search prompt, replacing the footer during a search.
+     *
+     * @param query Current search query.
+     * @param typing Search prompt is open & receives input.
+     * @param status Hit count, or state of the search.
+     */
+    [[nodiscard]] ftxui::Element SearchRender(const std::string& query,
+                                              bool typing,
+                                              const std::string& status);
+
+    /**
+     * @brief Creates a Renderer for an input prompt, replacing the footer while it is open.
+     *
+     * @param label Text in front of the input.
+     * @param input Current input.
+     */
+    [[nodiscard]] ftxui::Element PromptRender(const std::string& label, const std::string& input);
 
     // Setter
     void SetContent(std::string content);
 
+    /// @brief Hides the shortcuts changing the repository (promote, drop, import).
+    void SetReadOnly(bool readOnly);
+
    private:
+    /// @return Shortcuts info shown without a notification.
+    [[nodiscard]] const std::string& defaultContent() const;
+
     const std::string DEFAULT_CONTENT{
         "  || Alt+Q : Quit || Alt+R : Refresh || Alt+C : Copy Hash || Alt+P : Promote || Alt+D: "
-        "Drop || "};
+        "Drop || Alt+O : Checkout || Alt+T : Export || Alt+I : Import || / : Search || l : Same "
+        "Content || Alt+L : Lineage || e : Update Size || "};
+    const std::string READ_ONLY_CONTENT{
+        "  || Alt+Q : Quit || Alt+R : Refresh || Alt+C : Copy Hash || Alt+O : Checkout || Alt+T "
+        ": Export || / : Search || l : Same Content || Alt+L : Lineage || e : Update Size || "};
+    bool readOnly{false};
     std::string content{DEFAULT_CONTENT};
 };
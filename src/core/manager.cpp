@@ -2,13 +2,25 @@
 
 #include <assert.h>
 #include <cstdio>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
 #include "ftxui/component/event.hpp"  // for Event
 #include "ftxui/dom/elements.hpp"     // for Element, operator|, text, center, border
 
 #include "../util/cpplibostree.hpp"
+#include "../util/deployments.hpp"
+#include "../util/diskusage.hpp"
+#include "../util/refcompare.hpp"
 
 #include "ostreetui.hpp"
 
@@ -16,13 +28,17 @@
 
 Manager::Manager(OSTreeTUI& ostreetui,
                  const ftxui::Component& infoView,
-                 const ftxui::Component& filterView)
+                 const ftxui::Component& filterView,
+                 const ftxui::Component& compareView,
+                 const ftxui::Component& filesView,
+                 const ftxui::Component& diffView)
     : ostreetui(ostreetui) {
     using namespace ftxui;
 
     tabSelection = Menu(&tabEntries, &tabIndex, MenuOption::HorizontalAnimated());
 
-    tabContent = Container::Tab({infoView, filterView}, &tabIndex);
+    tabContent =
+        Container::Tab({infoView, filterView, compareView, filesView, diffView}, &tabIndex);
 
     managerRenderer = Container::Vertical(
         {tabSelection, tabContent,
@@ -48,62 +64,347 @@ int Manager::GetTabIndex() const {
 
 // BranchBoxManager
 
-BranchBoxManager::BranchBoxManager(OSTreeTUI& ostreetui,
-                                   cpplibostree::OSTreeRepo& repo,
-                                   std::unordered_map<std::string, bool>& visibleBranches) {
+BranchBoxManager::BranchBoxManager(OSTreeTUI& ostreetui, cpplibostree::OSTreeRepo& repo)
+    : ostreetui(ostreetui) {
     using namespace ftxui;
 
-    CheckboxOption cboption = CheckboxOption::Simple();
-    cboption.on_change = [&] { ostreetui.RefreshCommitListComponent(); };
-    // CheckboxOption cboption = {.on_change = [&] { ostreetui.RefreshCommitListComponent(); }};
+    // time range
+    const auto& range = ostreetui.GetTimeFilter();
+    sinceText = range.since ? cpplibostree::FormatTimepoint(*range.since) : "";
+    untilText = range.until ? cpplibostree::FormatTimepoint(*range.until) : "";
+    InputOption timeOption;
+    timeOption.multiline = false;
+    timeOption.on_change = [&] { applyTimeFilter(); };
+    timeInputs->Add(Input(&sinceText, "since, e.g. 7d", timeOption));
+    timeInputs->Add(Input(&untilText, "until, e.g. 2024-05-01", timeOption));
 
     // branch visibility
-    for (const auto& branch : repo.GetBranches()) {
-        branchBoxes->Add(Checkbox(branch, &(visibleBranches.at(branch)), cboption));
+    refTree.Build(repo);
+    refTreeView = RefTreeRender::RefTreeComponent(refTree, ostreetui);
+}
+
+void BranchBoxManager::RefreshRefTree(const cpplibostree::OSTreeRepo& repo) {
+    refTree.Build(repo);
+}
+
+void BranchBoxManager::applyTimeFilter() {
+    const auto since = cpplibostree::ParseTimepoint(sinceText);
+    const auto until = cpplibostree::ParseTimepoint(untilText, true);
+    sinceValid = sinceText.empty() || since.has_value();
+    untilValid = untilText.empty() || until.has_value();
+    if (sinceValid && untilValid) {
+        ostreetui.SetTimeFilter({since, until});
     }
 }
 
 ftxui::Element BranchBoxManager::BranchBoxRender() {
     using namespace ftxui;
 
-    // branch filter
+    // time range filter
+    auto validity = [](bool valid) { return valid ? color(Color::White) : color(Color::Red); };
     Elements bfbElements = {
-        text(L"branches:") | bold,
-        filler(),
-        branchBoxes->Render() | vscroll_indicator | frame | size(HEIGHT, LESS_THAN, 10),
+        text(L"time range:") | bold,
+        hbox({text(" since: "), timeInputs->ChildAt(0)->Render() | validity(sinceValid)}),
+        hbox({text(" until: "), timeInputs->ChildAt(1)->Render() | validity(untilValid)}),
+        text(" (YYYY-MM-DD [HH:MM], or relative: 30m, 48h, 7d)") | dim,
+        text(""),
     };
+
+    // branch filter
+    const auto& visibleBranches = ostreetui.GetVisibleBranches();
+    const std::string& filter = refTree.GetFilter();
+    bfbElements.insert(
+        bfbElements.end(),
+        {
+            hbox({text(L"branches:") | bold,
+                  text(std::format(" {}/{} visible", visibleBranches.Count(),
+                                   visibleBranches.Size())) |
+                      dim}),
+            filter.empty() ? text(" (type to filter)") | dim
+                           : hbox({text(" filter: "), text(filter) | bold}),
+            filler(),
+            refTreeView->Render(),
+            text(" ␣ show/hide  ⏎ ←/→ collapse/expand  Esc clear filter") | dim,
+        });
     return vbox(bfbElements);
 }
 
+// CompareManager
+
+CompareManager::CompareManager(OSTreeTUI& ostreetui, cpplibostree::OSTreeRepo& repo)
+    : ostreetui(ostreetui), repo(repo) {
+    using namespace ftxui;
+
+    InputOption inputOption;
+    inputOption.multiline = false;
+    inputOption.on_enter = [&] { compare(); };
+    compareInputs->Add(Input(&refA, "ref A, e.g. testing", inputOption));
+    compareInputs->Add(Input(&refB, "ref B, e.g. stable", inputOption));
+    compareInputs->Add(Input(&otherRepoPath, "this repository", inputOption));
+    compareInputs->Add(Button(" Compare ", [&] { compare(); }, ButtonOption::Ascii()));
+
+    MenuOption menuOption;
+    menuOption.on_enter = [&] { selectResult(); };
+    results = Menu(&resultEntries, &selectedResult, menuOption);
+    compareInputs->Add(results);
+}
+
+void CompareManager::compare() {
+    resultEntries.clear();
+    resultHashes.clear();
+    selectedResult = 0;
+    statusError = false;
+
+    if (otherRepoPath.empty()) {
+        loader.request_stop();
+        loading = false;
+        compareWith(repo, false);
+        return;
+    }
+    // ref B lives in another repository (e.g. a production mirror), which may be large or
+    // locked -> load it in the background, a running load is cancelled (it stops parsing, so
+    // joining it is quick)
+    loader = std::jthread();
+    {
+        // drop the result of a previous load, that was not compared yet
+        const std::lock_guard<std::mutex> lock(loadMutex);
+        loadFinished = false;
+        loadedRepo.reset();
+    }
+    loading = true;
+    loadPath = otherRepoPath;
+    status = "loading " + loadPath + "…";
+    loader = std::jthread(
+        [this, path = loadPath](const std::stop_token& stop) { loadOtherRepo(path, stop); });
+}
+
+void CompareManager::loadOtherRepo(const std::string& path, const std::stop_token& stop) {
+    GError* error{nullptr};
+    auto other = cpplibostree::OSTreeRepo::Open(path, false, nullptr, nullptr, stop, &error);
+    if (stop.stop_requested()) {
+        g_clear_error(&error);
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(loadMutex);
+        loadFinished = true;
+        loadedRepo = std::move(other);
+        loadError = error != nullptr ? error->message : "";
+    }
+    g_clear_error(&error);
+    ostreetui.GetScreen().Post([this] { finishLoad(); });
+    ostreetui.GetScreen().Post(ftxui::Event::Custom);
+}
+
+void CompareManager::finishLoad() {
+    std::unique_ptr<cpplibostree::OSTreeRepo> other;
+    std::string error;
+    {
+        const std::lock_guard<std::mutex> lock(loadMutex);
+        if (!loadFinished) {
+            return;
+        }
+        loadFinished = false;
+        other = std::move(loadedRepo);
+        error = std::move(loadError);
+    }
+    if (!loading) {
+        return;
+    }
+    loading = false;
+    if (!other) {
+        statusError = true;
+        status = "could not load " + loadPath + ": " + error;
+        return;
+    }
+    compareWith(*other, true);
+}
+
+void CompareManager::compareWith(const cpplibostree::OSTreeRepo& repoB, bool otherRepo) {
+    statusError = true;
+    const auto historyA = repo.GetBranchHistory(refA);
+    const auto historyB = repoB.GetBranchHistory(refB);
+    if (historyA.empty()) {
+        status = "ref A (" + refA + ") not found";
+        return;
+    }
+    if (historyB.empty()) {
+        status = "ref B (" + refB + ") not found";
+        return;
+    }
+    const auto comparison = cpplibostree::CompareHistories(historyA, historyB);
+    statusError = false;
+    status = std::format("by hash: {} only on A, {} only on B, {} on both", comparison.hashOnlyA,
+                         comparison.hashOnlyB, comparison.hashBoth);
+
+    // results are copied into the entries, the commits of another repository don't outlive this
+    auto entry = [](const cpplibostree::Commit& commit) {
+        return std::format("  {} {:%Y-%m-%d} {}", commit.hash.substr(0, 8),
+                           std::chrono::time_point_cast<std::chrono::seconds>(commit.timestamp),
+                           std::string(commit.Subject()));
+    };
+    resultEntries.push_back(std::format("only on A ({}):", comparison.onlyA.size()));
+    resultHashes.emplace_back();
+    for (const auto* commit : comparison.onlyA) {
+        resultEntries.push_back(entry(*commit));
+        resultHashes.push_back(commit->hash);
+    }
+    resultEntries.push_back(std::format("only on B ({}):", comparison.onlyB.size()));
+    resultHashes.emplace_back();
+    for (const auto* commit : comparison.onlyB) {
+        resultEntries.push_back(entry(*commit));
+        resultHashes.push_back(otherRepo ? "" : commit->hash);
+    }
+    resultEntries.push_back(std::format("on both ({}):", comparison.both.size()));
+    resultHashes.emplace_back();
+    for (const auto& [commitA, commitB] : comparison.both) {
+        resultEntries.push_back(entry(*commitA) +
+                                (commitA->hash == commitB->hash
+                                     ? ""
+                                     : " (B: " + commitB->hash.substr(0, 8) + ")"));
+        resultHashes.push_back(commitA->hash);
+    }
+}
+
+void CompareManager::selectResult() {
+    if (selectedResult < 0 || static_cast<size_t>(selectedResult) >= resultHashes.size()) {
+        return;
+    }
+    const std::string& hash = resultHashes.at(static_cast<size_t>(selectedResult));
+    if (!hash.empty()) {
+        ostreetui.SelectCommit(hash);
+    }
+}
+
+ftxui::Element CompareManager::CompareRender() {
+    using namespace ftxui;
+
+    return vbox({
+        text(L"compare refs:") | bold,
+        hbox({text(" A:      "), compareInputs->ChildAt(0)->Render()}),
+        hbox({text(" B:      "), compareInputs->ChildAt(1)->Render()}),
+        hbox({text(" B repo: "), compareInputs->ChildAt(2)->Render()}),
+        compareInputs->ChildAt(3)->Render(),
+        text(" " + status) | color(statusError ? Color::Red : Color::GrayLight),
+        text(""),
+        results->Render() | vscroll_indicator | frame | size(HEIGHT, LESS_THAN, 20),
+        resultEntries.empty() ? text("") : text(" ⏎ select commit") | dim,
+    });
+}
+
 // CommitInfoManager
 
-ftxui::Element CommitInfoManager::RenderInfoView(const cpplibostree::Commit& displayCommit) {
+ftxui::Element CommitInfoManager::RenderDeltaEstimate(
+    const std::optional<cpplibostree::DeltaEstimate>& estimate,
+    bool failed) {
     using namespace ftxui;
 
+    if (!estimate) {
+        return text(failed ? "not available" : "calculating…") | dim;
+    }
+    if (estimate->objects == 0) {
+        return text("nothing to download");
+    }
+    using cpplibostree::FormatBytes;
+    return vbox({
+        text(FormatBytes(estimate->compressedBytes) + " download (" +
+             std::to_string(estimate->objects) + " objects)"),
+        text(FormatBytes(estimate->uncompressedBytes) + " uncompressed") | dim,
+    });
+}
+
+ftxui::Element CommitInfoManager::RenderInfoView(
+    const cpplibostree::Commit& displayCommit,
+    std::span<const cpplibostree::Commit* const> sameContent,
+    const std::optional<cpplibostree::DiskUsage>& diskUsage,
+    bool diskUsageFailed,
+    std::span<const std::string> staticDeltas,
+    const std::optional<std::vector<cpplibostree::Signature>>& commitSignatures,
+    std::span<const cpplibostree::Deployment> deployments) {
+    using namespace ftxui;
+
+    // deployments of the commit (sysroot mode)
+    Elements deployedAs;
+    for (const auto& deployment : deployments) {
+        if (deployment.checksum != displayCommit.hash) {
+            continue;
+        }
+        const std::string_view role = cpplibostree::RoleName(deployment.role);
+        std::string flags = deployment.staged ? " staged" : "";
+        flags += deployment.pinned ? " pinned" : "";
+        deployedAs.push_back(hbox({text("‣ "), text(deployment.Name()) | bold,
+                                   text(role.empty() ? "" : " " + std::string(role)),
+                                   text(flags) | dim}));
+    }
+
+    // static deltas leading to the commit
+    Elements deltas;
+    for (const auto& from : staticDeltas) {
+        deltas.push_back(text(from.empty() ? "‣ from scratch" : "‣ from " + from.substr(0, 8)));
+    }
+
+    // size, exclusive / shared relative to the parent
+    Element sizeInfo = text(diskUsageFailed ? "not available" : "calculating…") | dim;
+    if (diskUsage) {
+        using cpplibostree::FormatBytes;
+        Elements sizeLines{text(FormatBytes(diskUsage->bytes) + " in " +
+                                std::to_string(diskUsage->objects) + " objects")};
+        if (diskUsage->hasParent) {
+            sizeLines.push_back(text("‣ exclusive: " + FormatBytes(diskUsage->exclusiveBytes) +
+                                     " (" + std::to_string(diskUsage->exclusiveObjects) +
+                                     " objects)"));
+            sizeLines.push_back(text("‣ shared with parent: " +
+                                     FormatBytes(diskUsage->sharedBytes) + " (" +
+                                     std::to_string(diskUsage->sharedObjects) + " objects)"));
+        }
+        sizeInfo = vbox(std::move(sizeLines));
+    }
+
+    // other commits with the same content (promotions)
+    Elements lineage;
+    for (const auto* commit : sameContent) {
+        if (commit == &displayCommit) {
+            continue;
+        }
+        lineage.push_back(hbox({text("‣ "), text(std::string(commit->branch)) | bold,
+                                text(" " + commit->hash.substr(0, 8)) | dim}));
+    }
+
     // selected commit info
+    const std::string_view version = displayCommit.Version();
     Elements signatures;
-    for (const auto& signature : displayCommit.signatures) {
-        std::string ts =
-            std::format("{:%Y-%m-%d %T %Ez}",
-                        std::chrono::time_point_cast<std::chrono::seconds>(signature.timestamp));
-        signatures.push_back(
-            vbox({hbox({text("‣ "), text(signature.pubkeyAlgorithm) | bold, text(" signature")}),
-                  text("  with key ID " + signature.fingerprint), text("  made " + ts)}));
+    if (!commitSignatures) {
+        signatures.push_back(text("verifying…") | dim);
+    } else {
+        for (const auto& signature : *commitSignatures) {
+            std::string ts = std::format(
+                "{:%Y-%m-%d %T %Ez}",
+                std::chrono::time_point_cast<std::chrono::seconds>(signature.timestamp));
+            signatures.push_back(vbox(
+                {hbox({text("‣ "), text(signature.pubkeyAlgorithm) | bold, text(" signature")}),
+                 text("  with key ID " + signature.fingerprint), text("  made " + ts)}));
+        }
     }
     return vbox(
         {text(" Subject:") | color(Color::Green),
-         paragraph(displayCommit.subject) | color(Color::White), filler(),
+         paragraph(std::string(displayCommit.Subject())) | color(Color::White), filler(),
          text(" Hash: ") | color(Color::Green), text(displayCommit.hash), filler(),
          text(" Date: ") | color(Color::Green),
          text(std::format("{:%Y-%m-%d %T %Ez}", std::chrono::time_point_cast<std::chrono::seconds>(
                                                     displayCommit.timestamp))),
          filler(),
          // TODO insert version, only if exists
-         displayCommit.version.empty() ? filler() : text(" Version: ") | color(Color::Green),
-         displayCommit.version.empty() ? filler() : text(displayCommit.version),
+         version.empty() ? filler() : text(" Version: ") | color(Color::Green),
+         version.empty() ? filler() : text(std::string(version)),
+         deployedAs.empty() ? filler() : text(" Deployed as: ") | color(Color::Green),
+         vbox(deployedAs), filler(),
          text(" Parent: ") | color(Color::Green), text(displayCommit.parent), filler(),
          text(" Checksum: ") | color(Color::Green), text(displayCommit.contentChecksum), filler(),
-         displayCommit.signatures.size() > 0 ? text(" Signatures: ") | color(Color::Green)
-                                             : text(""),
+         text(" Size: ") | color(Color::Green), sizeInfo, filler(),
+         lineage.empty() ? text("") : text(" Same content on: (l)") | color(Color::Green),
+         vbox(lineage), filler(),
+         deltas.empty() ? text("") : text(" Static Deltas:") | color(Color::Green),
+         vbox(deltas), filler(),
+         signatures.empty() ? text("") : text(" Signatures: ") | color(Color::Green),
          vbox(signatures), filler()});
 }
@@ -1,16 +1,29 @@
 /*_____________________________________________________________
  | Manager Render
- |   Right portion of main window, includes branch filter &
- |   detailed commit info of the selected commit.
+ |   Right portion of main window, includes branch filter,
+ |   detailed commit info of the selected commit, the branch
+ |   comparison, the file tree & the diff of the selected
+ |   commit.
  |___________________________________________________________*/
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "ftxui/component/component.hpp"  // for Component
 
 #include "../util/cpplibostree.hpp"
+#include "../util/deployments.hpp"
+#include "../util/diskusage.hpp"
+
+#include "reftree.hpp"
 
 class OSTreeTUI;
 
@@ -19,7 +32,10 @@ class Manager {
    public:
     Manager(OSTreeTUI& ostreetui,
             const ftxui::Component& infoView,
-            const ftxui::Component& filterView);
+            const ftxui::Component& filterView,
+            const ftxui::Component& compareView,
+            const ftxui::Component& filesView,
+            const ftxui::Component& diffView);
 
    public:
     [[nodiscard]] ftxui::Component GetManagerRenderer();
@@ -29,7 +45,7 @@ class Manager {
     OSTreeTUI& ostreetui;
 
     int tabIndex{0};
-    std::vector<std::string> tabEntries = {" Info ", " Filter "};
+    std::vector<std::string> tabEntries = {" Info ", " Filter ", " Compare ", " Files ", " Diff "};
 
     // because the combination of all interchangeable views is very simple,
     // we can (in contrast to the other ones) render this one here
@@ -44,16 +60,40 @@ class CommitInfoManager {
      * @brief Build the info view Element.
      *
      * @param displayCommit Commit to display the information of.
+     * @param sameContent All commits with the same content checksum (incl. displayCommit).
+     * @param diskUsage Disk usage of the commit, nullopt while it is calculated.
+     * @param diskUsageFailed Disk usage could not be calculated (e.g. missing objects).
+     * @param staticDeltas Source commits of the static deltas to the commit ("" = scratch).
+     * @param commitSignatures Verified GPG signatures of the commit, nullopt while they are
+     * verified.
+     * @param deployments All deployments of the sysroot, those of the commit are listed.
      * @return ftxui::Element
      */
-    [[nodiscard]] static ftxui::Element RenderInfoView(const cpplibostree::Commit& displayCommit);
+    [[nodiscard]] static ftxui::Element RenderInfoView(
+        const cpplibostree::Commit& displayCommit,
+        std::span<const cpplibostree::Commit* const> sameContent = {},
+        const std::optional<cpplibostree::DiskUsage>& diskUsage = std::nullopt,
+        bool diskUsageFailed = false,
+        std::span<const std::string> staticDeltas = {},
+        const std::optional<std::vector<cpplibostree::Signature>>& commitSignatures =
+            std::vector<cpplibostree::Signature>{},
+        std::span<const cpplibostree::Deployment> deployments = {});
+
+    /**
+     * @brief Build the Element describing an update between two commits.
+     *
+     * @param estimate Delta estimate, nullopt while it is calculated.
+     * @param failed Delta estimate could not be calculated.
+     * @return ftxui::Element
+     */
+    [[nodiscard]] static ftxui::Element RenderDeltaEstimate(
+        const std::optional<cpplibostree::DeltaEstimate>& estimate,
+        bool failed);
 };
 
 class BranchBoxManager {
    public:
-    BranchBoxManager(OSTreeTUI& ostreetui,
-                     cpplibostree::OSTreeRepo& repo,
-                     std::unordered_map<std::string, bool>& visibleBranches);
+    BranchBoxManager(OSTreeTUI& ostreetui, cpplibostree::OSTreeRepo& repo);
 
     /**
      * @brief Build the branch box Element.
@@ -62,6 +102,77 @@ class BranchBoxManager {
      */
     [[nodiscard]] ftxui::Element BranchBoxRender();
 
+    /// @brief Rebuilds the ref tree, after the refs of the repository changed.
+    void RefreshRefTree(const cpplibostree::OSTreeRepo& repo);
+
+   private:
+    /// @brief Parses the time range inputs & applies them, if they are valid.
+    void applyTimeFilter();
+
+   public:
+    ftxui::Component refTreeView;
+    ftxui::Component timeInputs = ftxui::Container::Vertical({});
+
+   private:
+    OSTreeTUI& ostreetui;
+    RefTree refTree;
+    std::string sinceText;
+    std::string untilText;
+    bool sinceValid{true};
+    bool untilValid{true};
+};
+
+class CompareManager {
+   public:
+    CompareManager(OSTreeTUI& ostreetui, cpplibostree::OSTreeRepo& repo);
+
+    /**
+     * @brief Build the compare view Element.
+     *
+     * @return ftxui::Element
+     */
+    [[nodiscard]] ftxui::Element CompareRender();
+
+   private:
+    /// @brief Compares ref A (of this repository) with ref B, loading another repository first.
+    void compare();
+
+    /// @brief Loads the repository of ref B in the background (loader thread).
+    void loadOtherRepo(const std::string& path, const std::stop_token& stop);
+
+    /// @brief Compares with the repository loaded by loadOtherRepo() (UI thread).
+    void finishLoad();
+
+    /// @brief Compares ref A (of this repository) with ref B (of repoB).
+    void compareWith(const cpplibostree::OSTreeRepo& repoB, bool otherRepo);
+
+    /// @brief Selects the commit of the highlighted result in the commit list.
+    void selectResult();
+
    public:
-    ftxui::Component branchBoxes = ftxui::Container::Vertical({});
+    ftxui::Component compareInputs = ftxui::Container::Vertical({});
+
+   private:
+    OSTreeTUI& ostreetui;
+    cpplibostree::OSTreeRepo& repo;
+
+    std::string refA;
+    std::string refB;
+    std::string otherRepoPath;  // empty -> compare inside this repository
+
+    std::string status;
+    bool statusError{false};
+    std::vector<std::string> resultEntries;
+    std::vector<std::string> resultHashes;  // hash (in this repository) per entry, or empty
+    int selectedResult{0};
+    ftxui::Component results;
+
+    // loader of the other repository
+    bool loading{false};
+    std::string loadPath;
+    std::mutex loadMutex;
+    bool loadFinished{false};
+    std::unique_ptr<cpplibostree::OSTreeRepo> loadedRepo;  // not compared yet
+    std::string loadError;
+    std::jthread loader;  // declared last, posts to the screen & has to stop first
 };
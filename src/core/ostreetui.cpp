@@ -1,14 +1,24 @@
 #include "ostreetui.hpp"
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <queue>
+#include <span>
+#include <stop_token>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include <ftxui/component/event.hpp>  // for Event, Event::ArrowDown, Event::ArrowUp, Event::End, Event::Home, Event::PageDown, Event::PageUp
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
@@ -18,26 +28,90 @@
 
 #include "clip.h"
 
+#include "../util/commitimport.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/diskusage.hpp"
+#include "../util/jobqueue.hpp"
+#include "../util/profiler.hpp"
+#include "../util/pruneplan.hpp"
+#include "../util/repojobs.hpp"
+#include "../util/repolock.hpp"
+#include "../util/searchindex.hpp"
+#include "../util/tarexport.hpp"
 
-OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& startupBranches)
-    : ostreeRepo(repo), selectedCommit(0), screen(ftxui::ScreenInteractive::Fullscreen()) {
+#include "perfhud.hpp"
+
+namespace {
+
+/// @return "<files> files, <bytes>, <throughput>/s" of a checkout or export started at start.
+std::string formatTransfer(uint64_t files,
+                           uint64_t bytes,
+                           std::chrono::steady_clock::time_point start) {
+    const double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto rate =
+        elapsed > 0 ? static_cast<uint64_t>(static_cast<double>(bytes) / elapsed) : bytes;
+    return std::to_string(files) + " files, " + cpplibostree::FormatBytes(bytes) + ", " +
+           cpplibostree::FormatBytes(rate) + "/s";
+}
+
+}  // namespace
+
+OSTreeTUI::OSTreeTUI(const std::string& repo,
+                     const std::vector<std::string>& startupBranches,
+                     const cpplibostree::TimeRange& startupTimeRange,
+                     bool scanObjects,
+                     std::optional<size_t> sysrootDepth,
+                     TuiContext* sharedContext)
+    : ownContext(sharedContext == nullptr ? std::make_unique<TuiContext>() : nullptr),
+      context(sharedContext == nullptr ? *ownContext : *sharedContext),
+      threadPool(context.threadPool),
+      screen(context.screen),
+      ostreeRepo(sysrootDepth ? cpplibostree::OSTreeRepo(
+                                    cpplibostree::SysrootOptions{repo, *sysrootDepth},
+                                    &context.strings)
+                              : cpplibostree::OSTreeRepo(repo, true,
+                                                         scanObjects ? &threadPool : nullptr,
+                                                         &context.strings)),
+      selectedCommit(0),
+      timeFilter(startupTimeRange) {
+    buildComponents(startupBranches);
+}
+
+OSTreeTUI::OSTreeTUI(cpplibostree::OSTreeRepo&& repo,
+                     const std::vector<std::string>& startupBranches,
+                     const cpplibostree::TimeRange& startupTimeRange,
+                     TuiContext& sharedContext)
+    : context(sharedContext),
+      threadPool(context.threadPool),
+      screen(context.screen),
+      ostreeRepo(std::move(repo)),
+      selectedCommit(0),
+      timeFilter(startupTimeRange) {
+    buildComponents(startupBranches);
+}
+
+void OSTreeTUI::buildComponents(const std::vector<std::string>& startupBranches) {
     using namespace ftxui;
 
     // set all branches as visible and define a branch color
+    // if startupBranches are defined, set all as non-visible
+    visibleBranches =
+        cpplibostree::BranchSet(ostreeRepo.GetBranches().size(), startupBranches.empty());
     for (const auto& branch : ostreeRepo.GetBranches()) {
-        // if startupBranches are defined, set all as non-visible
-        visibleBranches[branch] = startupBranches.size() == 0 ? true : false;
         std::hash<std::string> nameHash{};
         branchColorMap[branch] = Color::Palette256((nameHash(branch) + 10) % 256);
     }
     // if startupBranches are defined, only set those visible
-    if (startupBranches.size() != 0) {
-        for (const auto& branch : startupBranches) {
-            visibleBranches[branch] = true;
+    for (const auto& branch : startupBranches) {
+        if (const auto branchId = ostreeRepo.GetBranchId(branch)) {
+            visibleBranches.Set(*branchId);
         }
     }
 
+    // sysroot tabs can't promote, drop or import
+    footer.SetReadOnly(ostreeRepo.IsSysroot());
+
     // COMMIT TREE
     RefreshCommitComponents();
 
@@ -64,6 +138,43 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
 
     // window specific shortcuts
     commitListComponent = CatchEvent(commitListComponent, [&](Event event) {
+        // search
+        if (viewMode == ViewMode::DEFAULT && event == Event::Character('/')) {
+            openSearch();
+            return true;
+        }
+        if (viewMode == ViewMode::DEFAULT && !searchHits.empty() &&
+            (event == Event::Character('n') || event == Event::Character('N'))) {
+            jumpToSearchHit(event == Event::Character('n'));
+            return true;
+        }
+        if (viewMode == ViewMode::DEFAULT && !searchQuery.empty() && event == Event::Escape) {
+            closeSearch(true);
+            return true;
+        }
+        // same content (promotion lineage)
+        if (viewMode == ViewMode::DEFAULT && event == Event::Character('l')) {
+            jumpToSameContent();
+            return true;
+        }
+        // mark as diff base
+        if (viewMode == ViewMode::DEFAULT && event == Event::Character('m')) {
+            if (visibleCommitViewMap.empty()) {
+                return true;
+            }
+            const std::string& hash = visibleCommitViewMap.at(selectedCommit);
+            diffBase = diffBase == hash ? "" : hash;
+            notificationText = diffBase.empty() ? " Unmarked Diff Base "
+                                                : " Marked " + hash.substr(0, 8) + " as Diff Base ";
+            return true;
+        }
+        // update size estimate
+        if (viewMode == ViewMode::DEFAULT && event == Event::Character('e')) {
+            showDeltaEstimate = !showDeltaEstimate;
+            notificationText = showDeltaEstimate ? " Showing Update Size Estimate "
+                                                 : " Hiding Update Size Estimate ";
+            return true;
+        }
         // switch through commits
         if ((viewMode == ViewMode::DEFAULT && event == Event::ArrowUp) ||
             (event.is_mouse() && event.mouse().button == Mouse::WheelUp)) {
@@ -87,32 +198,126 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
         if (visibleCommitViewMap.size() <= 0) {
             return text(" no commit info available ") | color(Color::RedLight) | bold | center;
         }
-        return CommitInfoManager::RenderInfoView(
-            ostreeRepo.GetCommitList().at(visibleCommitViewMap.at(selectedCommit)));
+        const auto& commit =
+            ostreeRepo.GetCommitList().at(visibleCommitViewMap.at(selectedCommit));
+        auto diskUsage = diskUsageWorker->Get(commit.hash, commit.parent);
+        Element info = CommitInfoManager::RenderInfoView(
+            commit, ostreeRepo.GetCommitsWithContent(commit.contentChecksum), diskUsage,
+            !diskUsage && diskUsageWorker->Failed(commit.hash),
+            ostreeRepo.GetStaticDeltasTo(commit.hash), signatureWorker->Get(commit.hash),
+            ostreeRepo.GetDeployments());
+        if (!showDeltaEstimate || ostreeRepo.GetCommitList().count(commit.parent) == 0) {
+            return info;
+        }
+        auto estimate = diskUsageWorker->GetDeltaEstimate(commit.parent, commit.hash);
+        return vbox({info, text(" Update from parent: (e)") | color(Color::Green),
+                     CommitInfoManager::RenderDeltaEstimate(
+                         estimate,
+                         !estimate && diskUsageWorker->DeltaFailed(commit.parent, commit.hash)),
+                     filler()});
     });
 
     // filter
     filterManager =
-        std::unique_ptr<BranchBoxManager>(new BranchBoxManager(*this, ostreeRepo, visibleBranches));
+        std::unique_ptr<BranchBoxManager>(new BranchBoxManager(*this, ostreeRepo));
     filterView =
-        Renderer(filterManager->branchBoxes, [&] { return filterManager->BranchBoxRender(); });
+        Renderer(Container::Vertical({filterManager->timeInputs, filterManager->refTreeView}),
+                 [&] { return filterManager->BranchBoxRender(); });
+
+    // compare
+    compareManager = std::unique_ptr<CompareManager>(new CompareManager(*this, ostreeRepo));
+    compareView = Renderer(compareManager->compareInputs,
+                           [&] { return compareManager->CompareRender(); });
+
+    // files
+    treeReader = std::make_unique<cpplibostree::TreeReader>(ostreeRepo.GetRepoPath());
+    fileTree = std::make_unique<FileTree>(*treeReader);
+    filesView = FileTreeRender::FileTreeComponent(*fileTree, *this);
+
+    // diff
+    commitDiffer = std::make_unique<cpplibostree::CommitDiffer>(
+        ostreeRepo.GetRepoPath(), threadPool, [this] { screen.Post(Event::Custom); });
+    diffView = DiffRender::DiffComponent(*commitDiffer, *this);
 
     // interchangeable view (composed)
-    manager = std::unique_ptr<Manager>(new Manager(*this, infoView, filterView));
+    manager = std::unique_ptr<Manager>(
+        new Manager(*this, infoView, filterView, compareView, filesView, diffView));
     managerRenderer = manager->GetManagerRenderer();
 
     // FOOTER
-    FooterRenderer = Renderer([&] { return footer.FooterRender(); });
+    FooterRenderer = Renderer([&] {
+        if (prompt) {
+            return footer.PromptRender(prompt->label, prompt->input);
+        }
+        if (searchActive || !searchQuery.empty()) {
+            return footer.SearchRender(searchQuery, searchActive, searchStatus());
+        }
+        const auto jobs = jobQueue->GetStatus();
+        return footer.FooterRender(jobStatus(), jobs.running.empty() && jobs.batchFailed > 0);
+    });
+
+    // SEARCH
+    searchWorker = std::make_unique<Search::CommitSearchWorker>(
+        [this](uint64_t generation, std::vector<std::string> hits) {
+            screen.Post([this, generation, hits = std::move(hits)]() mutable {
+                applySearchResults(generation, std::move(hits));
+            });
+            screen.Post(Event::Custom);
+        });
+
+    // DISK USAGE
+    diskUsageWorker = std::make_unique<cpplibostree::DiskUsageWorker>(
+        ostreeRepo.GetRepoPath(), threadPool,
+        [this](const std::string& /*commit*/) { screen.Post(Event::Custom); });
+    prunePlanner = std::make_unique<cpplibostree::PrunePlanner>(
+        ostreeRepo.GetRepoPath(), threadPool, [this] { screen.Post(Event::Custom); });
+
+    // SIGNATURES
+    signatureWorker = std::make_unique<cpplibostree::SignatureWorker>(
+        ostreeRepo.GetRepoPath(),
+        [this](const std::string& /*commit*/) { screen.Post(Event::Custom); });
+
+    // BACKGROUND JOBS
+    jobQueue = std::make_unique<cpplibostree::JobQueue>(ostreeRepo.GetRepoPath(),
+                                                        [this] { screen.Post(Event::Custom); });
+    if (ostreeRepo.IsLoadedFromSummary()) {
+        verifySummaryRefs();
+    }
 
     // BUILD MAIN CONTAINER
     container = Component(managerRenderer);
     container = ResizableSplitLeft(commitListComponent, container, &logSize);
     container = ResizableSplitBottom(FooterRenderer, container, &footerSize);
 
+    // performance overlay
+    Component framedContainer = container | border;
+    container = Renderer(framedContainer, [this, framedContainer] {
+        Element frame;
+        {
+            // building the element tree, ftxui draws it to the terminal afterwards
+            OSTREE_TUI_PROFILE_SCOPE("layout");
+            frame = framedContainer->Render();
+        }
+        if (!showPerformanceHud) {
+            return frame;
+        }
+        Element hud = PerformanceHud::Render(ostreeRepo.GetCommitList().size(),
+                                             visibleCommitViewMap.size());
+        return dbox({frame, vbox({hbox({filler(), hud | clear_under}), filler()})});
+    });
+
     commitListComponent->TakeFocus();
 
     // add application shortcuts
-    mainContainer = CatchEvent(container | border, [&](const Event& event) {
+    mainContainer = CatchEvent(container, [&](const Event& event) {
+        // search prompt captures all keyboard input
+        if (searchActive && !event.is_mouse()) {
+            return handleSearchInput(event);
+        }
+        // as does any other prompt
+        if (prompt && !event.is_mouse()) {
+            return handlePromptInput(event);
+        }
         // start commit promotion window
         if (event == Event::AltP) {
             SetViewMode(ViewMode::COMMIT_PROMOTION, visibleCommitViewMap.at(selectedCommit));
@@ -120,8 +325,57 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
         // start commit deletion window
         if (event == Event::AltD) {
             std::string hashToDrop = visibleCommitViewMap.at(selectedCommit);
-            SetViewMode(ViewMode::COMMIT_DROP, hashToDrop);
-            SetModeBranch(GetOstreeRepo().GetCommitList().at(hashToDrop).branch);
+            if (SetViewMode(ViewMode::COMMIT_DROP, hashToDrop)) {
+                SetModeBranch(std::string(GetOstreeRepo().GetCommitList().at(hashToDrop).branch));
+            }
+        }
+        // check out the selected commit
+        if (event == Event::AltO) {
+            if (visibleCommitViewMap.empty()) {
+                return true;
+            }
+            const std::string hash = visibleCommitViewMap.at(selectedCommit);
+            openPrompt(" Checkout " + hash.substr(0, 8) + " to: ", "./" + hash.substr(0, 8),
+                       [this, hash](const std::string& destination) {
+                           CheckoutCommit(hash, destination);
+                       });
+            return true;
+        }
+        // export the selected commit as tar archive
+        if (event == Event::AltT) {
+            if (visibleCommitViewMap.empty()) {
+                return true;
+            }
+            const std::string hash = visibleCommitViewMap.at(selectedCommit);
+            openPrompt(" Export " + hash.substr(0, 8) + " to: ",
+                       "./" + hash.substr(0, 8) + ".tar.zst",
+                       [this, hash](const std::string& destination) {
+                           ExportCommit(hash, destination);
+                       });
+            return true;
+        }
+        // import a directory or tarball as new commit (source, branch & subject are prompted)
+        if (event == Event::AltI) {
+            if (refuseReadOnly()) {
+                return true;
+            }
+            std::string branch;
+            if (!visibleCommitViewMap.empty()) {
+                const std::string& hash = visibleCommitViewMap.at(selectedCommit);
+                branch = ostreeRepo.GetCommitList().at(hash).branch;
+            }
+            openPrompt(" Import directory / tarball: ", "",
+                       [this, branch](const std::string& source) {
+                           openPrompt(" Import to branch: ", branch,
+                                      [this, source](const std::string& target) {
+                                          openPrompt(" Subject: ", "Import of " + source,
+                                                     [this, source, target](
+                                                         const std::string& subject) {
+                                                         ImportCommit(source, target, subject);
+                                                     });
+                                      });
+                       });
+            return true;
         }
         // copy commit id
         if (event == Event::AltC) {
@@ -132,8 +386,32 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
         }
         // refresh repository
         if (event == Event::AltR) {
-            RefreshOSTreeRepository();
-            notificationText = " Refreshed Repository Data ";
+            refreshWithNotification();
+            return true;
+        }
+        // toggle lineage connectors
+        if (event == Event::AltL) {
+            showLineage = !showLineage;
+            notificationText =
+                showLineage ? " Showing Content Lineage " : " Hiding Content Lineage ";
+            return true;
+        }
+        // cancel background jobs
+        if (event == Event::AltK) {
+            jobQueue->CancelAll();
+            notificationText = " Cancelled Background Jobs ";
+            return true;
+        }
+        // toggle performance overlay
+        if (event == Event::F12) {
+            showPerformanceHud = !showPerformanceHud;
+            if (showPerformanceHud && !Profiler::IsEnabled()) {
+                Profiler::SetEnabled(true);
+                hudEnabledProfiler = true;
+            } else if (!showPerformanceHud && hudEnabledProfiler) {
+                Profiler::SetEnabled(false);
+                hudEnabledProfiler = false;
+            }
             return true;
         }
         // exit
@@ -151,38 +429,38 @@ OSTreeTUI::OSTreeTUI(const std::string& repo, const std::vector<std::string>& st
     });
 }
 
-int OSTreeTUI::Run() {
-    using namespace ftxui;
-    // footer notification update loader
-    // Probably not the best solution, having an active wait and should maybe
-    // only be started, once a notification is set...
-    bool runSubThreads{true};
-    std::thread footerNotificationUpdater([&] {
-        while (runSubThreads) {
-            using namespace std::chrono_literals;
-            // notification is set
-            if (notificationText != "") {
-                footer.SetContent(notificationText);
-                screen.Post(Event::Custom);
-                std::this_thread::sleep_for(2s);
-                // clear notification
-                notificationText = "";
-                footer.ResetContent();
-                screen.Post(Event::Custom);
-            }
-            std::this_thread::sleep_for(0.2s);
-        }
-    });
+void OSTreeTUI::SetActive(bool active) {
+    this->active = active;
+    if (active && refreshPending) {
+        refreshPending = false;
+        refreshWithNotification();
+    }
+}
+
+bool OSTreeTUI::ShowNotification() {
+    // notification is set
+    if (notificationText == "") {
+        return false;
+    }
+    footer.SetContent(notificationText);
+    screen.Post(ftxui::Event::Custom);
+    return true;
+}
 
-    screen.Loop(mainContainer);
-    runSubThreads = false;
-    footerNotificationUpdater.join();
+void OSTreeTUI::ClearNotification() {
+    notificationText = "";
+    footer.ResetContent();
+    screen.Post(ftxui::Event::Custom);
+}
 
-    return EXIT_SUCCESS;
+void OSTreeTUI::SetSummarySigning(std::vector<std::string> keyIds, std::string gpgHomedir) {
+    summaryKeyIds = std::move(keyIds);
+    summaryGpgHomedir = std::move(gpgHomedir);
 }
 
 void OSTreeTUI::RefreshCommitComponents() {
     using namespace ftxui;
+    OSTREE_TUI_PROFILE_SCOPE("RefreshCommitComponents");
 
     commitComponents.clear();
     commitComponents.push_back(TrashBin::TrashBinComponent(*this));
@@ -201,6 +479,7 @@ void OSTreeTUI::RefreshCommitComponents() {
 
 void OSTreeTUI::RefreshCommitListComponent() {
     using namespace ftxui;
+    OSTREE_TUI_PROFILE_SCOPE("RefreshCommitListComponent");
 
     parseVisibleCommitMap();
 
@@ -211,16 +490,87 @@ void OSTreeTUI::RefreshCommitListComponent() {
 }
 
 bool OSTreeTUI::RefreshOSTreeRepository() {
-    ostreeRepo.UpdateData();
+    // branch ids change with the refs -> carry the visibility over by name
+    const std::vector<std::string> previousBranches = ostreeRepo.GetBranches();
+    const cpplibostree::BranchSet previousVisibleBranches = visibleBranches;
+    if (!ostreeRepo.UpdateData(false, REFRESH_LOCK_TIMEOUT)) {
+        waitForRepositoryLock();
+        return false;
+    }
+    prunePlanner->Clear();
+    signatureWorker->Clear();
+    const auto& branches = ostreeRepo.GetBranches();
+    visibleBranches = cpplibostree::BranchSet(branches.size());
+    for (size_t id{0}; id < branches.size(); id++) {
+        const std::string& branch = branches[id];
+        const auto previous =
+            std::lower_bound(previousBranches.begin(), previousBranches.end(), branch);
+        if (previous != previousBranches.end() && *previous == branch) {
+            const auto previousId = static_cast<size_t>(previous - previousBranches.begin());
+            visibleBranches.Set(id, previousVisibleBranches.Test(previousId));
+        } else {
+            // new ref
+            visibleBranches.Set(id);
+            std::hash<std::string> nameHash{};
+            branchColorMap[branch] = ftxui::Color::Palette256((nameHash(branch) + 10) % 256);
+        }
+    }
+    filterManager->RefreshRefTree(ostreeRepo);
+
     RefreshCommitListComponent();
+    // re-index & re-run an active search on the new data
+    searchIndexOutdated = true;
+    if (!searchQuery.empty()) {
+        updateSearchIndex();
+        searchGeneration = searchWorker->Search(searchQuery);
+        searchPending = true;
+    }
     return true;
 }
 
+void OSTreeTUI::waitForRepositoryLock() {
+    using namespace std::chrono;
+    if (lockWaitSeconds >= 0) {
+        return;
+    }
+    lockWaitSeconds = 0;
+    // the previous waiter finished already
+    lockWaiter = std::jthread([this](const std::stop_token& stop) {
+        g_autoptr(GCancellable) cancellable = g_cancellable_new();
+        const std::stop_callback cancel(stop, [&cancellable] {
+            g_cancellable_cancel(cancellable);
+        });
+        g_autoptr(GError) error{nullptr};
+        g_autoptr(OstreeRepo) repo =
+            ostree_repo_open_at(AT_FDCWD, ostreeRepo.GetRepoPath().c_str(), cancellable, &error);
+        const bool available =
+            repo != nullptr &&
+            cpplibostree::WaitForLock(
+                repo, cpplibostree::LockMode::SHARED, LOCK_WAIT_TIMEOUT,
+                [this](seconds waited) {
+                    lockWaitSeconds = waited.count();
+                    screen.Post(ftxui::Event::Custom);
+                },
+                cancellable, &error);
+        lockWaitSeconds = -1;
+        // retry, the lock may be taken again meanwhile -> wait again
+        if (available) {
+            requestRefresh();
+        } else {
+            screen.Post(ftxui::Event::Custom);
+        }
+    });
+}
+
 bool OSTreeTUI::SetViewMode(ViewMode newViewMode, const std::string& hash, bool setModeBranch) {
     // nothing to change
     if (newViewMode == viewMode && hash == modeHash) {
         return false;
     }
+    // promotion & drop windows change the repository
+    if (newViewMode != ViewMode::DEFAULT && refuseReadOnly()) {
+        return false;
+    }
     // deactivate promotion mode
     if (newViewMode == ViewMode::DEFAULT) {
         viewMode = ViewMode::DEFAULT;
@@ -251,50 +601,574 @@ bool OSTreeTUI::PromoteCommit(const std::string& hash,
                               const std::string& targetBranch,
                               const std::vector<std::string>& metadataStrings,
                               const std::string& newSubject,
-                              bool keepMetadata) {
-    bool success =
-        ostreeRepo.PromoteCommit(hash, targetBranch, metadataStrings, newSubject, keepMetadata);
+                              bool keepMetadata,
+                              bool staticDelta) {
     SetViewMode(ViewMode::DEFAULT);
-    // reload repository
-    if (success) {
-        scrollOffset = 0;
-        selectedCommit = 0;
-        screen.PostEvent(ftxui::Event::AltR);
-        notificationText = "Promoted commit " + hash.substr(0, 8) + " to branch " + targetBranch;
+    if (refuseReadOnly()) {
+        return false;
+    }
+    if (hash.empty() || targetBranch.empty() || targetBranch == cpplibostree::UNREACHABLE_BRANCH) {
+        return false;
     }
-    return success;
+    const auto* oldHead = ostreeRepo.GetBranchHead(targetBranch);
+    const std::string oldHeadHash = oldHead != nullptr ? oldHead->hash : "";
+    jobQueue->Submit(
+        "promote " + hash.substr(0, 8) + " → " + targetBranch,
+        [hash, targetBranch, metadataStrings, newSubject, keepMetadata](
+            OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+            std::string newCommit;
+            return cpplibostree::PromoteCommit(repo, hash, targetBranch, metadataStrings,
+                                               newSubject, keepMetadata, newCommit, cancellable,
+                                               error);
+        },
+        [this, hash, targetBranch, oldHeadHash, staticDelta](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this, hash, targetBranch] {
+                scrollOffset = 0;
+                selectedCommit = 0;
+                notificationText =
+                    "Promoted commit " + hash.substr(0, 8) + " to branch " + targetBranch;
+            });
+            // reload repository
+            requestRefresh();
+            // the new head is resolved from the ref, once the job runs
+            if (staticDelta) {
+                GenerateStaticDelta(oldHeadHash, targetBranch);
+            } else {
+                markSummaryDirty();
+            }
+        },
+        cpplibostree::LockMode::EXCLUSIVE);
+    notificationText = "Promoting commit " + hash.substr(0, 8) + "...";
+    return true;
+}
+
+void OSTreeTUI::GenerateStaticDelta(const std::string& from, const std::string& to) {
+    const std::string name =
+        "static delta " + (from.empty() ? "(scratch)" : from.substr(0, 8)) + " → " + to;
+    jobQueue->Submit(
+        name,
+        [from, to](OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+            return cpplibostree::GenerateStaticDelta(repo, from, to, cancellable, error);
+        },
+        [this](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this] { ostreeRepo.RefreshStaticDeltas(); });
+            // once, after the batch of deltas
+            markSummaryDirty();
+        },
+        cpplibostree::LockMode::SHARED);
 }
 
 bool OSTreeTUI::RemoveCommit(const cpplibostree::Commit& commit) {
-    bool success = ostreeRepo.RemoveCommitFromBranchAndPrune(commit);
+    if (refuseReadOnly()) {
+        SetViewMode(ViewMode::DEFAULT);
+        return false;
+    }
+    const auto plan = prunePlanner->Get(ostreeRepo, commit);
+    if (plan) {
+        SetViewMode(ViewMode::DEFAULT);
+        const std::string hash = commit.hash;
+        const std::string branch(commit.branch);
+        jobQueue->Submit(
+            "drop " + hash.substr(0, 8),
+            [plan](OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+                return cpplibostree::ExecutePrunePlan(repo, *plan, cancellable, error);
+            },
+            [this, hash, branch](bool success) {
+                if (!success) {
+                    // e.g. the repository changed: reloading drops the plan, it is made again
+                    requestRefresh();
+                    return;
+                }
+                screen.Post([this, hash, branch] {
+                    scrollOffset = 0;
+                    selectedCommit = 0;
+                    notificationText =
+                        "Dropped commit " + hash.substr(0, 8) + " from branch " + branch;
+                });
+                requestRefresh();
+                markSummaryDirty();
+            },
+            cpplibostree::LockMode::EXCLUSIVE);
+        notificationText = "Dropping commit " + hash.substr(0, 8) + "...";
+        return true;
+    }
+    if (!prunePlanner->Failed(commit.hash)) {
+        notificationText = "Still planning the drop, try again in a moment";
+        return false;
+    }
+
+    // the objects could not be planned (e.g. partial commits), let ostree prune decide
     SetViewMode(ViewMode::DEFAULT);
-    // reload repository
-    if (success) {
-        scrollOffset = 0;
-        selectedCommit = 0;
-        screen.PostEvent(ftxui::Event::AltR);
-        notificationText =
-            "Dropped commit " + commit.hash.substr(0, 8) + " from branch " + commit.branch;
-    } else {
-        notificationText = "Failed to drop commit";
+    const std::string hash = commit.hash;
+    const std::string branch(commit.branch);
+    jobQueue->Submit(
+        "drop " + hash.substr(0, 8),
+        [hash, branch](OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+            // unreachable commits have no ref to reset
+            return cpplibostree::DropCommit(
+                repo, hash, branch != cpplibostree::UNREACHABLE_BRANCH ? branch : "",
+                cancellable, error);
+        },
+        [this, hash, branch](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this, hash, branch] {
+                scrollOffset = 0;
+                selectedCommit = 0;
+                notificationText =
+                    "Dropped commit " + hash.substr(0, 8) + " from branch " + branch;
+            });
+            requestRefresh();
+            markSummaryDirty();
+        },
+        cpplibostree::LockMode::EXCLUSIVE);
+    notificationText = "Dropping commit " + hash.substr(0, 8) + "...";
+    return true;
+}
+
+void OSTreeTUI::CheckoutCommit(const std::string& hash, const std::string& destination) {
+    // written by the job, read once it finished
+    auto summary = std::make_shared<std::string>();
+    jobQueue->Submit(
+        "checkout " + hash.substr(0, 8),
+        [this, hash, destination, summary](OstreeRepo* repo, GCancellable* cancellable,
+                                           GError** error) {
+            const auto start = std::chrono::steady_clock::now();
+            return cpplibostree::CheckoutCommit(
+                repo, hash, destination,
+                [this, start, summary](uint64_t files, uint64_t bytes) {
+                    *summary = formatTransfer(files, bytes, start);
+                    jobQueue->ReportProgress(*summary);
+                },
+                cancellable, error);
+        },
+        [this, destination, summary](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this, destination, summary] {
+                notificationText = " Checked out to " + destination + " (" + *summary + ") ";
+            });
+        },
+        cpplibostree::LockMode::SHARED);
+    notificationText = "Checking out " + hash.substr(0, 8) + " to " + destination + "...";
+}
+
+void OSTreeTUI::ExportCommit(const std::string& hash, const std::string& destination) {
+    // written by the job, read once it finished
+    auto summary = std::make_shared<std::string>();
+    jobQueue->Submit(
+        "export " + hash.substr(0, 8),
+        [this, hash, destination, summary](OstreeRepo* repo, GCancellable* cancellable,
+                                           GError** error) {
+            const auto start = std::chrono::steady_clock::now();
+            return cpplibostree::ExportTarToFile(
+                repo, hash, destination,
+                [this, start, summary](uint64_t files, uint64_t bytes) {
+                    *summary = formatTransfer(files, bytes, start);
+                    jobQueue->ReportProgress(*summary);
+                },
+                cancellable, error);
+        },
+        [this, destination, summary](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this, destination, summary] {
+                notificationText = " Exported to " + destination + " (" + *summary + ") ";
+            });
+        },
+        cpplibostree::LockMode::SHARED);
+    notificationText = "Exporting " + hash.substr(0, 8) + " to " + destination + "...";
+}
+
+void OSTreeTUI::ImportCommit(const std::string& source,
+                             const std::string& branch,
+                             const std::string& subject) {
+    if (refuseReadOnly()) {
+        return;
     }
-    return success;
+    // written by the job, read once it finished
+    auto summary = std::make_shared<std::string>();
+    auto commit = std::make_shared<std::string>();
+    jobQueue->Submit(
+        "import " + branch,
+        [this, options = cpplibostree::ImportOptions{source, branch, subject, ""}, summary,
+         commit](OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+            const auto start = std::chrono::steady_clock::now();
+            return cpplibostree::ImportCommit(
+                repo, threadPool, options,
+                [this, start, summary](uint64_t files, uint64_t bytes) {
+                    *summary = formatTransfer(files, bytes, start);
+                    jobQueue->ReportProgress(*summary);
+                },
+                *commit, cancellable, error);
+        },
+        [this, branch, summary, commit](bool success) {
+            if (!success) {
+                return;
+            }
+            screen.Post([this, branch, summary, commit] {
+                notificationText = " Imported " + commit->substr(0, 8) + " on " + branch + " (" +
+                                   *summary + ") ";
+            });
+            requestRefresh();
+            markSummaryDirty();
+        },
+        // writing the objects does not block readers, the ref update upgrades the lock
+        cpplibostree::LockMode::SHARED);
+    notificationText = "Importing " + source + " to " + branch + "...";
 }
 
 void OSTreeTUI::parseVisibleCommitMap() {
-    // get filtered commits
-    visibleCommitViewMap = {};
-    for (const auto& commitPair : ostreeRepo.GetCommitList()) {
-        if (visibleBranches[commitPair.second.branch]) {
-            visibleCommitViewMap.push_back(commitPair.first);
+    OSTREE_TUI_PROFILE_SCOPE("parseVisibleCommitMap");
+    // visible slice of every visible branch (binary search on the sorted branch timelines)
+    std::vector<std::span<const cpplibostree::Commit* const>> slices;
+    size_t visibleCount{0};
+    visibleBranches.ForEach([&](size_t branchId) {
+        auto slice = ostreeRepo.GetBranchCommits(branchId, timeFilter);
+        if (!slice.empty()) {
+            slices.push_back(slice);
+            visibleCount += slice.size();
+        }
+    });
+
+    // k-way merge of the (already sorted) slices by date, newest first
+    OSTREE_TUI_PROFILE_SCOPE("mergeVisibleCommits");
+    visibleCommitViewMap.clear();
+    visibleCommitViewMap.reserve(visibleCount);
+    using Cursor = std::pair<size_t, size_t>;  // slice, position in slice
+    auto isOlder = [&](const Cursor& a, const Cursor& b) {
+        return slices[a.first][a.second]->timestamp < slices[b.first][b.second]->timestamp;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(isOlder)> heads(isOlder);
+    for (size_t i{0}; i < slices.size(); i++) {
+        heads.emplace(i, 0);
+    }
+    while (!heads.empty()) {
+        const auto [slice, position] = heads.top();
+        heads.pop();
+        visibleCommitViewMap.push_back(slices[slice][position]->hash);
+        if (position + 1 < slices[slice].size()) {
+            heads.emplace(slice, position + 1);
+        }
+    }
+}
+
+void OSTreeTUI::SetTimeFilter(const cpplibostree::TimeRange& range) {
+    if (range == timeFilter) {
+        return;
+    }
+    timeFilter = range;
+    selectedCommit = 0;
+    scrollOffset = 0;
+    RefreshCommitListComponent();
+}
+
+void OSTreeTUI::SetVisibleBranches(const cpplibostree::BranchSet& branches) {
+    if (branches == visibleBranches) {
+        return;
+    }
+    visibleBranches = branches;
+    RefreshCommitListComponent();
+}
+
+void OSTreeTUI::jumpToSameContent() {
+    if (visibleCommitViewMap.empty()) {
+        return;
+    }
+    const auto& current = ostreeRepo.GetCommitList().at(visibleCommitViewMap.at(selectedCommit));
+    const auto lineage = ostreeRepo.GetCommitsWithContent(current.contentChecksum);
+    if (lineage.size() < 2) {
+        notificationText = " No other commit with the same content ";
+        return;
+    }
+
+    // next commit of the lineage, wrapping around
+    const auto it = std::find(lineage.begin(), lineage.end(), &current);
+    const cpplibostree::Commit* target =
+        it == lineage.end() || it + 1 == lineage.end() ? lineage.front() : *(it + 1);
+
+    notificationText = " Same content on " + std::string(target->branch) + " (" +
+                       target->hash.substr(0, 8) +
+                       (SelectCommit(target->hash) ? ") " : "), outside of the time range ");
+}
+
+bool OSTreeTUI::SelectCommit(const std::string& hash) {
+    const auto commit = ostreeRepo.GetCommitList().find(hash);
+    if (commit == ostreeRepo.GetCommitList().end()) {
+        return false;
+    }
+
+    // make sure the branch of the commit is visible
+    const auto branchId = ostreeRepo.GetBranchId(commit->second.branch);
+    if (branchId && !visibleBranches.Test(*branchId)) {
+        cpplibostree::BranchSet branches = visibleBranches;
+        branches.Set(*branchId);
+        SetVisibleBranches(branches);
+    }
+
+    const auto position = std::find(visibleCommitViewMap.begin(), visibleCommitViewMap.end(), hash);
+    if (position == visibleCommitViewMap.end()) {
+        return false;
+    }
+    selectedCommit = static_cast<size_t>(position - visibleCommitViewMap.begin());
+    adjustScrollToSelectedCommit();
+    return true;
+}
+
+void OSTreeTUI::updateSearchIndex() {
+    if (!searchIndexOutdated) {
+        return;
+    }
+    // copies share the serialized commit objects, subjects & bodies are decoded by the worker
+    std::vector<cpplibostree::Commit> commits;
+    commits.reserve(ostreeRepo.GetCommitList().size());
+    for (const auto& [hash, commit] : ostreeRepo.GetCommitList()) {
+        commits.push_back(commit);
+    }
+    searchWorker->SetDocuments([commits = std::move(commits)] {
+        std::vector<Search::SearchDocument> documents;
+        documents.reserve(commits.size());
+        for (const auto& commit : commits) {
+            documents.push_back({commit.hash, std::string(commit.Subject()),
+                                 std::string(commit.Body()), std::string(commit.Version())});
+        }
+        return documents;
+    });
+    searchIndexOutdated = false;
+}
+
+void OSTreeTUI::openSearch() {
+    updateSearchIndex();
+    searchActive = true;
+    searchOrigin = selectedCommit;
+}
+
+void OSTreeTUI::closeSearch(bool clear) {
+    searchActive = false;
+    if (clear) {
+        searchWorker->Cancel();
+        searchQuery.clear();
+        searchHits.clear();
+        searchPending = false;
+    }
+}
+
+bool OSTreeTUI::handleSearchInput(const ftxui::Event& event) {
+    using namespace ftxui;
+
+    if (event == Event::Return) {
+        closeSearch(false);
+        return true;
+    }
+    if (event == Event::Escape) {
+        closeSearch(true);
+        return true;
+    }
+    if (event == Event::Backspace) {
+        // remove last UTF-8 character
+        while (!searchQuery.empty() && (searchQuery.back() & 0xC0) == 0x80) {
+            searchQuery.pop_back();
+        }
+        if (!searchQuery.empty()) {
+            searchQuery.pop_back();
+        }
+    } else if (event.is_character()) {
+        searchQuery += event.character();
+    } else {
+        // ignore other keys, but do not pass them on
+        return true;
+    }
+
+    if (searchQuery.empty()) {
+        searchWorker->Cancel();
+        searchHits.clear();
+        searchPending = false;
+        return true;
+    }
+    searchGeneration = searchWorker->Search(searchQuery);
+    searchPending = true;
+    return true;
+}
+
+void OSTreeTUI::openPrompt(std::string label,
+                           std::string input,
+                           std::function<void(const std::string&)> onSubmit) {
+    prompt = Prompt{std::move(label), std::move(input), std::move(onSubmit)};
+}
+
+bool OSTreeTUI::handlePromptInput(const ftxui::Event& event) {
+    using namespace ftxui;
+
+    if (event == Event::Return) {
+        // close first, onSubmit may open the next prompt
+        Prompt submitted = std::move(*prompt);
+        prompt.reset();
+        if (!submitted.input.empty()) {
+            submitted.onSubmit(submitted.input);
+        }
+        return true;
+    }
+    if (event == Event::Escape) {
+        prompt.reset();
+        return true;
+    }
+    std::string& input = prompt->input;
+    if (event == Event::Backspace) {
+        // remove last UTF-8 character
+        while (!input.empty() && (input.back() & 0xC0) == 0x80) {
+            input.pop_back();
+        }
+        if (!input.empty()) {
+            input.pop_back();
+        }
+    } else if (event.is_character()) {
+        input += event.character();
+    }
+    // ignore other keys, but do not pass them on
+    return true;
+}
+
+void OSTreeTUI::applySearchResults(uint64_t generation, std::vector<std::string> hits) {
+    // stale results of an outdated query
+    if (generation != searchGeneration || searchQuery.empty()) {
+        return;
+    }
+    searchPending = false;
+    searchHits = std::unordered_set<std::string>(std::make_move_iterator(hits.begin()),
+                                                 std::make_move_iterator(hits.end()));
+    // jump to the first hit, starting from where the search was opened
+    if (!searchHits.empty() && !visibleCommitViewMap.empty()) {
+        SetSelectedCommit(std::min(searchOrigin, visibleCommitViewMap.size() - 1));
+        if (!searchHits.contains(visibleCommitViewMap.at(selectedCommit))) {
+            jumpToSearchHit(true);
         }
     }
-    // sort by date
-    std::sort(visibleCommitViewMap.begin(), visibleCommitViewMap.end(),
-              [&](const std::string& a, const std::string& b) {
-                  return ostreeRepo.GetCommitList().at(a).timestamp >
-                         ostreeRepo.GetCommitList().at(b).timestamp;
-              });
+}
+
+void OSTreeTUI::jumpToSearchHit(bool forward) {
+    const size_t count = visibleCommitViewMap.size();
+    for (size_t step{1}; step <= count; step++) {
+        const size_t index =
+            forward ? (selectedCommit + step) % count : (selectedCommit + count - step) % count;
+        if (searchHits.contains(visibleCommitViewMap.at(index))) {
+            SetSelectedCommit(index);
+            return;
+        }
+    }
+}
+
+std::string OSTreeTUI::searchStatus() const {
+    if (searchPending) {
+        return "searching...";
+    }
+    if (searchQuery.empty()) {
+        return "type to search subject, body, version or hash";
+    }
+    if (searchHits.empty()) {
+        return "no hits";
+    }
+    return std::to_string(searchHits.size()) + " hits" +
+           (searchActive ? "  (Enter: keep, Esc: cancel)" : "  (n / N: next / previous)");
+}
+
+void OSTreeTUI::verifySummaryRefs() {
+    auto stale = std::make_shared<bool>(false);
+    jobQueue->Submit(
+        "verify refs",
+        [loadedRefs = ostreeRepo.GetRefs(), stale](OstreeRepo* repo, GCancellable* /*cancellable*/,
+                                                   GError** error) {
+            // only the local refs came from the summary, remote refs (`remote:ref`) were listed
+            cpplibostree::RefList summaryRefs;
+            std::ranges::copy_if(loadedRefs, std::back_inserter(summaryRefs), [](const auto& ref) {
+                return ref.first.find(':') == std::string::npos;
+            });
+            cpplibostree::RefList refs;
+            if (!cpplibostree::ListRefs(repo, refs, error, true)) {
+                return false;
+            }
+            *stale = refs != summaryRefs;
+            return true;
+        },
+        [this, stale](bool success) {
+            // refresh with a directory scan
+            if (success && *stale) {
+                requestRefresh();
+            }
+        },
+        cpplibostree::LockMode::SHARED);
+}
+
+void OSTreeTUI::markSummaryDirty() {
+    const auto summaryPath = std::filesystem::path(ostreeRepo.GetRepoPath()) / "summary";
+    if (summaryKeyIds.empty() && !std::filesystem::exists(summaryPath)) {
+        return;
+    }
+    jobQueue->SubmitCoalesced(
+        "summary update",
+        [this](OstreeRepo* repo, GCancellable* cancellable, GError** error) {
+            return cpplibostree::RegenerateSummary(repo, summaryKeyIds, summaryGpgHomedir,
+                                                   cancellable, error);
+        },
+        [this](bool success) {
+            if (success) {
+                screen.Post([this] { notificationText = " Updated Summary "; });
+            }
+        },
+        SUMMARY_DEBOUNCE,
+        cpplibostree::LockMode::EXCLUSIVE);
+}
+
+bool OSTreeTUI::refuseReadOnly() {
+    if (!ostreeRepo.IsSysroot()) {
+        return false;
+    }
+    notificationText = " Sysroot tabs are read-only ";
+    return true;
+}
+
+void OSTreeTUI::requestRefresh() {
+    screen.Post([this] {
+        if (!active) {
+            refreshPending = true;
+            return;
+        }
+        refreshWithNotification();
+    });
+    screen.Post(ftxui::Event::Custom);
+}
+
+void OSTreeTUI::refreshWithNotification() {
+    notificationText = RefreshOSTreeRepository()
+                           ? " Refreshed Repository Data "
+                           : " Repository is locked, refreshing once it is free ";
+}
+
+std::string OSTreeTUI::jobStatus() const {
+    const auto jobs = jobQueue->GetStatus();
+    if (const int64_t waited = lockWaitSeconds; waited >= 0 && jobs.running.empty()) {
+        return "⧗ refresh waiting for lock (" + std::to_string(waited) + "s)";
+    }
+    if (!jobs.running.empty()) {
+        return "⟳ " + jobs.running + (jobs.progress.empty() ? "" : ": " + jobs.progress) + " (" +
+               std::to_string(jobs.batchDone + 1) + "/" + std::to_string(jobs.batchTotal) +
+               ")  Alt+K : Cancel";
+    }
+    if (jobs.batchFailed > 0) {
+        return "✖ " + jobs.lastError;
+    }
+    if (jobs.pending > 0) {
+        return "⧗ " + std::to_string(jobs.pending) + " job(s) scheduled";
+    }
+    return "";
 }
 
 void OSTreeTUI::adjustScrollToSelectedCommit() {
@@ -334,6 +1208,22 @@ ftxui::ScreenInteractive& OSTreeTUI::GetScreen() {
     return screen;
 }
 
+ftxui::Component& OSTreeTUI::GetMainContainer() {
+    return mainContainer;
+}
+
+cpplibostree::DiskUsageWorker& OSTreeTUI::GetDiskUsageWorker() {
+    return *diskUsageWorker;
+}
+
+cpplibostree::PrunePlanner& OSTreeTUI::GetPrunePlanner() {
+    return *prunePlanner;
+}
+
+cpplibostree::JobQueue& OSTreeTUI::GetJobQueue() {
+    return *jobQueue;
+}
+
 // GETTER
 const cpplibostree::OSTreeRepo& OSTreeTUI::GetOstreeRepo() const {
     return ostreeRepo;
@@ -347,10 +1237,14 @@ const std::string& OSTreeTUI::GetModeBranch() const {
     return modeBranch;
 }
 
-const std::unordered_map<std::string, bool>& OSTreeTUI::GetVisibleBranches() const {
+const cpplibostree::BranchSet& OSTreeTUI::GetVisibleBranches() const {
     return visibleBranches;
 }
 
+const cpplibostree::TimeRange& OSTreeTUI::GetTimeFilter() const {
+    return timeFilter;
+}
+
 const std::vector<std::string>& OSTreeTUI::GetColumnToBranchMap() const {
     return columnToBranchMap;
 }
@@ -375,6 +1269,14 @@ const std::string& OSTreeTUI::GetModeHash() const {
     return modeHash;
 }
 
+const std::string& OSTreeTUI::GetDiffBase() const {
+    return diffBase;
+}
+
+bool OSTreeTUI::GetShowLineage() const {
+    return showLineage;
+}
+
 // STATIC
 int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessage) {
     using namespace ftxui;
@@ -385,6 +1287,23 @@ int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessa
         {"-h, --help", "", "Show help options. The REPOSITORY_PATH can be omitted"},
         {"-r, --refs", "REF [REF...]",
          "Specify a list of visible refs at startup if not specified, show all refs"},
+        {"--record", "FILE", "Record all input events to FILE, to replay with ostree-tui-replay"},
+        {"--since", "TIME",
+         "Only show commits since TIME (YYYY-MM-DD [HH:MM], or relative like 48h, 7d)"},
+        {"--until", "TIME", "Only show commits until TIME (same formats as --since)"},
+        {"--sign-summary", "KEY-ID [KEY-ID...]",
+         "GPG sign the summary, when it is regenerated after a promotion or drop"},
+        {"--gpg-homedir", "DIR", "GPG home directory of the --sign-summary keys"},
+        {"--scan-objects", "",
+         "Load all commit objects in parallel, showing unreachable commits as (unreachable)"},
+        {"--sysroot", "[PATH...]",
+         "Show the deployments of sysroots (default /, read-only) instead of repositories"},
+        {"--depth", "N", "Parents loaded per deployment with --sysroot (default 20)"},
+        {"--profile", "FILE", "Write a Chrome trace-event JSON of all timed phases to FILE on exit"},
+        {"--import", "SOURCE REF [SUBJECT]",
+         "Commit a directory or tarball (plain, gzip or zstd) on top of REF, and exit"},
+        {"--export-tar", "REV [FILE]",
+         "Write the tree of REV as tar archive to FILE (zstd for .tar.zst) or stdout, and exit"},
     };
 
     Elements options{text("Options:")};
@@ -399,7 +1318,7 @@ int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessa
     auto helpPage = vbox(
         {errorMessage.empty() ? filler() : (text(errorMessage) | bold | color(Color::Red) | flex),
          hbox({text("Usage: "), text(caller) | color(Color::GrayLight),
-               text(" REPOSITORY_PATH") | color(Color::Yellow),
+               text(" REPOSITORY_PATH [REPOSITORY_PATH...]") | color(Color::Yellow),
                text(" [OPTION...]") | color(Color::Yellow)}),
          text(""),
          hbox({
@@ -420,6 +1339,65 @@ int OSTreeTUI::showHelp(const std::string& caller, const std::string& errorMessa
     return errorMessage.empty();
 }
 
+int OSTreeTUI::exportTar(const std::string& repoPath,
+                         const std::string& rev,
+                         const std::string& destination) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(OstreeRepo) repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        std::cerr << "could not open repository " << repoPath << ": " << error->message << "\n";
+        return 1;
+    }
+    if (destination.empty() && isatty(STDOUT_FILENO) != 0) {
+        std::cerr << "refusing to write a tar archive to a terminal, pass a FILE\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::string summary;
+    const auto onProgress = [&](uint64_t files, uint64_t bytes) {
+        summary = formatTransfer(files, bytes, start);
+    };
+    const bool success =
+        destination.empty()
+            ? cpplibostree::ExportTar(repo, rev, STDOUT_FILENO, cpplibostree::TarCompression::NONE,
+                                      onProgress, nullptr, &error)
+            : cpplibostree::ExportTarToFile(repo, rev, destination, onProgress, nullptr, &error);
+    if (!success) {
+        std::cerr << "could not export " << rev << ": " << error->message << "\n";
+        return 1;
+    }
+    std::cerr << "exported " << rev << " (" << summary << ")\n";
+    return 0;
+}
+
+int OSTreeTUI::importCommit(const std::string& repoPath,
+                            const std::string& source,
+                            const std::string& branch,
+                            const std::string& subject) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(OstreeRepo) repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        std::cerr << "could not open repository " << repoPath << ": " << error->message << "\n";
+        return 1;
+    }
+
+    cpplibostree::ThreadPool pool;
+    const auto start = std::chrono::steady_clock::now();
+    std::string summary;
+    std::string commit;
+    if (!cpplibostree::ImportCommit(
+            repo, pool, {source, branch, subject.empty() ? "Import of " + source : subject, ""},
+            [&](uint64_t files, uint64_t bytes) { summary = formatTransfer(files, bytes, start); },
+            commit, nullptr, &error)) {
+        std::cerr << "could not import " << source << ": " << error->message << "\n";
+        return 1;
+    }
+    std::cerr << "imported " << source << " (" << summary << ")\n";
+    std::cout << commit << "\n";
+    return 0;
+}
+
 int OSTreeTUI::showVersion() {
     using namespace ftxui;
 
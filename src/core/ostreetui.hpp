@@ -5,8 +5,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "ftxui/component/component.hpp"  // for Renderer, ResizableSplitBottom, ResizableSplitLeft, ResizableSplitRight, ResizableSplitTop
@@ -15,14 +22,38 @@
 #include "ftxui/dom/elements.hpp"                  // for Element, operator|, text, center, border
 
 #include "commit.hpp"
+#include "diffview.hpp"
+#include "filetree.hpp"
 #include "footer.hpp"
 #include "manager.hpp"
 #include "trashbin.hpp"
 
+#include "../util/branchset.hpp"
+#include "../util/commitdiff.hpp"
 #include "../util/cpplibostree.hpp"
+#include "../util/diskusage.hpp"
+#include "../util/jobqueue.hpp"
+#include "../util/pruneplan.hpp"
+#include "../util/searchindex.hpp"
+#include "../util/signatures.hpp"
+#include "../util/stringtable.hpp"
+#include "../util/threadpool.hpp"
+#include "../util/treereader.hpp"
+
+struct BenchmarkAccess;
 
 enum ViewMode : uint8_t { DEFAULT, COMMIT_DRAGGING, COMMIT_PROMOTION, COMMIT_DROP };
 
+/**
+ * @brief Shared by the OSTreeTUIs of all repository tabs (see RepoTabs): one screen, one worker
+ * pool & one table of branch names, instead of one each per repository.
+ */
+struct TuiContext {
+    ftxui::ScreenInteractive screen{ftxui::ScreenInteractive::Fullscreen()};
+    cpplibostree::ThreadPool threadPool;
+    cpplibostree::StringTable strings;
+};
+
 class OSTreeTUI {
    public:
     /**
@@ -31,16 +62,60 @@ class OSTreeTUI {
      * @param repo Path to the OSTree repository directory.
      * @param startupBranches Optional list of branches to pre-select at startup (providing nothing
      * will display all branches).
+     * @param startupTimeRange Optional time range filter to apply at startup.
+     * @param scanObjects Load all commit objects (in parallel), instead of following the refs.
+     * Commits not reachable from any ref are shown on cpplibostree::UNREACHABLE_BRANCH.
+     * @param sysrootDepth Treat repo as sysroot: load only its deployed commits & this many
+     * parents of each, marking the booted, pending & rollback commits.
+     * @param sharedContext Screen, worker pool & string table shared with other tabs, outliving
+     * the OSTreeTUI. nullptr uses an own one.
      */
     explicit OSTreeTUI(const std::string& repo,
-                       const std::vector<std::string>& startupBranches = {});
+                       const std::vector<std::string>& startupBranches = {},
+                       const cpplibostree::TimeRange& startupTimeRange = {},
+                       bool scanObjects = false,
+                       std::optional<size_t> sysrootDepth = std::nullopt,
+                       TuiContext* sharedContext = nullptr);
 
     /**
-     * @brief Runs the OSTreeTUI (starts the ftxui screen loop).
+     * @brief Constructs the OSTreeTUI of a repository, that was loaded in the background (see
+     * cpplibostree::OSTreeRepo::Open()).
      *
-     * @return Exit Code
+     * @param repo Loaded repository.
+     * @param startupBranches, startupTimeRange see OSTreeTUI()
+     * @param sharedContext Screen, worker pool & string table shared with other tabs, the
+     * repository was loaded with, outliving the OSTreeTUI.
+     */
+    OSTreeTUI(cpplibostree::OSTreeRepo&& repo,
+              const std::vector<std::string>& startupBranches,
+              const cpplibostree::TimeRange& startupTimeRange,
+              TuiContext& sharedContext);
+
+    /**
+     * @brief Marks the OSTreeTUI as shown (or hidden) tab. Hidden tabs postpone the refreshes
+     * requested by their background jobs, until they are shown again.
+     *
+     * @param active true, if the tab is shown.
+     */
+    void SetActive(bool active);
+
+    /**
+     * @brief Moves a pending notification into the footer (called by the notification thread).
+     *
+     * @return true, if a notification is shown now.
      */
-    int Run();
+    bool ShowNotification();
+
+    /// @brief Removes the notification from the footer (called by the notification thread).
+    void ClearNotification();
+
+    /**
+     * @brief Signs the summary, whenever it is regenerated after a repository change.
+     *
+     * @param keyIds GPG key IDs to sign with.
+     * @param gpgHomedir GPG home directory of the keys, empty for the default one.
+     */
+    void SetSummarySigning(std::vector<std::string> keyIds, std::string gpgHomedir);
 
     /// @brief OSTreeTUI Refresh Level 3: Refreshes the commit components.
     void RefreshCommitComponents();
@@ -48,7 +123,12 @@ class OSTreeTUI {
     /// @brief OSTreeTUI Refresh Level 2: Refreshes the commit list component & upper levels.
     void RefreshCommitListComponent();
 
-    /// @brief OSTreeTUI Refresh Level 1: Refreshes complete repository & upper levels.
+    /**
+     * @brief OSTreeTUI Refresh Level 1: Refreshes complete repository & upper levels.
+     *
+     * @return false if the repository is locked (e.g. by a prune), it is refreshed in the
+     * background, once the lock is free.
+     */
     bool RefreshOSTreeRepository();
 
     /**
@@ -74,68 +154,243 @@ class OSTreeTUI {
      * @param metadataStrings Optional additional metadata-strings to be set.
      * @param newSubject New commit subject.
      * @param keepMetadata Keep metadata of old commit.
+     * @param staticDelta Generate a static delta from the old to the new target branch head
+     * (in the background).
      * @return promotion success
      */
     bool PromoteCommit(const std::string& hash,
                        const std::string& targetBranch,
                        const std::vector<std::string>& metadataStrings = {},
                        const std::string& newSubject = "",
-                       bool keepMetadata = true);
+                       bool keepMetadata = true,
+                       bool staticDelta = false);
 
     /**
-     * @brief Remove a commit from the OSTree repo and refresh the UI.
+     * @brief Queues the generation of a static delta as background job. The summary is
+     * updated once the batch of deltas is done.
+     *
+     * @param from Commit (or ref) the delta starts from, empty for a delta from scratch.
+     * @param to Commit (or ref) the delta leads to.
+     */
+    void GenerateStaticDelta(const std::string& from, const std::string& to);
+
+    /**
+     * @brief Selects a commit in the commit list, showing its branch if necessary.
+     *
+     * @param hash Hash of the commit to select.
+     * @return false, if the commit is not visible (e.g. outside of the time range).
+     */
+    bool SelectCommit(const std::string& hash);
+
+    /**
+     * @brief Remove a commit from the OSTree repo and refresh the UI. The finished prune plan of
+     * the commit is executed as background job (if it could not be planned, only the commit
+     * itself is dropped by cpplibostree::DropCommit(), also under an exclusive lock).
      *
      * @param commit Commit to remove.
-     * @return True on success.
+     * @return True on success (or if the drop was queued).
      */
     bool RemoveCommit(const cpplibostree::Commit& commit);
 
+    /**
+     * @brief Checks a commit out into a new directory as background job (hardlinks where
+     * possible), its progress & throughput are shown in the footer.
+     *
+     * @param hash Hash of the commit to check out.
+     * @param destination Directory to create.
+     */
+    void CheckoutCommit(const std::string& hash, const std::string& destination);
+
+    /**
+     * @brief Streams the tree of a commit into a tar archive as background job (zstd
+     * compressed, if the destination ends with .tar.zst).
+     *
+     * @param hash Hash of the commit to export.
+     * @param destination Path of the archive to create.
+     */
+    void ExportCommit(const std::string& hash, const std::string& destination);
+
+    /**
+     * @brief Commits a directory or tarball on top of a branch as background job, content
+     * objects are written in parallel.
+     *
+     * @param source Directory, or tarball (plain, gzip or zstd compressed).
+     * @param branch Branch to commit to, created if it doesn't exist.
+     * @param subject Subject of the commit.
+     */
+    void ImportCommit(const std::string& source,
+                      const std::string& branch,
+                      const std::string& subject);
+
    private:
+    /// grants the benchmark suite (bench/bench.cpp) access to the view-map stage
+    friend struct ::BenchmarkAccess;
+
+    /// @brief Builds and assembles all components, once the repository is loaded.
+    void buildComponents(const std::vector<std::string>& startupBranches);
+
     /// @brief Calculates all visible commits from an OSTreeRepo and a list of branches.
     void parseVisibleCommitMap();
 
     /// @brief Adjust scroll offset to fit the selected commit.
     void adjustScrollToSelectedCommit();
 
+    /// @brief Passes all commits to the search worker, if the repository changed.
+    void updateSearchIndex();
+
+    /// @brief Opens the search prompt in the footer.
+    void openSearch();
+
+    /**
+     * @brief Closes the search prompt.
+     *
+     * @param clear Also drop the query & its hits (otherwise they stay available for n / N).
+     */
+    void closeSearch(bool clear);
+
+    /// @brief Edits the search query while the search prompt is open.
+    bool handleSearchInput(const ftxui::Event& event);
+
+    /// @brief Receives results of the search worker (on the UI thread).
+    void applySearchResults(uint64_t generation, std::vector<std::string> hits);
+
+    /// @brief Selects the next (or previous) visible commit matching the search.
+    void jumpToSearchHit(bool forward);
+
+    /// @return Status of the current search, for the footer.
+    [[nodiscard]] std::string searchStatus() const;
+
+    /// @return Status of the background jobs, for the footer (empty if there is nothing to show).
+    [[nodiscard]] std::string jobStatus() const;
+
+    /// @brief Waits for the repository lock in the background & refreshes once it is free.
+    void waitForRepositoryLock();
+
+    /**
+     * @brief Checks if the repository must not be changed, notifying about it. Sysroot tabs are
+     * read-only: their refs are synthesized from the deployment origins and only a window of
+     * commits is loaded, a drop planned on it could delete objects of the booted system.
+     *
+     * @return true, if the change has to be refused.
+     */
+    bool refuseReadOnly();
+
+    /// @brief Refreshes the repository (like Alt+R), postponed while the tab is hidden.
+    void requestRefresh();
+
+    /// @brief Refreshes the repository & notifies about the result.
+    void refreshWithNotification();
+
+    /**
+     * @brief Compares the refs read from the summary at startup with the refs directories (in
+     * a background job) & refreshes the repository, if they differ.
+     */
+    void verifySummaryRefs();
+
+    /**
+     * @brief Marks the summary as outdated after a repository change. It is regenerated by a
+     * debounced job, so a burst of changes causes one regeneration. Repositories without a
+     * summary only get one, if it is signed.
+     */
+    void markSummaryDirty();
+
+    /**
+     * @brief Selects the next commit with the same content as the selected one (e.g. its
+     * promotion), showing its branch if necessary.
+     */
+    void jumpToSameContent();
+
+    /**
+     * @brief Opens a prompt in the footer, capturing the keyboard until it is submitted (Enter)
+     * or cancelled (Escape).
+     *
+     * @param label Text in front of the input.
+     * @param input Initial input.
+     * @param onSubmit Called with the input, when it is submitted.
+     */
+    void openPrompt(std::string label,
+                    std::string input,
+                    std::function<void(const std::string&)> onSubmit);
+
+    /// @brief Edits the input while the prompt is open.
+    bool handlePromptInput(const ftxui::Event& event);
+
    public:
     // SETTER
     void SetModeBranch(const std::string& modeBranch);
     void SetSelectedCommit(size_t selectedCommit);
     void SetNotificationText(const std::string& notification);
+    /// @brief Sets the time range filter & refreshes the commit list, if it changed.
+    void SetTimeFilter(const cpplibostree::TimeRange& range);
+    /// @brief Sets the visibility of all branches at once & refreshes the commit list (once).
+    void SetVisibleBranches(const cpplibostree::BranchSet& branches);
 
     // non-const GETTER
     [[nodiscard]] std::vector<std::string>& GetColumnToBranchMap();
     [[nodiscard]] ftxui::ScreenInteractive& GetScreen();
+    [[nodiscard]] ftxui::Component& GetMainContainer();
+    [[nodiscard]] cpplibostree::DiskUsageWorker& GetDiskUsageWorker();
+    [[nodiscard]] cpplibostree::PrunePlanner& GetPrunePlanner();
+    [[nodiscard]] cpplibostree::JobQueue& GetJobQueue();
 
     // GETTER
     [[nodiscard]] const cpplibostree::OSTreeRepo& GetOstreeRepo() const;
     [[nodiscard]] const size_t& GetSelectedCommit() const;
     [[nodiscard]] const std::string& GetModeBranch() const;
-    [[nodiscard]] const std::unordered_map<std::string, bool>& GetVisibleBranches() const;
+    /// @return Visibility of all branches, indexed by dense branch id (see OSTreeRepo).
+    [[nodiscard]] const cpplibostree::BranchSet& GetVisibleBranches() const;
+    [[nodiscard]] const cpplibostree::TimeRange& GetTimeFilter() const;
     [[nodiscard]] const std::vector<std::string>& GetColumnToBranchMap() const;
     [[nodiscard]] const std::vector<std::string>& GetVisibleCommitViewMap() const;
     [[nodiscard]] const std::unordered_map<std::string, ftxui::Color>& GetBranchColorMap() const;
     [[nodiscard]] int GetScrollOffset() const;
     [[nodiscard]] ViewMode GetViewMode() const;
     [[nodiscard]] const std::string& GetModeHash() const;
+    /// @return Commit marked as diff base, empty if none is marked.
+    [[nodiscard]] const std::string& GetDiffBase() const;
+    [[nodiscard]] bool GetShowLineage() const;
 
    private:
+    // shared with the other tabs, outlives all
+    std::unique_ptr<TuiContext> ownContext;  // if not hosted in tabs
+    TuiContext& context;
+    cpplibostree::ThreadPool& threadPool;  // object scan & background traversals
+    ftxui::ScreenInteractive& screen;
+
     // model
     cpplibostree::OSTreeRepo ostreeRepo;
 
     // backend states
     size_t selectedCommit;
-    std::unordered_map<std::string, bool> visibleBranches;  // map branch -> visibe
+    cpplibostree::BranchSet visibleBranches;     // branch id -> visible
+    cpplibostree::TimeRange timeFilter;          // visible time window
     std::vector<std::string> columnToBranchMap;             // map branch -> column in commit-tree
     std::vector<std::string> visibleCommitViewMap;          // map view-index -> commit-hash
     std::unordered_map<std::string, ftxui::Color> branchColorMap;  // map branch -> color
     std::string notificationText;                                  // footer notification
 
     // view states
+    bool active{false};          // shown tab, only UI thread
+    bool refreshPending{false};  // refresh requested while hidden
     int scrollOffset{0};
+    bool showPerformanceHud{false};
+    bool showLineage{false};  // draw connectors between commits with the same content
+    bool showDeltaEstimate{false};  // show the update size from the parent in the info view
+    bool hudEnabledProfiler{false};
     ViewMode viewMode = ViewMode::DEFAULT;
     std::string modeHash;
     std::string modeBranch;
+    std::string diffBase;  // marked commit, the diff tab diffs against (instead of the parent)
+
+    // repository lock, the UI only waits briefly & refreshes once a background waiter saw it free
+    static constexpr std::chrono::milliseconds REFRESH_LOCK_TIMEOUT{200};
+    static constexpr std::chrono::milliseconds LOCK_WAIT_TIMEOUT{std::chrono::hours{1}};
+    std::atomic<int64_t> lockWaitSeconds{-1};  // seconds the waiter waits, -1 if none waits
+
+    // summary regeneration
+    static constexpr std::chrono::milliseconds SUMMARY_DEBOUNCE{2000};
+    std::vector<std::string> summaryKeyIds;
+    std::string summaryGpgHomedir;
 
     // view constants
     int logSize{45};
@@ -144,8 +399,10 @@ class OSTreeTUI {
     // components
     Footer footer;
     std::unique_ptr<BranchBoxManager> filterManager{nullptr};
+    std::unique_ptr<CompareManager> compareManager{nullptr};
+    std::unique_ptr<cpplibostree::TreeReader> treeReader{nullptr};
+    std::unique_ptr<FileTree> fileTree{nullptr};
     std::unique_ptr<Manager> manager{nullptr};
-    ftxui::ScreenInteractive screen;
     ftxui::Component mainContainer;
     ftxui::Components commitComponents;
     ftxui::Component commitList;
@@ -153,10 +410,38 @@ class OSTreeTUI {
     ftxui::Component commitListComponent;
     ftxui::Component infoView;
     ftxui::Component filterView;
+    ftxui::Component compareView;
+    ftxui::Component filesView;
+    ftxui::Component diffView;
     ftxui::Component managerRenderer;
     ftxui::Component FooterRenderer;
     ftxui::Component container;
 
+    // footer prompt (e.g. the checkout destination)
+    struct Prompt {
+        std::string label;
+        std::string input;
+        std::function<void(const std::string&)> onSubmit;
+    };
+    std::optional<Prompt> prompt;
+
+    // search
+    bool searchActive{false};   // search prompt is open
+    bool searchPending{false};  // waiting for worker results
+    bool searchIndexOutdated{true};
+    std::string searchQuery;
+    std::unordered_set<std::string> searchHits;  // hashes of all matching commits
+    uint64_t searchGeneration{0};
+    size_t searchOrigin{0};  // selected commit when the search was opened
+    // declared last, the worker thread posts to the screen & has to stop first
+    std::unique_ptr<Search::CommitSearchWorker> searchWorker;
+    std::unique_ptr<cpplibostree::DiskUsageWorker> diskUsageWorker;
+    std::unique_ptr<cpplibostree::PrunePlanner> prunePlanner;
+    std::unique_ptr<cpplibostree::SignatureWorker> signatureWorker;
+    std::unique_ptr<cpplibostree::CommitDiffer> commitDiffer;
+    std::unique_ptr<cpplibostree::JobQueue> jobQueue;
+    std::jthread lockWaiter;  // stopped (cancelled) first
+
    public:
     /**
      * @brief Print a help page including usage, options, etc.
@@ -173,4 +458,30 @@ class OSTreeTUI {
      * @return Exit Code
      */
     static int showVersion();
+
+    /**
+     * @brief Export the tree of a commit as tar archive, without starting the TUI
+     *
+     * @param repoPath Path of the repository.
+     * @param rev Commit or ref to export.
+     * @param destination Archive to create, stdout if empty.
+     * @return Exit Code
+     */
+    static int exportTar(const std::string& repoPath,
+                         const std::string& rev,
+                         const std::string& destination);
+
+    /**
+     * @brief Commit a directory or tarball on top of a branch, without starting the TUI
+     *
+     * @param repoPath Path of the repository.
+     * @param source Directory or tarball to import.
+     * @param branch Branch to commit to.
+     * @param subject Subject of the commit, "Import of SOURCE" if empty.
+     * @return Exit Code
+     */
+    static int importCommit(const std::string& repoPath,
+                            const std::string& source,
+                            const std::string& branch,
+                            const std::string& subject);
 };
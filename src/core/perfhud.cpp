@@ -0,0 +1,63 @@
+#include "perfhud.hpp"
+
+#include <chrono>
+#include <format>
+#include <string>
+
+#include "ftxui/dom/elements.hpp"  // for Element, operator|, text, window, hbox, vbox
+#include "ftxui/screen/color.hpp"  // for Color
+
+#include "../util/profiler.hpp"
+
+namespace PerformanceHud {
+
+namespace {
+std::string formatMs(std::chrono::nanoseconds duration) {
+    return std::format("{:9.2f}", std::chrono::duration<double, std::milli>(duration).count());
+}
+}  // namespace
+
+ftxui::Element Render(size_t commitCount, size_t visibleCommitCount) {
+    using namespace ftxui;
+
+    if (!Profiler::IsEnabled()) {
+        return window(text(" Performance "), text(" instrumentation disabled ") | dim);
+    }
+
+    Elements names{text("phase") | bold};
+    Elements calls{text(" calls") | bold};
+    Elements last{text("   last ms") | bold};
+    Elements load{text("   load ms") | bold};
+    std::chrono::nanoseconds layoutTime{0};
+    for (const auto& phase : Profiler::GetPhases()) {
+        if (phase.name == "layout") {
+            layoutTime = phase.last;
+            continue;
+        }
+        names.push_back(text(phase.name));
+        calls.push_back(text(std::format("{:6}", phase.loadCalls)));
+        last.push_back(text(formatMs(phase.last)));
+        load.push_back(text(formatMs(phase.load)) | color(Color::GrayLight));
+    }
+
+    Elements counters;
+    for (const auto& counter : Profiler::GetCounters()) {
+        counters.push_back(text(std::format(" {}: {}", counter.name, counter.value)));
+    }
+
+    const double rssMiB = static_cast<double>(Profiler::GetResidentSetSize()) / (1024.0 * 1024.0);
+    return window(text(" Performance (F12) "),
+                  vbox({
+                      text(std::format(" layout:  {} ms", formatMs(layoutTime))) | bold,
+                      text(std::format(" commits: {} ({} visible)", commitCount,
+                                       visibleCommitCount)),
+                      text(std::format(" RSS:     {:.1f} MiB", rssMiB)),
+                      separator(),
+                      hbox({vbox(names), vbox(calls), vbox(last), vbox(load)}),
+                      separator(),
+                      vbox(counters),
+                  })) |
+           color(Color::YellowLight);
+}
+
+}  // namespace PerformanceHud
@@ -0,0 +1,25 @@
+/*_____________________________________________________________
+ | Performance HUD
+ |   Overlay in the top right corner of the main window, shows
+ |   layout time, the breakdown of the last repository load,
+ |   commit counts & resident memory (see util/profiler.hpp).
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "ftxui/dom/elements.hpp"  // for Element
+
+namespace PerformanceHud {
+
+/**
+ * @brief Builds the performance overlay window.
+ *
+ * @param commitCount Amount of commits in the repository.
+ * @param visibleCommitCount Amount of currently visible commits.
+ * @return UI Element
+ */
+[[nodiscard]] ftxui::Element Render(size_t commitCount, size_t visibleCommitCount);
+
+}  // namespace PerformanceHud
@@ -0,0 +1,471 @@
+#include "reftree.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ftxui/component/component_base.hpp>  // for Component, ComponentBase
+#include <ftxui/component/event.hpp>           // for Event
+#include "ftxui/component/component.hpp"       // for Make
+#include "ftxui/component/mouse.hpp"           // for Mouse
+#include "ftxui/dom/elements.hpp"  // for operator|, Element, text, hbox, vbox, reflect, inverted
+#include "ftxui/screen/box.hpp"    // for Box
+#include "ftxui/screen/color.hpp"  // for Color
+
+#include "../util/branchset.hpp"
+#include "../util/cpplibostree.hpp"
+#include "../util/profiler.hpp"
+
+#include "ostreetui.hpp"
+
+namespace {
+
+std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return str;
+}
+
+}  // namespace
+
+// RefTree
+
+void RefTree::Build(const cpplibostree::OSTreeRepo& repo) {
+    OSTREE_TUI_PROFILE_SCOPE("RefTree::Build");
+
+    if (initialized) {
+        // remember the expanded directories of the previous tree
+        expandedPaths.clear();
+        for (const auto& node : nodes) {
+            if (!node.leaf && node.expanded) {
+                expandedPaths.insert(node.path);
+            }
+        }
+    }
+
+    branches = repo.GetBranches();
+    nodes.clear();
+
+    // prefix sums of the commit counts, to count the commits of a subtree in O(1)
+    std::vector<size_t> commitPrefix(branches.size() + 1, 0);
+    std::vector<std::optional<cpplibostree::Timepoint>> heads(branches.size());
+    for (size_t id{0}; id < branches.size(); id++) {
+        const auto commits = repo.GetBranchCommits(id);
+        commitPrefix[id + 1] = commitPrefix[id] + commits.size();
+        if (!commits.empty()) {
+            heads[id] = commits.front()->timestamp;
+        }
+    }
+
+    // directories that are still open, innermost last
+    std::vector<size_t> open;
+    auto close = [&](size_t lastBranch) {
+        Node& dir = nodes[open.back()];
+        dir.lastBranch = lastBranch;
+        dir.end = nodes.size();
+        dir.commits = commitPrefix[dir.lastBranch] - commitPrefix[dir.firstBranch];
+        for (size_t id{dir.firstBranch}; id < dir.lastBranch; id++) {
+            if (heads[id] && (!dir.head || *heads[id] > *dir.head)) {
+                dir.head = heads[id];
+            }
+        }
+        open.pop_back();
+    };
+
+    // branches are sorted -> all refs sharing a prefix are adjacent
+    for (size_t id{0}; id < branches.size(); id++) {
+        const std::string& branch = branches[id];
+        while (!open.empty() && !branch.starts_with(nodes[open.back()].path)) {
+            close(id);
+        }
+        size_t segmentStart = open.empty() ? 0 : nodes[open.back()].path.size();
+        size_t slash = branch.find('/', segmentStart);
+        while (slash != std::string::npos) {
+            Node dir;
+            dir.label = branch.substr(segmentStart, slash - segmentStart);
+            dir.path = branch.substr(0, slash + 1);
+            dir.depth = open.size();
+            // top level directories start expanded
+            dir.expanded = initialized ? expandedPaths.contains(dir.path) : dir.depth == 0;
+            dir.firstBranch = id;
+            open.push_back(nodes.size());
+            nodes.push_back(std::move(dir));
+            segmentStart = slash + 1;
+            slash = branch.find('/', segmentStart);
+        }
+        Node ref;
+        ref.label = branch.substr(segmentStart);
+        ref.path = branch;
+        ref.depth = open.size();
+        ref.leaf = true;
+        ref.firstBranch = id;
+        ref.lastBranch = id + 1;
+        ref.end = nodes.size() + 1;
+        ref.commits = commitPrefix[id + 1] - commitPrefix[id];
+        ref.head = heads[id];
+        nodes.push_back(std::move(ref));
+    }
+    while (!open.empty()) {
+        close(branches.size());
+    }
+    initialized = true;
+
+    updateMatches();
+    updateRows();
+}
+
+void RefTree::SetFilter(const std::string& newFilter) {
+    if (newFilter == filter) {
+        return;
+    }
+    filter = newFilter;
+    updateMatches();
+    updateRows();
+}
+
+void RefTree::SetExpanded(size_t nodeIndex, bool expanded) {
+    Node& node = nodes.at(nodeIndex);
+    if (node.leaf || node.expanded == expanded) {
+        return;
+    }
+    node.expanded = expanded;
+    updateRows();
+}
+
+cpplibostree::BranchSet RefTree::WithSubtreeVisible(const cpplibostree::BranchSet& visibleBranches,
+                                                    size_t nodeIndex,
+                                                    bool visible) const {
+    const Node& node = nodes.at(nodeIndex);
+    cpplibostree::BranchSet result = visibleBranches;
+    if (filter.empty()) {
+        result.SetRange(node.firstBranch, node.lastBranch, visible);
+        return result;
+    }
+    for (size_t id{node.firstBranch}; id < node.lastBranch; id++) {
+        if (matchPrefix[id + 1] != matchPrefix[id]) {
+            result.Set(id, visible);
+        }
+    }
+    return result;
+}
+
+size_t RefTree::CountVisible(const cpplibostree::BranchSet& visibleBranches,
+                             size_t nodeIndex) const {
+    const Node& node = nodes.at(nodeIndex);
+    if (filter.empty()) {
+        return visibleBranches.Count(node.firstBranch, node.lastBranch);
+    }
+    size_t count{0};
+    for (size_t id{node.firstBranch}; id < node.lastBranch; id++) {
+        if (matchPrefix[id + 1] != matchPrefix[id] && visibleBranches.Test(id)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t RefTree::CountMatching(size_t nodeIndex) const {
+    const Node& node = nodes.at(nodeIndex);
+    return matchPrefix[node.lastBranch] - matchPrefix[node.firstBranch];
+}
+
+void RefTree::updateMatches() {
+    const std::string lowerFilter = toLower(filter);
+    matchPrefix.assign(branches.size() + 1, 0);
+    for (size_t id{0}; id < branches.size(); id++) {
+        const bool match =
+            lowerFilter.empty() || toLower(branches[id]).find(lowerFilter) != std::string::npos;
+        matchPrefix[id + 1] = matchPrefix[id] + (match ? 1 : 0);
+    }
+}
+
+void RefTree::updateRows() {
+    rows.clear();
+    size_t i{0};
+    while (i < nodes.size()) {
+        const Node& node = nodes[i];
+        if (CountMatching(i) == 0) {
+            i = node.end;
+            continue;
+        }
+        rows.push_back(i);
+        // while filtering, all directories containing matches are expanded
+        const bool descend = node.leaf || node.expanded || !filter.empty();
+        i = descend ? i + 1 : node.end;
+    }
+}
+
+const std::string& RefTree::GetFilter() const {
+    return filter;
+}
+
+const RefTree::Node& RefTree::GetNode(size_t nodeIndex) const {
+    return nodes.at(nodeIndex);
+}
+
+const std::vector<size_t>& RefTree::GetRows() const {
+    return rows;
+}
+
+// RefTreeRender
+
+namespace RefTreeRender {
+
+namespace {
+using namespace ftxui;
+
+/// rows rendered at once, the tree only renders the rows inside this viewport
+constexpr size_t VIEWPORT_HEIGHT{14};
+/// columns of the expand arrow & the checkbox of each row
+constexpr int ARROW_WIDTH{2};
+constexpr int CHECKBOX_WIDTH{4};
+
+class RefTreeComponentImpl : public ComponentBase {
+   public:
+    RefTreeComponentImpl(RefTree& tree, OSTreeTUI& ostreetui) : tree(tree), ostreetui(ostreetui) {}
+
+    Element Render() final {
+        OSTREE_TUI_PROFILE_SCOPE("RefTreeRender");
+        const auto& rows = tree.GetRows();
+        if (rows.empty()) {
+            return text(" no matching refs ") | color(Color::RedLight) | reflect(box);
+        }
+        clampCursor();
+
+        Elements lines;
+        const size_t last = std::min(rows.size(), scroll + VIEWPORT_HEIGHT);
+        for (size_t row{scroll}; row < last; row++) {
+            lines.push_back(renderRow(row));
+        }
+        // scroll position, as the virtualized rows can't use a frame's scroll indicator
+        const std::string position =
+            rows.size() > VIEWPORT_HEIGHT
+                ? std::format(" {}-{} of {} rows ", scroll + 1, last, rows.size())
+                : "";
+        lines.push_back(text(position) | dim);
+        return vbox(std::move(lines)) | reflect(box);
+    }
+
+    bool OnEvent(Event event) final {
+        if (event.is_mouse()) {
+            return onMouseEvent(event);
+        }
+        if (!Focused()) {
+            return false;
+        }
+        const auto& rows = tree.GetRows();
+
+        // navigation
+        if (event == Event::ArrowUp) {
+            return moveCursor(-1);
+        }
+        if (event == Event::ArrowDown) {
+            return moveCursor(1);
+        }
+        if (event == Event::PageUp) {
+            return moveCursor(-static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::PageDown) {
+            return moveCursor(static_cast<int>(VIEWPORT_HEIGHT));
+        }
+        if (event == Event::Home) {
+            cursor = 0;
+            return true;
+        }
+        if (event == Event::End) {
+            cursor = rows.empty() ? 0 : rows.size() - 1;
+            return true;
+        }
+        if (rows.empty()) {
+            return onFilterEvent(event);
+        }
+        clampCursor();
+
+        // expand & collapse
+        const size_t nodeIndex = rows.at(cursor);
+        const RefTree::Node& node = tree.GetNode(nodeIndex);
+        if (event == Event::ArrowRight && !node.leaf) {
+            if (!node.expanded && tree.GetFilter().empty()) {
+                tree.SetExpanded(nodeIndex, true);
+            } else {
+                moveCursor(1);
+            }
+            return true;
+        }
+        if (event == Event::ArrowLeft) {
+            if (!node.leaf && node.expanded && tree.GetFilter().empty()) {
+                tree.SetExpanded(nodeIndex, false);
+                return true;
+            }
+            // jump to the parent directory
+            for (size_t row{cursor}; row > 0; row--) {
+                if (tree.GetNode(rows.at(row - 1)).depth < node.depth) {
+                    cursor = row - 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (event == Event::Return && !node.leaf) {
+            tree.SetExpanded(nodeIndex, !node.expanded);
+            return true;
+        }
+
+        // show / hide
+        if (event == Event::Character(' ') || (event == Event::Return && node.leaf)) {
+            toggleVisibility(nodeIndex);
+            return true;
+        }
+
+        return onFilterEvent(event);
+    }
+
+    bool Focusable() const final { return true; }
+
+   private:
+    Element renderRow(size_t row) {
+        const size_t nodeIndex = tree.GetRows().at(row);
+        const RefTree::Node& node = tree.GetNode(nodeIndex);
+        const size_t matching = tree.CountMatching(nodeIndex);
+        const size_t visible = tree.CountVisible(ostreetui.GetVisibleBranches(), nodeIndex);
+
+        const std::string indent(node.depth * 2, ' ');
+        std::string arrow = "  ";
+        if (!node.leaf) {
+            arrow = node.expanded || !tree.GetFilter().empty() ? "▾ " : "▸ ";
+        }
+        std::string checkbox = "[-] ";
+        if (visible == 0) {
+            checkbox = "[ ] ";
+        } else if (visible == matching) {
+            checkbox = "[x] ";
+        }
+
+        Element label = text(node.leaf ? node.label : node.label + "/");
+        if (node.leaf) {
+            label |= color(ostreetui.GetBranchColorMap().at(node.path));
+        } else {
+            label |= bold;
+        }
+        std::string details = std::format(" {} commits", node.commits);
+        if (!node.leaf) {
+            details = std::format(" {} refs,{}", matching, details);
+        }
+        if (node.head) {
+            details += std::format(", head {:%Y-%m-%d}",
+                                   std::chrono::time_point_cast<std::chrono::seconds>(*node.head));
+        }
+
+        Element line = hbox({text(indent), text(arrow), text(checkbox), label, filler(),
+                             text(details + " ") | dim});
+        if (row == cursor) {
+            line = line | (Focused() ? inverted : bold);
+        }
+        return line;
+    }
+
+    bool onMouseEvent(Event& event) {
+        if (!box.Contain(event.mouse().x, event.mouse().y)) {
+            return false;
+        }
+        if (event.mouse().button == Mouse::WheelUp) {
+            return moveCursor(-1);
+        }
+        if (event.mouse().button == Mouse::WheelDown) {
+            return moveCursor(1);
+        }
+        if (event.mouse().button != Mouse::Left || event.mouse().motion != Mouse::Pressed) {
+            return false;
+        }
+        const auto line = static_cast<size_t>(event.mouse().y - box.y_min);
+        const size_t row = scroll + line;
+        if (line >= VIEWPORT_HEIGHT || row >= tree.GetRows().size()) {
+            return false;
+        }
+        TakeFocus();
+        cursor = row;
+
+        // clicks on the arrow expand, clicks on the checkbox toggle
+        const size_t nodeIndex = tree.GetRows().at(row);
+        const RefTree::Node& node = tree.GetNode(nodeIndex);
+        const int column = event.mouse().x - box.x_min - static_cast<int>(node.depth) * 2;
+        if (column >= 0 && column < ARROW_WIDTH && !node.leaf) {
+            tree.SetExpanded(nodeIndex, !node.expanded);
+        } else if (column >= ARROW_WIDTH && column < ARROW_WIDTH + CHECKBOX_WIDTH) {
+            toggleVisibility(nodeIndex);
+        }
+        return true;
+    }
+
+    /// type-to-filter
+    bool onFilterEvent(const Event& event) {
+        std::string filter = tree.GetFilter();
+        if (event == Event::Backspace && !filter.empty()) {
+            filter.pop_back();
+        } else if (event == Event::Escape && !filter.empty()) {
+            filter.clear();
+        } else if (event.is_character() && event.character() != " ") {
+            filter += event.character();
+        } else {
+            return false;
+        }
+        tree.SetFilter(filter);
+        cursor = 0;
+        scroll = 0;
+        return true;
+    }
+
+    /// @brief Shows all refs of the subtree, or hides them, if all of them are visible.
+    void toggleVisibility(size_t nodeIndex) {
+        const auto& visibleBranches = ostreetui.GetVisibleBranches();
+        const bool show =
+            tree.CountVisible(visibleBranches, nodeIndex) < tree.CountMatching(nodeIndex);
+        // one batched update for the whole subtree
+        ostreetui.SetVisibleBranches(tree.WithSubtreeVisible(visibleBranches, nodeIndex, show));
+    }
+
+    bool moveCursor(int delta) {
+        const auto rowCount = static_cast<int>(tree.GetRows().size());
+        if (rowCount == 0) {
+            return false;
+        }
+        const auto target =
+            static_cast<size_t>(std::clamp(static_cast<int>(cursor) + delta, 0, rowCount - 1));
+        // at the border -> let the container move the focus
+        if (target == cursor) {
+            return false;
+        }
+        cursor = target;
+        return true;
+    }
+
+    /// @brief Keeps the cursor inside the rows & the viewport around the cursor.
+    void clampCursor() {
+        const size_t rowCount = tree.GetRows().size();
+        cursor = std::min(cursor, rowCount - 1);
+        if (cursor < scroll) {
+            scroll = cursor;
+        } else if (cursor >= scroll + VIEWPORT_HEIGHT) {
+            scroll = cursor - VIEWPORT_HEIGHT + 1;
+        }
+        scroll = std::min(scroll, rowCount > VIEWPORT_HEIGHT ? rowCount - VIEWPORT_HEIGHT : 0);
+    }
+
+    RefTree& tree;
+    OSTreeTUI& ostreetui;
+    size_t cursor{0};
+    size_t scroll{0};
+    Box box;
+};
+
+}  // namespace
+
+ftxui::Component RefTreeComponent(RefTree& tree, OSTreeTUI& ostreetui) {
+    return ftxui::Make<RefTreeComponentImpl>(tree, ostreetui);
+}
+
+}  // namespace RefTreeRender
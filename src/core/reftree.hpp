@@ -0,0 +1,118 @@
+/*_____________________________________________________________
+ | Ref Tree
+ |   Collapsible tree of all refs, grouped by `/` segments, for
+ |   the branch filter. Scales to thousands of refs:
+ |   - refs are sorted, so every subtree is a contiguous range of
+ |     dense branch ids -> visibility lives in a BranchSet &
+ |     a subtree is shown / hidden as one batched update
+ |   - per-subtree commit counts come from prefix sums over the
+ |     branch timelines, filter matches likewise
+ |   - only the rows inside the viewport are rendered
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ftxui/component/component_base.hpp"  // for Component
+
+#include "../util/branchset.hpp"
+#include "../util/cpplibostree.hpp"
+
+class OSTreeTUI;
+
+class RefTree {
+   public:
+    struct Node {
+        std::string label;  // last path segment
+        std::string path;   // complete ref, or prefix incl. trailing `/` for directories
+        size_t depth{0};
+        bool leaf{false};
+        bool expanded{false};
+        size_t firstBranch{0};  // branch id range [firstBranch, lastBranch)
+        size_t lastBranch{0};
+        size_t end{0};  // index after the last descendant node
+        size_t commits{0};
+        std::optional<cpplibostree::Timepoint> head;  // date of the newest commit
+    };
+
+    /**
+     * @brief (Re-)builds the tree from the refs of a repository. Expanded directories stay
+     * expanded across rebuilds.
+     *
+     * @param repo Repository to read the (sorted) refs & branch timelines from.
+     */
+    void Build(const cpplibostree::OSTreeRepo& repo);
+
+    /**
+     * @brief Only shows refs containing the filter text (case insensitive), with all their
+     * parent directories expanded.
+     *
+     * @param filter Filter text, empty shows all refs.
+     */
+    void SetFilter(const std::string& filter);
+
+    /// @brief Expands or collapses the directory node at nodeIndex.
+    void SetExpanded(size_t nodeIndex, bool expanded);
+
+    /**
+     * @brief Shows or hides all (filter-matching) refs of a subtree.
+     *
+     * @param visibleBranches Current branch visibility.
+     * @param nodeIndex Root node of the subtree.
+     * @param visible Show or hide.
+     * @return Updated branch visibility.
+     */
+    [[nodiscard]] cpplibostree::BranchSet WithSubtreeVisible(
+        const cpplibostree::BranchSet& visibleBranches,
+        size_t nodeIndex,
+        bool visible) const;
+
+    /// @return Amount of (filter-matching) refs in the subtree, that are visible.
+    [[nodiscard]] size_t CountVisible(const cpplibostree::BranchSet& visibleBranches,
+                                      size_t nodeIndex) const;
+
+    /// @return Amount of (filter-matching) refs in the subtree.
+    [[nodiscard]] size_t CountMatching(size_t nodeIndex) const;
+
+    // GETTER
+    [[nodiscard]] const std::string& GetFilter() const;
+    [[nodiscard]] const Node& GetNode(size_t nodeIndex) const;
+    /// @return Node indices of all displayed rows (expanded & matching the filter).
+    [[nodiscard]] const std::vector<size_t>& GetRows() const;
+
+   private:
+    /// @brief Recalculates the filter matches of all refs.
+    void updateMatches();
+
+    /// @brief Recalculates the displayed rows.
+    void updateRows();
+
+    std::vector<Node> nodes;  // pre-order
+    std::vector<size_t> rows;
+    std::vector<std::string> branches;
+    std::unordered_set<std::string> expandedPaths;
+    bool initialized{false};
+
+    std::string filter;
+    std::vector<size_t> matchPrefix;  // prefix sums of filter matches over branch ids
+};
+
+namespace RefTreeRender {
+
+/**
+ * @brief Creates the virtualized, navigable view of a RefTree. Keys: arrows / Home / End /
+ * PageUp / PageDown navigate, Enter & ←/→ collapse and expand, Space shows or hides the ref
+ * (or the whole subtree), typing filters the refs, Esc clears the filter.
+ *
+ * @param tree Tree to display (has to outlive the component).
+ * @param ostreetui OSTreeTUI, holding the branch visibility.
+ * @return UI Component
+ */
+[[nodiscard]] ftxui::Component RefTreeComponent(RefTree& tree, OSTreeTUI& ostreetui);
+
+}  // namespace RefTreeRender
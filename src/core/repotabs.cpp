@@ -0,0 +1,254 @@
+#include "repotabs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glib.h>
+
+#include <ftxui/component/event.hpp>  // for Event
+#include "ftxui/component/component.hpp"  // for CatchEvent, Renderer, Container
+#include "ftxui/component/component_base.hpp"      // for ComponentBase
+#include "ftxui/component/screen_interactive.hpp"  // for ScreenInteractive
+#include "ftxui/dom/elements.hpp"                  // for Element, operator|, text, hbox
+
+#include "eventlog.hpp"
+
+namespace {
+
+/// tabs reachable with Alt+1 .. Alt+9
+constexpr size_t MAX_SHORTCUT_TABS{9};
+
+/// @return Name of a repository in the tab bar (last path component).
+std::string tabName(const std::string& repo) {
+    const std::filesystem::path path(repo);
+    const std::string name =
+        (path.has_filename() ? path.filename() : path.parent_path().filename()).string();
+    return name.empty() ? repo : name;
+}
+
+}  // namespace
+
+RepoTabs::RepoTabs(std::vector<std::string> repos,
+                   std::vector<std::string> startupBranches,
+                   cpplibostree::TimeRange startupTimeRange,
+                   bool scanObjects,
+                   std::optional<size_t> sysrootDepth)
+    : repos(std::move(repos)),
+      startupBranches(std::move(startupBranches)),
+      startupTimeRange(startupTimeRange),
+      scanObjects(scanObjects),
+      sysrootDepth(sysrootDepth),
+      tabs(this->repos.size()),
+      loading(this->repos.size(), false),
+      loadErrors(this->repos.size()) {
+    using namespace ftxui;
+
+    // the first tab is shown right away, the others load when they are shown
+    if (!this->repos.empty()) {
+        tabs[0] = std::make_unique<OSTreeTUI>(this->repos[0], this->startupBranches,
+                                              startupTimeRange, scanObjects, sysrootDepth,
+                                              &context);
+    }
+
+    tabHost = Container::Vertical({});
+    Component tabsView = Renderer(tabHost, [this] {
+        if (this->repos.size() <= 1) {
+            return tabHost->Render();
+        }
+        return vbox({renderTabBar(), tabHost->Render() | flex});
+    });
+
+    // switch tabs
+    mainContainer = CatchEvent(tabsView, [this](const Event& event) {
+        if (this->repos.size() <= 1) {
+            return false;
+        }
+        const size_t shortcutTabs = std::min(this->repos.size(), MAX_SHORTCUT_TABS);
+        for (size_t index{0}; index < shortcutTabs; index++) {
+            if (event == Event::Special(std::string("\x1b") + static_cast<char>('1' + index))) {
+                SelectTab(index);
+                return true;
+            }
+        }
+        return false;
+    });
+
+    showSelectedTab();
+    loader = std::jthread([this](const std::stop_token& stop) { loadTabs(stop); });
+}
+
+int RepoTabs::Run() {
+    // footer notification update loader, for the shown tab
+    // Probably not the best solution, having an active wait and should maybe
+    // only be started, once a notification is set...
+    std::atomic<bool> runSubThreads{true};
+    std::thread footerNotificationUpdater([&] {
+        while (runSubThreads) {
+            using namespace std::chrono_literals;
+            // notification is set
+            OSTreeTUI* tab = shownTab;
+            if (tab != nullptr && tab->ShowNotification()) {
+                std::this_thread::sleep_for(2s);
+                // clear notification
+                tab->ClearNotification();
+            }
+            std::this_thread::sleep_for(0.2s);
+        }
+    });
+
+    context.screen.Loop(eventRecord.is_open() ? EventLog::Record(mainContainer, eventRecord)
+                                              : mainContainer);
+    runSubThreads = false;
+    footerNotificationUpdater.join();
+
+    return EXIT_SUCCESS;
+}
+
+bool RepoTabs::RecordEvents(const std::string& file) {
+    eventRecord.open(file, std::ios::out | std::ios::trunc);
+    return eventRecord.is_open();
+}
+
+void RepoTabs::SetSummarySigning(std::vector<std::string> keyIds, std::string gpgHomedir) {
+    summaryKeyIds = std::move(keyIds);
+    summaryGpgHomedir = std::move(gpgHomedir);
+    for (auto& tab : tabs) {
+        if (tab) {
+            tab->SetSummarySigning(summaryKeyIds, summaryGpgHomedir);
+        }
+    }
+}
+
+void RepoTabs::SelectTab(size_t index) {
+    if (index >= repos.size() || index == selectedTab) {
+        return;
+    }
+    if (tabs[selectedTab]) {
+        tabs[selectedTab]->SetActive(false);
+    }
+    selectedTab = index;
+    if (!tabs[index] && !loading[index] && loadErrors[index].empty()) {
+        loading[index] = true;
+        {
+            const std::lock_guard<std::mutex> lock(loadMutex);
+            loadQueue.push_back(index);
+        }
+        loadCondition.notify_one();
+    }
+    showSelectedTab();
+}
+
+void RepoTabs::loadTabs(const std::stop_token& stop) {
+    while (true) {
+        size_t index{0};
+        {
+            std::unique_lock<std::mutex> lock(loadMutex);
+            if (!loadCondition.wait(lock, stop, [this] { return !loadQueue.empty(); })) {
+                return;
+            }
+            index = loadQueue.front();
+            loadQueue.pop_front();
+        }
+        // waiting for a locked repository stops with the loader (on quit)
+        g_autoptr(GError) error = nullptr;
+        auto repo = sysrootDepth
+                        ? cpplibostree::OSTreeRepo::Open(
+                              cpplibostree::SysrootOptions{repos[index], *sysrootDepth},
+                              &context.strings, stop, &error)
+                        : cpplibostree::OSTreeRepo::Open(
+                              repos[index], true, scanObjects ? &context.threadPool : nullptr,
+                              &context.strings, stop, &error);
+        if (stop.stop_requested()) {
+            return;
+        }
+        LoadedTab result{index, nullptr, ""};
+        if (repo) {
+            // the options are only set before the screen loop starts
+            result.tab = std::make_unique<OSTreeTUI>(std::move(*repo), startupBranches,
+                                                     startupTimeRange, context);
+            result.tab->SetSummarySigning(summaryKeyIds, summaryGpgHomedir);
+        } else {
+            result.error = error != nullptr ? error->message : "unknown error";
+        }
+        {
+            const std::lock_guard<std::mutex> lock(loadMutex);
+            loaded.push_back(std::move(result));
+        }
+        context.screen.Post([this] { installLoadedTabs(); });
+        context.screen.Post(ftxui::Event::Custom);
+    }
+}
+
+void RepoTabs::installLoadedTabs() {
+    std::vector<LoadedTab> installable;
+    {
+        const std::lock_guard<std::mutex> lock(loadMutex);
+        installable.swap(loaded);
+    }
+    for (auto& [index, tab, error] : installable) {
+        tabs[index] = std::move(tab);
+        loadErrors[index] = std::move(error);
+        loading[index] = false;
+        if (index == selectedTab) {
+            showSelectedTab();
+        }
+    }
+}
+
+void RepoTabs::showSelectedTab() {
+    using namespace ftxui;
+
+    tabHost->DetachAllChildren();
+    OSTreeTUI* tab = tabs.empty() ? nullptr : tabs[selectedTab].get();
+    shownTab = tab;
+    if (tab == nullptr && !repos.empty() && !loadErrors[selectedTab].empty()) {
+        const std::string hint =
+            " could not load " + repos[selectedTab] + ": " + loadErrors[selectedTab] + " ";
+        tabHost->Add(Renderer(
+            [hint] { return paragraph(hint) | color(Color::RedLight) | center | border; }));
+        return;
+    }
+    if (tab == nullptr) {
+        const std::string hint =
+            repos.empty() ? " no repository " : " loading " + repos[selectedTab] + " ... ";
+        tabHost->Add(Renderer([hint] { return text(hint) | dim | center | border; }));
+        return;
+    }
+    tabHost->Add(tab->GetMainContainer());
+    tab->SetActive(true);
+}
+
+ftxui::Element RepoTabs::renderTabBar() const {
+    using namespace ftxui;
+
+    Elements entries;
+    for (size_t index{0}; index < repos.size(); index++) {
+        std::string label = " " + tabName(repos[index]) + " ";
+        if (index < MAX_SHORTCUT_TABS) {
+            label = " Alt+" + std::to_string(index + 1) + label;
+        }
+        Element entry = text(label);
+        if (index == selectedTab) {
+            entry = entry | bold | inverted;
+        } else if (!loadErrors[index].empty()) {
+            entry = entry | color(Color::RedLight);
+        } else if (!tabs[index]) {
+            entry = entry | dim;
+        }
+        entries.push_back(entry);
+        entries.push_back(text("│") | dim);
+    }
+    return hbox(std::move(entries));
+}
@@ -0,0 +1,140 @@
+/*_____________________________________________________________
+ | Repository Tabs
+ |   Shows several repositories as tabs (Alt+1 .. Alt+9) in one
+ |   process, each tab is an OSTreeTUI, all sharing one screen,
+ |   worker pool & table of branch names:
+ |   - the first tab is loaded at startup, the others by one
+ |     loader thread, when they are shown the first time (a
+ |     tab, that could not be loaded, shows the error)
+ |   - only the shown tab refreshes, hidden tabs refresh, when
+ |     they are shown again
+ |   The tab bar is only shown for more than one repository.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ftxui/component/component_base.hpp"  // for ComponentBase
+#include "ftxui/dom/elements.hpp"              // for Element
+
+#include "ostreetui.hpp"
+
+#include "../util/cpplibostree.hpp"
+
+class RepoTabs {
+   public:
+    /**
+     * @brief Prepares a tab per repository & loads the first one.
+     *
+     * @param repos Paths of the OSTree repository directories.
+     * @param startupBranches Branches to pre-select in every tab (see OSTreeTUI).
+     * @param startupTimeRange Time range filter of every tab.
+     * @param scanObjects Load all commit objects, instead of following the refs.
+     * @param sysrootDepth The repos are sysroots, load their deployments (see OSTreeTUI).
+     */
+    explicit RepoTabs(std::vector<std::string> repos,
+                      std::vector<std::string> startupBranches = {},
+                      cpplibostree::TimeRange startupTimeRange = {},
+                      bool scanObjects = false,
+                      std::optional<size_t> sysrootDepth = std::nullopt);
+
+    RepoTabs(const RepoTabs&) = delete;
+    RepoTabs& operator=(const RepoTabs&) = delete;
+
+    /**
+     * @brief Runs the tabs (starts the ftxui screen loop).
+     *
+     * @return Exit Code
+     */
+    int Run();
+
+    /**
+     * @brief Records all events sent to the tabs into an event log, to be replayed by the
+     * ostree-tui-replay runner. Has to be called before Run().
+     *
+     * @param file Path of the event log to write.
+     * @return true, if the event log could be opened.
+     */
+    bool RecordEvents(const std::string& file);
+
+    /**
+     * @brief Signs the summaries of all repositories, when they are regenerated.
+     *
+     * @param keyIds GPG key IDs to sign with.
+     * @param gpgHomedir GPG home directory of the keys, empty for the default one.
+     */
+    void SetSummarySigning(std::vector<std::string> keyIds, std::string gpgHomedir);
+
+    /**
+     * @brief Shows the tab of a repository, it is loaded in the background on first use.
+     *
+     * @param index Index of the repository.
+     */
+    void SelectTab(size_t index);
+
+   private:
+    /// tab built by the loader thread, not installed yet
+    struct LoadedTab {
+        size_t index{0};
+        std::unique_ptr<OSTreeTUI> tab;  // nullptr, if the repository could not be loaded
+        std::string error;
+    };
+
+    /// @brief Loads the queued tabs (loader thread).
+    void loadTabs(const std::stop_token& stop);
+
+    /// @brief Moves the tabs loaded by the loader thread into the tab list (UI thread).
+    void installLoadedTabs();
+
+    /// @brief Puts the selected tab (or a loading hint) into the tab host.
+    void showSelectedTab();
+
+    /// @return Tab bar, with the repository names & their shortcuts.
+    [[nodiscard]] ftxui::Element renderTabBar() const;
+
+    // shared by all tabs, outlives them
+    TuiContext context;
+
+    // startup options of all tabs
+    std::vector<std::string> repos;
+    std::vector<std::string> startupBranches;
+    cpplibostree::TimeRange startupTimeRange;
+    bool scanObjects;
+    std::optional<size_t> sysrootDepth;
+    std::vector<std::string> summaryKeyIds;
+    std::string summaryGpgHomedir;
+
+    // tabs, only UI thread
+    std::vector<std::unique_ptr<OSTreeTUI>> tabs;  // nullptr until loaded
+    std::vector<bool> loading;
+    std::vector<std::string> loadErrors;  // tab -> why it could not be loaded
+    size_t selectedTab{0};
+    std::atomic<OSTreeTUI*> shownTab{nullptr};  // read by the notification thread
+
+    // components
+    ftxui::Component tabHost;
+    ftxui::Component mainContainer;
+
+    // event recording
+    std::ofstream eventRecord;
+
+    // loader
+    std::mutex loadMutex;
+    std::condition_variable_any loadCondition;
+    std::deque<size_t> loadQueue;
+    std::vector<LoadedTab> loaded;  // not installed yet
+    std::jthread loader;  // declared last, posts to the screen & has to stop first
+};
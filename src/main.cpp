@@ -1,8 +1,16 @@
+#include <charconv>
+#include <cstddef>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <system_error>
+#include <utility>
 #include <vector>
 
 #include "core/ostreetui.hpp"
+#include "core/repotabs.hpp"
+#include "util/deployments.hpp"
+#include "util/profiler.hpp"
 
 /**
  * @brief Parse all options listed behind an argument
@@ -51,12 +59,109 @@ int main(int argc, const char** argv) {
     if (argExists(args, "-v") || argExists(args, "--version")) {
         return OSTreeTUI::showVersion();
     }
-    // assume ostree repository path as first argument
-    std::string repo = args.at(0);
+    // assume ostree repository paths as first arguments (one tab each)
+    std::vector<std::string> repos;
+    for (const auto& arg : args) {
+        if (arg.starts_with('-')) {
+            break;
+        }
+        repos.push_back(arg);
+    }
+    // --sysroot [PATH...], --depth N
+    std::optional<size_t> sysrootDepth;
+    if (argExists(args, "--sysroot")) {
+        std::vector<std::string> sysroots = getArgOptions(args, {"--sysroot"});
+        if (!sysroots.empty()) {
+            repos = std::move(sysroots);
+        } else if (repos.empty()) {
+            repos.emplace_back("/");
+        }
+        sysrootDepth = cpplibostree::DEFAULT_DEPLOYMENT_DEPTH;
+        std::vector<std::string> depth = getArgOptions(args, {"--depth"});
+        if (!depth.empty()) {
+            const std::string& value = depth.at(0);
+            size_t parsed{0};
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(),
+                                                      parsed);
+            if (error != std::errc() || end != value.data() + value.size()) {
+                return OSTreeTUI::showHelp(argv[0], "invalid number for --depth: " + value);
+            }
+            sysrootDepth = parsed;
+        }
+    }
+    if (repos.empty()) {
+        return OSTreeTUI::showHelp(argv[0], "no repository provided");
+    }
+    // the commands work on the system repository of a sysroot
+    const std::string repo =
+        sysrootDepth ? cpplibostree::SysrootRepoPath(repos.at(0)) : repos.at(0);
     // -r, --refs
     std::vector<std::string> startupBranches = getArgOptions(args, {"-r", "--refs"});
+    // --since, --until
+    cpplibostree::TimeRange startupTimeRange;
+    std::vector<std::string> since = getArgOptions(args, {"--since"});
+    std::vector<std::string> until = getArgOptions(args, {"--until"});
+    if (!since.empty()) {
+        startupTimeRange.since = cpplibostree::ParseTimepoint(since.at(0));
+        if (!startupTimeRange.since) {
+            return OSTreeTUI::showHelp(argv[0], "invalid time for --since: " + since.at(0));
+        }
+    }
+    if (!until.empty()) {
+        startupTimeRange.until = cpplibostree::ParseTimepoint(until.at(0), true);
+        if (!startupTimeRange.until) {
+            return OSTreeTUI::showHelp(argv[0], "invalid time for --until: " + until.at(0));
+        }
+    }
 
-    // OSTree TUI
-    OSTreeTUI ostreetui(repo, startupBranches);
-    return ostreetui.Run();
+    // --import SOURCE REF [SUBJECT]
+    if (argExists(args, "--import")) {
+        std::vector<std::string> importArgs = getArgOptions(args, {"--import"});
+        if (importArgs.size() < 2) {
+            return OSTreeTUI::showHelp(argv[0], "--import needs a directory or tarball and a ref");
+        }
+        if (sysrootDepth) {
+            return OSTreeTUI::showHelp(argv[0], "--import can't write to a --sysroot");
+        }
+        return OSTreeTUI::importCommit(repo, importArgs.at(0), importArgs.at(1),
+                                       importArgs.size() > 2 ? importArgs.at(2) : "");
+    }
+
+    // --export-tar REV [FILE]
+    if (argExists(args, "--export-tar")) {
+        std::vector<std::string> exportArgs = getArgOptions(args, {"--export-tar"});
+        if (exportArgs.empty()) {
+            return OSTreeTUI::showHelp(argv[0], "--export-tar needs a commit or ref");
+        }
+        return OSTreeTUI::exportTar(repo, exportArgs.at(0),
+                                    exportArgs.size() > 1 ? exportArgs.at(1) : "");
+    }
+
+    // --sign-summary, --gpg-homedir
+    std::vector<std::string> summaryKeys = getArgOptions(args, {"--sign-summary"});
+    std::vector<std::string> gpgHomedir = getArgOptions(args, {"--gpg-homedir"});
+
+    // --scan-objects
+    const bool scanObjects = argExists(args, "--scan-objects");
+
+    // --record
+    std::vector<std::string> recordFile = getArgOptions(args, {"--record"});
+    // --profile
+    std::vector<std::string> profileFile = getArgOptions(args, {"--profile"});
+    if (!profileFile.empty()) {
+        Profiler::SetEnabled(true, true);
+    }
+
+    // OSTree TUI, a tab per repository
+    RepoTabs ostreetui(repos, startupBranches, startupTimeRange, scanObjects, sysrootDepth);
+    ostreetui.SetSummarySigning(summaryKeys, gpgHomedir.empty() ? "" : gpgHomedir.at(0));
+    if (!recordFile.empty() && !ostreetui.RecordEvents(recordFile.at(0))) {
+        return OSTreeTUI::showHelp(argv[0], "could not open event log " + recordFile.at(0));
+    }
+    const int exitCode = ostreetui.Run();
+
+    if (!profileFile.empty() && !Profiler::WriteTrace(profileFile.at(0))) {
+        std::cerr << "could not write profile " << profileFile.at(0) << "\n";
+    }
+    return exitCode;
 }
@@ -0,0 +1,120 @@
+/*_____________________________________________________________
+ | Branch Set
+ |   Dense bitset over branch ids (the index of a branch in the
+ |   sorted OSTreeRepo::GetBranches()). As the branches are
+ |   sorted, all refs below a prefix (e.g. `app/x86_64/`) form a
+ |   contiguous id range, that can be counted & updated word-wise.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpplibostree {
+
+class BranchSet {
+   public:
+    BranchSet() = default;
+
+    /**
+     * @brief Constructs a set over `size` branch ids.
+     *
+     * @param size Amount of branches.
+     * @param value Initial value of all bits.
+     */
+    explicit BranchSet(size_t size, bool value = false)
+        : size(size), words((size + WORD_BITS - 1) / WORD_BITS, value ? ~uint64_t{0} : 0) {
+        clearTail();
+    }
+
+    /// @return Amount of branch ids in the set.
+    [[nodiscard]] size_t Size() const { return size; }
+
+    [[nodiscard]] bool Test(size_t id) const {
+        return id < size && (words[id / WORD_BITS] >> (id % WORD_BITS) & 1U) != 0;
+    }
+
+    void Set(size_t id, bool value = true) {
+        if (id >= size) {
+            return;
+        }
+        uint64_t& word = words[id / WORD_BITS];
+        const uint64_t mask = uint64_t{1} << (id % WORD_BITS);
+        word = value ? word | mask : word & ~mask;
+    }
+
+    /// @brief Sets all ids in [first, last) to value.
+    void SetRange(size_t first, size_t last, bool value) {
+        forRange(words, first, std::min(last, size), [value](uint64_t& word, uint64_t mask) {
+            word = value ? word | mask : word & ~mask;
+        });
+    }
+
+    /// @return Amount of set ids.
+    [[nodiscard]] size_t Count() const { return Count(0, size); }
+
+    /// @return Amount of set ids in [first, last).
+    [[nodiscard]] size_t Count(size_t first, size_t last) const {
+        size_t count{0};
+        forRange(words, first, std::min(last, size), [&count](uint64_t word, uint64_t mask) {
+            count += static_cast<size_t>(std::popcount(word & mask));
+        });
+        return count;
+    }
+
+    /// @return true, if no id is set.
+    [[nodiscard]] bool None() const {
+        for (const auto word : words) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Calls f(id) for every set id, in ascending order.
+    template <typename F>
+    void ForEach(F&& f) const {
+        for (size_t w{0}; w < words.size(); w++) {
+            uint64_t word = words[w];
+            while (word != 0) {
+                f(w * WORD_BITS + static_cast<size_t>(std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    bool operator==(const BranchSet&) const = default;
+
+   private:
+    static constexpr size_t WORD_BITS{64};
+
+    /// @brief Calls f(word, mask) for every word overlapping [first, last).
+    template <typename Words, typename F>
+    static void forRange(Words& words, size_t first, size_t last, F&& f) {
+        while (first < last) {
+            const size_t offset = first % WORD_BITS;
+            const size_t bits = std::min(last - first, WORD_BITS - offset);
+            const uint64_t mask =
+                bits == WORD_BITS ? ~uint64_t{0} : ((uint64_t{1} << bits) - 1) << offset;
+            f(words[first / WORD_BITS], mask);
+            first += bits;
+        }
+    }
+
+    /// @brief Keeps the unused bits of the last word cleared (Count(), None() & == rely on it).
+    void clearTail() {
+        if (size % WORD_BITS != 0) {
+            words.back() &= (uint64_t{1} << (size % WORD_BITS)) - 1;
+        }
+    }
+
+    size_t size{0};
+    std::vector<uint64_t> words;
+};
+
+}  // namespace cpplibostree
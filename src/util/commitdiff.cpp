@@ -0,0 +1,366 @@
+#include "commitdiff.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+/// results are passed on at most this often, while a diff runs
+constexpr std::chrono::milliseconds CHANGE_INTERVAL{50};
+
+/// @return Name of a dirtree entry, file (say) or directory (sayay).
+const char* entryName(GVariant* entry) {
+    const char* name{nullptr};
+    g_variant_get_child(entry, 0, "&s", &name);
+    return name;
+}
+
+/// @return Checksum of a dirtree entry: 1 content / dirtree, 2 dirmeta (directories only).
+ObjectId entryChecksum(GVariant* entry, gsize index) {
+    g_autoptr(GVariant) checksum = g_variant_get_child_value(entry, index);
+    ObjectId id{};
+    ReadObjectId(checksum, id);
+    return id;
+}
+
+/**
+ * @brief Walks two entry arrays of dirtrees side by side, both are sorted by name (see
+ * OSTREE_TREE_GVARIANT_FORMAT).
+ *
+ * @param from Entries of the old dirtree.
+ * @param to Entries of the new dirtree.
+ * @param onEntry Called with the name & the entry on both sides (nullptr on the missing side).
+ */
+template <typename OnEntry>
+void mergeEntries(GVariant* from, GVariant* to, OnEntry onEntry) {
+    const gsize fromCount = g_variant_n_children(from);
+    const gsize toCount = g_variant_n_children(to);
+    gsize i{0};
+    gsize j{0};
+    while (i < fromCount || j < toCount) {
+        g_autoptr(GVariant) a = i < fromCount ? g_variant_get_child_value(from, i) : nullptr;
+        g_autoptr(GVariant) b = j < toCount ? g_variant_get_child_value(to, j) : nullptr;
+        int order{0};
+        if (a == nullptr) {
+            order = 1;
+        } else if (b == nullptr) {
+            order = -1;
+        } else {
+            order = std::strcmp(entryName(a), entryName(b));
+        }
+        if (order < 0) {
+            onEntry(entryName(a), a, nullptr);
+            i++;
+        } else if (order > 0) {
+            onEntry(entryName(b), nullptr, b);
+            j++;
+        } else {
+            onEntry(entryName(a), a, b);
+            i++;
+            j++;
+        }
+    }
+}
+
+}  // namespace
+
+struct CommitDiffer::Diff {
+    Diff(uint64_t generation, ThreadPool& pool) : generation(generation), group(pool) {}
+
+    uint64_t generation;
+    std::atomic<bool> failed{false};
+    std::mutex errorMutex;
+    std::string error;
+    // declared last: waits for all tasks, before the other members are destroyed
+    TaskGroup group;
+};
+
+CommitDiffer::CommitDiffer(std::string repoPath, ThreadPool& pool, ChangeCallback onChange)
+    : repoPath(std::move(repoPath)),
+      pool(pool),
+      onChange(std::move(onChange)),
+      repos(pool.Size(), nullptr) {
+    worker = std::thread([this] { run(); });
+}
+
+CommitDiffer::~CommitDiffer() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        generation++;
+    }
+    wakeup.notify_one();
+    worker.join();
+    for (auto* r : repos) {
+        if (r != nullptr) {
+            g_object_unref(r);
+        }
+    }
+}
+
+void CommitDiffer::Start(const std::string& from, const std::string& to) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        // a cancelled or failed diff of the same commits runs again
+        if (status.from == from && status.to == to && (status.running || !status.failed)) {
+            return;
+        }
+        generation++;
+        status = Status{.from = from, .to = to, .running = true};
+        entries.clear();
+        pending.emplace(from, to);
+    }
+    wakeup.notify_one();
+}
+
+void CommitDiffer::Cancel() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!status.running) {
+        return;
+    }
+    generation++;
+    pending.reset();
+    status.running = false;
+    status.failed = true;
+    status.error = "cancelled";
+}
+
+CommitDiffer::Status CommitDiffer::GetStatus() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
+
+size_t CommitDiffer::GetEntryCount() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::vector<DiffEntry> CommitDiffer::GetEntries(size_t first, size_t count) const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (first >= entries.size()) {
+        return {};
+    }
+    const auto begin = entries.begin() + static_cast<std::ptrdiff_t>(first);
+    return {begin, begin + static_cast<std::ptrdiff_t>(std::min(count, entries.size() - first))};
+}
+
+void CommitDiffer::run() {
+    while (true) {
+        std::pair<std::string, std::string> request;
+        uint64_t requestGeneration{0};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || pending.has_value(); });
+            if (stop) {
+                return;
+            }
+            request = std::move(*pending);
+            pending.reset();
+            requestGeneration = generation;
+        }
+
+        OSTREE_TUI_PROFILE_SCOPE("CommitDiffer::diff");
+        const auto start = std::chrono::steady_clock::now();
+        bool failed{false};
+        std::string error;
+        {
+            Diff diff(requestGeneration, pool);
+            diff.group.Run([&] { diffCommits(diff, request.first, request.second); });
+            diff.group.Wait();
+            failed = diff.failed;
+            error = diff.error;
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                return;
+            }
+            if (requestGeneration != generation) {
+                continue;
+            }
+            status.running = false;
+            status.failed = failed;
+            status.error = error;
+            status.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            std::sort(entries.begin(), entries.end(),
+                      [](const DiffEntry& a, const DiffEntry& b) { return a.path < b.path; });
+        }
+        onChange();
+    }
+}
+
+void CommitDiffer::diffCommits(Diff& diff, const std::string& from, const std::string& to) {
+    OstreeRepo* r = repo();
+    if (r == nullptr) {
+        return fail(diff, "could not open repository " + repoPath);
+    }
+    // see OSTREE_COMMIT_GVARIANT_FORMAT, (6) root dirtree & (7) root dirmeta checksum
+    std::array<ObjectId, 2> trees{};
+    std::array<ObjectId, 2> metas{};
+    const std::array<const std::string*, 2> commits{&from, &to};
+    for (size_t side{0}; side < 2; side++) {
+        GError* loadError{nullptr};
+        g_autoptr(GVariant) variant = nullptr;
+        if (!ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_COMMIT, commits[side]->c_str(),
+                                      &variant, &loadError)) {
+            fail(diff, loadError->message);
+            g_error_free(loadError);
+            return;
+        }
+        g_autoptr(GVariant) treeChecksum = g_variant_get_child_value(variant, 6);
+        g_autoptr(GVariant) metaChecksum = g_variant_get_child_value(variant, 7);
+        if (!ReadObjectId(treeChecksum, trees[side]) || !ReadObjectId(metaChecksum, metas[side])) {
+            return fail(diff, "invalid root tree in commit " + *commits[side]);
+        }
+    }
+
+    if (metas[0] != metas[1]) {
+        std::vector<DiffEntry> root{{DiffKind::MODIFIED, "/", true}};
+        publish(diff, root);
+    }
+    if (trees[0] != trees[1]) {
+        diffDirtrees(diff, "/", trees[0], trees[1]);
+    }
+}
+
+void CommitDiffer::diffDirtrees(Diff& diff,
+                                const std::string& path,
+                                const ObjectId& from,
+                                const ObjectId& to) {
+    if (diff.failed || superseded(diff)) {
+        return;
+    }
+    OSTREE_TUI_PROFILE_COUNT("diffedDirtrees", 1);
+
+    OstreeRepo* r = repo();
+    g_autoptr(GVariant) fromTree = nullptr;
+    g_autoptr(GVariant) toTree = nullptr;
+    GError* loadError{nullptr};
+    if (r == nullptr ||
+        !ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_DIR_TREE, ToChecksum(from).c_str(),
+                                  &fromTree, &loadError) ||
+        !ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_DIR_TREE, ToChecksum(to).c_str(),
+                                  &toTree, &loadError)) {
+        fail(diff, loadError != nullptr ? loadError->message : "could not open repository");
+        g_clear_error(&loadError);
+        return;
+    }
+
+    std::vector<DiffEntry> changes;
+    // see OSTREE_TREE_GVARIANT_FORMAT, a(say) files & a(sayay) directories
+    g_autoptr(GVariant) fromFiles = g_variant_get_child_value(fromTree, 0);
+    g_autoptr(GVariant) toFiles = g_variant_get_child_value(toTree, 0);
+    mergeEntries(fromFiles, toFiles, [&](const char* name, GVariant* a, GVariant* b) {
+        if (a == nullptr) {
+            changes.push_back({DiffKind::ADDED, path + name});
+        } else if (b == nullptr) {
+            changes.push_back({DiffKind::REMOVED, path + name});
+        } else if (entryChecksum(a, 1) != entryChecksum(b, 1)) {
+            changes.push_back({DiffKind::MODIFIED, path + name});
+        }
+    });
+
+    g_autoptr(GVariant) fromDirs = g_variant_get_child_value(fromTree, 1);
+    g_autoptr(GVariant) toDirs = g_variant_get_child_value(toTree, 1);
+    mergeEntries(fromDirs, toDirs, [&](const char* name, GVariant* a, GVariant* b) {
+        if (a == nullptr) {
+            changes.push_back({DiffKind::ADDED, path + name, true});
+            return;
+        }
+        if (b == nullptr) {
+            changes.push_back({DiffKind::REMOVED, path + name, true});
+            return;
+        }
+        if (entryChecksum(a, 2) != entryChecksum(b, 2)) {
+            changes.push_back({DiffKind::MODIFIED, path + name, true});
+        }
+        // identical subtrees are skipped as a whole
+        const ObjectId fromSubtree = entryChecksum(a, 1);
+        const ObjectId toSubtree = entryChecksum(b, 1);
+        if (fromSubtree != toSubtree) {
+            diff.group.Run([this, &diff, subPath = path + name + "/", fromSubtree, toSubtree] {
+                diffDirtrees(diff, subPath, fromSubtree, toSubtree);
+            });
+        }
+    });
+
+    publish(diff, changes);
+}
+
+void CommitDiffer::publish(Diff& diff, std::vector<DiffEntry>& changes) {
+    if (changes.empty()) {
+        return;
+    }
+    bool notify{false};
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (diff.generation != generation) {
+            return;
+        }
+        for (auto& change : changes) {
+            switch (change.kind) {
+                case DiffKind::ADDED:
+                    status.added++;
+                    break;
+                case DiffKind::REMOVED:
+                    status.removed++;
+                    break;
+                case DiffKind::MODIFIED:
+                    status.modified++;
+                    break;
+            }
+            entries.push_back(std::move(change));
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastChange >= CHANGE_INTERVAL) {
+            lastChange = now;
+            notify = true;
+        }
+    }
+    if (notify) {
+        onChange();
+    }
+}
+
+bool CommitDiffer::superseded(const Diff& diff) const {
+    return diff.generation != generation;
+}
+
+void CommitDiffer::fail(Diff& diff, const std::string& message) {
+    diff.failed = true;
+    const std::lock_guard<std::mutex> lock(diff.errorMutex);
+    diff.error = message;
+}
+
+OstreeRepo* CommitDiffer::repo() {
+    const auto index = ThreadPool::CurrentWorker();
+    if (!index || *index >= repos.size()) {
+        return nullptr;
+    }
+    OstreeRepo*& r = repos[*index];
+    if (r == nullptr) {
+        r = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, nullptr);
+    }
+    return r;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,142 @@
+/*_____________________________________________________________
+ | Commit Diff
+ |   Added, removed & modified files between two commits, like
+ |   `ostree diff`, calculated on a background thread:
+ |   - only dirtree pairs with differing checksums are entered,
+ |     identical subtrees are skipped as a whole (two images,
+ |     that differ in a few packages, diff in milliseconds)
+ |   - differing subtrees are diffed in parallel, one pool task
+ |     per directory pair, every worker uses its own OstreeRepo
+ |   - results stream in, while the diff runs
+ |   Only one diff runs at a time, starting another one cancels
+ |   the running diff.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+enum class DiffKind : uint8_t { ADDED, REMOVED, MODIFIED };
+
+struct DiffEntry {
+    DiffKind kind{DiffKind::MODIFIED};
+    std::string path;
+    // added / removed directories are not entered, they stand for their whole subtree;
+    // modified directories changed their metadata (ownership, mode, xattrs)
+    bool dir{false};
+};
+
+class CommitDiffer {
+   public:
+    /// Called from the worker threads, when entries were added (throttled) & once a diff ends.
+    using ChangeCallback = std::function<void()>;
+
+    struct Status {
+        std::string from;
+        std::string to;
+        size_t added{0};
+        size_t removed{0};
+        size_t modified{0};
+        bool running{false};
+        bool failed{false};
+        std::string error;
+        std::chrono::milliseconds duration{0};
+    };
+
+    /**
+     * @param repoPath Path of the repository (every pool worker opens its own handle).
+     * @param pool Pool to run the directory diffs on.
+     * @param onChange Change callback.
+     */
+    CommitDiffer(std::string repoPath, ThreadPool& pool, ChangeCallback onChange);
+    ~CommitDiffer();
+    CommitDiffer(const CommitDiffer&) = delete;
+    CommitDiffer& operator=(const CommitDiffer&) = delete;
+
+    /**
+     * @brief Starts diffing two commits, cancelling the running diff. Nothing happens, if the
+     * commits are already being diffed or were diffed successfully (a cancelled or failed diff
+     * is started again).
+     *
+     * @param from Commit checksum of the old state.
+     * @param to Commit checksum of the new state.
+     */
+    void Start(const std::string& from, const std::string& to);
+
+    /// @brief Cancels the running diff (its entries so far stay).
+    void Cancel();
+
+    [[nodiscard]] Status GetStatus() const;
+
+    /// @return Amount of entries of the current diff.
+    [[nodiscard]] size_t GetEntryCount() const;
+
+    /**
+     * @brief Copies a range of entries (sorted by path, once the diff finished).
+     *
+     * @param first Index of the first entry.
+     * @param count Maximum amount of entries.
+     * @return Entries.
+     */
+    [[nodiscard]] std::vector<DiffEntry> GetEntries(size_t first, size_t count) const;
+
+   private:
+    struct Diff;
+
+    void run();
+
+    /// @brief Diffs the root trees of the commits (runs on the pool).
+    void diffCommits(Diff& diff, const std::string& from, const std::string& to);
+
+    /// @brief Diffs two different dirtrees at path (runs on the pool).
+    void diffDirtrees(Diff& diff,
+                      const std::string& path,
+                      const ObjectId& from,
+                      const ObjectId& to);
+
+    /// @brief Adds the entries of one directory, if the diff is still the current one.
+    void publish(Diff& diff, std::vector<DiffEntry>& entries);
+
+    /// @return true, if another diff was started (or the differ stops).
+    [[nodiscard]] bool superseded(const Diff& diff) const;
+
+    void fail(Diff& diff, const std::string& message);
+
+    /// @return OstreeRepo handle of the calling pool worker.
+    OstreeRepo* repo();
+
+    std::string repoPath;
+    ThreadPool& pool;
+    ChangeCallback onChange;
+    std::vector<OstreeRepo*> repos;  // pool worker -> repo handle, opened lazily
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    std::optional<std::pair<std::string, std::string>> pending;  // from, to
+    std::atomic<uint64_t> generation{0};  // incremented by every Start() & Cancel()
+    Status status;
+    std::vector<DiffEntry> entries;
+    std::chrono::steady_clock::time_point lastChange;
+
+    std::thread worker;
+};
+
+}  // namespace cpplibostree
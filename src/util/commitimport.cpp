@@ -0,0 +1,930 @@
+#include "commitimport.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+#include "repolock.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE{512};
+/// size of the read buffers of tarballs
+constexpr size_t BUFFER_SIZE{1024 * 1024};
+/// tarball content buffered for the pool at once
+constexpr uint64_t MAX_BUFFERED{256 * 1024 * 1024};
+/// larger files of tarballs are streamed to their task through a pipe, instead of buffered
+constexpr uint64_t STREAM_THRESHOLD{8 * 1024 * 1024};
+constexpr std::chrono::milliseconds PROGRESS_INTERVAL{100};
+
+struct ImportEntry {
+    std::string path;  // relative to the root, empty for the root itself
+    uint32_t mode{0};  // including the file type
+    uint32_t uid{0};
+    uint32_t gid{0};
+    uint64_t size{0};
+    std::string symlinkTarget;
+    std::string hardlink;  // tarball hardlinks: path of the linked file
+    std::string checksum;  // content object of files, set by the pool
+};
+
+/// State shared by the reading thread & the pool tasks of one import.
+struct Import {
+    Import(OstreeRepo* repo,
+           ThreadPool& pool,
+           const ImportProgress& onProgress,
+           GCancellable* cancellable)
+        : repo(repo), onProgress(onProgress), cancellable(cancellable), group(pool) {}
+    ~Import() {
+        group.Wait();
+        g_clear_error(&error);
+    }
+    Import(const Import&) = delete;
+    Import& operator=(const Import&) = delete;
+
+    OstreeRepo* repo;
+    const ImportProgress& onProgress;
+    GCancellable* cancellable;
+    // entries stay at their address, while the pool fills in their checksums
+    std::deque<ImportEntry> entries;
+
+    std::atomic<bool> failed{false};
+    std::mutex errorMutex;
+    GError* error{nullptr};  // first error
+
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> bytes{0};
+    std::mutex progressMutex;
+    std::chrono::steady_clock::time_point lastReport;
+
+    // tarball content waiting for the pool
+    std::mutex bufferMutex;
+    std::condition_variable bufferReleased;
+    uint64_t buffered{0};
+
+    // declared last: waits for all tasks, before the other members are destroyed
+    TaskGroup group;
+};
+
+/// @brief Records the first error of an import, takes the ownership of error.
+void fail(Import& import, GError* error) {
+    const std::lock_guard<std::mutex> lock(import.errorMutex);
+    if (import.error == nullptr) {
+        import.error = error;
+    } else {
+        g_error_free(error);
+    }
+    import.failed = true;
+}
+
+void failWithErrno(Import& import, const std::string& what) {
+    const int code = errno;
+    fail(import, g_error_new(G_IO_ERROR, g_io_error_from_errno(code), "%s: %s", what.c_str(),
+                             g_strerror(code)));
+}
+
+/// @return true, if the import should stop reading.
+bool stopped(Import& import) {
+    if (import.failed) {
+        return true;
+    }
+    GError* error{nullptr};
+    if (g_cancellable_set_error_if_cancelled(import.cancellable, &error)) {
+        fail(import, error);
+        return true;
+    }
+    return false;
+}
+
+/// @brief Reports the progress, at most every PROGRESS_INTERVAL (unless forced), serialized.
+void report(Import& import, bool force) {
+    std::unique_lock<std::mutex> lock(import.progressMutex, std::defer_lock);
+    if (force) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now - import.lastReport < PROGRESS_INTERVAL) {
+        return;
+    }
+    import.lastReport = now;
+    import.onProgress(import.files, import.bytes);
+}
+
+GFileInfo* newFileInfo(const ImportEntry& entry) {
+    GFileInfo* info = g_file_info_new();
+    g_file_info_set_attribute_uint32(info, "unix::uid", entry.uid);
+    g_file_info_set_attribute_uint32(info, "unix::gid", entry.gid);
+    g_file_info_set_attribute_uint32(info, "unix::mode", entry.mode);
+    if (S_ISDIR(entry.mode)) {
+        g_file_info_set_file_type(info, G_FILE_TYPE_DIRECTORY);
+    } else if (S_ISLNK(entry.mode)) {
+        g_file_info_set_file_type(info, G_FILE_TYPE_SYMBOLIC_LINK);
+        g_file_info_set_is_symlink(info, TRUE);
+        g_file_info_set_symlink_target(info, entry.symlinkTarget.c_str());
+    } else {
+        g_file_info_set_file_type(info, G_FILE_TYPE_REGULAR);
+        g_file_info_set_size(info, static_cast<goffset>(entry.size));
+    }
+    return info;
+}
+
+/**
+ * @brief Hashes & writes the content object of a file or symbolic link (runs on the pool, all
+ * tasks write into the transaction of the same repository handle, as libostree's pulls do).
+ *
+ * @param input Content of regular files, nullptr for symbolic links.
+ */
+void writeContent(Import& import, ImportEntry& entry, GInputStream* input) {
+    if (import.failed) {
+        return;
+    }
+    OSTREE_TUI_PROFILE_COUNT("importedObjects", 1);
+    g_autoptr(GFileInfo) info = newFileInfo(entry);
+    g_autoptr(GInputStream) content = nullptr;
+    guint64 length{0};
+    g_autofree guchar* checksum{nullptr};
+    GError* error{nullptr};
+    if (!ostree_raw_file_to_content_stream(input, info, nullptr, &content, &length,
+                                           import.cancellable, &error) ||
+        !ostree_repo_write_content(import.repo, nullptr, content, length, &checksum,
+                                   import.cancellable, &error)) {
+        g_prefix_error(&error, "%s: ", entry.path.c_str());
+        fail(import, error);
+        return;
+    }
+    g_autofree char* hex = ostree_checksum_from_bytes(checksum);
+    entry.checksum = hex;
+    import.files++;
+    import.bytes += entry.size;
+    report(import, false);
+}
+
+struct DevIno {
+    dev_t dev;
+    ino_t ino;
+    bool operator==(const DevIno& other) const = default;
+};
+
+struct DevInoHash {
+    size_t operator()(const DevIno& devino) const noexcept {
+        return std::hash<uint64_t>{}(static_cast<uint64_t>(devino.ino) * 31 +
+                                     static_cast<uint64_t>(devino.dev));
+    }
+};
+
+/// (device, inode) of hardlinked file objects -> checksum
+using DevInoCache = std::unordered_map<DevIno, std::string, DevInoHash>;
+
+/**
+ * @brief Collects the file objects of a bare repository, that have further hardlinks (e.g. from
+ * a checkout), like ostree_repo_scan_hardlinks(). The 256 object directories are scanned in
+ * parallel.
+ */
+DevInoCache scanHardlinkedObjects(OstreeRepo* repo, ThreadPool& pool) {
+    OSTREE_TUI_PROFILE_SCOPE("scanHardlinkedObjects");
+    DevInoCache cache;
+    std::mutex mutex;
+    TaskGroup group(pool);
+    const int repoDfd = ostree_repo_get_dfd(repo);
+    for (unsigned int prefix{0}; prefix < 256; prefix++) {
+        group.Run([&, prefix] {
+            std::array<char, 16> name{};
+            std::snprintf(name.data(), name.size(), "objects/%02x", prefix);
+            const int dfd = openat(repoDfd, name.data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            DIR* dir = dfd >= 0 ? fdopendir(dfd) : nullptr;
+            if (dir == nullptr) {
+                if (dfd >= 0) {
+                    close(dfd);
+                }
+                return;
+            }
+            DevInoCache local;
+            while (const dirent* entry = readdir(dir)) {
+                const std::string_view file = entry->d_name;
+                struct stat stbuf {};
+                if (!file.ends_with(".file") ||
+                    fstatat(dfd, entry->d_name, &stbuf, AT_SYMLINK_NOFOLLOW) != 0 ||
+                    stbuf.st_nlink < 2) {
+                    continue;
+                }
+                local.emplace(DevIno{stbuf.st_dev, stbuf.st_ino},
+                              std::string(name.data() + 8) +
+                                  std::string(file.substr(0, file.size() - 5)));
+            }
+            closedir(dir);
+            const std::lock_guard<std::mutex> lock(mutex);
+            cache.merge(local);
+        });
+    }
+    group.Wait();
+    return cache;
+}
+
+/// @brief Walks a directory, writing its files on the pool (hardlinked objects are reused).
+void readDirectory(Import& import, ThreadPool& pool, const std::string& source) {
+    OSTREE_TUI_PROFILE_SCOPE("readDirectory");
+    struct stat root {};
+    if (lstat(source.c_str(), &root) != 0) {
+        return failWithErrno(import, source);
+    }
+    import.entries.push_back({.mode = root.st_mode, .uid = root.st_uid, .gid = root.st_gid});
+
+    // only hardlinks into a bare repository on the same device can be reused
+    DevInoCache devino;
+    struct stat repoStat {};
+    if (ostree_repo_get_mode(import.repo) != OSTREE_REPO_MODE_ARCHIVE &&
+        fstat(ostree_repo_get_dfd(import.repo), &repoStat) == 0 &&
+        repoStat.st_dev == root.st_dev) {
+        devino = scanHardlinkedObjects(import.repo, pool);
+    }
+
+    std::error_code fsError;
+    std::filesystem::recursive_directory_iterator walk(source, fsError);
+    for (; !fsError && walk != std::filesystem::recursive_directory_iterator();
+         walk.increment(fsError)) {
+        if (stopped(import)) {
+            return;
+        }
+        const std::string path = walk->path().string();
+        struct stat stbuf {};
+        if (lstat(path.c_str(), &stbuf) != 0) {
+            return failWithErrno(import, path);
+        }
+        ImportEntry& entry = import.entries.emplace_back(
+            ImportEntry{.path = walk->path().lexically_relative(source).generic_string(),
+                        .mode = stbuf.st_mode,
+                        .uid = stbuf.st_uid,
+                        .gid = stbuf.st_gid});
+
+        if (S_ISDIR(stbuf.st_mode)) {
+            continue;
+        }
+        if (S_ISLNK(stbuf.st_mode)) {
+            entry.symlinkTarget = std::filesystem::read_symlink(walk->path(), fsError).string();
+            if (fsError) {
+                break;
+            }
+            import.group.Run([&import, &entry] { writeContent(import, entry, nullptr); });
+            continue;
+        }
+        if (!S_ISREG(stbuf.st_mode)) {
+            return fail(import, g_error_new(G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                            "%s: unsupported file type", path.c_str()));
+        }
+
+        entry.size = static_cast<uint64_t>(stbuf.st_size);
+        if (stbuf.st_nlink > 1) {
+            const auto object = devino.find(DevIno{stbuf.st_dev, stbuf.st_ino});
+            if (object != devino.end()) {
+                OSTREE_TUI_PROFILE_COUNT("importReusedObjects", 1);
+                entry.checksum = object->second;
+                import.files++;
+                import.bytes += entry.size;
+                report(import, false);
+                continue;
+            }
+        }
+        import.group.Run([&import, &entry, path] {
+            g_autoptr(GFile) file = g_file_new_for_path(path.c_str());
+            GError* error{nullptr};
+            g_autoptr(GFileInputStream) input = g_file_read(file, import.cancellable, &error);
+            if (input == nullptr) {
+                return fail(import, error);
+            }
+            writeContent(import, entry, G_INPUT_STREAM(input));
+        });
+    }
+    if (fsError) {
+        fail(import, g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED, "%s: %s", source.c_str(),
+                                 fsError.message().c_str()));
+    }
+}
+
+/// Sequential reader of a plain, gzip or zstd compressed tarball.
+class TarballReader {
+   public:
+    static std::unique_ptr<TarballReader> Open(const std::string& path,
+                                               GCancellable* cancellable,
+                                               GError** error) {
+        // the compression is detected by the magic bytes
+        std::array<unsigned char, 6> magic{};
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            const int code = errno;
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code), "%s: %s", path.c_str(),
+                        g_strerror(code));
+            return nullptr;
+        }
+        const ssize_t magicSize = pread(fd, magic.data(), magic.size(), 0);
+        close(fd);
+
+        g_autoptr(GFile) file = g_file_new_for_path(path.c_str());
+        g_autoptr(GFileInputStream) input = g_file_read(file, cancellable, error);
+        if (input == nullptr) {
+            return nullptr;
+        }
+        std::unique_ptr<TarballReader> reader(new TarballReader(cancellable));
+        const auto starts = [&](std::initializer_list<unsigned char> bytes) {
+            return magicSize >= static_cast<ssize_t>(bytes.size()) &&
+                   std::equal(bytes.begin(), bytes.end(), magic.begin());
+        };
+        if (starts({0x1f, 0x8b})) {
+            g_autoptr(GZlibDecompressor) gzip =
+                g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+            reader->stream = g_converter_input_stream_new(G_INPUT_STREAM(input), G_CONVERTER(gzip));
+        } else if (starts({0x28, 0xb5, 0x2f, 0xfd})) {
+            reader->stream = G_INPUT_STREAM(g_object_ref(input));
+            reader->zstd = ZSTD_createDCtx();
+            reader->compressed.resize(BUFFER_SIZE);
+        } else if (starts({'B', 'Z', 'h'}) || starts({0xfd, '7', 'z', 'X', 'Z', 0x00})) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                        "%s: only plain, gzip & zstd compressed tarballs are supported",
+                        path.c_str());
+            return nullptr;
+        } else {
+            reader->stream = G_INPUT_STREAM(g_object_ref(input));
+        }
+        return reader;
+    }
+
+    ~TarballReader() {
+        ZSTD_freeDCtx(zstd);
+        if (stream != nullptr) {
+            g_object_unref(stream);
+        }
+    }
+    TarballReader(const TarballReader&) = delete;
+    TarballReader& operator=(const TarballReader&) = delete;
+
+    /// @brief Reads exactly size bytes, a shorter tarball is an error.
+    bool Read(char* data, size_t size, GError** error) {
+        if (zstd == nullptr) {
+            gsize bytesRead{0};
+            if (!g_input_stream_read_all(stream, data, size, &bytesRead, cancellable, error)) {
+                return false;
+            }
+            return bytesRead == size || truncated(error);
+        }
+        ZSTD_outBuffer out{data, size, 0};
+        while (out.pos < out.size) {
+            if (input.pos == input.size) {
+                const gssize bytesRead = g_input_stream_read(stream, compressed.data(),
+                                                             compressed.size(), cancellable, error);
+                if (bytesRead < 0) {
+                    return false;
+                }
+                if (bytesRead == 0) {
+                    return truncated(error);
+                }
+                input = ZSTD_inBuffer{compressed.data(), static_cast<size_t>(bytesRead), 0};
+            }
+            const size_t result = ZSTD_decompressStream(zstd, &out, &input);
+            if (ZSTD_isError(result) != 0U) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "zstd: %s",
+                            ZSTD_getErrorName(result));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Skips size bytes.
+    bool Skip(uint64_t size, GError** error) {
+        for (uint64_t remaining{size}; remaining > 0;) {
+            const auto chunk = static_cast<size_t>(std::min<uint64_t>(remaining, scratch.size()));
+            if (!Read(scratch.data(), chunk, error)) {
+                return false;
+            }
+            remaining -= chunk;
+        }
+        return true;
+    }
+
+    /// buffer for skipped & streamed data
+    std::vector<char> scratch = std::vector<char>(BUFFER_SIZE);
+
+   private:
+    explicit TarballReader(GCancellable* cancellable) : cancellable(cancellable) {}
+
+    static bool truncated(GError** error) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, "unexpected end of tarball");
+        return false;
+    }
+
+    GCancellable* cancellable;
+    GInputStream* stream{nullptr};
+    ZSTD_DCtx* zstd{nullptr};
+    std::vector<char> compressed;
+    ZSTD_inBuffer input{nullptr, 0, 0};
+};
+
+/// @return Value of a numeric header field, octal or base-256 (GNU, large files).
+uint64_t parseNumber(const char* field, size_t width) {
+    uint64_t value{0};
+    if ((static_cast<unsigned char>(field[0]) & 0x80) != 0) {
+        for (size_t i{1}; i < width; i++) {
+            value = (value << 8) | static_cast<unsigned char>(field[i]);
+        }
+        return value;
+    }
+    for (size_t i{0}; i < width && field[i] != 0; i++) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = (value << 3) | static_cast<uint64_t>(field[i] - '0');
+        }
+    }
+    return value;
+}
+
+/// @return NUL terminated string of a header field.
+std::string parseString(const char* field, size_t width) {
+    return {field, strnlen(field, width)};
+}
+
+bool validChecksum(const std::array<char, BLOCK_SIZE>& header) {
+    unsigned int sum{0};
+    for (size_t i{0}; i < BLOCK_SIZE; i++) {
+        sum += i >= 148 && i < 156 ? ' ' : static_cast<unsigned char>(header[i]);
+    }
+    return sum == parseNumber(header.data() + 148, 8);
+}
+
+/**
+ * @brief Normalizes a path of a tarball ("./usr/bin/" -> "usr/bin").
+ *
+ * @return false, if the path leaves the root.
+ */
+bool normalizePath(std::string& path) {
+    std::string normalized;
+    for (const auto part : std::views::split(std::string_view(path), '/')) {
+        const std::string_view component(part.begin(), part.end());
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (component == "..") {
+            return false;
+        }
+        normalized += (normalized.empty() ? "" : "/") + std::string(component);
+    }
+    path = std::move(normalized);
+    return true;
+}
+
+/// @brief Applies the records of a pax extended header ("<length> <key>=<value>\n").
+void parsePax(std::string_view records, std::map<std::string, std::string>& values) {
+    while (!records.empty()) {
+        const size_t space = records.find(' ');
+        if (space == std::string_view::npos) {
+            return;
+        }
+        const size_t length = std::strtoull(std::string(records.substr(0, space)).c_str(),
+                                            nullptr, 10);
+        if (length <= space + 1 || length > records.size()) {
+            return;
+        }
+        const std::string_view record = records.substr(space + 1, length - space - 2);
+        const size_t equals = record.find('=');
+        if (equals != std::string_view::npos) {
+            values[std::string(record.substr(0, equals))] = record.substr(equals + 1);
+        }
+        records.remove_prefix(length);
+    }
+}
+
+/// @brief Writes all bytes into a pipe.
+bool writePipe(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the content of a regular file of a tarball & writes it on the pool: small files
+ * are buffered (bounded by MAX_BUFFERED), large ones are streamed through a pipe.
+ */
+bool readTarballFile(Import& import, TarballReader& reader, ImportEntry& entry, GError** error) {
+    if (entry.size <= STREAM_THRESHOLD) {
+        {
+            std::unique_lock<std::mutex> lock(import.bufferMutex);
+            import.bufferReleased.wait(lock, [&] {
+                return import.buffered == 0 || import.buffered + entry.size <= MAX_BUFFERED;
+            });
+            import.buffered += entry.size;
+        }
+        auto buffer = std::make_shared<std::string>(entry.size, '\0');
+        const auto release = [&import, size = entry.size] {
+            {
+                const std::lock_guard<std::mutex> lock(import.bufferMutex);
+                import.buffered -= size;
+            }
+            import.bufferReleased.notify_one();
+        };
+        if (!reader.Read(buffer->data(), buffer->size(), error)) {
+            release();
+            return false;
+        }
+        import.group.Run([&import, &entry, buffer, release] {
+            g_autoptr(GInputStream) input =
+                g_memory_input_stream_new_from_data(buffer->data(), buffer->size(), nullptr);
+            writeContent(import, entry, input);
+            release();
+        });
+        return true;
+    }
+
+    OSTREE_TUI_PROFILE_COUNT("importStreamedFiles", 1);
+    std::array<int, 2> fds{};
+    if (pipe2(fds.data(), O_CLOEXEC) != 0) {
+        const int code = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code), "pipe: %s", g_strerror(code));
+        return false;
+    }
+    import.group.Run([&import, &entry, readFd = fds[0]] {
+        g_autoptr(GInputStream) input = g_unix_input_stream_new(readFd, TRUE);
+        writeContent(import, entry, input);
+        // the reading thread blocks, until everything was consumed (even after failures)
+        std::array<char, 64 * 1024> rest{};
+        while (g_input_stream_read(input, rest.data(), rest.size(), nullptr, nullptr) > 0) {
+        }
+    });
+    bool success{true};
+    for (uint64_t remaining{entry.size}; success && !import.failed && remaining > 0;) {
+        const auto chunk =
+            static_cast<size_t>(std::min<uint64_t>(remaining, reader.scratch.size()));
+        success = reader.Read(reader.scratch.data(), chunk, error);
+        if (success && !writePipe(fds[1], reader.scratch.data(), chunk)) {
+            const int code = errno;
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code), "pipe: %s",
+                        g_strerror(code));
+            success = false;
+        }
+        remaining -= chunk;
+    }
+    // end of the content (or truncated, if reading failed)
+    close(fds[1]);
+    return success;
+}
+
+/// @brief Reads a tarball, writing its files on the pool.
+void readTarball(Import& import, TarballReader& reader) {
+    OSTREE_TUI_PROFILE_SCOPE("readTarball");
+    // the root may be missing in tarballs
+    import.entries.push_back({.mode = S_IFDIR | 0755});
+
+    GError* error{nullptr};
+    std::array<char, BLOCK_SIZE> header{};
+    std::map<std::string, std::string> pax;  // extended header of the next entry
+    std::string longName;                    // GNU long names of the next entry
+    std::string longLink;
+    while (!stopped(import)) {
+        if (!reader.Read(header.data(), header.size(), &error)) {
+            return fail(import, error);
+        }
+        if (std::all_of(header.begin(), header.end(), [](char c) { return c == 0; })) {
+            break;
+        }
+        if (!validChecksum(header)) {
+            return fail(import, g_error_new(G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                            "not a tarball (invalid header checksum)"));
+        }
+
+        const char type = header[156];
+        uint64_t size = parseNumber(header.data() + 124, 12);
+        if (pax.contains("size")) {
+            size = std::strtoull(pax["size"].c_str(), nullptr, 10);
+        }
+        const uint64_t padding = (BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE;
+
+        // headers describing the next entry
+        if (type == 'x' || type == 'L' || type == 'K') {
+            std::string data(size, '\0');
+            if (!reader.Read(data.data(), data.size(), &error) ||
+                !reader.Skip(padding, &error)) {
+                return fail(import, error);
+            }
+            if (type == 'x') {
+                parsePax(data, pax);
+            } else {
+                (type == 'L' ? longName : longLink) = data.c_str();
+            }
+            continue;
+        }
+
+        ImportEntry entry{.mode = static_cast<uint32_t>(parseNumber(header.data() + 100, 8)),
+                          .uid = static_cast<uint32_t>(parseNumber(header.data() + 108, 8)),
+                          .gid = static_cast<uint32_t>(parseNumber(header.data() + 116, 8))};
+        entry.path = parseString(header.data(), 100);
+        if (std::string_view(header.data() + 257, 5) == "ustar" && header[345] != 0) {
+            entry.path = parseString(header.data() + 345, 155) + "/" + entry.path;
+        }
+        std::string link = parseString(header.data() + 157, 100);
+        if (!longName.empty()) {
+            entry.path = std::exchange(longName, "");
+        }
+        if (!longLink.empty()) {
+            link = std::exchange(longLink, "");
+        }
+        if (pax.contains("path")) {
+            entry.path = pax["path"];
+        }
+        if (pax.contains("linkpath")) {
+            link = pax["linkpath"];
+        }
+        if (pax.contains("uid")) {
+            entry.uid = static_cast<uint32_t>(std::strtoul(pax["uid"].c_str(), nullptr, 10));
+        }
+        if (pax.contains("gid")) {
+            entry.gid = static_cast<uint32_t>(std::strtoul(pax["gid"].c_str(), nullptr, 10));
+        }
+        pax.clear();
+        if (!normalizePath(entry.path)) {
+            return fail(import, g_error_new(G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                            "%s: path leaves the root", entry.path.c_str()));
+        }
+        entry.mode &= 07777;
+
+        bool success{true};
+        switch (type) {
+            case '5':
+                entry.mode |= S_IFDIR;
+                if (entry.path.empty()) {
+                    import.entries.front() = std::move(entry);
+                } else {
+                    import.entries.push_back(std::move(entry));
+                }
+                success = reader.Skip(size + padding, &error);
+                break;
+            case '2': {
+                entry.mode |= S_IFLNK;
+                entry.symlinkTarget = link;
+                ImportEntry& symlink = import.entries.emplace_back(std::move(entry));
+                import.group.Run([&import, &symlink] { writeContent(import, symlink, nullptr); });
+                success = reader.Skip(size + padding, &error);
+                break;
+            }
+            case '1':
+                entry.mode |= S_IFREG;
+                entry.hardlink = link;
+                success = normalizePath(entry.hardlink) && reader.Skip(size + padding, &error);
+                import.entries.push_back(std::move(entry));
+                break;
+            case '0':
+            case '7':
+            case '\0': {
+                entry.mode |= S_IFREG;
+                entry.size = size;
+                ImportEntry& file = import.entries.emplace_back(std::move(entry));
+                success = readTarballFile(import, reader, file, &error) &&
+                          reader.Skip(padding, &error);
+                break;
+            }
+            default:
+                // devices, fifos & global headers have no equivalent in ostree
+                OSTREE_TUI_PROFILE_COUNT("importSkippedEntries", 1);
+                success = reader.Skip(size + padding, &error);
+                break;
+        }
+        if (!success) {
+            return fail(import, error != nullptr
+                                    ? error
+                                    : g_error_new(G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                                  "hardlink leaves the root"));
+        }
+    }
+}
+
+/// Writes & deduplicates the dirmeta objects of an import.
+class DirmetaWriter {
+   public:
+    explicit DirmetaWriter(OstreeRepo* repo) : repo(repo) {}
+
+    /// @return Checksum of the dirmeta of a directory entry, nullptr on errors.
+    const char* Write(const ImportEntry& entry, GCancellable* cancellable, GError** error) {
+        const auto key = std::make_tuple(entry.uid, entry.gid, entry.mode);
+        auto written = checksums.find(key);
+        if (written != checksums.end()) {
+            return written->second.c_str();
+        }
+        g_autoptr(GFileInfo) info = newFileInfo(entry);
+        g_autoptr(GVariant) dirmeta = ostree_create_directory_metadata(info, nullptr);
+        g_autofree guchar* checksum{nullptr};
+        if (!ostree_repo_write_metadata(repo, OSTREE_OBJECT_TYPE_DIR_META, nullptr, dirmeta,
+                                        &checksum, cancellable, error)) {
+            return nullptr;
+        }
+        g_autofree char* hex = ostree_checksum_from_bytes(checksum);
+        return checksums.emplace(key, hex).first->second.c_str();
+    }
+
+   private:
+    OstreeRepo* repo;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::string> checksums;
+};
+
+/// @brief Builds the mutable tree of the imported entries (checksums are all set).
+bool buildTree(Import& import, OstreeMutableTree* root, GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("buildTree");
+    DirmetaWriter dirmetas(import.repo);
+    // parents, that are missing in tarballs
+    const ImportEntry implicitDir{.mode = S_IFDIR | 0755};
+    const char* implicitMeta = dirmetas.Write(implicitDir, import.cancellable, error);
+    const char* rootMeta = dirmetas.Write(import.entries.front(), import.cancellable, error);
+    if (implicitMeta == nullptr || rootMeta == nullptr) {
+        return false;
+    }
+    ostree_mutable_tree_set_metadata_checksum(root, rootMeta);
+
+    // tarball hardlinks share the content of their target
+    std::unordered_map<std::string_view, const std::string*> files;
+    if (std::any_of(import.entries.begin(), import.entries.end(),
+                    [](const ImportEntry& entry) { return !entry.hardlink.empty(); })) {
+        for (const auto& entry : import.entries) {
+            if (!entry.checksum.empty()) {
+                files.emplace(entry.path, &entry.checksum);
+            }
+        }
+    }
+
+    for (auto entry = import.entries.begin() + 1; entry != import.entries.end(); entry++) {
+        g_autoptr(GPtrArray) components = g_ptr_array_new_with_free_func(g_free);
+        for (const auto part : std::views::split(std::string_view(entry->path), '/')) {
+            g_ptr_array_add(components, g_strndup(part.data(), part.size()));
+        }
+        const char* name = static_cast<const char*>(components->pdata[components->len - 1]);
+        g_autoptr(OstreeMutableTree) parent = nullptr;
+        if (!ostree_mutable_tree_ensure_parent_dirs(root, components, implicitMeta, &parent,
+                                                    error)) {
+            return false;
+        }
+
+        if (S_ISDIR(entry->mode)) {
+            const char* meta = dirmetas.Write(*entry, import.cancellable, error);
+            g_autoptr(OstreeMutableTree) dir = nullptr;
+            if (meta == nullptr || !ostree_mutable_tree_ensure_dir(parent, name, &dir, error)) {
+                return false;
+            }
+            ostree_mutable_tree_set_metadata_checksum(dir, meta);
+            continue;
+        }
+        const std::string* checksum = &entry->checksum;
+        if (!entry->hardlink.empty()) {
+            const auto target = files.find(entry->hardlink);
+            if (target == files.end()) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                            "%s: hardlink to missing file %s", entry->path.c_str(),
+                            entry->hardlink.c_str());
+                return false;
+            }
+            checksum = target->second;
+        }
+        if (!ostree_mutable_tree_replace_file(parent, name, checksum->c_str(), error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Imports the source & writes the commit, inside the prepared transaction.
+bool importInTransaction(OstreeRepo* repo,
+                         ThreadPool& pool,
+                         const ImportOptions& options,
+                         TarballReader* tarball,
+                         const char* parent,
+                         const ImportProgress& onProgress,
+                         std::string& commit,
+                         GCancellable* cancellable,
+                         GError** error) {
+    Import import(repo, pool, onProgress, cancellable);
+    if (tarball != nullptr) {
+        readTarball(import, *tarball);
+    } else {
+        readDirectory(import, pool, options.source);
+    }
+    import.group.Wait();
+    if (import.failed) {
+        g_propagate_error(error, std::exchange(import.error, nullptr));
+        return false;
+    }
+    report(import, true);
+
+    g_autoptr(OstreeMutableTree) tree = ostree_mutable_tree_new();
+    g_autoptr(GFile) root = nullptr;
+    g_autofree char* checksum{nullptr};
+    if (!buildTree(import, tree, error) ||
+        !ostree_repo_write_mtree(repo, tree, &root, cancellable, error) ||
+        !ostree_repo_write_commit(repo, parent, options.subject.c_str(),
+                                  options.body.empty() ? nullptr : options.body.c_str(), nullptr,
+                                  OSTREE_REPO_FILE(root), &checksum, cancellable, error)) {
+        return false;
+    }
+
+    // readers see the old or the new head, & the head is still the parent of the new commit
+    RepoLock lock;
+    g_autofree char* head{nullptr};
+    if (!lock.Acquire(repo, LockMode::EXCLUSIVE, LOCK_TIMEOUT, nullptr, cancellable, error) ||
+        !ostree_repo_resolve_rev(repo, options.branch.c_str(), TRUE, &head, error)) {
+        return false;
+    }
+    if (g_strcmp0(head, parent) != 0) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                    "Branch %s moved since the import started", options.branch.c_str());
+        return false;
+    }
+    ostree_repo_transaction_set_ref(repo, nullptr, options.branch.c_str(), checksum);
+    if (!ostree_repo_commit_transaction(repo, nullptr, cancellable, error)) {
+        return false;
+    }
+    commit = checksum;
+    return true;
+}
+
+}  // namespace
+
+bool ImportCommit(OstreeRepo* repo,
+                  ThreadPool& pool,
+                  const ImportOptions& options,
+                  const ImportProgress& onProgress,
+                  std::string& commit,
+                  GCancellable* cancellable,
+                  GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("ImportCommit");
+    if (options.branch.empty()) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "no branch to import to");
+        return false;
+    }
+    std::error_code fsError;
+    std::unique_ptr<TarballReader> tarball;
+    if (!std::filesystem::is_directory(options.source, fsError)) {
+        tarball = TarballReader::Open(options.source, cancellable, error);
+        if (!tarball) {
+            return false;
+        }
+    }
+
+    // the objects are written under a shared lock, only the ref update is exclusive (an
+    // upgrade of the held lock, libostree's transaction lock would block a fresh one)
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::SHARED, LOCK_TIMEOUT, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    // the current head becomes the parent
+    g_autofree char* parent{nullptr};
+    if (!ostree_repo_resolve_rev(repo, options.branch.c_str(), TRUE, &parent, error) ||
+        !ostree_repo_prepare_transaction(repo, nullptr, cancellable, error)) {
+        return false;
+    }
+    if (!importInTransaction(repo, pool, options, tarball.get(), parent, onProgress, commit,
+                             cancellable, error)) {
+        ostree_repo_abort_transaction(repo, nullptr, nullptr);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace cpplibostree
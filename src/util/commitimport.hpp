@@ -0,0 +1,61 @@
+/*_____________________________________________________________
+ | Commit Import
+ |   Creates a commit from a directory or tarball, like
+ |   `ostree commit --branch=REF --subject=TEXT [--tree=tar=]`,
+ |   without forking ostree:
+ |   - the source is read by one thread, content objects are
+ |     hashed & written by the thread pool, all inside one
+ |     transaction of the calling thread's repository handle
+ |   - files of a directory, that are hardlinks of objects of
+ |     the repository (e.g. a hardlinked checkout), are not
+ |     read again (devino cache)
+ |   - tarballs may be gzip or zstd compressed, their content
+ |     is buffered with a bound, large files are streamed
+ |   Extended attributes are not imported (`--no-xattrs`).
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <ostree.h>
+
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+struct ImportOptions {
+    std::string source;  // directory, or tarball (.tar, gzip or zstd compressed)
+    std::string branch;
+    std::string subject;
+    std::string body;
+};
+
+/// Called with the files & content bytes written (or reused) so far, from any thread.
+using ImportProgress = std::function<void(uint64_t files, uint64_t bytes)>;
+
+/**
+ * @brief Imports a directory or tarball as new commit on a branch, its parent is the current
+ * head of the branch (if it exists). The objects are written under a shared lock, the ref is
+ * updated under an exclusive one & only if the branch did not move in the meantime.
+ *
+ * @param repo Repository handle, the transaction is prepared & committed on it.
+ * @param pool Pool to hash & write the content objects on (not a worker of it).
+ * @param options Source, branch & commit message.
+ * @param onProgress Called at most every 100 ms (serialized), and once at the end.
+ * @param commit Set to the checksum of the new commit.
+ * @param cancellable Cancellable, the transaction is aborted when cancelled.
+ * @param error Set on failure, or if the branch moved.
+ * @return true on success
+ */
+bool ImportCommit(OstreeRepo* repo,
+                  ThreadPool& pool,
+                  const ImportOptions& options,
+                  const ImportProgress& onProgress,
+                  std::string& commit,
+                  GCancellable* cancellable,
+                  GError** error);
+
+}  // namespace cpplibostree
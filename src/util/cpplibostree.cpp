@@ -4,8 +4,11 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdlib>
-#include <sstream>
+#include <format>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,23 +19,233 @@
 #include <cassert>
 #include <cstdio>
 
+#include "profiler.hpp"
+#include "repojobs.hpp"
+#include "repolock.hpp"
+
 namespace cpplibostree {
 
-OSTreeRepo::OSTreeRepo(std::string path) : repoPath(std::move(path)), commitList({}), branches({}) {
-    UpdateData();
+std::optional<Timepoint> ParseTimepoint(const std::string& spec, bool endOfDay) {
+    using namespace std::chrono;
+
+    const size_t first = spec.find_first_not_of(' ');
+    if (first == std::string::npos) {
+        return std::nullopt;
+    }
+    const std::string trimmed = spec.substr(first, spec.find_last_not_of(' ') - first + 1);
+    const auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
+
+    if (trimmed == "now") {
+        return Timepoint(now);
+    }
+
+    // relative to now, e.g. 48h
+    long long amount{0};
+    char unit{0};
+    int consumed{0};
+    if (std::sscanf(trimmed.c_str(), "%lld%c%n", &amount, &unit, &consumed) == 2 &&
+        static_cast<size_t>(consumed) == trimmed.size() && amount >= 0) {
+        const std::unordered_map<char, long long> unitSeconds{
+            {'s', 1}, {'m', 60}, {'h', 3600}, {'d', 86400}, {'w', 604800}};
+        if (!unitSeconds.contains(unit)) {
+            return std::nullopt;
+        }
+        return Timepoint(now - seconds(amount * unitSeconds.at(unit)));
+    }
+
+    // absolute date, with optional time of day
+    int year{0};
+    int month{0};
+    int day{0};
+    if (std::sscanf(trimmed.c_str(), "%4d-%2d-%2d%n", &year, &month, &day, &consumed) != 3) {
+        return std::nullopt;
+    }
+    const year_month_day date{std::chrono::year{year},
+                              std::chrono::month{static_cast<unsigned>(month)},
+                              std::chrono::day{static_cast<unsigned>(day)}};
+    if (!date.ok()) {
+        return std::nullopt;
+    }
+    seconds timeOfDay{0};
+    const std::string rest = trimmed.substr(static_cast<size_t>(consumed));
+    if (rest.empty()) {
+        timeOfDay = endOfDay ? seconds(86399) : seconds(0);
+    } else {
+        int hour{0};
+        int minute{0};
+        int second{0};
+        consumed = 0;
+        if ((rest.at(0) != ' ' && rest.at(0) != 'T') ||
+            std::sscanf(rest.c_str() + 1, "%2d:%2d%n:%2d%n", &hour, &minute, &consumed, &second,
+                        &consumed) < 2 ||
+            static_cast<size_t>(consumed) + 1 != rest.size() || hour > 23 || minute > 59 ||
+            second > 59) {
+            return std::nullopt;
+        }
+        timeOfDay = hours(hour) + minutes(minute) + seconds(second);
+    }
+    return Timepoint(sys_days{date}.time_since_epoch() + timeOfDay);
+}
+
+std::string FormatTimepoint(const Timepoint& timepoint) {
+    return std::format("{:%Y-%m-%d %H:%M}",
+                       std::chrono::time_point_cast<std::chrono::seconds>(timepoint));
+}
+
+OSTreeRepo::OSTreeRepo(std::string path,
+                       bool preferSummary,
+                       ThreadPool* scanPool,
+                       StringTable* strings)
+    : OSTreeRepo(Unloaded{}, std::move(path), scanPool, strings) {
+    loadInitially(preferSummary);
+}
+
+OSTreeRepo::OSTreeRepo(const SysrootOptions& sysroot, StringTable* strings)
+    : OSTreeRepo(Unloaded{}, sysroot, strings) {
+    loadInitially(false);
+}
+
+OSTreeRepo::OSTreeRepo(Unloaded /*tag*/,
+                       std::string path,
+                       ThreadPool* scanPool,
+                       StringTable* strings)
+    : repoPath(std::move(path)),
+      commitList({}),
+      scanPool(scanPool),
+      ownStrings(strings == nullptr ? std::make_unique<StringTable>() : nullptr),
+      strings(strings == nullptr ? ownStrings.get() : strings),
+      branches({}) {}
+
+OSTreeRepo::OSTreeRepo(Unloaded /*tag*/, const SysrootOptions& sysroot, StringTable* strings)
+    : repoPath(SysrootRepoPath(sysroot.path)),
+      commitList({}),
+      ownStrings(strings == nullptr ? std::make_unique<StringTable>() : nullptr),
+      strings(strings == nullptr ? ownStrings.get() : strings),
+      sysrootPath(sysroot.path),
+      sysrootDepth(sysroot.depth),
+      branches({}) {}
+
+std::unique_ptr<OSTreeRepo> OSTreeRepo::Open(std::string repoPath,
+                                             bool preferSummary,
+                                             ThreadPool* scanPool,
+                                             StringTable* strings,
+                                             const std::stop_token& stop,
+                                             GError** error) {
+    // private constructor, no make_unique
+    std::unique_ptr<OSTreeRepo> repo(
+        new OSTreeRepo(Unloaded{}, std::move(repoPath), scanPool, strings));
+    if (!repo->loadUntilStopped(preferSummary, stop, error)) {
+        return nullptr;
+    }
+    return repo;
+}
+
+std::unique_ptr<OSTreeRepo> OSTreeRepo::Open(const SysrootOptions& sysroot,
+                                             StringTable* strings,
+                                             const std::stop_token& stop,
+                                             GError** error) {
+    std::unique_ptr<OSTreeRepo> repo(new OSTreeRepo(Unloaded{}, sysroot, strings));
+    if (!repo->loadUntilStopped(false, stop, error)) {
+        return nullptr;
+    }
+    return repo;
+}
+
+void OSTreeRepo::loadInitially(bool preferSummary) {
+    GError* error{nullptr};
+    bool waiting{false};
+    while (!UpdateData(preferSummary, waiting ? LOCK_TIMEOUT : std::chrono::milliseconds{0},
+                       nullptr, &error)) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+            g_printerr("Error loading repository %s: %s\n", repoPath.c_str(), error->message);
+            g_error_free(error);
+            return;
+        }
+        g_clear_error(&error);
+        // locks are released with the process holding them, so this ends
+        if (!waiting) {
+            g_printerr("Waiting for the lock of repository %s...\n", repoPath.c_str());
+            waiting = true;
+        }
+    }
+}
+
+bool OSTreeRepo::loadUntilStopped(bool preferSummary,
+                                  const std::stop_token& stop,
+                                  GError** error) {
+    g_autoptr(GCancellable) cancellable = g_cancellable_new();
+    const std::stop_callback cancel(stop, [&cancellable] { g_cancellable_cancel(cancellable); });
+    GError* lockError{nullptr};
+    while (!UpdateData(preferSummary, LOCK_TIMEOUT, cancellable, &lockError)) {
+        if (!g_error_matches(lockError, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+            g_propagate_error(error, lockError);
+            return false;
+        }
+        g_clear_error(&lockError);
+    }
+    return true;
 }
 
-bool OSTreeRepo::UpdateData() {
-    // parse branches
-    std::string branchString = getBranchesAsString();
-    std::stringstream bss(branchString);
-    std::string word;
-    while (bss >> word) {
-        branches.push_back(word);
+bool OSTreeRepo::UpdateData(bool preferSummary,
+                            std::chrono::milliseconds lockTimeout,
+                            GCancellable* cancellable,
+                            GError** error) {
+    Profiler::MarkLoad();
+    OSTREE_TUI_PROFILE_SCOPE("UpdateData");
+
+    // keep the current data on failures, the caller retries
+    g_autoptr(OstreeRepo) repo =
+        ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), cancellable, error);
+    if (repo == nullptr) {
+        return false;
+    }
+    // refs & commits are read under one shared lock, so no ref moves & no commit is pruned
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::SHARED, lockTimeout, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    // list refs, from the summary if possible, or the origins of the deployments
+    std::optional<RefList> summaryRefs;
+    if (preferSummary && !IsSysroot()) {
+        summaryRefs = ReadSummaryRefs(repoPath);
+    }
+    if (IsSysroot()) {
+        refs = loadDeployments(repo);
+    } else if (summaryRefs) {
+        if (!MergeRemoteRefs(repo, repoPath, *summaryRefs, error)) {
+            return false;
+        }
+        refs = std::move(*summaryRefs);
+    } else {
+        RefList listed;
+        if (!ListRefs(repo, listed, error)) {
+            return false;
+        }
+        refs = std::move(listed);
+    }
+    refsFromSummary = summaryRefs.has_value();
+
+    // branches (refs are sorted already)
+    branches.clear();
+    branches.reserve(refs.size());
+    for (const auto& [ref, checksum] : refs) {
+        branches.push_back(ref);
     }
 
     // parse commits
-    commitList = parseCommitsAllBranches();
+    branchHeads.clear();
+    if (IsSysroot()) {
+        commitList = parseDeployedCommits(repo, refs);
+    } else {
+        commitList = scanPool != nullptr ? scanCommitObjects(refs, *scanPool, cancellable)
+                                         : parseCommitsAllBranches(refs, cancellable);
+    }
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        return false;
+    }
+    buildIndices();
+    RefreshStaticDeltas();
 
     return true;
 }
@@ -51,6 +264,32 @@ OstreeRepo* OSTreeRepo::_c() {
     return repo;
 }
 
+const RefList& OSTreeRepo::GetRefs() const {
+    return refs;
+}
+
+bool OSTreeRepo::IsLoadedFromSummary() const {
+    return refsFromSummary;
+}
+
+bool OSTreeRepo::IsSysroot() const {
+    return !sysrootPath.empty();
+}
+
+const std::vector<Deployment>& OSTreeRepo::GetDeployments() const {
+    return deployments;
+}
+
+const Deployment* OSTreeRepo::GetDeployment(const std::string& hash) const {
+    const Deployment* found{nullptr};
+    for (const auto& deployment : deployments) {
+        if (deployment.checksum == hash && (found == nullptr || deployment.role < found->role)) {
+            found = &deployment;
+        }
+    }
+    return found;
+}
+
 const std::string& OSTreeRepo::GetRepoPath() const {
     return repoPath;
 }
@@ -63,151 +302,214 @@ const std::vector<std::string>& OSTreeRepo::GetBranches() const {
     return branches;
 }
 
-bool OSTreeRepo::IsCommitSigned(const Commit& commit) {
-    return commit.signatures.size() > 0;
+std::optional<size_t> OSTreeRepo::GetBranchId(std::string_view branch) const {
+    const auto it = std::lower_bound(branches.begin(), branches.end(), branch);
+    if (it == branches.end() || *it != branch) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - branches.begin());
 }
 
-Commit OSTreeRepo::parseCommit(GVariant* variant,
-                               const std::string& branch,
-                               const std::string& hash) {
-    Commit commit;
+std::span<const Commit* const> OSTreeRepo::GetBranchCommits(const std::string& branch,
+                                                             const TimeRange& range) const {
+    const auto branchId = GetBranchId(branch);
+    if (!branchId) {
+        return {};
+    }
+    return GetBranchCommits(*branchId, range);
+}
+
+std::span<const Commit* const> OSTreeRepo::GetBranchCommits(size_t branchId,
+                                                             const TimeRange& range) const {
+    if (branchId >= branchTimelines.size()) {
+        return {};
+    }
+    const BranchTimeline& commits = branchTimelines[branchId];
+
+    // newest first: skip commits newer than until, stop at the first commit older than since
+    auto first = commits.begin();
+    if (range.until) {
+        first = std::partition_point(commits.begin(), commits.end(), [&](const Commit* commit) {
+            return commit->timestamp > *range.until;
+        });
+    }
+    auto last = commits.end();
+    if (range.since) {
+        last = std::partition_point(first, commits.end(), [&](const Commit* commit) {
+            return commit->timestamp >= *range.since;
+        });
+    }
+    return {first, last};
+}
+
+std::vector<const Commit*> OSTreeRepo::GetBranchHistory(const std::string& branch) const {
+    std::vector<const Commit*> history;
+    const auto head = branchHeads.find(branch);
+    if (head == branchHeads.end()) {
+        return history;
+    }
+    auto commit = commitList.find(head->second);
+    while (commit != commitList.end()) {
+        history.push_back(&commit->second);
+        commit = commitList.find(commit->second.parent);
+    }
+    return history;
+}
+
+std::span<const std::string> OSTreeRepo::GetStaticDeltasTo(const std::string& hash) const {
+    const auto deltas = staticDeltas.find(hash);
+    if (deltas == staticDeltas.end()) {
+        return {};
+    }
+    return deltas->second;
+}
+
+void OSTreeRepo::RefreshStaticDeltas() {
+    OSTREE_TUI_PROFILE_SCOPE("RefreshStaticDeltas");
+    staticDeltas.clear();
+
+    GError* error{nullptr};
+    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr) {
+        g_printerr("Error opening repository: %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    // names are `from-to`, or `to` for deltas from scratch
+    GPtrArray* deltaNames{nullptr};
+    if (!ostree_repo_list_static_delta_names(repo, &deltaNames, nullptr, &error)) {
+        g_printerr("Error listing static deltas: %s\n", error->message);
+        g_error_free(error);
+        g_object_unref(repo);
+        return;
+    }
+    for (guint i{0}; i < deltaNames->len; i++) {
+        const std::string name = static_cast<const char*>(g_ptr_array_index(deltaNames, i));
+        const size_t separator = name.find('-');
+        if (separator == std::string::npos) {
+            staticDeltas[name].emplace_back();
+        } else {
+            staticDeltas[name.substr(separator + 1)].push_back(name.substr(0, separator));
+        }
+    }
+
+    g_ptr_array_unref(deltaNames);
+    g_object_unref(repo);
+}
+
+const Commit* OSTreeRepo::GetBranchHead(const std::string& branch) const {
+    const auto head = branchHeads.find(branch);
+    if (head == branchHeads.end()) {
+        return nullptr;
+    }
+    const auto commit = commitList.find(head->second);
+    return commit == commitList.end() ? nullptr : &commit->second;
+}
 
+std::span<const Commit* const> OSTreeRepo::GetCommitsWithContent(
+    const std::string& contentChecksum) const {
+    const auto lineage = contentIndex.find(contentChecksum);
+    if (lineage == contentIndex.end()) {
+        return {};
+    }
+    return lineage->second;
+}
+
+const Commit* OSTreeRepo::FindContentOnBranch(const std::string& contentChecksum,
+                                              const std::string& branch) const {
+    const auto lineage = GetCommitsWithContent(contentChecksum);
+    const auto it = std::find_if(lineage.rbegin(), lineage.rend(),
+                                 [&](const Commit* commit) { return commit->branch == branch; });
+    return it == lineage.rend() ? nullptr : *it;
+}
+
+void OSTreeRepo::buildIndices() {
+    OSTREE_TUI_PROFILE_SCOPE("buildIndices");
+    branchTimelines.assign(branches.size(), {});
+    contentIndex.clear();
+    for (const auto& [hash, commit] : commitList) {
+        if (const auto branchId = GetBranchId(commit.branch)) {
+            branchTimelines[*branchId].push_back(&commit);
+        }
+        if (!commit.contentChecksum.empty()) {
+            contentIndex[commit.contentChecksum].push_back(&commit);
+        }
+    }
+    for (auto& timeline : branchTimelines) {
+        std::sort(timeline.begin(), timeline.end(), [](const Commit* a, const Commit* b) {
+            return a->timestamp != b->timestamp ? a->timestamp > b->timestamp : a->hash < b->hash;
+        });
+    }
+    // almost all lineages consist of a single commit, only promoted content needs sorting
+    for (auto& [checksum, lineage] : contentIndex) {
+        if (lineage.size() > 1) {
+            std::sort(lineage.begin(), lineage.end(), [](const Commit* a, const Commit* b) {
+                return a->timestamp != b->timestamp ? a->timestamp < b->timestamp
+                                                    : a->hash < b->hash;
+            });
+        }
+    }
+}
+
+// Commit
+
+std::string_view Commit::Subject() const {
+    if (!object) {
+        return "OSTree TUI Error - invalid commit state";
+    }
     const gchar* subject{nullptr};
+    g_variant_get_child(object.get(), 3, "&s", &subject);
+    return subject[0] != '\0' ? subject : "(no subject)";
+}
+
+std::string_view Commit::Body() const {
+    if (!object) {
+        return {};
+    }
     const gchar* body{nullptr};
+    g_variant_get_child(object.get(), 4, "&s", &body);
+    return body;
+}
+
+std::string_view Commit::Version() const {
+    if (!object) {
+        return {};
+    }
     const gchar* version{nullptr};
-    guint64 timestamp{0};
-    g_autofree char* parent{nullptr};
+    g_autoptr(GVariant) metadata = g_variant_get_child_value(object.get(), 0);
+    if (!g_variant_lookup(metadata, OSTREE_COMMIT_META_KEY_VERSION, "&s", &version)) {
+        return {};
+    }
+    return version;
+}
 
-    // see OSTREE_COMMIT_GVARIANT_FORMAT
-    g_variant_get(variant, "(a{sv}aya(say)&s&stayay)", nullptr, nullptr, nullptr, &subject, &body,
-                  &timestamp, nullptr, nullptr);
-    assert(body);
-    assert(timestamp);
+Commit OSTreeRepo::parseCommit(GVariant* variant,
+                               std::string_view branch,
+                               const std::string& hash) {
+    OSTREE_TUI_PROFILE_SCOPE("parseCommit");
+    OSTREE_TUI_PROFILE_COUNT("commits", 1);
+    Commit commit;
 
-    // timestamp
-    timestamp = GUINT64_FROM_BE(timestamp);
-    commit.timestamp = Timepoint(std::chrono::seconds(timestamp));
+    // timestamp, see OSTREE_COMMIT_GVARIANT_FORMAT
+    commit.timestamp = Timepoint(std::chrono::seconds(ostree_commit_get_timestamp(variant)));
 
     // parent
-    parent = ostree_commit_get_parent(variant);
+    g_autofree char* parent = ostree_commit_get_parent(variant);
     if (parent) {
         commit.parent = parent;
     } else {
         commit.parent = "(no parent)";
     }
 
-    // content checksum
+    // content checksum (needed for the content index)
     g_autofree char* contents = ostree_commit_get_content_checksum(variant);
     assert(contents);
     commit.contentChecksum = contents;
 
-    // version
-    g_autoptr(GVariant) metadata = NULL;
-    const char* ret = NULL;
-    metadata = g_variant_get_child_value(variant, 0);
-    if (g_variant_lookup(metadata, OSTREE_COMMIT_META_KEY_VERSION, "&s", &ret)) {
-        version = g_strdup(ret);
-        commit.version = version;
-    }
-
-    // subject
-    if (subject[0]) {
-        std::string val = subject;
-        commit.subject = val;
-    } else {
-        commit.subject = "(no subject)";
-    }
-
-    // body
-    if (body[0]) {
-        commit.body = body;
-    }
-
     commit.branch = branch;
     commit.hash = hash;
-
-    // Signatures ___ refactor into own method
-    // open repo
-    GError* error = nullptr;
-    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
-    if (repo == nullptr) {
-        g_printerr("Error opening repository: %s\n", error->message);
-        g_error_free(error);
-        assert(repo);
-    }
-    // see ostree print_object for reference
-    g_autoptr(OstreeGpgVerifyResult) result = nullptr;
-    g_autoptr(GError) local_error = nullptr;
-    result = ostree_repo_verify_commit_ext(repo, commit.hash.c_str(), nullptr, nullptr, nullptr,
-                                           &local_error);
-    if (g_error_matches(local_error, OSTREE_GPG_ERROR, OSTREE_GPG_ERROR_NO_SIGNATURE) ||
-        local_error != nullptr) {
-        /* Ignore */
-    } else {
-        assert(result);
-        guint n_sigs = ostree_gpg_verify_result_count_all(result);
-        // parse all found signatures
-        for (guint ii = 0; ii < n_sigs; ii++) {
-            g_autoptr(GVariant) variant = nullptr;
-            variant = ostree_gpg_verify_result_get_all(result, ii);
-            // see ostree_gpg_verify_result_describe_variant for reference
-            gint64 timestamp{0};
-            gint64 exp_timestamp{0};
-            gint64 key_exp_timestamp{0};
-            gint64 key_exp_timestamp_primary{0};
-            const char* fingerprint{nullptr};
-            const char* fingerprintPrimary{nullptr};
-            const char* pubkey_algo{nullptr};
-            const char* user_name{nullptr};
-            const char* user_email{nullptr};
-            gboolean valid{false};
-            gboolean sigExpired{false};
-            gboolean keyExpired{false};
-            gboolean keyRevoked{false};
-            gboolean keyMissing{false};
-
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_VALID, "b", &valid);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_SIG_EXPIRED, "b", &sigExpired);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXPIRED, "b", &keyExpired);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_REVOKED, "b", &keyRevoked);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_MISSING, "b", &keyMissing);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT, "&s", &fingerprint);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT_PRIMARY, "&s",
-                                &fingerprintPrimary);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_TIMESTAMP, "x", &timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_EXP_TIMESTAMP, "x",
-                                &exp_timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_PUBKEY_ALGO_NAME, "&s",
-                                &pubkey_algo);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_NAME, "&s", &user_name);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_EMAIL, "&s", &user_email);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP, "x",
-                                &key_exp_timestamp);
-            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP_PRIMARY, "x",
-                                &key_exp_timestamp_primary);
-
-            // create signature struct
-            Signature sig;
-
-            sig.valid = valid;
-            sig.sigExpired = sigExpired;
-            sig.keyExpired = keyExpired;
-            sig.keyRevoked = keyRevoked;
-            sig.keyMissing = keyMissing;
-            sig.fingerprint = fingerprint;
-            sig.fingerprintPrimary = fingerprintPrimary;
-            sig.timestamp = Timepoint(std::chrono::seconds(timestamp));
-            sig.expireTimestamp = Timepoint(std::chrono::seconds(exp_timestamp));
-            sig.pubkeyAlgorithm = pubkey_algo;
-            sig.username = user_name;
-            sig.usermail = user_email;
-            sig.keyExpireTimestamp = Timepoint(std::chrono::seconds(key_exp_timestamp));
-            sig.keyExpireTimestampPrimary =
-                Timepoint(std::chrono::seconds(key_exp_timestamp_primary));
-
-            commit.signatures.push_back(std::move(sig));
-        }
-    }
+    commit.object = std::shared_ptr<GVariant>(g_variant_ref(variant), VariantUnref{});
 
     return commit;
 }
@@ -218,14 +520,21 @@ gboolean OSTreeRepo::parseCommitsRecursive(OstreeRepo* repo,
                                            const gchar* checksum,
                                            GError** error,
                                            CommitList* commitList,
-                                           const std::string& branch,
+                                           std::string_view branch,
+                                           GCancellable* cancellable,
                                            gboolean isRecurse) {
     GError* local_error{nullptr};
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        return FALSE;
+    }
 
     g_autoptr(GVariant) variant = nullptr;
-    if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, &variant,
-                                  &local_error)) {
-        return isRecurse && g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+    {
+        OSTREE_TUI_PROFILE_SCOPE("loadCommitVariant");
+        if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, &variant,
+                                      &local_error)) {
+            return isRecurse && g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+        }
     }
 
     commitList->insert({static_cast<std::string>(checksum),
@@ -234,144 +543,264 @@ gboolean OSTreeRepo::parseCommitsRecursive(OstreeRepo* repo,
     // parent recursion
     g_autofree char* parent = ostree_commit_get_parent(variant);
 
-    return !(parent && !parseCommitsRecursive(repo, parent, error, commitList, branch, true));
+    return !(parent &&
+             !parseCommitsRecursive(repo, parent, error, commitList, branch, cancellable, true));
 }
 
-CommitList OSTreeRepo::parseCommitsOfBranch(const std::string& branch) {
+CommitList OSTreeRepo::parseCommitsOfBranch(OstreeRepo* repo,
+                                            const std::string& branch,
+                                            const std::string& head,
+                                            GCancellable* cancellable) {
+    OSTREE_TUI_PROFILE_SCOPE("parseCommitsOfBranch");
     auto ret = CommitList();
 
-    // open repo
-    GError* error = nullptr;
+    // recursive commit log
+    GError* error{nullptr};
+    branchHeads[branch] = head;
+    parseCommitsRecursive(repo, head.c_str(), &error, &ret, strings->Intern(branch), cancellable);
+    g_clear_error(&error);
+
+    return ret;
+}
+
+CommitList OSTreeRepo::parseCommitsAllBranches(const RefList& refs, GCancellable* cancellable) {
+    OSTREE_TUI_PROFILE_SCOPE("parseCommitsAllBranches");
+    CommitList commits_all_branches;
+
+    // open repo, once for all branches
+    GError* error{nullptr};
     OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
     if (repo == nullptr) {
         g_printerr("Error opening repository: %s\n", error->message);
         g_error_free(error);
-        return ret;
+        return commits_all_branches;
     }
 
-    // recursive commit log
-    g_autofree char* checksum = nullptr;
-    if (!ostree_repo_resolve_rev(repo, branch.c_str(), false, &checksum, &error)) {
-        return ret;
+    for (const auto& [branch, head] : refs) {
+        if (g_cancellable_is_cancelled(cancellable)) {
+            break;
+        }
+        auto commits = parseCommitsOfBranch(repo, branch, head, cancellable);
+        commits_all_branches.insert(commits.begin(), commits.end());
     }
 
-    parseCommitsRecursive(repo, checksum, &error, &ret, branch);
-
-    return ret;
+    g_object_unref(repo);
+    return commits_all_branches;
 }
 
-CommitList OSTreeRepo::parseCommitsAllBranches() {
-    std::istringstream branches_string(getBranchesAsString());
-    std::string branch;
+CommitList OSTreeRepo::scanCommitObjects(const RefList& refs,
+                                         ThreadPool& pool,
+                                         GCancellable* cancellable) {
+    OSTREE_TUI_PROFILE_SCOPE("scanCommitObjects");
+    constexpr size_t FAN_OUT{256};
+
+    // parse the commits of every fan-out directory concurrently, with one repo per worker
+    std::vector<std::vector<Commit>> scanned(FAN_OUT);
+    std::vector<OstreeRepo*> repos(pool.Size(), nullptr);
+    {
+        TaskGroup group(pool);
+        for (size_t dir{0}; dir < FAN_OUT; dir++) {
+            group.Run([this, dir, cancellable, &scanned, &repos] {
+                OSTREE_TUI_PROFILE_SCOPE("scanFanOutDirectory");
+                const auto worker = ThreadPool::CurrentWorker();
+                if (!worker || *worker >= repos.size() || g_cancellable_is_cancelled(cancellable)) {
+                    return;
+                }
+                GError* error{nullptr};
+                OstreeRepo*& repo = repos[*worker];
+                if (repo == nullptr) {
+                    repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+                    if (repo == nullptr) {
+                        g_printerr("Error opening repository: %s\n", error->message);
+                        g_error_free(error);
+                        return;
+                    }
+                }
+
+                // a two character prefix only lists `objects/<prefix>/*.commit`
+                const std::string prefix = std::format("{:02x}", dir);
+                GHashTable* objects{nullptr};
+                if (!ostree_repo_list_commit_objects_starting_with(repo, prefix.c_str(), &objects,
+                                                                   nullptr, &error)) {
+                    g_printerr("Error listing commits: %s\n", error->message);
+                    g_error_free(error);
+                    return;
+                }
+                GHashTableIter iter;
+                gpointer key{nullptr};
+                g_hash_table_iter_init(&iter, objects);
+                while (g_hash_table_iter_next(&iter, &key, nullptr) &&
+                       !g_cancellable_is_cancelled(cancellable)) {
+                    const char* checksum{nullptr};
+                    OstreeObjectType type{OSTREE_OBJECT_TYPE_COMMIT};
+                    ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &type);
+                    g_autoptr(GVariant) variant = nullptr;
+                    if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum,
+                                                  &variant, &error)) {
+                        g_clear_error(&error);
+                        continue;
+                    }
+                    scanned[dir].push_back(parseCommit(variant, "", checksum));
+                }
+                g_hash_table_unref(objects);
+            });
+        }
+        group.Wait();
+    }
+    for (auto* repo : repos) {
+        if (repo != nullptr) {
+            g_object_unref(repo);
+        }
+    }
 
-    CommitList commits_all_branches;
+    CommitList commits;
+    for (auto& commitsOfDir : scanned) {
+        for (auto& commit : commitsOfDir) {
+            std::string hash = commit.hash;
+            commits.emplace(std::move(hash), std::move(commit));
+        }
+    }
 
-    while (branches_string >> branch) {
-        auto commits = parseCommitsOfBranch(branch);
-        commits_all_branches.insert(commits.begin(), commits.end());
+    // parent graph: assign commits to the first ref reaching them, like parseCommitsAllBranches()
+    for (const auto& [branch, head] : refs) {
+        branchHeads[branch] = head;
+        auto commit = commits.find(head);
+        const std::string_view interned = strings->Intern(branch);
+        while (commit != commits.end() && commit->second.branch.empty()) {
+            commit->second.branch = interned;
+            commit = commits.find(commit->second.parent);
+        }
+    }
+    size_t unreachable{0};
+    for (auto& [hash, commit] : commits) {
+        if (commit.branch.empty()) {
+            commit.branch = UNREACHABLE_BRANCH;
+            unreachable++;
+        }
+    }
+    if (unreachable > 0) {
+        branches.insert(std::lower_bound(branches.begin(), branches.end(), UNREACHABLE_BRANCH),
+                        UNREACHABLE_BRANCH);
     }
+    OSTREE_TUI_PROFILE_COUNT("unreachableCommits", static_cast<int64_t>(unreachable));
 
-    return commits_all_branches;
+    return commits;
 }
 
-std::string OSTreeRepo::getBranchesAsString() {
-    std::string branches_str;
-
-    // open repo
+RefList OSTreeRepo::loadDeployments(OstreeRepo* repo) {
+    OSTREE_TUI_PROFILE_SCOPE("loadDeployments");
     GError* error{nullptr};
-    OstreeRepo* repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
-
-    if (repo == nullptr) {
-        g_printerr("Error opening repository: %s\n", error->message);
+    if (!ListDeployments(sysrootPath, deployments, nullptr, &error)) {
+        g_printerr("Error loading sysroot %s: %s\n", sysrootPath.c_str(), error->message);
         g_error_free(error);
-        return "";
+        return {};
     }
 
-    // get a list of refs
-    GHashTable* refs_hash{nullptr};
-    gboolean result = ostree_repo_list_refs_ext(repo, nullptr, &refs_hash,
-                                                OSTREE_REPO_LIST_REFS_EXT_NONE, nullptr, &error);
-    if (!result) {
-        g_printerr("Error listing refs: %s\n", error->message);
-        g_error_free(error);
-        g_object_unref(repo);
-        // TODO exit with error
-        return "";
+    // one ref per origin, deployments in boot order -> the first one is the newest
+    RefList origins;
+    for (const auto& deployment : deployments) {
+        const std::string& branch = deployment.Branch();
+        if (std::any_of(origins.begin(), origins.end(),
+                        [&branch](const auto& origin) { return origin.first == branch; })) {
+            continue;
+        }
+        std::string head = deployment.checksum;
+        g_autofree gchar* pulled{nullptr};
+        if (repo != nullptr && !deployment.refspec.empty() &&
+            ostree_repo_resolve_rev(repo, deployment.refspec.c_str(), TRUE, &pulled, nullptr) &&
+            pulled != nullptr) {
+            head = pulled;
+        }
+        origins.emplace_back(branch, std::move(head));
     }
+    std::sort(origins.begin(), origins.end());
+    return origins;
+}
 
-    // iterate through the refs
-    GHashTableIter iter;
-    gpointer key{nullptr};
-    gpointer value{nullptr};
-    g_hash_table_iter_init(&iter, refs_hash);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        const gchar* ref_name = static_cast<const gchar*>(key);
-        branches_str += " " + std::string(ref_name);
+CommitList OSTreeRepo::parseDeployedCommits(OstreeRepo* repo, const RefList& refs) {
+    OSTREE_TUI_PROFILE_SCOPE("parseDeployedCommits");
+    CommitList commits;
+    if (repo == nullptr) {
+        return commits;
     }
 
-    // free
-    g_hash_table_unref(refs_hash);
+    const auto loadWindow = [this, repo, &commits](std::string checksum, std::string_view branch) {
+        for (size_t depth{0}; depth <= sysrootDepth && !commits.contains(checksum); depth++) {
+            g_autoptr(GVariant) variant = nullptr;
+            if (!ostree_repo_load_variant_if_exists(repo, OSTREE_OBJECT_TYPE_COMMIT,
+                                                    checksum.c_str(), &variant, nullptr) ||
+                variant == nullptr) {
+                return;
+            }
+            commits.emplace(checksum, parseCommit(variant, branch, checksum));
+            g_autofree char* parent = ostree_commit_get_parent(variant);
+            if (parent == nullptr) {
+                return;
+            }
+            checksum = parent;
+        }
+    };
 
-    return branches_str;
+    for (const auto& [branch, head] : refs) {
+        branchHeads[branch] = head;
+        loadWindow(head, strings->Intern(branch));
+    }
+    // deployments older than the window of their refspec
+    for (const auto& deployment : deployments) {
+        loadWindow(deployment.checksum, strings->Intern(deployment.Branch()));
+    }
+    return commits;
 }
 
-/// TODO This implementation should not rely on the ostree CLI -> change to libostree usage.
 bool OSTreeRepo::PromoteCommit(const std::string& hash,
                                const std::string& newRef,
                                const std::vector<std::string> addMetadataStrings,
                                const std::string& newSubject,
                                bool keepMetadata) {
-    if (hash.size() <= 0 || newRef.size() <= 0) {
+    if (hash.size() <= 0 || newRef.size() <= 0 || newRef == UNREACHABLE_BRANCH) {
         return false;
     }
 
-    std::string command = "ostree commit";
-    command += " --repo=" + repoPath;
-    command += " -b " + newRef;
-    command += (newSubject.size() <= 0 ? "" : " -s \"" + newSubject + "\"");
-    command += (keepMetadata ? "" : " --keep-metadata");
-    for (auto str : addMetadataStrings) {
-        command += " --add-metadata-string=\"" + str + "\"";
+    OstreeRepo* repo = _c();
+    if (repo == nullptr) {
+        return false;
     }
-    command += " --tree=ref=" + hash;
-
-    return runCLICommand(command);
+    GError* error{nullptr};
+    std::string newCommit;
+    const bool success =
+        cpplibostree::PromoteCommit(repo, hash, newRef, addMetadataStrings, newSubject,
+                                    keepMetadata, newCommit, nullptr, &error);
+    if (!success) {
+        g_printerr("Error promoting commit: %s\n", error->message);
+        g_error_free(error);
+    }
+    g_object_unref(repo);
+    return success;
 }
 
-/// TODO This implementation should not rely on the ostree CLI -> change to libostree usage.
 bool OSTreeRepo::RemoveCommitFromBranchAndPrune(const Commit& commit) {
-    // reset head if it is last commit on the branch
-    if (IsMostRecentCommitOnBranch(commit)) {
-        std::string command = "ostree reset";
-        command += " --repo=" + repoPath;
-        command += " " + commit.branch;
-        command += " " + commit.branch + "^";
-
-        if (!runCLICommand(command)) {
-            return false;
-        };
+    OstreeRepo* repo = _c();
+    if (repo == nullptr) {
+        return false;
     }
-
-    // prune commit
-    std::string command2 = "ostree prune";
-    command2 += " --repo=" + repoPath;
-    command2 += " --delete-commit=" + commit.hash;
-
-    return runCLICommand(command2);
+    // unreachable commits have no ref to reset
+    GError* error{nullptr};
+    const bool success = DropCommit(
+        repo, commit.hash,
+        commit.branch != UNREACHABLE_BRANCH ? std::string(commit.branch) : std::string(), nullptr,
+        &error);
+    if (!success) {
+        g_printerr("Error dropping commit: %s\n", error->message);
+        g_error_free(error);
+    }
+    g_object_unref(repo);
+    return success;
 }
 
 bool OSTreeRepo::ResetBranchHeadAndPrune(const std::string& branch) {
     return RemoveCommitFromBranchAndPrune(GetMostRecentCommitOfBranch(branch));
 }
 
-bool OSTreeRepo::runCLICommand(const std::string& command) {
-    std::unique_ptr<FILE, int (*)(FILE*)> pipe(popen(command.c_str(), "r"), &pclose);
-    if (!pipe) {
-        return false;
-    }
-    return true;
-}
-
 const Commit& OSTreeRepo::GetMostRecentCommitOfBranch(const std::string& branch) const {
     Timepoint latestTimestamp;
     std::string latestHash;
@@ -394,7 +823,7 @@ const Commit& OSTreeRepo::GetMostRecentCommitOfBranch(const std::string& branch)
 }
 
 bool OSTreeRepo::IsMostRecentCommitOnBranch(const Commit& commit) const {
-    return GetMostRecentCommitOfBranch(commit.branch).hash == commit.hash;
+    return GetMostRecentCommitOfBranch(std::string(commit.branch)).hash == commit.hash;
 }
 
 bool OSTreeRepo::IsMostRecentCommitOnBranch(const std::string& hash) const {
@@ -15,7 +15,12 @@
 // C++
 #include <sys/types.h>
 #include <chrono>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 // C
@@ -26,11 +31,22 @@
 #include <glib.h>
 #include <ostree.h>
 
+#include "deployments.hpp"
+#include "reflist.hpp"
+#include "repolock.hpp"
+#include "stringtable.hpp"
+#include "threadpool.hpp"
+
+struct BenchmarkAccess;
+
 namespace cpplibostree {
 
 using Clock = std::chrono::utc_clock;
 using Timepoint = std::chrono::time_point<Clock>;
 
+/// Synthetic branch of all commits, that are not reachable from any ref (object scan only).
+inline constexpr const char* UNREACHABLE_BRANCH = "(unreachable)";
+
 struct Signature {
     bool valid{false};
     bool sigExpired{true};
@@ -48,20 +64,63 @@ struct Signature {
     Timepoint keyExpireTimestampPrimary;
 } __attribute__((aligned(128)));
 
+/// Releases a GVariant held in a std::shared_ptr.
+struct VariantUnref {
+    void operator()(GVariant* variant) const { g_variant_unref(variant); }
+};
+
+/**
+ * @brief A commit. Only the fields needed for loading & layout are decoded eagerly, subject,
+ * body & metadata are read from the (refcounted) serialized commit object when displayed.
+ */
 struct Commit {
     std::string hash;
     std::string contentChecksum;
-    std::string subject{"OSTree TUI Error - invalid commit state"};
-    std::string body;
-    std::string version;
     Timepoint timestamp;
     std::string parent;
-    std::string branch;
-    std::vector<Signature> signatures;
+    std::string_view branch;  // interned in the StringTable of the repository
+    /// serialized commit object (OSTREE_COMMIT_GVARIANT_FORMAT), shared by all copies
+    std::shared_ptr<GVariant> object;
+
+    // lazily decoded, the views point into `object` & stay valid as long as it
+
+    /// @return Subject, "(no subject)" if it is empty.
+    [[nodiscard]] std::string_view Subject() const;
+    [[nodiscard]] std::string_view Body() const;
+    /// @return Version metadata, empty if it is not set.
+    [[nodiscard]] std::string_view Version() const;
 } __attribute__((aligned(128)));
 
 // map commit hash to commit
 using CommitList = std::unordered_map<std::string, Commit>;
+// commits of one branch, sorted by timestamp (newest first)
+using BranchTimeline = std::vector<const Commit*>;
+// commits sharing one content checksum (promotions), sorted by timestamp (oldest first)
+using ContentLineage = std::vector<const Commit*>;
+
+/// Time window to filter commits by, both bounds are inclusive & optional.
+struct TimeRange {
+    std::optional<Timepoint> since;
+    std::optional<Timepoint> until;
+
+    bool operator==(const TimeRange&) const = default;
+};
+
+/**
+ * @brief Parses a point in time (UTC) for the time range filter. Supported formats:
+ * `YYYY-MM-DD`, `YYYY-MM-DD HH:MM[:SS]` (or with `T` as separator), `now`, and times
+ * relative to now, like `30m`, `48h`, `7d` or `2w`.
+ *
+ * @param spec String to parse.
+ * @param endOfDay Date-only specs resolve to the end of the day, instead of its beginning
+ * (used for the upper bound).
+ * @return Timepoint, or std::nullopt if spec is not valid.
+ */
+[[nodiscard]] std::optional<Timepoint> ParseTimepoint(const std::string& spec,
+                                                      bool endOfDay = false);
+
+/// @brief Formats a timepoint, so that it can be parsed by ParseTimepoint() again.
+[[nodiscard]] std::string FormatTimepoint(const Timepoint& timepoint);
 
 /**
  * @brief OSTreeRepo functions as a C++ wrapper around libostree's OstreeRepo.
@@ -72,15 +131,70 @@ class OSTreeRepo {
    private:
     std::string repoPath;
     CommitList commitList;
-    std::vector<std::string> branches;
+    RefList refs;                                 // ref -> head commit, sorted
+    bool refsFromSummary{false};                  // refs were read from the summary
+    ThreadPool* scanPool{nullptr};                // scan all commit objects, instead of refs
+    std::unique_ptr<StringTable> ownStrings;      // if no table is shared with other repos
+    StringTable* strings{nullptr};                // branch names of the commits
+    std::string sysrootPath;                      // sysroot mode, empty otherwise
+    size_t sysrootDepth{0};                       // parents loaded per deployment
+    std::vector<Deployment> deployments;          // sysroot mode, in boot order
+    std::vector<std::string> branches;            // sorted, index = dense branch id
+    std::vector<BranchTimeline> branchTimelines;  // branch id -> timeline
+    std::unordered_map<std::string, ContentLineage> contentIndex;  // content checksum -> commits
+    std::unordered_map<std::string, std::string> branchHeads;      // branch -> head commit hash
+    // target commit -> source commits of its static deltas ("" = from scratch)
+    std::unordered_map<std::string, std::vector<std::string>> staticDeltas;
 
    public:
     /**
      * @brief Construct a new OSTreeRepo.
      *
      * @param repoPath Path to the OSTree Repository
+     * @param preferSummary Read the refs from the summary, if it is fresh (see UpdateData()).
+     * @param scanPool Load all commit objects of the repository in parallel on this pool,
+     * including commits, that are not reachable from any ref (see UNREACHABLE_BRANCH).
+     * nullptr loads the commits by following the parents of the refs.
+     * @param strings Table to intern the branch names of the commits in, shared by the
+     * repositories of all tabs, has to outlive the repository. nullptr uses an own table.
      */
-    explicit OSTreeRepo(std::string repoPath);
+    explicit OSTreeRepo(std::string repoPath,
+                        bool preferSummary = false,
+                        ThreadPool* scanPool = nullptr,
+                        StringTable* strings = nullptr);
+
+    /**
+     * @brief Construct a new OSTreeRepo of the system repository of a sysroot. Only the
+     * deployed commits & a bounded window of their history are loaded (not the complete history
+     * of all refs), shown on the branches of their origin refspecs.
+     *
+     * @param sysroot Sysroot & history depth to load.
+     * @param strings Table to intern the branch names of the commits in (see above).
+     */
+    explicit OSTreeRepo(const SysrootOptions& sysroot, StringTable* strings = nullptr);
+
+    /**
+     * @brief Loads a repository in the background. Unlike the constructor, this does not wait
+     * for the repository lock forever: waiting & loading end, when stop is requested, & failures
+     * (e.g. a wrong path) are reported instead of printed.
+     *
+     * @param repoPath, preferSummary, scanPool, strings see OSTreeRepo()
+     * @param stop Cancels waiting for the repository lock & loading the commits.
+     * @param error Set on failure, G_IO_ERROR_CANCELLED when stopped.
+     * @return Loaded repository, nullptr on failure.
+     */
+    [[nodiscard]] static std::unique_ptr<OSTreeRepo> Open(std::string repoPath,
+                                                          bool preferSummary,
+                                                          ThreadPool* scanPool,
+                                                          StringTable* strings,
+                                                          const std::stop_token& stop,
+                                                          GError** error);
+
+    /// @brief Loads the system repository of a sysroot in the background, see above.
+    [[nodiscard]] static std::unique_ptr<OSTreeRepo> Open(const SysrootOptions& sysroot,
+                                                          StringTable* strings,
+                                                          const std::stop_token& stop,
+                                                          GError** error);
 
     /**
      * @brief Return a C-style pointer to a libostree OstreeRepo. This exists, to be
@@ -94,33 +208,118 @@ class OSTreeRepo {
     [[nodiscard]] const std::string& GetRepoPath() const;
     /// Getter
     [[nodiscard]] const CommitList& GetCommitList() const;
-    /// Getter
+    /// Getter, branches are sorted by name & their index serves as dense branch id.
     [[nodiscard]] const std::vector<std::string>& GetBranches() const;
 
-    // Methods
+    /**
+     * @brief Looks up the dense id of a branch (binary search on the sorted branches).
+     *
+     * @param branch Branch name.
+     * @return Index of the branch in GetBranches(), std::nullopt if it does not exist.
+     */
+    [[nodiscard]] std::optional<size_t> GetBranchId(std::string_view branch) const;
+
+    /**
+     * @brief Get the commits of a branch inside a time range. The range is looked up by binary
+     * search on the branch timeline, so this does not scan the commit list.
+     *
+     * @param branch Branch to get the commits of.
+     * @param range Time range filter, unset bounds are unlimited.
+     * @return Commits, sorted by timestamp (newest first). Valid until the next UpdateData().
+     */
+    [[nodiscard]] std::span<const Commit* const> GetBranchCommits(
+        const std::string& branch,
+        const TimeRange& range = {}) const;
+
+    /// @brief Same as GetBranchCommits(branch, range), with the dense id of the branch.
+    [[nodiscard]] std::span<const Commit* const> GetBranchCommits(
+        size_t branchId,
+        const TimeRange& range = {}) const;
+
+    /**
+     * @brief Get the complete history of a branch, by following the parent links from its head.
+     * In contrast to GetBranchCommits(), this includes commits shared with other branches
+     * (every commit is only assigned to one branch in the commit list).
+     *
+     * @param branch Branch to get the history of.
+     * @return Commits, from the head to the first commit.
+     */
+    [[nodiscard]] std::vector<const Commit*> GetBranchHistory(const std::string& branch) const;
+
+    /// @return Head commit of a branch, nullptr if the branch does not exist.
+    [[nodiscard]] const Commit* GetBranchHead(const std::string& branch) const;
+
+    /**
+     * @brief Get all commits with the same content (e.g. a commit & its promotions), by
+     * looking up the content checksum index.
+     *
+     * @param contentChecksum Content checksum of the commits.
+     * @return Commits, sorted by timestamp (oldest first, the origin of the content).
+     */
+    [[nodiscard]] std::span<const Commit* const> GetCommitsWithContent(
+        const std::string& contentChecksum) const;
 
     /**
-     * @brief Reload the OSTree repository data.
+     * @brief Checks if content was already promoted to a branch, without traversing any
+     * branch history.
      *
-     * @return true if data was changed during the reload
-     * @return false if nothing changed
+     * @param contentChecksum Content checksum to look for.
+     * @param branch Branch to look on.
+     * @return Newest commit on the branch with this content, nullptr if there is none.
      */
-    bool UpdateData();
+    [[nodiscard]] const Commit* FindContentOnBranch(const std::string& contentChecksum,
+                                                    const std::string& branch) const;
 
     /**
-     * @brief Check if a certain commit is signed. This simply accesses the
-     * size() of commit.signatures.
+     * @brief Get the static deltas leading to a commit, from the index of `deltas/`.
      *
-     * @param commit
-     * @return true if the commit is signed
-     * @return false if the commit is not signed
+     * @param hash Target commit of the deltas.
+     * @return Source commits of the deltas, an empty string for a delta from scratch.
      */
-    [[nodiscard]] static bool IsCommitSigned(const Commit& commit);
+    [[nodiscard]] std::span<const std::string> GetStaticDeltasTo(const std::string& hash) const;
+
+    /// @brief Re-reads the static delta index (e.g. after a delta was generated).
+    void RefreshStaticDeltas();
+
+    // Methods
+
+    /**
+     * @brief Reload the OSTree repository data, under a shared repository lock (no ref moves &
+     * no commit is pruned while loading).
+     *
+     * @param preferSummary Read the refs from the memory-mapped summary instead of scanning
+     * the refs directories, if the summary is not older than `refs/heads`. The summary only
+     * lists local refs (remote refs are listed from their directories) & the staleness check
+     * is shallow, verify the local refs with ListRefs() afterwards.
+     * @param lockTimeout Maximum wait for the lock.
+     * @param cancellable Cancels waiting for the lock & loading the commits.
+     * @param error Set on failure, G_IO_ERROR_TIMED_OUT if the repository stayed locked.
+     * @return true if the data was reloaded
+     * @return false if the repository stayed locked or could not be read, the data is unchanged
+     * (if cancelled while loading the commits it is incomplete, the repository has to be
+     * dropped, as Open() does)
+     */
+    bool UpdateData(bool preferSummary = false,
+                    std::chrono::milliseconds lockTimeout = LOCK_TIMEOUT,
+                    GCancellable* cancellable = nullptr,
+                    GError** error = nullptr);
+
+    /// Getter, all refs with their head commit, sorted by ref.
+    [[nodiscard]] const RefList& GetRefs() const;
+    /// @return true, if the refs of the last UpdateData() were read from the summary.
+    [[nodiscard]] bool IsLoadedFromSummary() const;
+
+    /// @return true, if the repository is the system repository of a sysroot.
+    [[nodiscard]] bool IsSysroot() const;
+    /// Getter, deployments of the sysroot in boot order, empty if not in sysroot mode.
+    [[nodiscard]] const std::vector<Deployment>& GetDeployments() const;
+    /// @return Most relevant deployment of a commit (booted first), nullptr if it is not deployed.
+    [[nodiscard]] const Deployment* GetDeployment(const std::string& hash) const;
 
     // read & write access to OSTree repo:
 
     /**
-     * @brief Promotes a commit to another branch. Similar to:
+     * @brief Promotes a commit to another branch (see cpplibostree::PromoteCommit). Similar to:
      * `ostree commit --repo=repo -b newRef -s newSubject --tree=ref=hash`
      *
      * @param hash hash of the commit to promote
@@ -185,49 +384,109 @@ class OSTreeRepo {
     [[nodiscard]] bool IsMostRecentCommitOnBranch(const std::string& hash) const;
 
    private:
+    /// grants the benchmark suite (bench/bench.cpp) access to the loading stages
+    friend struct ::BenchmarkAccess;
+
+    /// Tag of the constructors, that leave loading to the caller.
+    struct Unloaded {};
+
+    OSTreeRepo(Unloaded tag, std::string repoPath, ThreadPool* scanPool, StringTable* strings);
+    OSTreeRepo(Unloaded tag, const SysrootOptions& sysroot, StringTable* strings);
+
+    /**
+     * @brief Loads the repository data for the first time, waiting for the repository lock as
+     * long as it takes. Failures are printed, the repository stays empty.
+     *
+     * @param preferSummary see UpdateData()
+     */
+    void loadInitially(bool preferSummary);
+
+    /**
+     * @brief Loads the repository data, waiting for the repository lock until stop is
+     * requested.
+     *
+     * @param preferSummary see UpdateData()
+     * @param stop Cancels waiting for the lock & loading the commits.
+     * @param error Set on failure.
+     * @return true on success
+     */
+    bool loadUntilStopped(bool preferSummary, const std::stop_token& stop, GError** error);
+
     /**
      * @brief Parse commits from a ostree log output to a commitList, mapping
      * the hashes to commits.
      *
-     * @param branch
+     * @param repo Opened repository.
+     * @param branch Branch, the commits are assigned to.
+     * @param head Head commit of the branch.
+     * @param cancellable Stops parsing, the commits are incomplete then.
      * @return std::unordered_map<std::string,Commit>
      */
-    CommitList parseCommitsOfBranch(const std::string& branch);
+    CommitList parseCommitsOfBranch(OstreeRepo* repo,
+                                    const std::string& branch,
+                                    const std::string& head,
+                                    GCancellable* cancellable = nullptr);
 
     /**
-     * @brief Performs parseCommitsOfBranch() on all available branches and
-     * merges all commit lists into one.
+     * @brief Performs parseCommitsOfBranch() on all refs and merges all commit lists into one.
      *
+     * @param refs Refs with their head commits.
+     * @param cancellable Stops parsing, the commits are incomplete then.
      * @return std::unordered_map<std::string,Commit>
      */
-    CommitList parseCommitsAllBranches();
+    CommitList parseCommitsAllBranches(const RefList& refs, GCancellable* cancellable = nullptr);
 
     /**
-     * @brief Execute a command on the CLI.
+     * @brief Loads all commit objects of the repository, one pool task per fan-out directory
+     * of `objects/`. The parent graph is only built afterwards: every commit is assigned to the
+     * first ref it is reachable from, all others to UNREACHABLE_BRANCH (which gets added to
+     * the branches, if there are any).
      *
-     * @warning If possible, use proper `libostree` access, not per command line access.
+     * @param refs Refs with their head commits.
+     * @param pool Pool to load the commits on.
+     * @param cancellable Stops loading, the commits are incomplete then.
+     * @return std::unordered_map<std::string,Commit>
+     */
+    CommitList scanCommitObjects(const RefList& refs,
+                                 ThreadPool& pool,
+                                 GCancellable* cancellable = nullptr);
+
+    /**
+     * @brief Lists the deployments of the sysroot & the origin refspecs as refs, each pointing
+     * to its pulled head, or its newest deployment if the refspec is not in the repository.
      *
-     * @param command Command to execute.
-     * @return true on success
+     * @param repo Opened system repository.
+     * @return Origin refspecs with their head commits, sorted.
      */
-    [[deprecated]] bool runCLICommand(const std::string& command);
+    RefList loadDeployments(OstreeRepo* repo);
 
     /**
-     * @brief Get all branches as a single string, separated by spaces.
+     * @brief Loads the heads of the refs & the deployed commits, each with up to sysrootDepth
+     * parents. A walk ends early at a commit, that is loaded already, or at a missing parent
+     * (deployed systems usually pull without history).
      *
-     * @return std::string All branch names, separated by spaces
+     * @param repo Opened system repository.
+     * @param refs Origin refspecs with their head commits.
+     * @return std::unordered_map<std::string,Commit>
+     */
+    CommitList parseDeployedCommits(OstreeRepo* repo, const RefList& refs);
+
+    /**
+     * @brief Builds the branch timelines & the content checksum index, both in one pass over
+     * the commit list.
      */
-    [[nodiscard]] std::string getBranchesAsString();
+    void buildIndices();
 
     /**
-     * @brief Parse a libostree GVariant commit to a C++ commit struct.
+     * @brief Parse a libostree GVariant commit to a C++ commit struct. Only timestamp, parent &
+     * content checksum are decoded, the commit keeps a reference to the variant.
      *
      * @param variant pointer to GVariant commit
-     * @param branch branch of the commit
+     * @param branch branch of the commit (interned)
      * @param hash commit hash
      * @return Commit struct
      */
-    Commit parseCommit(GVariant* variant, const std::string& branch, const std::string& hash);
+    static Commit parseCommit(GVariant* variant, std::string_view branch, const std::string& hash);
 
     /**
      * @brief Parse all commits in a OstreeRepo into a commit vector.
@@ -236,7 +495,8 @@ class OSTreeRepo {
      * @param checksum checksum of first commit
      * @param error gets set, if an error occurred during parsing
      * @param commitList commit list to parse the commits into
-     * @param branch branch to read the commit from
+     * @param branch branch to read the commit from (interned)
+     * @param cancellable stops parsing (sets error)
      * @param isRecurse !Do not use!, or set to false. Used only for recursion.
      * @return true if parsing was successful
      * @return false if an error occurred during parsing
@@ -245,7 +505,8 @@ class OSTreeRepo {
                                    const gchar* checksum,
                                    GError** error,
                                    CommitList* commitList,
-                                   const std::string& branch,
+                                   std::string_view branch,
+                                   GCancellable* cancellable,
                                    gboolean isRecurse = false);
 };
 
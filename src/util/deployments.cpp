@@ -0,0 +1,106 @@
+#include "deployments.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+const std::string& Deployment::Branch() const {
+    return refspec.empty() ? osname : refspec;
+}
+
+std::string Deployment::Name() const {
+    return osname + "." + std::to_string(serial);
+}
+
+std::string_view RoleName(DeploymentRole role) {
+    switch (role) {
+        case DeploymentRole::BOOTED:
+            return "booted";
+        case DeploymentRole::PENDING:
+            return "pending";
+        case DeploymentRole::ROLLBACK:
+            return "rollback";
+        case DeploymentRole::OTHER:
+            break;
+    }
+    return "";
+}
+
+std::string SysrootRepoPath(const std::string& sysroot) {
+    return (std::filesystem::path(sysroot) / "ostree" / "repo").string();
+}
+
+bool ListDeployments(const std::string& sysroot,
+                     std::vector<Deployment>& deployments,
+                     GCancellable* cancellable,
+                     GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("ListDeployments");
+    deployments.clear();
+
+    g_autoptr(GFile) path = g_file_new_for_path(sysroot.c_str());
+    g_autoptr(OstreeSysroot) self = ostree_sysroot_new(path);
+    if (!ostree_sysroot_load(self, cancellable, error)) {
+        return false;
+    }
+    g_autoptr(GPtrArray) all = ostree_sysroot_get_deployments(self);
+    OstreeDeployment* booted = ostree_sysroot_get_booted_deployment(self);
+
+    // pending & rollback per OS, relative to the booted deployment if it is one of the OS
+    std::unordered_map<std::string, std::vector<size_t>> byOs;
+    for (guint i{0}; i < all->len; i++) {
+        auto* deployment = static_cast<OstreeDeployment*>(g_ptr_array_index(all, i));
+        Deployment& entry = deployments.emplace_back();
+        entry.osname = ostree_deployment_get_osname(deployment);
+        entry.checksum = ostree_deployment_get_csum(deployment);
+        entry.serial = ostree_deployment_get_deployserial(deployment);
+        entry.staged = ostree_deployment_is_staged(deployment) != FALSE;
+        entry.pinned = ostree_deployment_is_pinned(deployment) != FALSE;
+        if (GKeyFile* origin = ostree_deployment_get_origin(deployment)) {
+            g_autofree gchar* refspec = g_key_file_get_string(origin, "origin", "refspec", nullptr);
+            if (refspec != nullptr) {
+                entry.refspec = refspec;
+            }
+        }
+        if (booted != nullptr && ostree_deployment_equal(deployment, booted)) {
+            entry.role = DeploymentRole::BOOTED;
+        }
+        byOs[entry.osname].push_back(deployments.size() - 1);
+    }
+
+    for (const auto& [osname, indices] : byOs) {
+        bool foundBooted{false};
+        bool osBooted{false};
+        for (const size_t index : indices) {
+            osBooted |= deployments[index].role == DeploymentRole::BOOTED;
+        }
+        // nothing booted: the first deployment boots next, like a pending one
+        for (size_t position{0}; position < indices.size(); position++) {
+            Deployment& entry = deployments[indices[position]];
+            if (entry.role == DeploymentRole::BOOTED) {
+                foundBooted = true;
+            } else if (!osBooted) {
+                entry.role = position == 0   ? DeploymentRole::PENDING
+                             : position == 1 ? DeploymentRole::ROLLBACK
+                                             : DeploymentRole::OTHER;
+            } else if (!foundBooted && position == 0) {
+                entry.role = DeploymentRole::PENDING;
+            } else if (foundBooted && deployments[indices[position - 1]].role ==
+                                          DeploymentRole::BOOTED) {
+                entry.role = DeploymentRole::ROLLBACK;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace cpplibostree
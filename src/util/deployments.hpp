@@ -0,0 +1,73 @@
+/*_____________________________________________________________
+ | Deployments
+ |   Lists the deployments of a sysroot (OstreeSysroot), like
+ |   `ostree admin status`: the deployed commit, its origin
+ |   refspec & its role for the next boots (booted, pending or
+ |   rollback). The commits are stored in the system repository
+ |   `<sysroot>/ostree/repo`, see OSTreeRepo for loading them.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ostree.h>
+
+namespace cpplibostree {
+
+/// parents loaded per deployment by default, deployed systems rarely need more history
+inline constexpr size_t DEFAULT_DEPLOYMENT_DEPTH{20};
+
+/// Sysroot to show the deployments of (see OSTreeRepo).
+struct SysrootOptions {
+    std::string path;                        // "/" for the running system
+    size_t depth{DEFAULT_DEPLOYMENT_DEPTH};  // parents loaded per deployment
+};
+
+enum class DeploymentRole : uint8_t { BOOTED, PENDING, ROLLBACK, OTHER };
+
+struct Deployment {
+    std::string osname;
+    std::string checksum;
+    int serial{0};
+    std::string refspec;  // origin refspec, empty if the deployment has no origin
+    DeploymentRole role{DeploymentRole::OTHER};
+    bool staged{false};
+    bool pinned{false};
+
+    /// @return Branch the deployment is shown on: its refspec, or the osname without origin.
+    [[nodiscard]] const std::string& Branch() const;
+    /// @return "osname.serial", like the deployment directory.
+    [[nodiscard]] std::string Name() const;
+};
+
+/// @return "booted", "pending", "rollback", or an empty string for other deployments.
+[[nodiscard]] std::string_view RoleName(DeploymentRole role);
+
+/// @return Path of the system repository of a sysroot.
+[[nodiscard]] std::string SysrootRepoPath(const std::string& sysroot);
+
+/**
+ * @brief Lists the deployments of a sysroot, in boot order (the first one boots next).
+ *
+ * The roles follow `ostree admin status`: on the running system the booted deployment is
+ * known, the deployment of the same OS before it is pending, the one after it the rollback.
+ * If nothing of the sysroot is booted (e.g. a mounted device image), the first deployment of
+ * each OS is pending & the second one its rollback.
+ *
+ * @param sysroot Path of the sysroot, "/" for the running system.
+ * @param deployments Filled with the deployments.
+ * @param cancellable Cancellable.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool ListDeployments(const std::string& sysroot,
+                     std::vector<Deployment>& deployments,
+                     GCancellable* cancellable,
+                     GError** error);
+
+}  // namespace cpplibostree
@@ -0,0 +1,270 @@
+#include "diskusage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+std::string deltaKey(const std::string& from, const std::string& to) {
+    return from + ".." + to;
+}
+
+}  // namespace
+
+std::string FormatBytes(uint64_t bytes) {
+    constexpr std::array<const char*, 5> UNITS{"B", "KiB", "MiB", "GiB", "TiB"};
+    auto value = static_cast<double>(bytes);
+    size_t unit{0};
+    while (value >= 1024 && unit + 1 < UNITS.size()) {
+        value /= 1024;
+        unit++;
+    }
+    if (unit == 0) {
+        return std::format("{} B", bytes);
+    }
+    return std::format("{:.1f} {}", value, UNITS.at(unit));
+}
+
+DiskUsageWorker::DiskUsageWorker(const std::string& repoPath,
+                                 ThreadPool& pool,
+                                 ResultCallback onResult)
+    : onResult(std::move(onResult)), walker(repoPath, pool) {
+    worker = std::thread([this] { run(); });
+}
+
+DiskUsageWorker::~DiskUsageWorker() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        runningStop.request_stop();
+    }
+    walker.Cancel();
+    wakeup.notify_one();
+    worker.join();
+}
+
+std::optional<DiskUsage> DiskUsageWorker::Get(const std::string& commit,
+                                              const std::string& parent) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (const auto it = cache.find(commit); it != cache.end()) {
+            return it->second;
+        }
+        queue({commit, commit, parent, false});
+    }
+    wakeup.notify_one();
+    return std::nullopt;
+}
+
+std::optional<DeltaEstimate> DiskUsageWorker::GetDeltaEstimate(const std::string& from,
+                                                               const std::string& to) {
+    const std::string key = deltaKey(from, to);
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (const auto it = deltaCache.find(key); it != deltaCache.end()) {
+            return it->second;
+        }
+        queue({key, to, from, true});
+    }
+    wakeup.notify_one();
+    return std::nullopt;
+}
+
+bool DiskUsageWorker::Failed(const std::string& commit) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return failed.contains(commit);
+}
+
+bool DiskUsageWorker::DeltaFailed(const std::string& from, const std::string& to) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return failed.contains(deltaKey(from, to));
+}
+
+void DiskUsageWorker::queue(Request request) {
+    if (failed.contains(request.key) || queued.contains(request.key)) {
+        return;
+    }
+    // the user moved on: replace the pending request & cancel the running one of this kind
+    std::optional<Request>& pending = request.delta ? pendingDelta : pendingUsage;
+    if (pending) {
+        queued.erase(pending->key);
+    }
+    if (runningDelta == request.delta) {
+        runningStop.request_stop();
+    }
+    queued.insert(request.key);
+    request.sequence = nextSequence++;
+    pending = std::move(request);
+}
+
+void DiskUsageWorker::run() {
+    while (true) {
+        Request request;
+        std::stop_token requestStop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || pendingUsage || pendingDelta; });
+            if (stop) {
+                return;
+            }
+            // most recent request first
+            std::optional<Request>& next =
+                !pendingDelta || (pendingUsage && pendingUsage->sequence > pendingDelta->sequence)
+                    ? pendingUsage
+                    : pendingDelta;
+            request = std::move(*next);
+            next.reset();
+            runningDelta = request.delta;
+            runningStop = std::stop_source();
+            requestStop = runningStop.get_token();
+        }
+
+        std::optional<DiskUsage> usage;
+        std::optional<DeltaEstimate> estimate;
+        if (request.delta) {
+            estimate = calculateDelta(request, requestStop);
+        } else {
+            usage = calculate(request, requestStop);
+        }
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                return;
+            }
+            runningDelta.reset();
+            queued.erase(request.key);
+            if (usage) {
+                cache.emplace(request.key, *usage);
+            } else if (estimate) {
+                deltaCache.emplace(request.key, *estimate);
+            } else if (!requestStop.stop_requested()) {
+                failed.insert(request.key);
+            }
+        }
+        // also after a cancellation: a redraw requests the commit again, if it is still shown
+        onResult(request.key);
+    }
+}
+
+DiskUsageWorker::ObjectSet DiskUsageWorker::objectsOf(const std::string& commit,
+                                                      const std::stop_token& stop) {
+    const auto cached = std::find_if(objectSets.begin(), objectSets.end(),
+                                     [&](const auto& entry) { return entry.first == commit; });
+    if (cached != objectSets.end()) {
+        ObjectSet objects = cached->second;
+        rememberObjects(commit, objects);
+        return objects;
+    }
+    // no sizes needed
+    auto objects = std::make_shared<ConcurrentObjectSet>();
+    if (!walker.WalkCommit(commit, *objects, nullptr, nullptr, false, stop)) {
+        return nullptr;
+    }
+    rememberObjects(commit, objects);
+    return objects;
+}
+
+void DiskUsageWorker::rememberObjects(const std::string& commit, ObjectSet objects) {
+    std::erase_if(objectSets, [&](const auto& entry) { return entry.first == commit; });
+    if (objectSets.size() >= OBJECT_SET_CACHE_SIZE) {
+        objectSets.erase(objectSets.begin());
+    }
+    objectSets.emplace_back(commit, std::move(objects));
+}
+
+std::optional<DiskUsage> DiskUsageWorker::calculate(const Request& request,
+                                                    const std::stop_token& stop) {
+    OSTREE_TUI_PROFILE_SCOPE("DiskUsageWorker::calculate");
+
+    // objects of the parent, usually cached from the previously selected commit
+    DiskUsage usage;
+    ObjectSet parentObjects;
+    if (ostree_validate_checksum_string(request.base.c_str(), nullptr)) {
+        // a missing parent (e.g. pulled without history): all objects count as exclusive
+        parentObjects = objectsOf(request.base, stop);
+        usage.hasParent = parentObjects != nullptr;
+    }
+    if (stop.stop_requested()) {
+        return std::nullopt;
+    }
+
+    std::atomic<uint64_t> objects{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> sharedObjects{0};
+    std::atomic<uint64_t> sharedBytes{0};
+    auto visited = std::make_shared<ConcurrentObjectSet>();
+    const bool complete = walker.WalkCommit(
+        request.commit, *visited,
+        [&](const ObjectId& id, OstreeObjectType /*type*/, uint64_t storageSize,
+            uint64_t /*contentSize*/) {
+            objects.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(storageSize, std::memory_order_relaxed);
+            if (parentObjects && parentObjects->Contains(id)) {
+                sharedObjects.fetch_add(1, std::memory_order_relaxed);
+                sharedBytes.fetch_add(storageSize, std::memory_order_relaxed);
+            }
+        },
+        nullptr, false, stop);
+    if (!complete) {
+        return std::nullopt;
+    }
+    // the parent of the next selected (older) commit, or a delta base
+    rememberObjects(request.commit, std::move(visited));
+
+    usage.objects = objects;
+    usage.bytes = bytes;
+    usage.sharedObjects = sharedObjects;
+    usage.sharedBytes = sharedBytes;
+    usage.exclusiveObjects = usage.objects - usage.sharedObjects;
+    usage.exclusiveBytes = usage.bytes - usage.sharedBytes;
+    return usage;
+}
+
+std::optional<DeltaEstimate> DiskUsageWorker::calculateDelta(const Request& request,
+                                                              const std::stop_token& stop) {
+    OSTREE_TUI_PROFILE_SCOPE("DiskUsageWorker::calculateDelta");
+
+    // everything present on the device
+    const ObjectSet present = objectsOf(request.base, stop);
+    if (!present) {
+        return std::nullopt;
+    }
+
+    // everything else reachable from the target, unchanged subtrees are not entered
+    std::atomic<uint64_t> objects{0};
+    std::atomic<uint64_t> compressedBytes{0};
+    std::atomic<uint64_t> uncompressedBytes{0};
+    ConcurrentObjectSet visited;
+    const bool complete = walker.WalkCommit(
+        request.commit, visited,
+        [&](const ObjectId& /*id*/, OstreeObjectType /*type*/, uint64_t storageSize,
+            uint64_t contentSize) {
+            objects.fetch_add(1, std::memory_order_relaxed);
+            compressedBytes.fetch_add(storageSize, std::memory_order_relaxed);
+            uncompressedBytes.fetch_add(contentSize, std::memory_order_relaxed);
+        },
+        present.get(), true, stop);
+    if (!complete) {
+        return std::nullopt;
+    }
+    return DeltaEstimate{objects, compressedBytes, uncompressedBytes};
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,159 @@
+/*_____________________________________________________________
+ | Disk Usage
+ |   Per-commit storage statistics, calculated in the background
+ |   with a parallel ObjectWalker:
+ |   - all objects reachable from the commit & their size
+ |   - split into objects shared with the parent commit and
+ |     objects exclusive to this commit (what it costs to keep)
+ |   - delta estimates: objects a device on commit A has to
+ |     download to reach commit B (subtrees already present on
+ |     A are skipped by checksum)
+ |   Results are cached by commit checksum (pair), the object
+ |   sets of the last walked commits are kept, so a commit's
+ |   parent (or delta base) is not walked again while scrolling.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "objectwalk.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+struct DiskUsage {
+    uint64_t objects{0};  // unique objects reachable from the commit
+    uint64_t bytes{0};
+    uint64_t exclusiveObjects{0};  // not reachable from the parent
+    uint64_t exclusiveBytes{0};
+    uint64_t sharedObjects{0};  // also reachable from the parent
+    uint64_t sharedBytes{0};
+    bool hasParent{false};  // false, if there is no parent (or it is not in the repository)
+};
+
+/// Objects missing on a device on commit `from`, to update to commit `to`.
+struct DeltaEstimate {
+    uint64_t objects{0};
+    uint64_t compressedBytes{0};  // storage size, equals uncompressed size in bare repositories
+    uint64_t uncompressedBytes{0};
+};
+
+/// @return Human readable size, e.g. "12.3 MiB".
+[[nodiscard]] std::string FormatBytes(uint64_t bytes);
+
+/**
+ * @brief Calculates the DiskUsage of commits & DeltaEstimates between commits on a background
+ * thread. Only the newest request of each kind is kept: a new request replaces the pending one
+ * & cancels the running calculation of the same kind, so commits skipped over while scrolling
+ * are not calculated.
+ */
+class DiskUsageWorker {
+   public:
+    /// Called from the worker thread with the commit checksum (or `from..to` for deltas), once
+    /// its result is available.
+    using ResultCallback = std::function<void(const std::string&)>;
+
+    /**
+     * @param repoPath Path of the repository (every pool worker opens its own handle).
+     * @param pool Pool to run the object traversals on.
+     * @param onResult Result callback.
+     */
+    DiskUsageWorker(const std::string& repoPath, ThreadPool& pool, ResultCallback onResult);
+    ~DiskUsageWorker();
+    DiskUsageWorker(const DiskUsageWorker&) = delete;
+    DiskUsageWorker& operator=(const DiskUsageWorker&) = delete;
+
+    /**
+     * @brief Gets the cached usage of a commit, or queues its calculation.
+     *
+     * @param commit Commit checksum.
+     * @param parent Checksum of its parent (anything else, e.g. "(no parent)", means none).
+     * @return Usage, nullopt while it is being calculated (or if the calculation failed).
+     */
+    [[nodiscard]] std::optional<DiskUsage> Get(const std::string& commit,
+                                               const std::string& parent);
+
+    /**
+     * @brief Gets the cached delta estimate between two commits, or queues its calculation.
+     *
+     * @param from Commit checksum the device is on.
+     * @param to Commit checksum the device updates to.
+     * @return Estimate, nullopt while it is being calculated (or if the calculation failed).
+     */
+    [[nodiscard]] std::optional<DeltaEstimate> GetDeltaEstimate(const std::string& from,
+                                                                const std::string& to);
+
+    /// @return true, if the calculation of the commit failed.
+    [[nodiscard]] bool Failed(const std::string& commit);
+
+    /// @return true, if the delta estimate between the commits failed.
+    [[nodiscard]] bool DeltaFailed(const std::string& from, const std::string& to);
+
+   private:
+    using ObjectSet = std::shared_ptr<const ConcurrentObjectSet>;
+
+    /// object sets of walked commits, kept for their children & as delta bases
+    static constexpr size_t OBJECT_SET_CACHE_SIZE{4};
+
+    struct Request {
+        std::string key;  // commit, or `from..to` for deltas
+        std::string commit;
+        std::string base;  // parent, or `from` for deltas
+        bool delta{false};
+        uint64_t sequence{0};  // order of the requests
+    };
+
+    /**
+     * @brief Queues a request, unless it is already queued or failed. It replaces the pending
+     * request of its kind & cancels the running one (mutex must be held).
+     */
+    void queue(Request request);
+
+    void run();
+
+    [[nodiscard]] std::optional<DiskUsage> calculate(const Request& request,
+                                                     const std::stop_token& stop);
+    [[nodiscard]] std::optional<DeltaEstimate> calculateDelta(const Request& request,
+                                                              const std::stop_token& stop);
+
+    /// @return All objects of a commit, from the cache or walked (worker thread only).
+    [[nodiscard]] ObjectSet objectsOf(const std::string& commit, const std::stop_token& stop);
+    /// @brief Adds the complete object set of a commit to the cache (worker thread only).
+    void rememberObjects(const std::string& commit, ObjectSet objects);
+
+    ResultCallback onResult;
+    ObjectWalker walker;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    std::optional<Request> pendingUsage;
+    std::optional<Request> pendingDelta;
+    uint64_t nextSequence{0};
+    std::optional<bool> runningDelta;         // kind of the running request
+    std::stop_source runningStop;             // cancels the running request
+    std::unordered_set<std::string> queued;   // keys pending or being calculated
+    std::unordered_set<std::string> failed;   // keys
+    std::unordered_map<std::string, DiskUsage> cache;
+    std::unordered_map<std::string, DeltaEstimate> deltaCache;  // `from..to` -> estimate
+
+    std::vector<std::pair<std::string, ObjectSet>> objectSets;  // LRU, most recent last
+
+    std::thread worker;
+};
+
+}  // namespace cpplibostree
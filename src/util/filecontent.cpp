@@ -0,0 +1,216 @@
+#include "filecontent.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+std::unique_ptr<FileContent> FileContent::Open(OstreeRepo* repo,
+                                               const ObjectId& file,
+                                               GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("FileContent::Open");
+    std::unique_ptr<FileContent> content(new FileContent(repo, ToChecksum(file)));
+    // bare repositories store the plain content, objects of parent repositories are streamed
+    if (ostree_repo_get_mode(repo) != OSTREE_REPO_MODE_ARCHIVE && content->map()) {
+        return content;
+    }
+    if (!content->openStream(error)) {
+        return nullptr;
+    }
+    return content;
+}
+
+FileContent::FileContent(OstreeRepo* repo, std::string checksum)
+    : repo(static_cast<OstreeRepo*>(g_object_ref(repo))), checksum(std::move(checksum)) {}
+
+FileContent::~FileContent() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+    if (stream != nullptr) {
+        g_object_unref(stream);
+    }
+    g_object_unref(repo);
+}
+
+std::string_view FileContent::Read(uint64_t offset, size_t length) {
+    if (offset >= size) {
+        return {};
+    }
+    length = static_cast<size_t>(std::min<uint64_t>(length, size - offset));
+    if (mapped) {
+        return {data + offset, length};
+    }
+
+    const uint64_t end = offset + length;
+    if ((offset < windowOffset || end > windowOffset + window.size()) && !fill(offset, end)) {
+        return {};
+    }
+    // the stream may have ended early (corrupt object)
+    const std::string_view view(window);
+    return offset - windowOffset >= view.size() ? std::string_view{}
+                                                : view.substr(offset - windowOffset, length);
+}
+
+std::optional<uint64_t> FileContent::Find(std::string_view needle,
+                                          uint64_t begin,
+                                          uint64_t end,
+                                          GCancellable* cancellable) {
+    OSTREE_TUI_PROFILE_SCOPE("FileContent::Find");
+    if (needle.empty()) {
+        return std::nullopt;
+    }
+    const std::boyer_moore_horspool_searcher searcher(needle.begin(), needle.end());
+    // chunks overlap by the needle, so matches across chunk borders are found
+    constexpr size_t CHUNK_SIZE{WINDOW_SIZE / 2};
+    for (uint64_t offset{begin}; offset < std::min(end, size); offset += CHUNK_SIZE) {
+        if (g_cancellable_is_cancelled(cancellable)) {
+            return std::nullopt;
+        }
+        const std::string_view chunk = Read(offset, CHUNK_SIZE + needle.size() - 1);
+        if (chunk.size() < needle.size()) {
+            break;
+        }
+        const auto match = std::search(chunk.begin(), chunk.end(), searcher);
+        if (match != chunk.end()) {
+            const uint64_t position = offset + static_cast<uint64_t>(match - chunk.begin());
+            if (position >= end) {
+                break;
+            }
+            return position;
+        }
+    }
+    return std::nullopt;
+}
+
+void FileContent::SetBufferedOnly(bool bufferedOnly) {
+    this->bufferedOnly = bufferedOnly;
+}
+
+bool FileContent::TakeMiss() {
+    return std::exchange(missed, false);
+}
+
+uint64_t FileContent::GetSize() const {
+    return size;
+}
+
+bool FileContent::IsMapped() const {
+    return mapped;
+}
+
+bool FileContent::map() {
+    const std::string path =
+        std::format("objects/{}/{}.file", checksum.substr(0, 2), checksum.substr(2));
+    const int fd =
+        openat(ostree_repo_get_dfd(repo), path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat stbuf {};
+    if (fstat(fd, &stbuf) != 0 || !S_ISREG(stbuf.st_mode)) {
+        close(fd);
+        return false;
+    }
+    size = static_cast<uint64_t>(stbuf.st_size);
+    if (size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        data = static_cast<const char*>(mapping);
+    }
+    close(fd);
+    mapped = true;
+    return true;
+}
+
+bool FileContent::openStream(GError** error) {
+    if (stream != nullptr) {
+        g_object_unref(stream);
+        stream = nullptr;
+    }
+    g_autoptr(GFileInfo) info = nullptr;
+    if (!ostree_repo_load_file(repo, checksum.c_str(), &stream, &info, nullptr, nullptr, error)) {
+        return false;
+    }
+    windowOffset = 0;
+    window.clear();
+    // symbolic links have no stream, their content is the target
+    if (g_file_info_get_file_type(info) == G_FILE_TYPE_SYMBOLIC_LINK) {
+        window = g_file_info_get_symlink_target(info);
+        size = window.size();
+        return true;
+    }
+    size = static_cast<uint64_t>(g_file_info_get_size(info));
+    return stream != nullptr || size == 0;
+}
+
+bool FileContent::fill(uint64_t offset, uint64_t end) {
+    OSTREE_TUI_PROFILE_SCOPE("FileContent::fill");
+    // keep some bytes before the offset, drop (or skip over) everything before them
+    const uint64_t keepFrom = offset > LOOKBEHIND ? offset - LOOKBEHIND : 0;
+    if (bufferedOnly &&
+        (offset < windowOffset || keepFrom > windowOffset + window.size() + WINDOW_SIZE)) {
+        missed = true;
+        return false;
+    }
+    if (offset < windowOffset && !openStream(nullptr)) {
+        return false;
+    }
+    if (stream == nullptr) {
+        return false;
+    }
+
+    const uint64_t streamOffset = windowOffset + window.size();
+    if (keepFrom >= streamOffset) {
+        for (uint64_t remaining{keepFrom - streamOffset}; remaining > 0;) {
+            const gssize skipped = g_input_stream_skip(
+                stream, static_cast<gsize>(std::min<uint64_t>(remaining, WINDOW_SIZE)), nullptr,
+                nullptr);
+            if (skipped <= 0) {
+                return false;
+            }
+            OSTREE_TUI_PROFILE_COUNT("contentBytesSkipped", skipped);
+            remaining -= static_cast<uint64_t>(skipped);
+        }
+        window.clear();
+        windowOffset = keepFrom;
+    } else if (keepFrom > windowOffset) {
+        window.erase(0, keepFrom - windowOffset);
+        windowOffset = keepFrom;
+    }
+
+    // read ahead a whole window, sequential reads rarely hit the stream
+    const uint64_t target = std::min(size, std::max(end, windowOffset + WINDOW_SIZE));
+    const size_t filled = window.size();
+    window.resize(target - windowOffset);
+    gsize bytesRead{0};
+    const bool success = g_input_stream_read_all(stream, window.data() + filled,
+                                                 window.size() - filled, &bytesRead, nullptr,
+                                                 nullptr);
+    window.resize(filled + bytesRead);
+    OSTREE_TUI_PROFILE_COUNT("contentBytesRead", static_cast<int64_t>(bytesRead));
+    return success;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,116 @@
+/*_____________________________________________________________
+ | File Content
+ |   Random access to the content of a file object, for the file
+ |   viewer, with bounded memory (even for multi-GB files):
+ |   - bare repositories store the plain content, the object is
+ |     mmapped & read without copies
+ |   - archive objects are decompressed as a stream, only a
+ |     window around the last read is kept; reading behind the
+ |     window restarts the stream. On the UI thread, reads can
+ |     be limited to the window (see SetBufferedOnly()), so a
+ |     restart or long skip is left to a background job
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+
+namespace cpplibostree {
+
+class FileContent {
+   public:
+    /// bytes decompressed ahead of a read (archive objects)
+    static constexpr size_t WINDOW_SIZE{256 * 1024};
+    /// bytes kept before a read, so scrolling back does not restart the stream
+    static constexpr size_t LOOKBEHIND{64 * 1024};
+
+    /**
+     * @brief Opens the content of a file object (the target of symbolic links).
+     *
+     * @param repo Repository, referenced as long as the content is open.
+     * @param file Checksum of the file object.
+     * @param error Set, if the object could not be opened.
+     * @return Content, nullptr on errors.
+     */
+    [[nodiscard]] static std::unique_ptr<FileContent> Open(OstreeRepo* repo,
+                                                           const ObjectId& file,
+                                                           GError** error = nullptr);
+    ~FileContent();
+    FileContent(const FileContent&) = delete;
+    FileContent& operator=(const FileContent&) = delete;
+
+    /**
+     * @brief Reads a part of the content.
+     *
+     * @param offset Offset of the first byte.
+     * @param length Amount of bytes.
+     * @return Up to length bytes (less at the end of the content, empty on read errors). Only
+     * valid until the next call.
+     */
+    [[nodiscard]] std::string_view Read(uint64_t offset, size_t length);
+
+    /**
+     * @brief Searches the content, chunk by chunk.
+     *
+     * @param needle Bytes to search for.
+     * @param begin Offset to start at.
+     * @param end Matches have to start before this offset.
+     * @param cancellable Checked after every chunk.
+     * @return Offset of the first match, nullopt if there is none (or the search was cancelled).
+     */
+    [[nodiscard]] std::optional<uint64_t> Find(std::string_view needle,
+                                               uint64_t begin,
+                                               uint64_t end,
+                                               GCancellable* cancellable = nullptr);
+
+    /**
+     * @brief Limits reads to the window & one read ahead of it: reads, that would restart the
+     * stream or skip far ahead, return nothing & are remembered as miss instead.
+     *
+     * @param bufferedOnly Limit the reads.
+     */
+    void SetBufferedOnly(bool bufferedOnly);
+
+    /// @return true, if a read missed the window since the last call (resets the miss).
+    [[nodiscard]] bool TakeMiss();
+
+    [[nodiscard]] uint64_t GetSize() const;
+    /// @return true, if the object is mapped (bare repositories), false if it is streamed.
+    [[nodiscard]] bool IsMapped() const;
+
+   private:
+    FileContent(OstreeRepo* repo, std::string checksum);
+
+    /// @brief Maps the plain object file, fails for archive objects & symbolic links.
+    bool map();
+    /// @brief (Re)opens the decompressing stream at the start of the content.
+    bool openStream(GError** error);
+    /// @brief Moves the window, so it contains [offset, end).
+    bool fill(uint64_t offset, uint64_t end);
+
+    OstreeRepo* repo;
+    std::string checksum;
+    uint64_t size{0};
+
+    // mapped content
+    bool mapped{false};
+    const char* data{nullptr};
+
+    // streamed content, the window always ends at the stream position
+    GInputStream* stream{nullptr};
+    std::string window;
+    uint64_t windowOffset{0};
+    bool bufferedOnly{false};
+    bool missed{false};
+};
+
+}  // namespace cpplibostree
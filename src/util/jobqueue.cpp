@@ -0,0 +1,218 @@
+#include "jobqueue.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+#include "repolock.hpp"
+
+namespace cpplibostree {
+
+JobQueue::JobQueue(std::string repoPath, ChangeCallback onChange)
+    : repoPath(std::move(repoPath)), onChange(std::move(onChange)) {
+    worker = std::thread([this] { run(); });
+}
+
+JobQueue::~JobQueue() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    CancelAll();
+    wakeup.notify_one();
+    worker.join();
+}
+
+void JobQueue::Submit(std::string name,
+                      JobFunction job,
+                      FinishedCallback onFinished,
+                      std::optional<LockMode> repoLock) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        queue({std::move(name), std::move(job), std::move(onFinished), Clock::now(), repoLock});
+    }
+    wakeup.notify_one();
+    onChange();
+}
+
+void JobQueue::SubmitCoalesced(std::string name,
+                               JobFunction job,
+                               FinishedCallback onFinished,
+                               std::chrono::milliseconds delay,
+                               std::optional<LockMode> repoLock) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        const auto pending = std::find_if(jobs.begin(), jobs.end(),
+                                          [&name](const Job& job) { return job.name == name; });
+        Job replacement{std::move(name), std::move(job), std::move(onFinished),
+                        Clock::now() + delay, repoLock};
+        if (pending == jobs.end()) {
+            queue(std::move(replacement));
+        } else {
+            // still part of the same batch
+            jobs.erase(pending);
+            jobs.push_back(std::move(replacement));
+        }
+    }
+    wakeup.notify_one();
+    onChange();
+}
+
+void JobQueue::CancelAll() {
+    std::deque<Job> dropped;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        dropped.swap(jobs);
+        status.batchTotal -= dropped.size();
+        status.pending = 0;
+        if (cancellable != nullptr) {
+            cancelledByUser = true;
+            g_cancellable_cancel(cancellable);
+        }
+    }
+    for (const auto& job : dropped) {
+        if (job.onFinished) {
+            job.onFinished(false);
+        }
+    }
+    onChange();
+}
+
+void JobQueue::ReportProgress(std::string progress) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (status.running.empty()) {
+            return;
+        }
+        status.progress = std::move(progress);
+    }
+    onChange();
+}
+
+JobQueue::Status JobQueue::GetStatus() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
+
+void JobQueue::queue(Job job) {
+    // new batch
+    if (status.running.empty() && jobs.empty()) {
+        status.batchDone = 0;
+        status.batchTotal = 0;
+        status.batchFailed = 0;
+    }
+    jobs.push_back(std::move(job));
+    status.pending = jobs.size();
+    status.batchTotal++;
+}
+
+std::deque<JobQueue::Job>::iterator JobQueue::nextReadyJob(Clock::time_point now) {
+    return std::find_if(jobs.begin(), jobs.end(),
+                        [now](const Job& job) { return job.notBefore <= now; });
+}
+
+void JobQueue::run() {
+    OstreeRepo* repo{nullptr};
+    while (true) {
+        Job job;
+        GCancellable* jobCancellable{nullptr};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto next = jobs.end();
+            while (!stop && (next = nextReadyJob(Clock::now())) == jobs.end()) {
+                // wake up for the earliest debounced job & to clear a shown failure
+                auto wakeAt = Clock::time_point::max();
+                if (status.batchFailed > 0) {
+                    wakeAt = errorShownUntil;
+                }
+                if (!jobs.empty()) {
+                    const auto earliest = std::min_element(
+                        jobs.begin(), jobs.end(),
+                        [](const Job& a, const Job& b) { return a.notBefore < b.notBefore; });
+                    wakeAt = std::min(wakeAt, earliest->notBefore);
+                }
+                if (wakeAt == Clock::time_point::max()) {
+                    wakeup.wait(lock);
+                } else {
+                    wakeup.wait_until(lock, wakeAt);
+                }
+                if (status.batchFailed > 0 && Clock::now() >= errorShownUntil) {
+                    status.batchFailed = 0;
+                    status.lastError.clear();
+                    lock.unlock();
+                    onChange();
+                    lock.lock();
+                }
+            }
+            if (stop) {
+                break;
+            }
+            job = std::move(*next);
+            jobs.erase(next);
+            status.pending = jobs.size();
+            status.running = job.name;
+            status.progress.clear();
+            cancellable = g_cancellable_new();
+            cancelledByUser = false;
+            jobCancellable = cancellable;
+        }
+        onChange();
+
+        GError* error{nullptr};
+        bool success{false};
+        {
+            OSTREE_TUI_PROFILE_SCOPE("JobQueue::job");
+            if (repo == nullptr) {
+                repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), jobCancellable, &error);
+            }
+            // released before the job is reported as finished (e.g. before a refresh)
+            RepoLock repoLock;
+            bool locked = !job.lock.has_value();
+            if (repo != nullptr && job.lock) {
+                locked = repoLock.Acquire(repo, *job.lock, LOCK_TIMEOUT,
+                                          [this](std::chrono::seconds waited) {
+                                              ReportProgress("waiting for lock (" +
+                                                             std::to_string(waited.count()) +
+                                                             "s)");
+                                          },
+                                          jobCancellable, &error);
+                ReportProgress("");
+            }
+            success = repo != nullptr && locked && job.run(repo, jobCancellable, &error);
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            status.running.clear();
+            status.progress.clear();
+            status.batchDone++;
+            if (!success && !cancelledByUser) {
+                status.batchFailed++;
+                status.lastError =
+                    job.name + ": " + (error != nullptr ? error->message : "unknown error");
+                errorShownUntil = Clock::now() + ERROR_DISPLAY_TIME;
+            }
+            g_object_unref(cancellable);
+            cancellable = nullptr;
+        }
+        g_clear_error(&error);
+        if (job.onFinished) {
+            job.onFinished(success);
+        }
+        onChange();
+    }
+    if (repo != nullptr) {
+        g_object_unref(repo);
+    }
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,144 @@
+/*_____________________________________________________________
+ | Job Queue
+ |   Long running repository operations (static deltas, summary
+ |   updates, ...), executed one after another on a background
+ |   thread with its own OstreeRepo handle, so they never block
+ |   the UI. Jobs are cancellable through a GCancellable, the
+ |   progress of the current batch is reported for the footer.
+ |   Coalesced jobs can be debounced: a burst of submissions
+ |   results in one run, once the submissions stopped.
+ |   Jobs may declare the repository lock they need, it is
+ |   taken before they run, a wait for it shows as progress.
+ |   A failure is shown for a while (or until the next batch),
+ |   jobs cancelled with CancelAll() do not count as failed.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <ostree.h>
+
+#include "repolock.hpp"
+
+namespace cpplibostree {
+
+class JobQueue {
+   public:
+    /// Runs on the job thread, libostree style: returns false & sets the error on failure.
+    using JobFunction = std::function<bool(OstreeRepo*, GCancellable*, GError**)>;
+    /// Called from the job thread once the job finished (success) or failed / was cancelled.
+    using FinishedCallback = std::function<void(bool success)>;
+    /// Called from the job thread whenever the status changed.
+    using ChangeCallback = std::function<void()>;
+
+    struct Status {
+        std::string running;   // name of the running job, empty if idle
+        std::string progress;  // reported by the running job, see ReportProgress()
+        size_t pending{0};
+        size_t batchDone{0};  // jobs done since the queue was last idle
+        size_t batchTotal{0};
+        size_t batchFailed{0};  // reset ERROR_DISPLAY_TIME after the last failure
+        std::string lastError;
+    };
+
+    /**
+     * @param repoPath Path of the repository, opened by the job thread.
+     * @param onChange Status change callback.
+     */
+    JobQueue(std::string repoPath, ChangeCallback onChange);
+    /// cancels the running & all pending jobs
+    ~JobQueue();
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    /**
+     * @brief Queues a job.
+     *
+     * @param name Name shown while the job runs.
+     * @param job Job to run.
+     * @param onFinished Optional callback, once the job finished.
+     * @param lock Repository lock to hold while the job runs, none if empty.
+     */
+    void Submit(std::string name,
+                JobFunction job,
+                FinishedCallback onFinished = nullptr,
+                std::optional<LockMode> lock = std::nullopt);
+
+    /**
+     * @brief Queues a job, replacing a pending (not yet running) job with the same name. The
+     * job moves to the back of the queue, so e.g. a summary update runs once, after a batch.
+     *
+     * @param name Name shown while the job runs, identifies the job to replace.
+     * @param job Job to run.
+     * @param onFinished Optional callback, once the job finished.
+     * @param delay Debounce delay, the job runs once no submission happened for this long.
+     * @param lock Repository lock to hold while the job runs, none if empty.
+     */
+    void SubmitCoalesced(std::string name,
+                         JobFunction job,
+                         FinishedCallback onFinished = nullptr,
+                         std::chrono::milliseconds delay = std::chrono::milliseconds{0},
+                         std::optional<LockMode> lock = std::nullopt);
+
+    /// @brief Cancels the running job & drops all pending ones.
+    void CancelAll();
+
+    /**
+     * @brief Sets the progress of the running job, shown next to its name. Called by the job
+     * (on the job thread), the job should throttle its reports.
+     *
+     * @param progress Progress, e.g. "1200 files, 80 MiB".
+     */
+    void ReportProgress(std::string progress);
+
+    [[nodiscard]] Status GetStatus() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    /// jobs run in the background, they may wait for other processes a while
+    static constexpr std::chrono::milliseconds LOCK_TIMEOUT{std::chrono::minutes{10}};
+    /// how long a failure stays in the status, if no new batch starts
+    static constexpr std::chrono::seconds ERROR_DISPLAY_TIME{10};
+
+    struct Job {
+        std::string name;
+        JobFunction run;
+        FinishedCallback onFinished;
+        Clock::time_point notBefore;  // debounced jobs wait until then
+        std::optional<LockMode> lock;
+    };
+
+    /// @brief Queues a job (mutex must be held).
+    void queue(Job job);
+
+    /// @return First job, that may run now (mutex must be held).
+    [[nodiscard]] std::deque<Job>::iterator nextReadyJob(Clock::time_point now);
+
+    void run();
+
+    std::string repoPath;
+    ChangeCallback onChange;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    std::deque<Job> jobs;
+    GCancellable* cancellable{nullptr};  // of the running job
+    bool cancelledByUser{false};         // the running job was cancelled by CancelAll()
+    Clock::time_point errorShownUntil;
+    Status status;
+
+    std::thread worker;
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,261 @@
+#include "objectwalk.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+std::string ToChecksum(const ObjectId& id) {
+    std::string checksum(OSTREE_SHA256_STRING_LEN, '\0');
+    ostree_checksum_inplace_from_bytes(id.data(), checksum.data());
+    return checksum;
+}
+
+ObjectId ToObjectId(const std::string& checksum) {
+    ObjectId id{};
+    ostree_checksum_inplace_to_bytes(checksum.c_str(), id.data());
+    return id;
+}
+
+bool ReadObjectId(GVariant* checksum, ObjectId& id) {
+    const guchar* bytes = ostree_checksum_bytes_peek(checksum);
+    if (bytes == nullptr) {
+        return false;
+    }
+    std::memcpy(id.data(), bytes, id.size());
+    return true;
+}
+
+// ConcurrentObjectSet
+
+bool ConcurrentObjectSet::Insert(const ObjectId& id) {
+    Shard& s = shard(id);
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    return s.objects.insert(id).second;
+}
+
+bool ConcurrentObjectSet::Contains(const ObjectId& id) const {
+    Shard& s = shard(id);
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    return s.objects.contains(id);
+}
+
+size_t ConcurrentObjectSet::Size() const {
+    size_t size{0};
+    for (auto& s : shards) {
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        size += s.objects.size();
+    }
+    return size;
+}
+
+ConcurrentObjectSet::Shard& ConcurrentObjectSet::shard(const ObjectId& id) const {
+    // a different byte than the one used by ObjectIdHash, to keep the shards' tables balanced
+    return shards[id.back() % SHARDS];
+}
+
+// ObjectWalker
+
+struct ObjectWalker::Walk {
+    Walk(ConcurrentObjectSet& visited,
+         const Visitor& visitor,
+         const ConcurrentObjectSet* skip,
+         bool contentSizes,
+         std::stop_token stop,
+         ThreadPool& pool)
+        : visited(visited),
+          visitor(visitor),
+          skip(skip),
+          contentSizes(contentSizes),
+          stop(std::move(stop)),
+          group(pool) {}
+
+    ConcurrentObjectSet& visited;
+    const Visitor& visitor;
+    const ConcurrentObjectSet* skip;
+    bool contentSizes;
+    std::stop_token stop;
+    std::atomic<bool> failed{false};
+    // declared last: waits for all tasks, before the other members are destroyed
+    TaskGroup group;
+};
+
+ObjectWalker::ObjectWalker(std::string repoPath, ThreadPool& pool)
+    : repoPath(std::move(repoPath)), pool(pool), repos(pool.Size(), nullptr) {}
+
+ObjectWalker::~ObjectWalker() {
+    for (auto* r : repos) {
+        if (r != nullptr) {
+            g_object_unref(r);
+        }
+    }
+}
+
+bool ObjectWalker::WalkCommit(const std::string& commit,
+                              ConcurrentObjectSet& visited,
+                              const Visitor& visitor,
+                              const ConcurrentObjectSet* skip,
+                              bool contentSizes,
+                              const std::stop_token& stop) {
+    OSTREE_TUI_PROFILE_SCOPE("ObjectWalker::WalkCommit");
+    if (cancelled || stop.stop_requested()) {
+        return false;
+    }
+
+    Walk walk(visited, visitor, skip, contentSizes, stop, pool);
+    walk.group.Run([&] {
+        OstreeRepo* r = repo();
+        if (r == nullptr) {
+            return fail(walk, "could not open repository " + repoPath);
+        }
+        GError* loadError{nullptr};
+        g_autoptr(GVariant) variant = nullptr;
+        if (!ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_COMMIT, commit.c_str(), &variant,
+                                      &loadError)) {
+            fail(walk, loadError->message);
+            g_error_free(loadError);
+            return;
+        }
+        visit(walk, ToObjectId(commit), OSTREE_OBJECT_TYPE_COMMIT);
+
+        // see OSTREE_COMMIT_GVARIANT_FORMAT, (6) root dirtree & (7) root dirmeta checksum
+        g_autoptr(GVariant) treeChecksum = g_variant_get_child_value(variant, 6);
+        g_autoptr(GVariant) metaChecksum = g_variant_get_child_value(variant, 7);
+        ObjectId tree{};
+        ObjectId meta{};
+        if (!ReadObjectId(treeChecksum, tree) || !ReadObjectId(metaChecksum, meta)) {
+            return fail(walk, "invalid root tree in commit " + commit);
+        }
+        visit(walk, meta, OSTREE_OBJECT_TYPE_DIR_META);
+        walkDirtree(walk, tree);
+    });
+    walk.group.Wait();
+
+    return !walk.failed && !cancelled && !stop.stop_requested();
+}
+
+void ObjectWalker::Cancel() {
+    cancelled = true;
+}
+
+std::string ObjectWalker::GetError() const {
+    const std::lock_guard<std::mutex> lock(errorMutex);
+    return error;
+}
+
+OstreeRepo* ObjectWalker::repo() {
+    const auto worker = ThreadPool::CurrentWorker();
+    if (!worker || *worker >= repos.size()) {
+        return nullptr;
+    }
+    OstreeRepo*& r = repos[*worker];
+    if (r == nullptr) {
+        r = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, nullptr);
+    }
+    return r;
+}
+
+void ObjectWalker::walkDirtree(Walk& walk, const ObjectId& dirtree) {
+    if (cancelled || walk.failed || walk.stop.stop_requested()) {
+        return;
+    }
+    // already visited, or a subtree known to be present
+    if (!visit(walk, dirtree, OSTREE_OBJECT_TYPE_DIR_TREE)) {
+        return;
+    }
+
+    OstreeRepo* r = repo();
+    GError* loadError{nullptr};
+    g_autoptr(GVariant) variant = nullptr;
+    if (r == nullptr || !ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_DIR_TREE,
+                                                  ToChecksum(dirtree).c_str(), &variant,
+                                                  &loadError)) {
+        fail(walk, loadError != nullptr ? loadError->message : "could not open repository");
+        g_clear_error(&loadError);
+        return;
+    }
+
+    // see OSTREE_TREE_GVARIANT_FORMAT, a(say) files & a(sayay) directories
+    g_autoptr(GVariant) files = g_variant_get_child_value(variant, 0);
+    const gsize fileCount = g_variant_n_children(files);
+    for (gsize i{0}; i < fileCount; i++) {
+        g_autoptr(GVariant) file = g_variant_get_child_value(files, i);
+        g_autoptr(GVariant) checksum = g_variant_get_child_value(file, 1);
+        ObjectId id{};
+        if (ReadObjectId(checksum, id)) {
+            visit(walk, id, OSTREE_OBJECT_TYPE_FILE);
+        }
+    }
+
+    g_autoptr(GVariant) dirs = g_variant_get_child_value(variant, 1);
+    const gsize dirCount = g_variant_n_children(dirs);
+    for (gsize i{0}; i < dirCount; i++) {
+        g_autoptr(GVariant) dir = g_variant_get_child_value(dirs, i);
+        g_autoptr(GVariant) treeChecksum = g_variant_get_child_value(dir, 1);
+        g_autoptr(GVariant) metaChecksum = g_variant_get_child_value(dir, 2);
+        ObjectId tree{};
+        ObjectId meta{};
+        if (!ReadObjectId(treeChecksum, tree) || !ReadObjectId(metaChecksum, meta)) {
+            continue;
+        }
+        visit(walk, meta, OSTREE_OBJECT_TYPE_DIR_META);
+        walk.group.Run([this, &walk, tree] { walkDirtree(walk, tree); });
+    }
+}
+
+bool ObjectWalker::visit(Walk& walk, const ObjectId& id, OstreeObjectType type) {
+    if (walk.skip != nullptr && walk.skip->Contains(id)) {
+        return false;
+    }
+    if (!walk.visited.Insert(id)) {
+        return false;
+    }
+    if (walk.visitor) {
+        OSTREE_TUI_PROFILE_COUNT("walkedObjects", 1);
+        OstreeRepo* r = repo();
+        const std::string checksum = ToChecksum(id);
+        guint64 storageSize{0};
+        GError* queryError{nullptr};
+        if (r == nullptr || !ostree_repo_query_object_storage_size(r, type, checksum.c_str(),
+                                                                   &storageSize, nullptr,
+                                                                   &queryError)) {
+            fail(walk, queryError != nullptr ? queryError->message : "could not open repository");
+            g_clear_error(&queryError);
+            return true;
+        }
+        guint64 contentSize{storageSize};
+        if (walk.contentSizes && type == OSTREE_OBJECT_TYPE_FILE) {
+            // only the file header is read, the content stream is not requested
+            g_autoptr(GFileInfo) fileInfo = nullptr;
+            if (!ostree_repo_load_file(r, checksum.c_str(), nullptr, &fileInfo, nullptr, nullptr,
+                                       &queryError)) {
+                fail(walk, queryError->message);
+                g_error_free(queryError);
+                return true;
+            }
+            contentSize = static_cast<guint64>(g_file_info_get_size(fileInfo));
+        }
+        walk.visitor(id, type, storageSize, contentSize);
+    }
+    return true;
+}
+
+void ObjectWalker::fail(Walk& walk, const std::string& message) {
+    walk.failed = true;
+    const std::lock_guard<std::mutex> lock(errorMutex);
+    error = message;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,137 @@
+/*_____________________________________________________________
+ | Object Walk
+ |   Parallel traversal of all objects reachable from a commit
+ |   (commit, dirtrees, dirmetas & files), one pool task per
+ |   dirtree. Objects are deduplicated through a shared,
+ |   sharded ConcurrentObjectSet, so every object is visited
+ |   once, even if multiple trees reference it.
+ |   Every pool worker uses its own OstreeRepo handle.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <ostree.h>
+
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+/// Binary sha256 checksum of an object.
+using ObjectId = std::array<uint8_t, 32>;
+
+struct ObjectIdHash {
+    size_t operator()(const ObjectId& id) const {
+        // checksums are uniformly distributed already
+        size_t hash{0};
+        std::memcpy(&hash, id.data(), sizeof(hash));
+        return hash;
+    }
+};
+
+/// Thread safe set of objects, split into independently locked shards.
+class ConcurrentObjectSet {
+   public:
+    /// @return true, if the object was not contained yet.
+    bool Insert(const ObjectId& id);
+
+    [[nodiscard]] bool Contains(const ObjectId& id) const;
+
+    [[nodiscard]] size_t Size() const;
+
+   private:
+    static constexpr size_t SHARDS{64};
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_set<ObjectId, ObjectIdHash> objects;
+    };
+
+    [[nodiscard]] Shard& shard(const ObjectId& id) const;
+
+    mutable std::array<Shard, SHARDS> shards;
+};
+
+class ObjectWalker {
+   public:
+    /**
+     * @brief Called (concurrently, from the pool workers) for every newly visited object.
+     * The storage size is the size of the object in the repository (compressed in archive
+     * repositories), the content size the uncompressed size of a file (only queried on
+     * request, otherwise equal to the storage size).
+     */
+    using Visitor = std::function<
+        void(const ObjectId&, OstreeObjectType, uint64_t storageSize, uint64_t contentSize)>;
+
+    ObjectWalker(std::string repoPath, ThreadPool& pool);
+    ~ObjectWalker();
+    ObjectWalker(const ObjectWalker&) = delete;
+    ObjectWalker& operator=(const ObjectWalker&) = delete;
+
+    /**
+     * @brief Walks all objects reachable from a commit in parallel & blocks until done.
+     *
+     * @param commit Commit checksum to start from.
+     * @param visited Objects already visited are skipped, all newly visited ones are added.
+     * @param visitor Called for every newly visited object. Without a visitor, no storage
+     * sizes are queried (cheaper, for only collecting the object set).
+     * @param skip Optional set of objects known to be present: dirtrees contained in it are
+     * not entered (identical subtree), files & dirmetas contained in it are not visited.
+     * @param contentSizes Also query the uncompressed size of files (reads their header).
+     * @param stop Cancels only this walk (e.g. when its result is not needed anymore).
+     * @return false, if an object could not be loaded or the walk was cancelled.
+     */
+    bool WalkCommit(const std::string& commit,
+                    ConcurrentObjectSet& visited,
+                    const Visitor& visitor = nullptr,
+                    const ConcurrentObjectSet* skip = nullptr,
+                    bool contentSizes = false,
+                    const std::stop_token& stop = {});
+
+    /// @brief Cancels all running & future walks (used on shutdown).
+    void Cancel();
+
+    /// @return Error message of the last failed walk.
+    [[nodiscard]] std::string GetError() const;
+
+   private:
+    struct Walk;
+
+    /// @return OstreeRepo handle of the calling pool worker.
+    OstreeRepo* repo();
+
+    void walkDirtree(Walk& walk, const ObjectId& dirtree);
+
+    /// @brief Marks an object as visited & passes it to the visitor, if it was not visited yet.
+    bool visit(Walk& walk, const ObjectId& id, OstreeObjectType type);
+
+    void fail(Walk& walk, const std::string& message);
+
+    std::string repoPath;
+    ThreadPool& pool;
+    std::vector<OstreeRepo*> repos;  // pool worker -> repo handle, opened lazily
+    std::atomic<bool> cancelled{false};
+    mutable std::mutex errorMutex;
+    std::string error;
+};
+
+/// @return Hex string of an object id.
+[[nodiscard]] std::string ToChecksum(const ObjectId& id);
+
+/// @return Object id of a hex checksum (must be a valid sha256 checksum).
+[[nodiscard]] ObjectId ToObjectId(const std::string& checksum);
+
+/// @return false, if the variant (ay) does not hold a valid (32 byte) checksum.
+bool ReadObjectId(GVariant* checksum, ObjectId& id);
+
+}  // namespace cpplibostree
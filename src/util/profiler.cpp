@@ -0,0 +1,196 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace Profiler {
+
+namespace {
+
+/// trace events kept for WriteTrace() (~32 MiB), later scopes are only counted as dropped
+constexpr size_t MAX_TRACE_EVENTS{1'000'000};
+
+struct TraceEvent {
+    const char* name;
+    Clock::time_point start;
+    Clock::duration duration;
+    uint32_t thread;
+};
+
+struct State {
+    std::mutex mutex;
+    bool trace{false};
+    Clock::time_point traceStart{Clock::now()};
+    std::vector<PhaseStats> phases;
+    std::unordered_map<std::string_view, size_t> phaseIndex;
+    std::vector<CounterStats> counters;
+    std::unordered_map<std::string_view, size_t> counterIndex;
+    std::vector<TraceEvent> traceEvents;
+    uint64_t droppedTraceEvents{0};
+};
+
+State& state() {
+    static State instance;
+    return instance;
+}
+
+uint32_t threadId() {
+    static std::atomic<uint32_t> nextId{1};
+    thread_local const uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+/// Escapes a phase name for use as JSON string (names are literals, but stay safe).
+std::string jsonEscape(std::string_view str) {
+    std::string out;
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+}  // namespace
+
+namespace detail {
+
+void Record(const char* name, Clock::time_point start, Clock::time_point end) {
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto [it, inserted] = s.phaseIndex.try_emplace(name, s.phases.size());
+    if (inserted) {
+        s.phases.push_back({.name = name});
+    }
+    PhaseStats& phase = s.phases.at(it->second);
+    phase.calls++;
+    phase.total += duration;
+    phase.last = duration;
+    phase.loadCalls++;
+    phase.load += duration;
+
+    if (s.trace) {
+        if (s.traceEvents.size() < MAX_TRACE_EVENTS) {
+            s.traceEvents.push_back({name, start, end - start, threadId()});
+        } else {
+            s.droppedTraceEvents++;
+        }
+    }
+}
+
+}  // namespace detail
+
+void SetEnabled(bool enable, bool trace) {
+    State& s = state();
+    {
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        s.trace = enable && trace;
+    }
+    detail::enabled.store(enable, std::memory_order_relaxed);
+}
+
+void MarkLoad() {
+    if (!IsEnabled()) {
+        return;
+    }
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    for (auto& phase : s.phases) {
+        phase.loadCalls = 0;
+        phase.load = {};
+    }
+}
+
+void Count(const char* name, int64_t delta) {
+    if (!IsEnabled()) {
+        return;
+    }
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    auto [it, inserted] = s.counterIndex.try_emplace(name, s.counters.size());
+    if (inserted) {
+        s.counters.push_back({.name = name});
+    }
+    s.counters.at(it->second).value += delta;
+}
+
+std::vector<PhaseStats> GetPhases() {
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    return s.phases;
+}
+
+std::vector<CounterStats> GetCounters() {
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    return s.counters;
+}
+
+size_t GetResidentSetSize() {
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return 0;
+    }
+    long pages{0};
+    long residentPages{0};
+    const int read = std::fscanf(statm, "%ld %ld", &pages, &residentPages);
+    std::fclose(statm);
+    if (read != 2) {
+        return 0;
+    }
+    return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool WriteTrace(const std::string& file) {
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    State& s = state();
+    const std::lock_guard<std::mutex> lock(s.mutex);
+    const auto toMicroseconds = [](Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    };
+
+    out << R"({"displayTimeUnit": "ms", "traceEvents": [)" << "\n";
+    bool first{true};
+    for (const auto& event : s.traceEvents) {
+        out << (first ? "" : ",\n") << R"({"name": ")" << jsonEscape(event.name)
+            << R"(", "cat": "ostree-tui", "ph": "X", "pid": 1, "tid": )" << event.thread
+            << R"(, "ts": )" << toMicroseconds(event.start - s.traceStart)
+            << R"(, "dur": )" << toMicroseconds(event.duration) << "}";
+        first = false;
+    }
+    // final counter values as one counter event each
+    const double end = toMicroseconds(Clock::now() - s.traceStart);
+    for (const auto& counter : s.counters) {
+        out << (first ? "" : ",\n") << R"({"name": ")" << jsonEscape(counter.name)
+            << R"(", "ph": "C", "pid": 1, "ts": )" << end << R"(, "args": {"value": )"
+            << counter.value << "}}";
+        first = false;
+    }
+    if (s.droppedTraceEvents > 0) {
+        out << (first ? "" : ",\n") << R"({"name": "dropped trace events", "ph": "C", "pid": 1, )"
+            << R"("ts": )" << end << R"(, "args": {"value": )" << s.droppedTraceEvents << "}}";
+    }
+    out << "\n]}\n";
+
+    return out.good();
+}
+
+}  // namespace Profiler
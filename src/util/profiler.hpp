@@ -0,0 +1,123 @@
+/*_____________________________________________________________
+ | Profiler
+ |   Lightweight phase timing & counters, used by the
+ |   performance overlay & the --profile trace dump.
+ |   - disabled by default, a disabled scope costs one relaxed
+ |     atomic load (compiled out with OSTREE_TUI_NO_PROFILING)
+ |   - tracing additionally records every scope as a Chrome
+ |     trace event (chrome://tracing, ui.perfetto.dev), up to
+ |     a fixed number of events, further ones are only counted
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Profiler {
+
+using Clock = std::chrono::steady_clock;
+
+/// Aggregated timings of one phase (e.g. "parseCommit").
+struct PhaseStats {
+    std::string name;
+    uint64_t calls{0};
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds last{0};
+    // accumulated since the last MarkLoad()
+    uint64_t loadCalls{0};
+    std::chrono::nanoseconds load{0};
+};
+
+/// Named counter (e.g. "signatures").
+struct CounterStats {
+    std::string name;
+    int64_t value{0};
+};
+
+namespace detail {
+inline std::atomic<bool> enabled{false};
+void Record(const char* name, Clock::time_point start, Clock::time_point end);
+}  // namespace detail
+
+/**
+ * @brief Enables or disables the instrumentation.
+ *
+ * @param enable Collect phase timings & counters.
+ * @param trace Additionally record every scope as trace event, see WriteTrace().
+ */
+void SetEnabled(bool enable, bool trace = false);
+
+/// @return true, if timings are currently collected.
+[[nodiscard]] inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/// @brief Starts a new "last load" breakdown, called at the begin of each repository load
+/// (no-op if disabled).
+void MarkLoad();
+
+/// @brief Adds delta to a named counter (no-op if disabled).
+void Count(const char* name, int64_t delta = 1);
+
+/// @return Copy of all phase timings, in order of first occurrence.
+[[nodiscard]] std::vector<PhaseStats> GetPhases();
+
+/// @return Copy of all counters, in order of first occurrence.
+[[nodiscard]] std::vector<CounterStats> GetCounters();
+
+/// @return Resident set size of the process in bytes, 0 if unavailable.
+[[nodiscard]] size_t GetResidentSetSize();
+
+/**
+ * @brief Writes all recorded trace events in the Chrome trace-event JSON format.
+ *
+ * @param file Path of the trace file.
+ * @return true on success.
+ */
+bool WriteTrace(const std::string& file);
+
+/// Measures the lifetime of the scope as phase `name`. `name` has to be a string literal.
+class ScopedTimer {
+   public:
+    explicit ScopedTimer(const char* name) : name(name) {
+        if (IsEnabled()) {
+            start = Clock::now();
+        }
+    }
+    ~ScopedTimer() {
+        if (start != Clock::time_point{}) {
+            detail::Record(name, start, Clock::now());
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    const char* name;
+    Clock::time_point start{};
+};
+
+}  // namespace Profiler
+
+#define OSTREE_TUI_PROFILE_CONCAT_INNER(a, b) a##b
+#define OSTREE_TUI_PROFILE_CONCAT(a, b) OSTREE_TUI_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef OSTREE_TUI_NO_PROFILING
+#define OSTREE_TUI_PROFILE_SCOPE(name)
+#define OSTREE_TUI_PROFILE_COUNT(name, delta)
+#else
+/// Times the enclosing scope as phase `name`.
+#define OSTREE_TUI_PROFILE_SCOPE(name) \
+    const Profiler::ScopedTimer OSTREE_TUI_PROFILE_CONCAT(profilerScope, __LINE__)(name)
+/// Adds `delta` to counter `name`.
+#define OSTREE_TUI_PROFILE_COUNT(name, delta) \
+    do {                                      \
+        if (Profiler::IsEnabled()) {          \
+            Profiler::Count(name, delta);     \
+        }                                     \
+    } while (false)
+#endif
@@ -0,0 +1,247 @@
+#include "pruneplan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+#include "reflist.hpp"
+
+namespace cpplibostree {
+
+bool TakeRepoSnapshot(OstreeRepo* repo,
+                      RepoSnapshot& snapshot,
+                      GCancellable* cancellable,
+                      GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("TakeRepoSnapshot");
+    if (!ListRefs(repo, snapshot.refs, error)) {
+        return false;
+    }
+    g_autoptr(GHashTable) objects{nullptr};
+    if (!ostree_repo_list_commit_objects_starting_with(repo, "", &objects, cancellable, error)) {
+        return false;
+    }
+    snapshot.commits.clear();
+    snapshot.commits.reserve(g_hash_table_size(objects));
+    GHashTableIter iter;
+    gpointer key{nullptr};
+    g_hash_table_iter_init(&iter, objects);
+    while (g_hash_table_iter_next(&iter, &key, nullptr)) {
+        const char* checksum{nullptr};
+        OstreeObjectType type{OSTREE_OBJECT_TYPE_COMMIT};
+        ostree_object_name_deserialize(static_cast<GVariant*>(key), &checksum, &type);
+        snapshot.commits.emplace_back(checksum);
+    }
+    std::sort(snapshot.commits.begin(), snapshot.commits.end());
+    return true;
+}
+
+PrunePlan PlanCommitDrop(const OSTreeRepo& repo, const Commit& commit) {
+    OSTREE_TUI_PROFILE_SCOPE("PlanCommitDrop");
+    const CommitList& commits = repo.GetCommitList();
+    PrunePlan plan;
+    plan.commit = commit.hash;
+
+    // refs on the commit move to its parent, or get deleted without one
+    const std::string parent = commits.contains(commit.parent) ? commit.parent : "";
+    std::vector<std::string> heads;
+    for (const auto& [ref, head] : repo.GetRefs()) {
+        if (head == commit.hash) {
+            plan.refResets.push_back({ref, head, parent});
+        }
+        heads.push_back(head == commit.hash ? parent : head);
+    }
+
+    // everything still reachable from a ref, the dropped commit cuts the history behind it
+    std::unordered_set<std::string> reachable;
+    for (const auto& head : heads) {
+        auto it = commits.find(head);
+        while (it != commits.end() && it->first != commit.hash &&
+               reachable.insert(it->first).second) {
+            it = commits.find(it->second.parent);
+        }
+    }
+
+    // the commit & its history, up to the first commit, that stays reachable
+    std::unordered_set<std::string> dropped;
+    auto it = commits.find(commit.hash);
+    while (it != commits.end() && !reachable.contains(it->first) &&
+           dropped.insert(it->first).second) {
+        plan.commits.push_back(it->first);
+        it = commits.find(it->second.parent);
+    }
+
+    return plan;
+}
+
+PrunePlanner::PrunePlanner(const std::string& repoPath, ThreadPool& pool, ResultCallback onResult)
+    : repoPath(repoPath), onResult(std::move(onResult)), walker(repoPath, pool) {
+    worker = std::thread([this] { run(); });
+}
+
+PrunePlanner::~PrunePlanner() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    walker.Cancel();
+    wakeup.notify_one();
+    worker.join();
+}
+
+std::shared_ptr<const PrunePlan> PrunePlanner::Get(const OSTreeRepo& repo, const Commit& commit) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (plan && plan->commit == commit.hash) {
+            return plan;
+        }
+        if (planning == commit.hash || failed == commit.hash) {
+            return nullptr;
+        }
+    }
+    PrunePlan request = PlanCommitDrop(repo, commit);
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        planning = commit.hash;
+        pending = std::move(request);
+    }
+    wakeup.notify_one();
+    return nullptr;
+}
+
+bool PrunePlanner::Failed(const std::string& commit) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return failed == commit;
+}
+
+void PrunePlanner::Clear() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+    pending.reset();
+    planning.clear();
+    failed.clear();
+    plan.reset();
+}
+
+bool PrunePlanner::superseded(uint64_t requestGeneration) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return stop || requestGeneration != generation;
+}
+
+void PrunePlanner::run() {
+    while (true) {
+        PrunePlan request;
+        uint64_t requestGeneration{0};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || pending.has_value(); });
+            if (stop) {
+                return;
+            }
+            request = std::move(*pending);
+            pending.reset();
+            requestGeneration = generation;
+        }
+
+        const bool complete = markAndSweep(request, requestGeneration);
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                return;
+            }
+            if (requestGeneration != generation) {
+                continue;
+            }
+            planning.clear();
+            if (complete) {
+                plan = std::make_shared<const PrunePlan>(std::move(request));
+            } else {
+                failed = request.commit;
+            }
+        }
+        onResult();
+    }
+}
+
+bool PrunePlanner::markAndSweep(PrunePlan& request, uint64_t requestGeneration) {
+    OSTREE_TUI_PROFILE_SCOPE("PrunePlanner::markAndSweep");
+
+    g_autoptr(GError) error{nullptr};
+    g_autoptr(OstreeRepo) repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+    if (repo == nullptr || !TakeRepoSnapshot(repo, request.snapshot, nullptr, &error)) {
+        return false;
+    }
+
+    // the commit level plan is based on the loaded refs, every ref on a dropped commit has to
+    // be reset as planned
+    const std::unordered_set<std::string> dropped(request.commits.begin(), request.commits.end());
+    size_t resets{0};
+    for (const auto& [ref, head] : request.snapshot.refs) {
+        if (!dropped.contains(head)) {
+            continue;
+        }
+        const auto reset =
+            std::find_if(request.refResets.begin(), request.refResets.end(),
+                         [&](const RefReset& planned) { return planned.ref == ref; });
+        if (reset == request.refResets.end() || reset->oldHead != head) {
+            return false;
+        }
+        resets++;
+    }
+    if (resets != request.refResets.size()) {
+        return false;
+    }
+
+    // mark: objects of all remaining commit objects (not only those reachable from refs, like
+    // `ostree prune` without --refs-only), subtrees shared between them are entered once
+    ConcurrentObjectSet marked;
+    for (const auto& root : request.snapshot.commits) {
+        if (dropped.contains(root)) {
+            continue;
+        }
+        if (superseded(requestGeneration) || !walker.WalkCommit(root, marked)) {
+            return false;
+        }
+    }
+
+    // sweep: objects of the dropped commits, marked subtrees are not entered
+    std::mutex objectsMutex;
+    std::atomic<uint64_t> bytes{0};
+    ConcurrentObjectSet swept;
+    for (const auto& commit : request.commits) {
+        if (superseded(requestGeneration) ||
+            !walker.WalkCommit(
+                commit, swept,
+                [&](const ObjectId& id, OstreeObjectType type, uint64_t storageSize,
+                    uint64_t /*contentSize*/) {
+                    bytes.fetch_add(storageSize, std::memory_order_relaxed);
+                    const std::lock_guard<std::mutex> lock(objectsMutex);
+                    request.objects.push_back({id, type});
+                },
+                &marked)) {
+            return false;
+        }
+    }
+    request.bytes = bytes;
+
+    // commits first, an interrupted deletion never leaves a commit with missing objects
+    std::stable_partition(request.objects.begin(), request.objects.end(),
+                          [](const PruneObject& object) {
+                              return object.type == OSTREE_OBJECT_TYPE_COMMIT;
+                          });
+    return true;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,157 @@
+/*_____________________________________________________________
+ | Prune Plan
+ |   Dry run of dropping a commit, before anything is deleted:
+ |   - refs on the commit move to its parent
+ |   - commits, that become unreachable by that (the commit &
+ |     its history, up to the first commit still reachable)
+ |   - objects only referenced by these commits & their size
+ |   The objects are found by a parallel mark phase over all
+ |   remaining commit objects (like `ostree prune` without
+ |   --refs-only), followed by a sweep over the dropped ones.
+ |   The finished plan drives the actual deletion (see
+ |   ExecutePrunePlan()), so nothing is marked twice. It is
+ |   only executed on the refs & commits it was made for.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ostree.h>
+
+#include "cpplibostree.hpp"
+#include "objectwalk.hpp"
+#include "reflist.hpp"
+#include "threadpool.hpp"
+
+namespace cpplibostree {
+
+struct RefReset {
+    std::string ref;
+    std::string oldHead;  // the plan is rejected, if the ref moved in the meantime
+    std::string newHead;  // empty deletes the ref
+};
+
+struct PruneObject {
+    ObjectId id{};
+    OstreeObjectType type{OSTREE_OBJECT_TYPE_FILE};
+};
+
+/// State of a repository, that a plan was made for.
+struct RepoSnapshot {
+    RefList refs;                      // all refs, incl. remote ones
+    std::vector<std::string> commits;  // all commit objects, sorted
+
+    bool operator==(const RepoSnapshot&) const = default;
+};
+
+/**
+ * @brief Lists all refs & commit objects of a repository.
+ *
+ * @param repo Repository handle.
+ * @param snapshot Filled with the refs & commits.
+ * @param cancellable Cancellable.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool TakeRepoSnapshot(OstreeRepo* repo,
+                      RepoSnapshot& snapshot,
+                      GCancellable* cancellable,
+                      GError** error);
+
+struct PrunePlan {
+    std::string commit;                // commit to drop
+    std::vector<RefReset> refResets;   // refs pointing to the commit
+    std::vector<std::string> commits;  // commits becoming unreachable, incl. `commit`
+    // filled by the PrunePlanner
+    RepoSnapshot snapshot;             // all other commits are roots of the mark phase
+    std::vector<PruneObject> objects;  // only referenced by `commits`, commit objects first
+    uint64_t bytes{0};                 // storage size of the objects
+};
+
+/**
+ * @brief Plans dropping a commit on the commit level (refs & commits). Other commits, that are
+ * not reachable from any ref (see UNREACHABLE_BRANCH, or not even loaded), stay & keep their
+ * objects.
+ *
+ * @param repo Repository the commit belongs to.
+ * @param commit Commit to drop.
+ * @return Plan, without objects.
+ */
+[[nodiscard]] PrunePlan PlanCommitDrop(const OSTreeRepo& repo, const Commit& commit);
+
+/**
+ * @brief Completes PrunePlans with their objects on a background thread. Only one commit is
+ * planned at a time, a request for another commit supersedes the running one.
+ */
+class PrunePlanner {
+   public:
+    /// Called from the worker thread, once a plan finished (or failed).
+    using ResultCallback = std::function<void()>;
+
+    /**
+     * @param repoPath Path of the repository (every pool worker opens its own handle).
+     * @param pool Pool to run the object traversals on.
+     * @param onResult Result callback.
+     */
+    PrunePlanner(const std::string& repoPath, ThreadPool& pool, ResultCallback onResult);
+    ~PrunePlanner();
+    PrunePlanner(const PrunePlanner&) = delete;
+    PrunePlanner& operator=(const PrunePlanner&) = delete;
+
+    /**
+     * @brief Gets the finished plan to drop a commit, or queues its calculation.
+     *
+     * @param repo Repository the commit belongs to.
+     * @param commit Commit to drop.
+     * @return Plan, nullptr while it is being calculated (or if the calculation failed).
+     */
+    [[nodiscard]] std::shared_ptr<const PrunePlan> Get(const OSTreeRepo& repo,
+                                                       const Commit& commit);
+
+    /// @return true, if the plan to drop the commit could not be calculated.
+    [[nodiscard]] bool Failed(const std::string& commit);
+
+    /// @brief Drops all plans, they are outdated after the repository changed.
+    void Clear();
+
+   private:
+    void run();
+
+    /**
+     * @brief Checks the plan against the refs on disk (the loaded ones may be outdated) &
+     * completes it with the snapshot & its objects.
+     *
+     * @return false, if the refs do not match, an object walk failed or the plan was
+     * superseded.
+     */
+    bool markAndSweep(PrunePlan& request, uint64_t requestGeneration);
+
+    /// @return true, if the plan of this generation is not needed anymore.
+    [[nodiscard]] bool superseded(uint64_t requestGeneration);
+
+    std::string repoPath;
+    ResultCallback onResult;
+    ObjectWalker walker;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    uint64_t generation{0};            // increased by every new request & Clear()
+    std::optional<PrunePlan> pending;  // waiting for the worker
+    std::string planning;              // commit of the pending, or running plan
+    std::string failed;                // commit of the last failed plan
+    std::shared_ptr<const PrunePlan> plan;
+
+    std::thread worker;
+};
+
+}  // namespace cpplibostree
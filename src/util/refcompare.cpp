@@ -0,0 +1,59 @@
+#include "refcompare.hpp"
+
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cpplibostree.hpp"
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+RefComparison CompareHistories(std::span<const Commit* const> a,
+                               std::span<const Commit* const> b) {
+    OSTREE_TUI_PROFILE_SCOPE("CompareHistories");
+    RefComparison result;
+
+    // content checksum -> newest commit with this content, hashes of all commits
+    auto index = [](std::span<const Commit* const> history) {
+        std::unordered_map<std::string_view, const Commit*> contents;
+        std::unordered_set<std::string_view> hashes;
+        contents.reserve(history.size());
+        hashes.reserve(history.size());
+        for (const auto* commit : history) {
+            contents.try_emplace(commit->contentChecksum, commit);
+            hashes.insert(commit->hash);
+        }
+        return std::pair{std::move(contents), std::move(hashes)};
+    };
+    const auto [contentsA, hashesA] = index(a);
+    const auto [contentsB, hashesB] = index(b);
+
+    for (const auto* commit : a) {
+        const auto match = contentsB.find(commit->contentChecksum);
+        if (match == contentsB.end()) {
+            result.onlyA.push_back(commit);
+        } else {
+            result.both.emplace_back(commit, match->second);
+        }
+        if (hashesB.contains(commit->hash)) {
+            result.hashBoth++;
+        } else {
+            result.hashOnlyA++;
+        }
+    }
+    for (const auto* commit : b) {
+        if (!contentsA.contains(commit->contentChecksum)) {
+            result.onlyB.push_back(commit);
+        }
+        if (!hashesA.contains(commit->hash)) {
+            result.hashOnlyB++;
+        }
+    }
+
+    return result;
+}
+
+}  // namespace cpplibostree
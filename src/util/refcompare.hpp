@@ -0,0 +1,44 @@
+/*_____________________________________________________________
+ | Ref Compare
+ |   Compares the histories of two refs (possibly of different
+ |   repositories, e.g. staging against a production mirror):
+ |   - by content checksum: which builds of A never reached B
+ |     (promotions create new commits with the same content)
+ |   - by commit hash
+ |   Both are hash-set lookups, linear in the commit counts.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+struct RefComparison {
+    // partitions by content checksum, each in history order (newest first)
+    std::vector<const Commit*> onlyA;  // content of A, that is not on B
+    std::vector<const Commit*> onlyB;  // content of B, that is not on A
+    std::vector<std::pair<const Commit*, const Commit*>> both;  // commit of A & of B, same content
+
+    // partition sizes by commit hash
+    size_t hashOnlyA{0};
+    size_t hashOnlyB{0};
+    size_t hashBoth{0};
+};
+
+/**
+ * @brief Compares two commit histories, see OSTreeRepo::GetBranchHistory().
+ *
+ * @param a History of ref A.
+ * @param b History of ref B.
+ * @return Partitions by content checksum & by commit hash.
+ */
+[[nodiscard]] RefComparison CompareHistories(std::span<const Commit* const> a,
+                                             std::span<const Commit* const> b);
+
+}  // namespace cpplibostree
@@ -0,0 +1,120 @@
+#include "reflist.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+bool ListRefs(OstreeRepo* repo, RefList& refs, GError** error, bool localOnly) {
+    OSTREE_TUI_PROFILE_SCOPE("listRefs");
+    refs.clear();
+
+    const auto flags = localOnly ? static_cast<OstreeRepoListRefsExtFlags>(
+                                       OSTREE_REPO_LIST_REFS_EXT_EXCLUDE_REMOTES |
+                                       OSTREE_REPO_LIST_REFS_EXT_EXCLUDE_MIRRORS)
+                                 : OSTREE_REPO_LIST_REFS_EXT_NONE;
+    GHashTable* refTable{nullptr};
+    if (!ostree_repo_list_refs_ext(repo, nullptr, &refTable, flags, nullptr, error)) {
+        return false;
+    }
+
+    refs.reserve(g_hash_table_size(refTable));
+    GHashTableIter iter;
+    gpointer ref{nullptr};
+    gpointer checksum{nullptr};
+    g_hash_table_iter_init(&iter, refTable);
+    while (g_hash_table_iter_next(&iter, &ref, &checksum)) {
+        refs.emplace_back(static_cast<const char*>(ref), static_cast<const char*>(checksum));
+    }
+    g_hash_table_unref(refTable);
+
+    std::sort(refs.begin(), refs.end());
+    return true;
+}
+
+bool MergeRemoteRefs(OstreeRepo* repo, const std::string& repoPath, RefList& refs, GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("mergeRemoteRefs");
+    namespace fs = std::filesystem;
+
+    // no remote was pulled from
+    std::error_code ec;
+    if (fs::is_empty(fs::path(repoPath) / "refs" / "remotes", ec) || ec) {
+        return true;
+    }
+    RefList all;
+    if (!ListRefs(repo, all, error)) {
+        return false;
+    }
+    // local ref names can't contain ':'
+    for (auto& entry : all) {
+        if (entry.first.find(':') != std::string::npos) {
+            refs.push_back(std::move(entry));
+        }
+    }
+    std::sort(refs.begin(), refs.end());
+    return true;
+}
+
+std::optional<RefList> ReadSummaryRefs(const std::string& repoPath) {
+    OSTREE_TUI_PROFILE_SCOPE("readSummaryRefs");
+    namespace fs = std::filesystem;
+
+    // stale, if a ref was updated after the summary was written
+    const fs::path summaryPath = fs::path(repoPath) / "summary";
+    std::error_code ec;
+    const auto summaryTime = fs::last_write_time(summaryPath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    const auto headsTime = fs::last_write_time(fs::path(repoPath) / "refs" / "heads", ec);
+    if (ec || headsTime > summaryTime) {
+        return std::nullopt;
+    }
+
+    // map the summary, the variant is read in place
+    GError* error{nullptr};
+    GMappedFile* mappedFile = g_mapped_file_new(summaryPath.c_str(), FALSE, &error);
+    if (mappedFile == nullptr) {
+        g_error_free(error);
+        return std::nullopt;
+    }
+    g_autoptr(GBytes) bytes = g_mapped_file_get_bytes(mappedFile);
+    g_mapped_file_unref(mappedFile);
+    g_autoptr(GVariant) summary =
+        g_variant_ref_sink(g_variant_new_from_bytes(OSTREE_SUMMARY_GVARIANT_FORMAT, bytes, FALSE));
+
+    // see OSTREE_SUMMARY_GVARIANT_STRING, a(s(taya{sv})) refs
+    g_autoptr(GVariant) refVariants = g_variant_get_child_value(summary, 0);
+    const gsize refCount = g_variant_n_children(refVariants);
+    RefList refs;
+    refs.reserve(refCount);
+    char checksum[OSTREE_SHA256_STRING_LEN + 1];
+    for (gsize i{0}; i < refCount; i++) {
+        g_autoptr(GVariant) refVariant = g_variant_get_child_value(refVariants, i);
+        const char* ref{nullptr};
+        g_variant_get_child(refVariant, 0, "&s", &ref);
+        g_autoptr(GVariant) target = g_variant_get_child_value(refVariant, 1);
+        g_autoptr(GVariant) checksumBytes = g_variant_get_child_value(target, 1);
+        const guchar* checksumData = ostree_checksum_bytes_peek(checksumBytes);
+        if (checksumData == nullptr) {
+            return std::nullopt;
+        }
+        ostree_checksum_inplace_from_bytes(checksumData, checksum);
+        refs.emplace_back(ref, checksum);
+    }
+
+    // written sorted by libostree, but the file is not trusted
+    std::sort(refs.begin(), refs.end());
+    return refs;
+}
+
+}  // namespace cpplibostree
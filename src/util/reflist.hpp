@@ -0,0 +1,57 @@
+/*_____________________________________________________________
+ | Ref List
+ |   Lists refs together with the commit they point to, either
+ |   - from the refs directories (ostree_repo_list_refs_ext), or
+ |   - from the repository summary, which is memory-mapped and
+ |     read in place. This avoids scanning the refs directories
+ |     at startup, but only covers local refs & may be stale, so
+ |     it should be verified against a directory scan later.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ostree.h>
+
+namespace cpplibostree {
+
+/// ref -> commit checksum, sorted by ref
+using RefList = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Lists all refs (local & remote ones as `remote:ref`) of a repository.
+ *
+ * @param repo Repository handle.
+ * @param refs Filled with all refs, sorted by name.
+ * @param error Set on failure.
+ * @param localOnly Only list the local refs (`refs/heads`), as the summary does.
+ * @return true on success
+ */
+bool ListRefs(OstreeRepo* repo, RefList& refs, GError** error, bool localOnly = false);
+
+/**
+ * @brief Adds the remote refs (`remote:ref`) to the local refs read from the summary, which
+ * doesn't list them. Only scans the refs directories, if `refs/remotes` isn't empty.
+ *
+ * @param repo Repository handle.
+ * @param repoPath Path of the repository.
+ * @param refs Local refs, the remote refs are merged in (sorted by name).
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool MergeRemoteRefs(OstreeRepo* repo, const std::string& repoPath, RefList& refs, GError** error);
+
+/**
+ * @brief Reads the local refs from the summary file of a repository, if it is not older than
+ * `refs/heads` (a cheap staleness check, that misses updates of nested refs).
+ *
+ * @param repoPath Path of the repository.
+ * @return Refs sorted by name, nullopt if there is no usable summary.
+ */
+[[nodiscard]] std::optional<RefList> ReadSummaryRefs(const std::string& repoPath);
+
+}  // namespace cpplibostree
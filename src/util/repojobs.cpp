@@ -0,0 +1,369 @@
+#include "repojobs.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+#include "pruneplan.hpp"
+#include "reflist.hpp"
+#include "repolock.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+/// @return remote (empty for local refs) & ref name, remote refs are listed as `remote:ref`
+std::pair<std::string, std::string> splitRef(const std::string& ref) {
+    const size_t separator = ref.find(':');
+    if (separator == std::string::npos) {
+        return {"", ref};
+    }
+    return {ref.substr(0, separator), ref.substr(separator + 1)};
+}
+
+/// @brief Writes the promoted commit & moves the ref, inside the prepared transaction.
+bool promoteInTransaction(OstreeRepo* repo,
+                          GFile* root,
+                          const char* parent,
+                          const std::string& ref,
+                          const char* subject,
+                          GVariant* metadata,
+                          std::string& newCommit,
+                          GCancellable* cancellable,
+                          GError** error) {
+    g_autofree char* checksum{nullptr};
+    if (!ostree_repo_write_commit(repo, parent, subject, nullptr, metadata, OSTREE_REPO_FILE(root),
+                                  &checksum, cancellable, error)) {
+        return false;
+    }
+    const auto [remote, name] = splitRef(ref);
+    ostree_repo_transaction_set_ref(repo, remote.empty() ? nullptr : remote.c_str(), name.c_str(),
+                                    checksum);
+    if (!ostree_repo_commit_transaction(repo, nullptr, cancellable, error)) {
+        return false;
+    }
+    newCommit = checksum;
+    return true;
+}
+
+}  // namespace
+
+bool GenerateStaticDelta(OstreeRepo* repo,
+                         const std::string& from,
+                         const std::string& to,
+                         GCancellable* cancellable,
+                         GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("GenerateStaticDelta");
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::SHARED, LOCK_TIMEOUT, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    g_autofree char* fromChecksum{nullptr};
+    g_autofree char* toChecksum{nullptr};
+    if ((!from.empty() &&
+         !ostree_repo_resolve_rev(repo, from.c_str(), FALSE, &fromChecksum, error)) ||
+        !ostree_repo_resolve_rev(repo, to.c_str(), FALSE, &toChecksum, error)) {
+        return false;
+    }
+    if (fromChecksum != nullptr && g_str_equal(fromChecksum, toChecksum)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                    "Delta from %s to itself", toChecksum);
+        return false;
+    }
+
+    // default parameters of `ostree static-delta generate`
+    g_autoptr(GVariantBuilder) parameters = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+    g_autoptr(GVariant) parameterVariant =
+        g_variant_ref_sink(g_variant_builder_end(parameters));
+
+    return ostree_repo_static_delta_generate(repo, OSTREE_STATIC_DELTA_GENERATE_OPT_MAJOR,
+                                             fromChecksum, toChecksum, nullptr, parameterVariant,
+                                             cancellable, error);
+}
+
+bool RegenerateSummary(OstreeRepo* repo,
+                       const std::vector<std::string>& keyIds,
+                       const std::string& gpgHomedir,
+                       GCancellable* cancellable,
+                       GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("RegenerateSummary");
+    // the summary lists the refs, none may move meanwhile
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::EXCLUSIVE, LOCK_TIMEOUT, nullptr, cancellable, error) ||
+        !ostree_repo_regenerate_summary(repo, nullptr, cancellable, error)) {
+        return false;
+    }
+    if (keyIds.empty()) {
+        return true;
+    }
+
+    // null terminated key list
+    std::vector<const char*> keys;
+    keys.reserve(keyIds.size() + 1);
+    for (const auto& keyId : keyIds) {
+        keys.push_back(keyId.c_str());
+    }
+    keys.push_back(nullptr);
+    return ostree_repo_add_gpg_signature_summary(repo, keys.data(),
+                                                 gpgHomedir.empty() ? nullptr : gpgHomedir.c_str(),
+                                                 cancellable, error);
+}
+
+bool PromoteCommit(OstreeRepo* repo,
+                   const std::string& commit,
+                   const std::string& ref,
+                   const std::vector<std::string>& addMetadataStrings,
+                   const std::string& subject,
+                   bool keepMetadata,
+                   std::string& newCommit,
+                   GCancellable* cancellable,
+                   GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("PromoteCommit");
+    // readers see the old or the new head, nothing in between
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::EXCLUSIVE, LOCK_TIMEOUT, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    g_autofree char* checksum{nullptr};
+    g_autofree char* parent{nullptr};
+    g_autoptr(GVariant) variant = nullptr;
+    g_autoptr(GFile) root = nullptr;
+    if (!ostree_repo_resolve_rev(repo, commit.c_str(), FALSE, &checksum, error) ||
+        !ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, &variant, error) ||
+        !ostree_repo_read_commit(repo, checksum, &root, nullptr, cancellable, error) ||
+        !ostree_repo_resolve_rev(repo, ref.c_str(), TRUE, &parent, error)) {
+        return false;
+    }
+
+    // see OSTREE_COMMIT_GVARIANT_FORMAT, (0) metadata & (3) subject
+    g_autoptr(GVariant) oldMetadata = g_variant_get_child_value(variant, 0);
+    const char* oldSubject{nullptr};
+    g_variant_get_child(variant, 3, "&s", &oldSubject);
+
+    g_auto(GVariantDict) metadata;
+    g_variant_dict_init(&metadata, keepMetadata ? oldMetadata : nullptr);
+    // bound to the new branch, like the commits of `ostree commit`
+    const std::string refName = splitRef(ref).second;
+    const char* bindings[] = {refName.c_str(), nullptr};
+    g_variant_dict_insert_value(&metadata, OSTREE_COMMIT_META_KEY_REF_BINDING,
+                                g_variant_new_strv(bindings, -1));
+    g_variant_dict_remove(&metadata, OSTREE_COMMIT_META_KEY_COLLECTION_BINDING);
+    if (const char* collectionId = ostree_repo_get_collection_id(repo)) {
+        g_variant_dict_insert_value(&metadata, OSTREE_COMMIT_META_KEY_COLLECTION_BINDING,
+                                    g_variant_new_string(collectionId));
+    }
+    for (const auto& keyValue : addMetadataStrings) {
+        const size_t separator = keyValue.find('=');
+        if (separator == std::string::npos) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                        "Missing '=' in KEY=VALUE metadata %s", keyValue.c_str());
+            return false;
+        }
+        g_variant_dict_insert_value(&metadata, keyValue.substr(0, separator).c_str(),
+                                    g_variant_new_string(keyValue.c_str() + separator + 1));
+    }
+    g_autoptr(GVariant) metadataVariant = g_variant_ref_sink(g_variant_dict_end(&metadata));
+
+    if (!ostree_repo_prepare_transaction(repo, nullptr, cancellable, error)) {
+        return false;
+    }
+    if (!promoteInTransaction(repo, root, parent, ref,
+                              subject.empty() ? oldSubject : subject.c_str(), metadataVariant,
+                              newCommit, cancellable, error)) {
+        ostree_repo_abort_transaction(repo, nullptr, nullptr);
+        return false;
+    }
+    return true;
+}
+
+bool DropCommit(OstreeRepo* repo,
+                const std::string& commit,
+                const std::string& branch,
+                GCancellable* cancellable,
+                GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("DropCommit");
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::EXCLUSIVE, LOCK_TIMEOUT, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    // reset the branch to the parent, if the commit is its head
+    if (!branch.empty()) {
+        g_autofree char* head{nullptr};
+        if (!ostree_repo_resolve_rev(repo, branch.c_str(), TRUE, &head, error)) {
+            return false;
+        }
+        if (head != nullptr && commit == head) {
+            g_autoptr(GVariant) variant = nullptr;
+            if (!ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, head, &variant,
+                                          error)) {
+                return false;
+            }
+            // no parent -> the ref is deleted
+            g_autofree char* parent = ostree_commit_get_parent(variant);
+            const auto [remote, ref] = splitRef(branch);
+            if (!ostree_repo_set_ref_immediate(repo, remote.empty() ? nullptr : remote.c_str(),
+                                               ref.c_str(), parent, cancellable, error)) {
+                return false;
+            }
+        }
+    }
+
+    // like `ostree prune --delete-commit`, referenced commits are kept
+    RefList refs;
+    if (!ListRefs(repo, refs, error)) {
+        return false;
+    }
+    for (const auto& [ref, checksum] : refs) {
+        if (checksum == commit) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Commit %s is referenced by %s",
+                        commit.c_str(), ref.c_str());
+            return false;
+        }
+    }
+    gint objectsTotal{0};
+    gint objectsPruned{0};
+    guint64 prunedSize{0};
+    if (!ostree_repo_delete_object(repo, OSTREE_OBJECT_TYPE_COMMIT, commit.c_str(), cancellable,
+                                   error) ||
+        !ostree_repo_prune(repo, OSTREE_REPO_PRUNE_FLAGS_NONE, -1, &objectsTotal, &objectsPruned,
+                           &prunedSize, cancellable, error)) {
+        return false;
+    }
+    OSTREE_TUI_PROFILE_COUNT("prunedObjects", static_cast<int64_t>(objectsPruned));
+    return ostree_repo_prune_static_deltas(repo, nullptr, cancellable, error);
+}
+
+bool ExecutePrunePlan(OstreeRepo* repo,
+                      const PrunePlan& plan,
+                      GCancellable* cancellable,
+                      GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("ExecutePrunePlan");
+    // no ref may move between the check & the deletion
+    RepoLock lock;
+    if (!lock.Acquire(repo, LockMode::EXCLUSIVE, LOCK_TIMEOUT, nullptr, cancellable, error)) {
+        return false;
+    }
+
+    // the plan is only valid for the refs & commits it was made for, a commit written since
+    // (pushed, imported) may share objects with the dropped ones
+    RepoSnapshot current;
+    if (!TakeRepoSnapshot(repo, current, cancellable, error)) {
+        return false;
+    }
+    if (current != plan.snapshot) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                    "Repository changed since the drop was planned, try again");
+        return false;
+    }
+    for (const auto& reset : plan.refResets) {
+        const auto [remote, ref] = splitRef(reset.ref);
+        if (!ostree_repo_set_ref_immediate(repo, remote.empty() ? nullptr : remote.c_str(),
+                                           ref.c_str(),
+                                           reset.newHead.empty() ? nullptr : reset.newHead.c_str(),
+                                           cancellable, error)) {
+            return false;
+        }
+    }
+
+    // commit objects come first in the plan
+    for (const auto& object : plan.objects) {
+        if (!ostree_repo_delete_object(repo, object.type, ToChecksum(object.id).c_str(),
+                                       cancellable, error)) {
+            return false;
+        }
+    }
+    OSTREE_TUI_PROFILE_COUNT("prunedObjects", static_cast<int64_t>(plan.objects.size()));
+
+    // static deltas of commits, that do not exist anymore
+    return ostree_repo_prune_static_deltas(repo, nullptr, cancellable, error);
+}
+
+namespace {
+
+struct CheckoutState {
+    const CheckoutProgress& onProgress;
+    uint64_t files{0};
+    uint64_t bytes{0};
+    std::chrono::steady_clock::time_point lastReport;
+};
+
+/// counts the checked out entries (the filter sees every entry, before it is checked out)
+OstreeRepoCheckoutFilterResult countCheckoutEntry(OstreeRepo* /*repo*/,
+                                                  const char* /*path*/,
+                                                  struct stat* stbuf,
+                                                  gpointer userData) {
+    auto* state = static_cast<CheckoutState*>(userData);
+    if (!S_ISDIR(stbuf->st_mode)) {
+        state->files++;
+        state->bytes += static_cast<uint64_t>(stbuf->st_size);
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now - state->lastReport >= std::chrono::milliseconds{100}) {
+        state->lastReport = now;
+        state->onProgress(state->files, state->bytes);
+    }
+    return OSTREE_REPO_CHECKOUT_FILTER_ALLOW;
+}
+
+}  // namespace
+
+bool CheckoutCommit(OstreeRepo* repo,
+                    const std::string& commit,
+                    const std::string& destination,
+                    const CheckoutProgress& onProgress,
+                    GCancellable* cancellable,
+                    GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("CheckoutCommit");
+
+    RepoLock lock;
+    g_autofree char* checksum{nullptr};
+    if (!lock.Acquire(repo, LockMode::SHARED, LOCK_TIMEOUT, nullptr, cancellable, error) ||
+        !ostree_repo_resolve_rev(repo, commit.c_str(), FALSE, &checksum, error)) {
+        return false;
+    }
+    std::error_code fsError;
+    if (std::filesystem::exists(destination, fsError)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS, "%s already exists",
+                    destination.c_str());
+        return false;
+    }
+
+    CheckoutState state{onProgress};
+    g_autoptr(OstreeRepoDevInoCache) devinoCache = ostree_repo_devino_cache_new();
+    OstreeRepoCheckoutAtOptions options{};
+    options.mode = OSTREE_REPO_CHECKOUT_MODE_USER;
+    options.overwrite_mode = OSTREE_REPO_CHECKOUT_OVERWRITE_NONE;
+    // hardlinks where possible, copies otherwise (libostree clones the data, if supported)
+    options.no_copy_fallback = FALSE;
+    // a tree to inspect or test, not a deployment
+    options.enable_fsync = FALSE;
+    options.devino_to_csum_cache = devinoCache;
+    options.filter = countCheckoutEntry;
+    options.filter_user_data = &state;
+
+    if (!ostree_repo_checkout_at(repo, &options, AT_FDCWD, destination.c_str(), checksum,
+                                 cancellable, error)) {
+        // no half checked out trees
+        std::filesystem::remove_all(destination, fsError);
+        return false;
+    }
+    onProgress(state.files, state.bytes);
+    return true;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,138 @@
+/*_____________________________________________________________
+ | Repository Jobs
+ |   In-process replacements for `ostree static-delta generate`,
+ |   `ostree summary -u`, `ostree prune`, `ostree reset`,
+ |   `ostree commit --tree=ref=` & `ostree checkout`, in the form
+ |   of JobQueue jobs (they run on the job thread, with its
+ |   repository handle). Each job takes the repository lock it
+ |   needs: shared to read, exclusive to move refs or delete.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <ostree.h>
+
+#include "pruneplan.hpp"
+
+namespace cpplibostree {
+
+/**
+ * @brief Generates a static delta, similar to `ostree static-delta generate --from=from to`.
+ *
+ * @param repo Repository handle.
+ * @param from Commit (or ref) the delta starts from, empty for a delta from scratch.
+ * @param to Commit (or ref) the delta leads to, resolved when the job runs.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool GenerateStaticDelta(OstreeRepo* repo,
+                         const std::string& from,
+                         const std::string& to,
+                         GCancellable* cancellable,
+                         GError** error);
+
+/**
+ * @brief Regenerates the summary file, similar to `ostree summary -u [--gpg-sign=KEY-ID]`.
+ *
+ * @param repo Repository handle.
+ * @param keyIds GPG keys to sign the summary with, unsigned if empty.
+ * @param gpgHomedir GPG home directory of the keys, empty for the default one.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool RegenerateSummary(OstreeRepo* repo,
+                       const std::vector<std::string>& keyIds,
+                       const std::string& gpgHomedir,
+                       GCancellable* cancellable,
+                       GError** error);
+
+/**
+ * @brief Promotes a commit to another branch, similar to
+ * `ostree commit -b ref -s subject --add-metadata-string=KEY=VALUE --tree=ref=commit`: the new
+ * commit has the same tree, its parent is the current head of the branch.
+ *
+ * @param repo Repository handle.
+ * @param commit Commit (or ref) to promote.
+ * @param ref Branch to promote to.
+ * @param addMetadataStrings Metadata strings to add, KEY=VALUE.
+ * @param subject Subject of the new commit, the one of the promoted commit if empty.
+ * @param keepMetadata Copy the metadata of the promoted commit (except its ref binding).
+ * @param newCommit Set to the checksum of the new commit.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool PromoteCommit(OstreeRepo* repo,
+                   const std::string& commit,
+                   const std::string& ref,
+                   const std::vector<std::string>& addMetadataStrings,
+                   const std::string& subject,
+                   bool keepMetadata,
+                   std::string& newCommit,
+                   GCancellable* cancellable,
+                   GError** error);
+
+/**
+ * @brief Drops a commit, similar to `ostree reset ref ref^` (if it is the head of the branch)
+ * followed by `ostree prune --delete-commit=commit`. Used, if the drop could not be planned.
+ *
+ * @param repo Repository handle.
+ * @param commit Commit to drop.
+ * @param branch Branch of the commit, reset if the commit is its head, may be empty.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure, or if another ref still points to the commit.
+ * @return true on success
+ */
+bool DropCommit(OstreeRepo* repo,
+                const std::string& commit,
+                const std::string& branch,
+                GCancellable* cancellable,
+                GError** error);
+
+/**
+ * @brief Drops a commit as planned by the PrunePlanner: moves the refs, deletes exactly the
+ * planned objects (nothing is marked again) & the static deltas of deleted commits.
+ *
+ * @param repo Repository handle.
+ * @param plan Finished plan.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure, or if a ref or commit changed since the plan was made.
+ * @return true on success
+ */
+bool ExecutePrunePlan(OstreeRepo* repo,
+                      const PrunePlan& plan,
+                      GCancellable* cancellable,
+                      GError** error);
+
+/// Called with the files & bytes checked out so far.
+using CheckoutProgress = std::function<void(uint64_t files, uint64_t bytes)>;
+
+/**
+ * @brief Checks a commit out into a new directory, similar to `ostree checkout --user-mode`.
+ * Files are hardlinked to their objects where possible (bare-user repositories on the same
+ * filesystem), otherwise they are copied (as reflinks, where the filesystem supports them).
+ * A failed or cancelled checkout is removed again.
+ *
+ * @param repo Repository handle.
+ * @param commit Commit (or ref) to check out.
+ * @param destination Directory to create, must not exist.
+ * @param onProgress Called at most every 100 ms while files are checked out & once at the end.
+ * @param cancellable Cancellable of the job.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool CheckoutCommit(OstreeRepo* repo,
+                    const std::string& commit,
+                    const std::string& destination,
+                    const CheckoutProgress& onProgress,
+                    GCancellable* cancellable,
+                    GError** error);
+
+}  // namespace cpplibostree
@@ -0,0 +1,170 @@
+#include "repolock.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+/// locks held per repository handle, a handle holding a lock must not probe (it would see itself)
+std::mutex heldLocksMutex;
+std::unordered_map<OstreeRepo*, size_t> heldLocks;
+
+enum class ProbeResult : uint8_t { AVAILABLE, LOCKED, FAILED };
+
+/**
+ * @brief Checks, if the lock could be taken right now. libostree locks `.lock` with open file
+ * description locks, or flock() where the kernel does not support them.
+ */
+ProbeResult probeLock(int fd, LockMode mode) {
+    struct flock lock{};
+    lock.l_type = mode == LockMode::SHARED ? F_RDLCK : F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_OFD_GETLK, &lock) == 0) {
+        return lock.l_type == F_UNLCK ? ProbeResult::AVAILABLE : ProbeResult::LOCKED;
+    }
+    if (errno != EINVAL) {
+        return ProbeResult::FAILED;
+    }
+    if (flock(fd, (mode == LockMode::SHARED ? LOCK_SH : LOCK_EX) | LOCK_NB) == 0) {
+        flock(fd, LOCK_UN);
+        return ProbeResult::AVAILABLE;
+    }
+    return errno == EWOULDBLOCK ? ProbeResult::LOCKED : ProbeResult::FAILED;
+}
+
+OstreeRepoLockType lockType(LockMode mode) {
+    return mode == LockMode::SHARED ? OSTREE_REPO_LOCK_SHARED : OSTREE_REPO_LOCK_EXCLUSIVE;
+}
+
+}  // namespace
+
+bool WaitForLock(OstreeRepo* repo,
+                 LockMode mode,
+                 std::chrono::milliseconds timeout,
+                 const LockWaitCallback& onWait,
+                 GCancellable* cancellable,
+                 GError** error) {
+    using namespace std::chrono;
+    OSTREE_TUI_PROFILE_SCOPE("WaitForLock");
+
+    const int fd = openat(ostree_repo_get_dfd(repo), ".lock", O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0) {
+        // created by the first writer, nobody holds a lock yet
+        if (errno == ENOENT) {
+            return true;
+        }
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno),
+                    "Opening the repository lock: %s", g_strerror(errno));
+        return false;
+    }
+
+    const auto start = steady_clock::now();
+    const auto deadline = start + timeout;
+    auto nextReport = start;
+    milliseconds interval{10};
+    ProbeResult result{ProbeResult::LOCKED};
+    while ((result = probeLock(fd, mode)) == ProbeResult::LOCKED) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            break;
+        }
+        const auto now = steady_clock::now();
+        if (now >= deadline) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                        "Repository stayed locked for %llds",
+                        static_cast<long long>(duration_cast<seconds>(now - start).count()));
+            break;
+        }
+        if (onWait && now >= nextReport) {
+            onWait(duration_cast<seconds>(now - start));
+            nextReport = now + seconds(1);
+        }
+        // back off, other processes hold their locks for a moment (transactions) or minutes (prune)
+        std::this_thread::sleep_for(
+            std::min(interval, duration_cast<milliseconds>(deadline - now)));
+        interval = std::min(interval * 2, milliseconds(250));
+    }
+    if (result == ProbeResult::FAILED) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno),
+                    "Probing the repository lock: %s", g_strerror(errno));
+    }
+    close(fd);
+    return result == ProbeResult::AVAILABLE;
+}
+
+RepoLock::~RepoLock() {
+    Release();
+}
+
+bool RepoLock::Acquire(OstreeRepo* repo,
+                       LockMode mode,
+                       std::chrono::milliseconds timeout,
+                       const LockWaitCallback& onWait,
+                       GCancellable* cancellable,
+                       GError** error) {
+    Release();
+
+    bool nested{false};
+    {
+        const std::lock_guard<std::mutex> lock(heldLocksMutex);
+        const auto held = heldLocks.find(repo);
+        nested = held != heldLocks.end() && held->second > 0;
+    }
+    // nested locks (also upgrades from shared) are up to libostree
+    if (!nested && !WaitForLock(repo, mode, timeout, onWait, cancellable, error)) {
+        return false;
+    }
+    if (!ostree_repo_lock_push(repo, lockType(mode), cancellable, error)) {
+        return false;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(heldLocksMutex);
+        heldLocks[repo]++;
+    }
+    this->repo = OSTREE_REPO(g_object_ref(repo));
+    this->mode = mode;
+    return true;
+}
+
+void RepoLock::Release() {
+    if (repo == nullptr) {
+        return;
+    }
+    GError* error{nullptr};
+    if (!ostree_repo_lock_pop(repo, lockType(mode), nullptr, &error)) {
+        g_printerr("Error releasing the repository lock: %s\n", error->message);
+        g_error_free(error);
+    }
+    {
+        const std::lock_guard<std::mutex> lock(heldLocksMutex);
+        const auto held = heldLocks.find(repo);
+        if (held != heldLocks.end() && --held->second == 0) {
+            heldLocks.erase(held);
+        }
+    }
+    g_object_unref(repo);
+    repo = nullptr;
+}
+
+bool RepoLock::IsHeld() const {
+    return repo != nullptr;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,90 @@
+/*_____________________________________________________________
+ | Repository Lock
+ |   Shared & exclusive repository locks (ostree_repo_lock_push),
+ |   like libostree takes them itself: readers & transactions
+ |   share the lock, prune & ref resets hold it exclusively.
+ |   libostree waits for a lock with the timeout of the repo's
+ |   config & without feedback, so the lock is probed first on
+ |   our own descriptor of `.lock`, polling until a deadline,
+ |   while the wait can be reported & cancelled.
+ |   Locks are released, when the holding process exits.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include <ostree.h>
+
+namespace cpplibostree {
+
+enum class LockMode : uint8_t { SHARED, EXCLUSIVE };
+
+/// default wait for a lock, before giving up
+inline constexpr std::chrono::milliseconds LOCK_TIMEOUT{30000};
+
+/// Called about once a second while waiting for a lock, with the time waited so far.
+using LockWaitCallback = std::function<void(std::chrono::seconds waited)>;
+
+/**
+ * @brief Waits until a lock could be taken, without taking it.
+ *
+ * @param repo Repository handle.
+ * @param mode Lock mode to wait for.
+ * @param timeout Maximum wait, 0 to only check.
+ * @param onWait Optional, called while waiting.
+ * @param cancellable Cancellable, checked while waiting.
+ * @param error Set to G_IO_ERROR_TIMED_OUT if the repository stayed locked, or on failure.
+ * @return true if the lock is available
+ */
+bool WaitForLock(OstreeRepo* repo,
+                 LockMode mode,
+                 std::chrono::milliseconds timeout,
+                 const LockWaitCallback& onWait,
+                 GCancellable* cancellable,
+                 GError** error);
+
+/**
+ * @brief Lock on a repository handle, held until it is released or destroyed. The locks of a
+ * handle nest: a handle holding the exclusive lock may take both again without waiting.
+ */
+class RepoLock {
+   public:
+    RepoLock() = default;
+    /// releases the lock
+    ~RepoLock();
+    RepoLock(const RepoLock&) = delete;
+    RepoLock& operator=(const RepoLock&) = delete;
+
+    /**
+     * @brief Waits for the lock (see WaitForLock) & takes it on the handle, where libostree
+     * operations on the same handle find it (without locking again).
+     *
+     * @param repo Repository handle, referenced while the lock is held.
+     * @param mode Lock mode.
+     * @param timeout Maximum wait.
+     * @param onWait Optional, called while waiting.
+     * @param cancellable Cancellable, checked while waiting.
+     * @param error Set if the repository stayed locked, or on failure.
+     * @return true if the lock is held
+     */
+    bool Acquire(OstreeRepo* repo,
+                 LockMode mode,
+                 std::chrono::milliseconds timeout = LOCK_TIMEOUT,
+                 const LockWaitCallback& onWait = nullptr,
+                 GCancellable* cancellable = nullptr,
+                 GError** error = nullptr);
+
+    /// @brief Releases the lock, if it is held.
+    void Release();
+
+    [[nodiscard]] bool IsHeld() const;
+
+   private:
+    OstreeRepo* repo{nullptr};
+    LockMode mode{LockMode::SHARED};
+};
+
+}  // namespace cpplibostree
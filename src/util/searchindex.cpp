@@ -0,0 +1,345 @@
+#include "searchindex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace Search {
+
+namespace {
+
+/// check for cancellation every CANCEL_CHECK_INTERVAL scanned texts
+constexpr uint32_t CANCEL_CHECK_INTERVAL{1024};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool isHex(std::string_view str) {
+    return std::all_of(str.begin(), str.end(), [](char c) { return hexValue(c) >= 0; });
+}
+
+void appendLower(std::string& out, std::string_view str) {
+    for (const char c : str) {
+        out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+}
+
+uint32_t trigramAt(std::string_view str, size_t pos) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(str[pos])) << 16U |
+           static_cast<uint32_t>(static_cast<unsigned char>(str[pos + 1])) << 8U |
+           static_cast<uint32_t>(static_cast<unsigned char>(str[pos + 2]));
+}
+
+bool cancelled(const std::atomic<uint64_t>& generation, uint64_t expectedGeneration) {
+    return generation.load(std::memory_order_relaxed) != expectedGeneration;
+}
+
+}  // namespace
+
+// CommitSearchIndex
+
+void CommitSearchIndex::Build(std::vector<SearchDocument> documents) {
+    OSTREE_TUI_PROFILE_SCOPE("CommitSearchIndex::Build");
+
+    hashes.clear();
+    sortedHashes.clear();
+    documentText.clear();
+    textArena.clear();
+    textOffsets.clear();
+    textDocuments.clear();
+    trigrams.clear();
+
+    // intern texts: equal (lower case) texts are only stored & indexed once
+    std::unordered_map<std::string, uint32_t> interned;
+    std::string lower;
+    for (auto& document : documents) {
+        const auto documentId = static_cast<uint32_t>(hashes.size());
+
+        Hash binary{};
+        if (document.hash.size() == binary.size() * 2 && isHex(document.hash)) {
+            for (size_t i{0}; i < binary.size(); i++) {
+                binary.at(i) = static_cast<uint8_t>(hexValue(document.hash[2 * i]) << 4 |
+                                                    hexValue(document.hash[2 * i + 1]));
+            }
+            sortedHashes.emplace_back(binary, documentId);
+        }
+        hashes.push_back(std::move(document.hash));
+
+        lower.clear();
+        appendLower(lower, document.subject);
+        lower += '\n';
+        appendLower(lower, document.body);
+        lower += '\n';
+        appendLower(lower, document.version);
+
+        auto [it, inserted] =
+            interned.try_emplace(lower, static_cast<uint32_t>(textDocuments.size()));
+        if (inserted) {
+            textOffsets.push_back(static_cast<uint32_t>(textArena.size()));
+            textArena += lower;
+            textDocuments.emplace_back();
+        }
+        textDocuments.at(it->second).push_back(documentId);
+        documentText.push_back(it->second);
+    }
+    textOffsets.push_back(static_cast<uint32_t>(textArena.size()));
+
+    std::sort(sortedHashes.begin(), sortedHashes.end());
+
+    // trigram posting lists, text ids are visited in ascending order -> lists stay sorted
+    for (uint32_t textId{0}; textId < textDocuments.size(); textId++) {
+        const std::string_view str = text(textId);
+        for (size_t pos{0}; pos + 3 <= str.size(); pos++) {
+            auto& postings = trigrams[trigramAt(str, pos)];
+            if (postings.empty() || postings.back() != textId) {
+                postings.push_back(textId);
+            }
+        }
+    }
+}
+
+std::optional<std::vector<std::string>> CommitSearchIndex::Search(
+    std::string_view query,
+    const std::atomic<uint64_t>& generation,
+    uint64_t expectedGeneration) const {
+    OSTREE_TUI_PROFILE_SCOPE("CommitSearchIndex::Search");
+
+    std::vector<uint32_t> matches;
+    bool firstTerm{true};
+    size_t pos{0};
+    while (pos < query.size()) {
+        // next space separated term
+        const size_t end = std::min(query.find(' ', pos), query.size());
+        const std::string_view rawTerm = query.substr(pos, end - pos);
+        pos = end + 1;
+        if (rawTerm.empty()) {
+            continue;
+        }
+        std::string term;
+        appendLower(term, rawTerm);
+
+        // documents matching the term by hash prefix or text
+        std::vector<uint32_t> termMatches;
+        if (isHex(term)) {
+            termMatches = searchHashPrefix(term);
+        }
+        auto textMatches = searchText(term, generation, expectedGeneration);
+        if (!textMatches) {
+            return std::nullopt;
+        }
+        std::vector<uint32_t> textDocumentMatches;
+        for (const auto textId : *textMatches) {
+            const auto& ids = textDocuments.at(textId);
+            textDocumentMatches.insert(textDocumentMatches.end(), ids.begin(), ids.end());
+        }
+        std::sort(textDocumentMatches.begin(), textDocumentMatches.end());
+        std::vector<uint32_t> merged;
+        std::set_union(termMatches.begin(), termMatches.end(), textDocumentMatches.begin(),
+                       textDocumentMatches.end(), std::back_inserter(merged));
+
+        // all terms have to match
+        if (firstTerm) {
+            matches = std::move(merged);
+            firstTerm = false;
+        } else {
+            std::vector<uint32_t> intersection;
+            std::set_intersection(matches.begin(), matches.end(), merged.begin(), merged.end(),
+                                  std::back_inserter(intersection));
+            matches = std::move(intersection);
+        }
+        if (matches.empty()) {
+            break;
+        }
+    }
+
+    if (cancelled(generation, expectedGeneration)) {
+        return std::nullopt;
+    }
+    std::vector<std::string> result;
+    result.reserve(matches.size());
+    for (const auto documentId : matches) {
+        result.push_back(hashes.at(documentId));
+    }
+    return result;
+}
+
+size_t CommitSearchIndex::Size() const {
+    return hashes.size();
+}
+
+std::vector<uint32_t> CommitSearchIndex::searchHashPrefix(std::string_view hexPrefix) const {
+    Hash low{};
+    Hash high{};
+    high.fill(0xff);
+    if (hexPrefix.size() > low.size() * 2) {
+        return {};
+    }
+    for (size_t i{0}; i < hexPrefix.size(); i++) {
+        const auto nibble = static_cast<uint8_t>(hexValue(hexPrefix[i]));
+        uint8_t& lowByte = low.at(i / 2);
+        uint8_t& highByte = high.at(i / 2);
+        if (i % 2 == 0) {
+            lowByte = static_cast<uint8_t>(nibble << 4U);
+            highByte = static_cast<uint8_t>(nibble << 4U | 0x0fU);
+        } else {
+            lowByte = static_cast<uint8_t>((lowByte & 0xf0U) | nibble);
+            highByte = static_cast<uint8_t>((highByte & 0xf0U) | nibble);
+        }
+    }
+
+    const auto first = std::lower_bound(
+        sortedHashes.begin(), sortedHashes.end(), low,
+        [](const std::pair<Hash, uint32_t>& entry, const Hash& hash) { return entry.first < hash; });
+    const auto last = std::upper_bound(
+        first, sortedHashes.end(), high,
+        [](const Hash& hash, const std::pair<Hash, uint32_t>& entry) { return hash < entry.first; });
+
+    std::vector<uint32_t> result;
+    for (auto it = first; it != last; ++it) {
+        result.push_back(it->second);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::optional<std::vector<uint32_t>> CommitSearchIndex::searchText(
+    std::string_view term,
+    const std::atomic<uint64_t>& generation,
+    uint64_t expectedGeneration) const {
+    const auto textCount = static_cast<uint32_t>(textDocuments.size());
+    std::vector<uint32_t> result;
+
+    // too short for trigrams -> scan all interned texts
+    if (term.size() < 3) {
+        for (uint32_t textId{0}; textId < textCount; textId++) {
+            if (textId % CANCEL_CHECK_INTERVAL == 0 && cancelled(generation, expectedGeneration)) {
+                return std::nullopt;
+            }
+            if (text(textId).find(term) != std::string_view::npos) {
+                result.push_back(textId);
+            }
+        }
+        return result;
+    }
+
+    // candidates: texts of the rarest trigram of the term
+    const std::vector<uint32_t>* candidates{nullptr};
+    for (size_t pos{0}; pos + 3 <= term.size(); pos++) {
+        const auto it = trigrams.find(trigramAt(term, pos));
+        if (it == trigrams.end()) {
+            return result;
+        }
+        if (candidates == nullptr || it->second.size() < candidates->size()) {
+            candidates = &it->second;
+        }
+    }
+
+    // verify candidates
+    for (size_t i{0}; i < candidates->size(); i++) {
+        if (i % CANCEL_CHECK_INTERVAL == 0 && cancelled(generation, expectedGeneration)) {
+            return std::nullopt;
+        }
+        const uint32_t textId = candidates->at(i);
+        if (text(textId).find(term) != std::string_view::npos) {
+            result.push_back(textId);
+        }
+    }
+    return result;
+}
+
+std::string_view CommitSearchIndex::text(uint32_t textId) const {
+    return std::string_view(textArena)
+        .substr(textOffsets.at(textId), textOffsets.at(textId + 1) - textOffsets.at(textId));
+}
+
+// CommitSearchWorker
+
+CommitSearchWorker::CommitSearchWorker(ResultCallback onResult) : onResult(std::move(onResult)) {
+    worker = std::thread([this] { run(); });
+}
+
+CommitSearchWorker::~CommitSearchWorker() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        generation++;
+    }
+    wakeup.notify_one();
+    worker.join();
+}
+
+void CommitSearchWorker::SetDocuments(DocumentSource source) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        pendingDocuments = std::move(source);
+    }
+    wakeup.notify_one();
+}
+
+uint64_t CommitSearchWorker::Search(std::string query) {
+    uint64_t queryGeneration{0};
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        pendingQuery = std::move(query);
+        queryGeneration = ++generation;
+    }
+    wakeup.notify_one();
+    return queryGeneration;
+}
+
+void CommitSearchWorker::Cancel() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    pendingQuery.reset();
+    generation++;
+}
+
+void CommitSearchWorker::run() {
+    while (true) {
+        DocumentSource documents;
+        std::optional<std::string> query;
+        uint64_t queryGeneration{0};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || pendingDocuments || pendingQuery; });
+            if (stop) {
+                return;
+            }
+            documents.swap(pendingDocuments);
+            query.swap(pendingQuery);
+            queryGeneration = generation.load();
+        }
+
+        if (documents) {
+            index.Build(documents());
+        }
+        if (!query) {
+            continue;
+        }
+        auto hits = index.Search(*query, generation, queryGeneration);
+        if (hits) {
+            onResult(queryGeneration, std::move(*hits));
+        }
+    }
+}
+
+}  // namespace Search
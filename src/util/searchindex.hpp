@@ -0,0 +1,141 @@
+/*_____________________________________________________________
+ | Commit Search Index
+ |   Incremental search over commit hashes, subjects, bodies &
+ |   versions.
+ |   - hash prefixes: sorted binary hashes, O(log n) per prefix
+ |   - text: interned (deduplicated) lower-case texts with a
+ |     trigram index, candidates are verified by substring scan
+ |   - queries are split at spaces, all terms have to match
+ |   Searches run on a background thread (CommitSearchWorker),
+ |   a new query cancels the previous one.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Search {
+
+/// Searchable fields of one commit.
+struct SearchDocument {
+    std::string hash;
+    std::string subject;
+    std::string body;
+    std::string version;
+};
+
+class CommitSearchIndex {
+   public:
+    /**
+     * @brief (Re-)builds the index.
+     *
+     * @param documents All commits to make searchable.
+     */
+    void Build(std::vector<SearchDocument> documents);
+
+    /**
+     * @brief Searches all documents for the query. Every space separated term has to match
+     * either a hash prefix, or a substring (case insensitive) of subject, body or version.
+     *
+     * @param query Search query.
+     * @param generation Current query generation, the search is cancelled once it changes.
+     * @param expectedGeneration Generation of this query.
+     * @return Hashes of all matching commits, std::nullopt if the search was cancelled.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>> Search(
+        std::string_view query,
+        const std::atomic<uint64_t>& generation,
+        uint64_t expectedGeneration) const;
+
+    /// @return Amount of indexed documents.
+    [[nodiscard]] size_t Size() const;
+
+   private:
+    using Hash = std::array<uint8_t, 32>;
+
+    /// @return Ids of all documents, whose hash begins with the hex prefix (sorted).
+    [[nodiscard]] std::vector<uint32_t> searchHashPrefix(std::string_view hexPrefix) const;
+
+    /// @return Ids of all texts containing the (lower case) term, nullopt if cancelled.
+    [[nodiscard]] std::optional<std::vector<uint32_t>> searchText(
+        std::string_view term,
+        const std::atomic<uint64_t>& generation,
+        uint64_t expectedGeneration) const;
+
+    [[nodiscard]] std::string_view text(uint32_t textId) const;
+
+    std::vector<std::string> hashes;                     // document id -> hash
+    std::vector<std::pair<Hash, uint32_t>> sortedHashes;  // binary hash -> document id
+    std::vector<uint32_t> documentText;                  // document id -> text id
+
+    // interned texts, all stored back to back in textArena
+    std::string textArena;
+    std::vector<uint32_t> textOffsets;                 // text id -> offset, plus end marker
+    std::vector<std::vector<uint32_t>> textDocuments;  // text id -> document ids
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;  // trigram -> text ids
+};
+
+/**
+ * @brief Runs searches on a CommitSearchIndex in a background thread. Only the most recent
+ * query is executed, older ones are cancelled.
+ */
+class CommitSearchWorker {
+   public:
+    /// Called from the worker thread with the generation of the query & all hits.
+    using ResultCallback = std::function<void(uint64_t, std::vector<std::string>)>;
+    /// Collects the documents to index, called from the worker thread.
+    using DocumentSource = std::function<std::vector<SearchDocument>()>;
+
+    explicit CommitSearchWorker(ResultCallback onResult);
+    ~CommitSearchWorker();
+    CommitSearchWorker(const CommitSearchWorker&) = delete;
+    CommitSearchWorker& operator=(const CommitSearchWorker&) = delete;
+
+    /**
+     * @brief Replaces the indexed documents. They are collected & indexed on the worker thread,
+     * e.g. decoding the subjects of all commits doesn't block the caller.
+     *
+     * @param source Collects the documents, must not refer to data owned by the caller.
+     */
+    void SetDocuments(DocumentSource source);
+
+    /**
+     * @brief Starts a new search & cancels the running one.
+     *
+     * @param query Search query.
+     * @return Generation of the query, passed to the result callback.
+     */
+    uint64_t Search(std::string query);
+
+    /// @brief Cancels the running search, without starting a new one.
+    void Cancel();
+
+   private:
+    void run();
+
+    ResultCallback onResult;
+    CommitSearchIndex index;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    DocumentSource pendingDocuments;
+    std::optional<std::string> pendingQuery;
+    std::atomic<uint64_t> generation{0};
+
+    std::thread worker;
+};
+
+}  // namespace Search
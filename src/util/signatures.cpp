@@ -0,0 +1,179 @@
+#include "signatures.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+// C
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <ostree.h>
+#include <cassert>
+
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+std::vector<Signature> VerifyCommitSignatures(OstreeRepo* repo, const std::string& hash) {
+    OSTREE_TUI_PROFILE_SCOPE("verifySignatures");
+    std::vector<Signature> signatures;
+
+    // see ostree print_object for reference
+    g_autoptr(OstreeGpgVerifyResult) result = nullptr;
+    g_autoptr(GError) local_error = nullptr;
+    result = ostree_repo_verify_commit_ext(repo, hash.c_str(), nullptr, nullptr, nullptr,
+                                           &local_error);
+    if (g_error_matches(local_error, OSTREE_GPG_ERROR, OSTREE_GPG_ERROR_NO_SIGNATURE) ||
+        local_error != nullptr) {
+        /* Ignore */
+    } else {
+        assert(result);
+        guint n_sigs = ostree_gpg_verify_result_count_all(result);
+        // parse all found signatures
+        for (guint ii = 0; ii < n_sigs; ii++) {
+            g_autoptr(GVariant) variant = nullptr;
+            variant = ostree_gpg_verify_result_get_all(result, ii);
+            // see ostree_gpg_verify_result_describe_variant for reference
+            gint64 timestamp{0};
+            gint64 exp_timestamp{0};
+            gint64 key_exp_timestamp{0};
+            gint64 key_exp_timestamp_primary{0};
+            const char* fingerprint{nullptr};
+            const char* fingerprintPrimary{nullptr};
+            const char* pubkey_algo{nullptr};
+            const char* user_name{nullptr};
+            const char* user_email{nullptr};
+            gboolean valid{false};
+            gboolean sigExpired{false};
+            gboolean keyExpired{false};
+            gboolean keyRevoked{false};
+            gboolean keyMissing{false};
+
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_VALID, "b", &valid);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_SIG_EXPIRED, "b", &sigExpired);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXPIRED, "b", &keyExpired);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_REVOKED, "b", &keyRevoked);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_MISSING, "b", &keyMissing);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT, "&s", &fingerprint);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_FINGERPRINT_PRIMARY, "&s",
+                                &fingerprintPrimary);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_TIMESTAMP, "x", &timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_EXP_TIMESTAMP, "x",
+                                &exp_timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_PUBKEY_ALGO_NAME, "&s",
+                                &pubkey_algo);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_NAME, "&s", &user_name);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_USER_EMAIL, "&s", &user_email);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP, "x",
+                                &key_exp_timestamp);
+            g_variant_get_child(variant, OSTREE_GPG_SIGNATURE_ATTR_KEY_EXP_TIMESTAMP_PRIMARY, "x",
+                                &key_exp_timestamp_primary);
+
+            // create signature struct
+            Signature sig;
+
+            sig.valid = valid;
+            sig.sigExpired = sigExpired;
+            sig.keyExpired = keyExpired;
+            sig.keyRevoked = keyRevoked;
+            sig.keyMissing = keyMissing;
+            sig.fingerprint = fingerprint;
+            sig.fingerprintPrimary = fingerprintPrimary;
+            sig.timestamp = Timepoint(std::chrono::seconds(timestamp));
+            sig.expireTimestamp = Timepoint(std::chrono::seconds(exp_timestamp));
+            sig.pubkeyAlgorithm = pubkey_algo;
+            sig.username = user_name;
+            sig.usermail = user_email;
+            sig.keyExpireTimestamp = Timepoint(std::chrono::seconds(key_exp_timestamp));
+            sig.keyExpireTimestampPrimary =
+                Timepoint(std::chrono::seconds(key_exp_timestamp_primary));
+
+            signatures.push_back(std::move(sig));
+            OSTREE_TUI_PROFILE_COUNT("signatures", 1);
+        }
+    }
+
+    return signatures;
+}
+
+SignatureWorker::SignatureWorker(std::string repoPath, ResultCallback onResult)
+    : repoPath(std::move(repoPath)), onResult(std::move(onResult)) {
+    worker = std::thread([this] { run(); });
+}
+
+SignatureWorker::~SignatureWorker() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_one();
+    worker.join();
+}
+
+std::optional<std::vector<Signature>> SignatureWorker::Get(const std::string& commit) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (const auto it = cache.find(commit); it != cache.end()) {
+            return it->second;
+        }
+        if (running == commit) {
+            return std::nullopt;
+        }
+        pending = commit;
+    }
+    wakeup.notify_one();
+    return std::nullopt;
+}
+
+void SignatureWorker::Clear() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+    cache.clear();
+}
+
+void SignatureWorker::run() {
+    g_autoptr(OstreeRepo) repo = nullptr;
+    while (true) {
+        std::string commit;
+        uint64_t requestGeneration{0};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || pending; });
+            if (stop) {
+                return;
+            }
+            commit = std::move(*pending);
+            pending.reset();
+            running = commit;
+            requestGeneration = generation;
+        }
+
+        if (repo == nullptr) {
+            g_autoptr(GError) error = nullptr;
+            repo = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, &error);
+        }
+        // an unreadable repository shows the commit as not signed
+        std::vector<Signature> signatures;
+        if (repo != nullptr) {
+            signatures = VerifyCommitSignatures(repo, commit);
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                return;
+            }
+            running.reset();
+            if (requestGeneration == generation) {
+                cache.emplace(commit, std::move(signatures));
+            }
+        }
+        // after a Clear() too: a redraw requests the commit again, if it is still shown
+        onResult(commit);
+    }
+}
+
+}  // namespace cpplibostree
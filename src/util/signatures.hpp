@@ -0,0 +1,82 @@
+/*_____________________________________________________________
+ | Signatures
+ |   GPG verification of commit signatures, in the background:
+ |   verifying a commit can take a while (gpgme, keyring), so
+ |   it never runs while rendering. Only the newest request is
+ |   kept, commits skipped over while scrolling are not
+ |   verified. Results are cached by commit checksum, until the
+ |   repository is reloaded.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <ostree.h>
+
+#include "cpplibostree.hpp"
+
+namespace cpplibostree {
+
+/**
+ * @brief Verifies the GPG signatures of a commit.
+ *
+ * @param repo Repository of the commit.
+ * @param hash Commit hash.
+ * @return All signatures, empty if the commit is not signed.
+ */
+[[nodiscard]] std::vector<Signature> VerifyCommitSignatures(OstreeRepo* repo,
+                                                            const std::string& hash);
+
+class SignatureWorker {
+   public:
+    /// Called from the worker thread with the commit checksum, once its signatures are verified.
+    using ResultCallback = std::function<void(const std::string&)>;
+
+    /**
+     * @param repoPath Path of the repository.
+     * @param onResult Result callback.
+     */
+    SignatureWorker(std::string repoPath, ResultCallback onResult);
+    ~SignatureWorker();
+    SignatureWorker(const SignatureWorker&) = delete;
+    SignatureWorker& operator=(const SignatureWorker&) = delete;
+
+    /**
+     * @brief Gets the cached signatures of a commit, or queues their verification (replacing
+     * the pending one).
+     *
+     * @param commit Commit checksum.
+     * @return Signatures (empty if not signed), nullopt while they are verified.
+     */
+    [[nodiscard]] std::optional<std::vector<Signature>> Get(const std::string& commit);
+
+    /// @brief Drops all results, the signatures may change with the repository.
+    void Clear();
+
+   private:
+    void run();
+
+    std::string repoPath;
+    ResultCallback onResult;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop{false};
+    uint64_t generation{0};  // increased by Clear(), drops results verified before
+    std::optional<std::string> pending;
+    std::optional<std::string> running;
+    std::unordered_map<std::string, std::vector<Signature>> cache;
+
+    std::thread worker;
+};
+
+}  // namespace cpplibostree
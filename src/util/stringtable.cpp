@@ -0,0 +1,24 @@
+#include "stringtable.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace cpplibostree {
+
+std::string_view StringTable::Intern(std::string_view string) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto interned = strings.find(string);
+    if (interned == strings.end()) {
+        interned = strings.emplace(string).first;
+    }
+    return *interned;
+}
+
+size_t StringTable::Size() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return strings.size();
+}
+
+}  // namespace cpplibostree
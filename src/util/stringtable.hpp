@@ -0,0 +1,51 @@
+/*_____________________________________________________________
+ | String Table
+ |   Interns strings, that repeat across commits & repositories
+ |   (branch names): every distinct string is stored once, the
+ |   views handed out stay valid as long as the table. Strings
+ |   are never removed, the table only grows with new names.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace cpplibostree {
+
+class StringTable {
+   public:
+    StringTable() = default;
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    /**
+     * @brief Interns a string (thread-safe).
+     *
+     * @param string String to intern.
+     * @return View of the stored copy, equal strings get the same view.
+     */
+    [[nodiscard]] std::string_view Intern(std::string_view string);
+
+    /// @return Amount of distinct strings.
+    [[nodiscard]] size_t Size() const;
+
+   private:
+    /// heterogeneous lookup, so that interning a known string does not allocate
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view string) const {
+            return std::hash<std::string_view>{}(string);
+        }
+    };
+
+    mutable std::mutex mutex;
+    // node based, the strings do not move on rehash
+    std::unordered_set<std::string, Hash, std::equal_to<>> strings;
+};
+
+}  // namespace cpplibostree
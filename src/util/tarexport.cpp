@@ -0,0 +1,557 @@
+#include "tarexport.hpp"
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <zstd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+#include "repolock.hpp"
+
+namespace cpplibostree {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE{512};
+/// size of the read & the output buffer, the only buffers of an export
+constexpr size_t BUFFER_SIZE{1024 * 1024};
+/// bytes per sendfile call, the cancellable is checked in between
+constexpr size_t SEND_CHUNK{8 * 1024 * 1024};
+constexpr std::chrono::milliseconds PROGRESS_INTERVAL{100};
+constexpr int ZSTD_LEVEL{3};
+
+bool failWithErrno(GError** error, const std::string& what) {
+    const int code = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(code), "%s: %s", what.c_str(),
+                g_strerror(code));
+    return false;
+}
+
+/// Buffered output of the archive, zstd compressed on the fly if requested.
+class TarStream {
+   public:
+    TarStream(int fd, TarCompression compression)
+        : fd(fd), output(BUFFER_SIZE), input(BUFFER_SIZE) {
+        if (compression == TarCompression::ZSTD) {
+            zstd = ZSTD_createCCtx();
+            ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, ZSTD_LEVEL);
+            // keeps up with the disk, fails (& stays single threaded) without ZSTD_MULTITHREAD
+            const auto workers = std::max(1U, std::thread::hardware_concurrency());
+            ZSTD_CCtx_setParameter(zstd, ZSTD_c_nbWorkers, static_cast<int>(workers));
+        }
+    }
+    ~TarStream() { ZSTD_freeCCtx(zstd); }
+    TarStream(const TarStream&) = delete;
+    TarStream& operator=(const TarStream&) = delete;
+
+    bool Write(const char* data, size_t size, GError** error) {
+        if (zstd != nullptr) {
+            return compress(data, size, ZSTD_e_continue, error);
+        }
+        if (outputUsed + size > output.size()) {
+            if (!flush(error)) {
+                return false;
+            }
+            // larger than the buffer -> no copy
+            if (size >= output.size()) {
+                return writeAll(data, size, error);
+            }
+        }
+        std::memcpy(output.data() + outputUsed, data, size);
+        outputUsed += size;
+        return true;
+    }
+
+    /// @brief Writes size bytes of a file, with sendfile if the archive isn't compressed.
+    bool WriteFile(int in, uint64_t size, GCancellable* cancellable, GError** error) {
+        if (zstd == nullptr) {
+            if (!flush(error)) {
+                return false;
+            }
+            off_t offset{0};
+            while (static_cast<uint64_t>(offset) < size) {
+                if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+                    return false;
+                }
+                const auto chunk = static_cast<size_t>(
+                    std::min<uint64_t>(SEND_CHUNK, size - static_cast<uint64_t>(offset)));
+                const ssize_t sent = sendfile(fd, in, &offset, chunk);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                // not supported by the descriptors -> copy the rest through the buffer
+                if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                    return copyFile(in, offset, size, cancellable, error);
+                }
+                if (sent < 0) {
+                    return failWithErrno(error, "sendfile");
+                }
+                if (sent == 0) {
+                    return truncated(error);
+                }
+                OSTREE_TUI_PROFILE_COUNT("tarBytesSent", sent);
+            }
+            return true;
+        }
+        return copyFile(in, 0, size, cancellable, error);
+    }
+
+    /// @brief Writes size bytes of a stream (objects of archive repositories).
+    bool WriteStream(GInputStream* in, uint64_t size, GCancellable* cancellable, GError** error) {
+        for (uint64_t done{0}; done < size;) {
+            const auto chunk = static_cast<size_t>(std::min<uint64_t>(input.size(), size - done));
+            gsize bytesRead{0};
+            if (!g_input_stream_read_all(in, input.data(), chunk, &bytesRead, cancellable,
+                                         error)) {
+                return false;
+            }
+            if (bytesRead == 0) {
+                return truncated(error);
+            }
+            if (!Write(input.data(), bytesRead, error)) {
+                return false;
+            }
+            done += bytesRead;
+        }
+        return true;
+    }
+
+    /// @brief Pads an entry of size bytes to the block size.
+    bool Pad(uint64_t size, GError** error) {
+        static constexpr std::array<char, BLOCK_SIZE> ZEROS{};
+        const size_t rest = size % BLOCK_SIZE;
+        return rest == 0 || Write(ZEROS.data(), BLOCK_SIZE - rest, error);
+    }
+
+    /// @brief Ends the archive (two zero blocks) & the zstd frame, flushes the buffer.
+    bool Finish(GError** error) {
+        static constexpr std::array<char, 2 * BLOCK_SIZE> END{};
+        if (!Write(END.data(), END.size(), error)) {
+            return false;
+        }
+        if (zstd != nullptr && !compress(nullptr, 0, ZSTD_e_end, error)) {
+            return false;
+        }
+        return flush(error);
+    }
+
+   private:
+    bool copyFile(int in, off_t offset, uint64_t size, GCancellable* cancellable, GError** error) {
+        while (static_cast<uint64_t>(offset) < size) {
+            if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+                return false;
+            }
+            const auto chunk = static_cast<size_t>(
+                std::min<uint64_t>(input.size(), size - static_cast<uint64_t>(offset)));
+            const ssize_t bytesRead = pread(in, input.data(), chunk, offset);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead < 0) {
+                return failWithErrno(error, "read");
+            }
+            if (bytesRead == 0) {
+                return truncated(error);
+            }
+            if (!Write(input.data(), static_cast<size_t>(bytesRead), error)) {
+                return false;
+            }
+            offset += bytesRead;
+        }
+        return true;
+    }
+
+    bool compress(const char* data, size_t size, ZSTD_EndDirective mode, GError** error) {
+        ZSTD_inBuffer in{data, size, 0};
+        while (true) {
+            ZSTD_outBuffer out{output.data(), output.size(), outputUsed};
+            const size_t remaining = ZSTD_compressStream2(zstd, &out, &in, mode);
+            if (ZSTD_isError(remaining) != 0U) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "zstd: %s",
+                            ZSTD_getErrorName(remaining));
+                return false;
+            }
+            outputUsed = out.pos;
+            const bool done = mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size;
+            if (done) {
+                return true;
+            }
+            if (outputUsed == output.size() && !flush(error)) {
+                return false;
+            }
+        }
+    }
+
+    bool flush(GError** error) {
+        const bool success = writeAll(output.data(), outputUsed, error);
+        outputUsed = 0;
+        return success;
+    }
+
+    bool writeAll(const char* data, size_t size, GError** error) {
+        while (size > 0) {
+            const ssize_t written = write(fd, data, size);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                return failWithErrno(error, "write");
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    static bool truncated(GError** error) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                    "object is shorter than its size, the repository may be corrupt");
+        return false;
+    }
+
+    int fd;
+    ZSTD_CCtx* zstd{nullptr};
+    std::vector<char> output;
+    size_t outputUsed{0};
+    std::vector<char> input;
+};
+
+struct TarEntry {
+    std::string path;
+    char type{'0'};  // 0 file, 2 symbolic link, 5 directory
+    uint32_t mode{0};
+    uint32_t uid{0};
+    uint32_t gid{0};
+    uint64_t size{0};
+    std::string linkTarget;
+};
+
+/// @return true, if the value fits into an octal header field (with its terminating NUL).
+bool fitsOctal(uint64_t value, size_t width) {
+    return value < (uint64_t{1} << (3 * (width - 1)));
+}
+
+void putOctal(char* field, size_t width, uint64_t value) {
+    std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1),
+                  static_cast<unsigned long long>(fitsOctal(value, width) ? value : 0));
+}
+
+/// @return pax record "<length> <key>=<value>\n", the length counts itself.
+std::string paxRecord(std::string_view key, std::string_view value) {
+    const size_t payload = key.size() + value.size() + 3;
+    size_t length = payload + 1;
+    while (std::to_string(length).size() + payload != length) {
+        length = std::to_string(length).size() + payload;
+    }
+    return std::format("{} {}={}\n", length, key, value);
+}
+
+/// @brief Fills & checksums a ustar header, name & linkname have to fit.
+void fillHeader(std::array<char, BLOCK_SIZE>& header,
+                const TarEntry& entry,
+                std::string_view prefix,
+                std::string_view name,
+                std::string_view linkName,
+                uint64_t mtime) {
+    header.fill(0);
+    name.copy(header.data(), 100);
+    putOctal(header.data() + 100, 8, entry.mode & 07777);
+    putOctal(header.data() + 108, 8, entry.uid);
+    putOctal(header.data() + 116, 8, entry.gid);
+    putOctal(header.data() + 124, 12, entry.size);
+    putOctal(header.data() + 136, 12, mtime);
+    header[156] = entry.type;
+    linkName.copy(header.data() + 157, 100);
+    std::memcpy(header.data() + 257, "ustar", 6);
+    std::memcpy(header.data() + 263, "00", 2);
+    prefix.copy(header.data() + 345, 155);
+
+    // the checksum is calculated with spaces in its own field
+    std::memset(header.data() + 148, ' ', 8);
+    unsigned int checksum{0};
+    for (const char c : header) {
+        checksum += static_cast<unsigned char>(c);
+    }
+    std::snprintf(header.data() + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+}
+
+/// @brief Writes the header of an entry, preceded by a pax header, if it doesn't fit ustar.
+bool writeHeader(TarStream& stream, const TarEntry& entry, uint64_t mtime, GError** error) {
+    std::string_view prefix;
+    std::string_view name = entry.path;
+    std::string pax;
+    if (name.size() > 100) {
+        // split at a slash into prefix (155) & name (100), or record the whole path; the
+        // trailing slash of directories stays with the name
+        const size_t slash = entry.path.rfind('/', std::min<size_t>(155, entry.path.size() - 2));
+        if (slash != std::string::npos && slash > 0 && entry.path.size() - slash - 1 <= 100) {
+            prefix = std::string_view(entry.path).substr(0, slash);
+            name = std::string_view(entry.path).substr(slash + 1);
+        } else {
+            pax += paxRecord("path", entry.path);
+            name = name.substr(0, 100);
+        }
+    }
+    std::string_view linkName = entry.linkTarget;
+    if (linkName.size() > 100) {
+        pax += paxRecord("linkpath", entry.linkTarget);
+        linkName = linkName.substr(0, 100);
+    }
+    if (!fitsOctal(entry.size, 12)) {
+        pax += paxRecord("size", std::to_string(entry.size));
+    }
+    if (!fitsOctal(entry.uid, 8)) {
+        pax += paxRecord("uid", std::to_string(entry.uid));
+    }
+    if (!fitsOctal(entry.gid, 8)) {
+        pax += paxRecord("gid", std::to_string(entry.gid));
+    }
+
+    std::array<char, BLOCK_SIZE> header{};
+    if (!pax.empty()) {
+        OSTREE_TUI_PROFILE_COUNT("tarPaxHeaders", 1);
+        const TarEntry paxEntry{.path = "PaxHeaders/" + std::string(name.substr(0, 88)),
+                                .type = 'x',
+                                .mode = 0644,
+                                .size = pax.size()};
+        fillHeader(header, paxEntry, "", paxEntry.path, "", mtime);
+        if (!stream.Write(header.data(), header.size(), error) ||
+            !stream.Write(pax.data(), pax.size(), error) || !stream.Pad(pax.size(), error)) {
+            return false;
+        }
+    }
+    fillHeader(header, entry, prefix, name, linkName, mtime);
+    return stream.Write(header.data(), header.size(), error);
+}
+
+/// State of one export, walked depth first.
+struct Export {
+    OstreeRepo* repo;
+    TarStream& stream;
+    uint64_t mtime;
+    bool bare;  // plain content in objects/xx/yyy.file
+    const ExportProgress& onProgress;
+    GCancellable* cancellable;
+    uint64_t files{0};
+    uint64_t bytes{0};
+    std::chrono::steady_clock::time_point lastReport;
+
+    void progress() {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= PROGRESS_INTERVAL) {
+            lastReport = now;
+            onProgress(files, bytes);
+        }
+    }
+};
+
+/// @return Descriptor of the plain content of a file object, -1 if it isn't stored locally.
+int openBareObject(OstreeRepo* repo, const std::string& checksum) {
+    const std::string path =
+        std::format("objects/{}/{}.file", checksum.substr(0, 2), checksum.substr(2));
+    return openat(ostree_repo_get_dfd(repo), path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+}
+
+bool exportFile(Export& state, std::string path, const std::string& checksum, GError** error) {
+    if (g_cancellable_set_error_if_cancelled(state.cancellable, error)) {
+        return false;
+    }
+    g_autoptr(GFileInfo) info = nullptr;
+    if (!ostree_repo_load_file(state.repo, checksum.c_str(), nullptr, &info, nullptr,
+                               state.cancellable, error)) {
+        return false;
+    }
+    TarEntry entry{.path = std::move(path),
+                   .mode = g_file_info_get_attribute_uint32(info, "unix::mode"),
+                   .uid = g_file_info_get_attribute_uint32(info, "unix::uid"),
+                   .gid = g_file_info_get_attribute_uint32(info, "unix::gid")};
+    if (g_file_info_get_file_type(info) == G_FILE_TYPE_SYMBOLIC_LINK) {
+        entry.type = '2';
+        entry.linkTarget = g_file_info_get_symlink_target(info);
+    } else {
+        entry.size = static_cast<uint64_t>(g_file_info_get_size(info));
+    }
+    if (!writeHeader(state.stream, entry, state.mtime, error)) {
+        return false;
+    }
+
+    if (entry.size > 0) {
+        const int fd = state.bare ? openBareObject(state.repo, checksum) : -1;
+        bool success{false};
+        if (fd >= 0) {
+            success = state.stream.WriteFile(fd, entry.size, state.cancellable, error);
+            close(fd);
+        } else {
+            // archive repositories (or objects of a parent repository) are decompressed
+            g_autoptr(GInputStream) input = nullptr;
+            success = ostree_repo_load_file(state.repo, checksum.c_str(), &input, nullptr,
+                                            nullptr, state.cancellable, error) &&
+                      state.stream.WriteStream(input, entry.size, state.cancellable, error);
+        }
+        if (!success || !state.stream.Pad(entry.size, error)) {
+            return false;
+        }
+    }
+    state.files++;
+    state.bytes += entry.size;
+    state.progress();
+    return true;
+}
+
+/// @brief Exports the entries of a directory, path is empty (root) or ends with a slash.
+bool exportDirectory(Export& state,
+                     const std::string& path,
+                     const std::string& dirtree,
+                     GError** error) {
+    g_autoptr(GVariant) tree = nullptr;
+    if (!ostree_repo_load_variant(state.repo, OSTREE_OBJECT_TYPE_DIR_TREE, dirtree.c_str(), &tree,
+                                  error)) {
+        return false;
+    }
+
+    // see OSTREE_TREE_GVARIANT_FORMAT, a(say) files & a(sayay) directories
+    g_autoptr(GVariant) files = g_variant_get_child_value(tree, 0);
+    for (gsize i{0}; i < g_variant_n_children(files); i++) {
+        g_autoptr(GVariant) file = g_variant_get_child_value(files, i);
+        const char* name{nullptr};
+        g_autoptr(GVariant) checksum = nullptr;
+        g_variant_get(file, "(&s@ay)", &name, &checksum);
+        ObjectId id{};
+        if (!ReadObjectId(checksum, id)) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "invalid checksum of %s%s",
+                        path.c_str(), name);
+            return false;
+        }
+        if (!exportFile(state, path + name, ToChecksum(id), error)) {
+            return false;
+        }
+    }
+
+    g_autoptr(GVariant) dirs = g_variant_get_child_value(tree, 1);
+    for (gsize i{0}; i < g_variant_n_children(dirs); i++) {
+        g_autoptr(GVariant) dir = g_variant_get_child_value(dirs, i);
+        const char* name{nullptr};
+        g_autoptr(GVariant) treeChecksum = nullptr;
+        g_autoptr(GVariant) metaChecksum = nullptr;
+        g_variant_get(dir, "(&s@ay@ay)", &name, &treeChecksum, &metaChecksum);
+        ObjectId treeId{};
+        ObjectId metaId{};
+        if (!ReadObjectId(treeChecksum, treeId) || !ReadObjectId(metaChecksum, metaId)) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "invalid checksum of %s%s",
+                        path.c_str(), name);
+            return false;
+        }
+
+        // see OSTREE_DIRMETA_GVARIANT_FORMAT, (uuua(ayay)) in big endian
+        g_autoptr(GVariant) meta = nullptr;
+        if (!ostree_repo_load_variant(state.repo, OSTREE_OBJECT_TYPE_DIR_META,
+                                      ToChecksum(metaId).c_str(), &meta, error)) {
+            return false;
+        }
+        guint32 uid{0};
+        guint32 gid{0};
+        guint32 mode{0};
+        g_variant_get(meta, "(uuu@a(ayay))", &uid, &gid, &mode, nullptr);
+        const std::string subPath = path + name + "/";
+        const TarEntry entry{.path = subPath,
+                             .type = '5',
+                             .mode = GUINT32_FROM_BE(mode),
+                             .uid = GUINT32_FROM_BE(uid),
+                             .gid = GUINT32_FROM_BE(gid)};
+        if (!writeHeader(state.stream, entry, state.mtime, error) ||
+            !exportDirectory(state, subPath, ToChecksum(treeId), error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TarCompression CompressionForPath(const std::string& path) {
+    return path.ends_with(".zst") || path.ends_with(".tzst") ? TarCompression::ZSTD
+                                                             : TarCompression::NONE;
+}
+
+bool ExportTar(OstreeRepo* repo,
+               const std::string& commit,
+               int fd,
+               TarCompression compression,
+               const ExportProgress& onProgress,
+               GCancellable* cancellable,
+               GError** error) {
+    OSTREE_TUI_PROFILE_SCOPE("ExportTar");
+
+    // objects must not be pruned while they are exported
+    RepoLock lock;
+    g_autofree char* checksum{nullptr};
+    g_autoptr(GVariant) variant = nullptr;
+    if (!lock.Acquire(repo, LockMode::SHARED, LOCK_TIMEOUT, nullptr, cancellable, error) ||
+        !ostree_repo_resolve_rev(repo, commit.c_str(), FALSE, &checksum, error) ||
+        !ostree_repo_load_variant(repo, OSTREE_OBJECT_TYPE_COMMIT, checksum, &variant, error)) {
+        return false;
+    }
+    // see OSTREE_COMMIT_GVARIANT_FORMAT, (6) root dirtree
+    g_autoptr(GVariant) rootChecksum = g_variant_get_child_value(variant, 6);
+    ObjectId root{};
+    if (!ReadObjectId(rootChecksum, root)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "invalid root tree in commit %s",
+                    checksum);
+        return false;
+    }
+
+    TarStream stream(fd, compression);
+    Export state{.repo = repo,
+                 .stream = stream,
+                 .mtime = ostree_commit_get_timestamp(variant),
+                 .bare = ostree_repo_get_mode(repo) != OSTREE_REPO_MODE_ARCHIVE,
+                 .onProgress = onProgress,
+                 .cancellable = cancellable};
+    if (!exportDirectory(state, "", ToChecksum(root), error) || !stream.Finish(error)) {
+        return false;
+    }
+    onProgress(state.files, state.bytes);
+    return true;
+}
+
+bool ExportTarToFile(OstreeRepo* repo,
+                     const std::string& commit,
+                     const std::string& destination,
+                     const ExportProgress& onProgress,
+                     GCancellable* cancellable,
+                     GError** error) {
+    const int fd = open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return failWithErrno(error, destination);
+    }
+    bool success = ExportTar(repo, commit, fd, CompressionForPath(destination), onProgress,
+                             cancellable, error);
+    if (close(fd) != 0 && success) {
+        success = failWithErrno(error, destination);
+    }
+    // no half written archives
+    if (!success) {
+        unlink(destination.c_str());
+    }
+    return success;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,71 @@
+/*_____________________________________________________________
+ | Tar Export
+ |   Streams the file tree of a commit into a tar archive (plain
+ |   or zstd compressed), without checking it out first:
+ |   - the tree is walked directory by directory, memory use is
+ |     bounded by fixed buffers & the depth of the tree
+ |   - plain archives copy the objects of bare repositories with
+ |     sendfile (in kernel), everything else passes through one
+ |     fixed read buffer
+ |   - long paths & large files use pax extended headers
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <ostree.h>
+
+namespace cpplibostree {
+
+enum class TarCompression : uint8_t { NONE, ZSTD };
+
+/// Called with the files & content bytes exported so far.
+using ExportProgress = std::function<void(uint64_t files, uint64_t bytes)>;
+
+/// @return ZSTD for .tar.zst / .tzst paths, NONE otherwise.
+[[nodiscard]] TarCompression CompressionForPath(const std::string& path);
+
+/**
+ * @brief Writes the tree of a commit as tar archive, similar to `ostree export`. Entries are
+ * relative to the root of the commit, all with the commit's timestamp as mtime.
+ *
+ * @param repo Repository handle.
+ * @param commit Commit (or ref) to export.
+ * @param fd File descriptor to write to (a file, pipe or socket), not closed.
+ * @param compression Compression of the archive.
+ * @param onProgress Called at most every 100 ms, and once at the end.
+ * @param cancellable Cancellable, checked between files and chunks of large files.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool ExportTar(OstreeRepo* repo,
+               const std::string& commit,
+               int fd,
+               TarCompression compression,
+               const ExportProgress& onProgress,
+               GCancellable* cancellable,
+               GError** error);
+
+/**
+ * @brief Writes the tree of a commit into a new tar file, compressed according to its name (see
+ * CompressionForPath). A failed export is removed again.
+ *
+ * @param repo Repository handle.
+ * @param commit Commit (or ref) to export.
+ * @param destination Path of the archive, must not exist.
+ * @param onProgress Called at most every 100 ms, and once at the end.
+ * @param cancellable Cancellable, checked between files and chunks of large files.
+ * @param error Set on failure.
+ * @return true on success
+ */
+bool ExportTarToFile(OstreeRepo* repo,
+                     const std::string& commit,
+                     const std::string& destination,
+                     const ExportProgress& onProgress,
+                     GCancellable* cancellable,
+                     GError** error);
+
+}  // namespace cpplibostree
@@ -0,0 +1,122 @@
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace cpplibostree {
+
+namespace {
+thread_local std::optional<size_t> currentWorker;
+}  // namespace
+
+// ThreadPool
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers.reserve(threadCount);
+    for (size_t i{0}; i < threadCount; i++) {
+        workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+size_t ThreadPool::Size() const {
+    return workers.size();
+}
+
+std::optional<size_t> ThreadPool::CurrentWorker() {
+    return currentWorker;
+}
+
+void ThreadPool::run(size_t index) {
+    currentWorker = index;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stop || !tasks.empty(); });
+            // remaining tasks are still executed, task groups wait for them
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// TaskGroup
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool) {}
+
+TaskGroup::~TaskGroup() {
+    waitAll();
+}
+
+void TaskGroup::Run(std::function<void()> task) {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+    }
+    pool.Submit([this, task = std::move(task)] {
+        // an escaping exception would end the worker (& the process), pass it to Wait()
+        std::exception_ptr exception;
+        try {
+            task();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (exception && !firstException) {
+            firstException = exception;
+        }
+        if (--pending == 0) {
+            done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::Wait() {
+    waitAll();
+    std::exception_ptr exception;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        exception = std::exchange(firstException, nullptr);
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::waitAll() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,83 @@
+/*_____________________________________________________________
+ | Thread Pool
+ |   Fixed set of worker threads for the background traversals
+ |   (disk usage, deltas, object scans, ...).
+ |   A TaskGroup tracks a set of tasks, that may spawn further
+ |   tasks into the same group (e.g. one task per dirtree), and
+ |   waits until all of them finished.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace cpplibostree {
+
+class ThreadPool {
+   public:
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param threadCount Amount of workers, 0 uses the amount of hardware threads.
+     */
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Queues a task, to be run by any worker.
+    void Submit(std::function<void()> task);
+
+    /// @return Amount of worker threads.
+    [[nodiscard]] size_t Size() const;
+
+    /// @return Index of the calling worker thread (0 .. Size()-1), nullopt outside of any pool.
+    [[nodiscard]] static std::optional<size_t> CurrentWorker();
+
+   private:
+    void run(size_t index);
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()>> tasks;
+    bool stop{false};
+    std::vector<std::thread> workers;
+};
+
+class TaskGroup {
+   public:
+    explicit TaskGroup(ThreadPool& pool);
+    /// waits for all tasks of the group
+    ~TaskGroup();
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /// @brief Runs a task on the pool, as part of this group (can be called from group tasks).
+    void Run(std::function<void()> task);
+
+    /**
+     * @brief Blocks until all tasks of the group finished. Must not be called from a worker
+     * of the same pool. Rethrows the first exception thrown by a task of the group.
+     */
+    void Wait();
+
+   private:
+    /// @brief Blocks until all tasks of the group finished, without rethrowing.
+    void waitAll();
+
+    ThreadPool& pool;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t pending{0};
+    std::exception_ptr firstException;
+};
+
+}  // namespace cpplibostree
@@ -0,0 +1,132 @@
+#include "treereader.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <ostree.h>
+
+#include "filecontent.hpp"
+#include "objectwalk.hpp"
+#include "profiler.hpp"
+
+namespace cpplibostree {
+
+TreeReader::TreeReader(std::string repoPath, size_t capacityBytes)
+    : repoPath(std::move(repoPath)), capacity(capacityBytes) {}
+
+TreeReader::~TreeReader() {
+    if (handle != nullptr) {
+        g_object_unref(handle);
+    }
+}
+
+OstreeRepo* TreeReader::repo() {
+    if (handle == nullptr) {
+        handle = ostree_repo_open_at(AT_FDCWD, repoPath.c_str(), nullptr, nullptr);
+    }
+    return handle;
+}
+
+std::optional<TreeRoot> TreeReader::GetRoot(const std::string& commit) {
+    OstreeRepo* r = repo();
+    g_autoptr(GVariant) variant = nullptr;
+    if (r == nullptr ||
+        !ostree_repo_load_variant(r, OSTREE_OBJECT_TYPE_COMMIT, commit.c_str(), &variant,
+                                  nullptr)) {
+        return std::nullopt;
+    }
+    // see OSTREE_COMMIT_GVARIANT_FORMAT, (6) root dirtree & (7) root dirmeta checksum
+    g_autoptr(GVariant) treeChecksum = g_variant_get_child_value(variant, 6);
+    g_autoptr(GVariant) metaChecksum = g_variant_get_child_value(variant, 7);
+    TreeRoot root;
+    if (!ReadObjectId(treeChecksum, root.dirtree) || !ReadObjectId(metaChecksum, root.dirmeta)) {
+        return std::nullopt;
+    }
+    return root;
+}
+
+std::shared_ptr<GVariant> TreeReader::GetDirtree(const ObjectId& dirtree) {
+    return get(OSTREE_OBJECT_TYPE_DIR_TREE, dirtree);
+}
+
+std::optional<TreeEntryInfo> TreeReader::GetDirmeta(const ObjectId& dirmeta) {
+    const auto variant = get(OSTREE_OBJECT_TYPE_DIR_META, dirmeta);
+    if (!variant) {
+        return std::nullopt;
+    }
+    // see OSTREE_DIRMETA_GVARIANT_FORMAT, (uuua(ayay)) in big endian
+    guint32 uid{0};
+    guint32 gid{0};
+    guint32 mode{0};
+    g_variant_get(variant.get(), "(uuu@a(ayay))", &uid, &gid, &mode, nullptr);
+    return TreeEntryInfo{GUINT32_FROM_BE(uid), GUINT32_FROM_BE(gid), GUINT32_FROM_BE(mode)};
+}
+
+std::optional<TreeEntryInfo> TreeReader::GetFileInfo(const ObjectId& file) {
+    OSTREE_TUI_PROFILE_SCOPE("TreeReader::GetFileInfo");
+    OstreeRepo* r = repo();
+    g_autoptr(GFileInfo) fileInfo = nullptr;
+    if (r == nullptr || !ostree_repo_load_file(r, ToChecksum(file).c_str(), nullptr, &fileInfo,
+                                               nullptr, nullptr, nullptr)) {
+        return std::nullopt;
+    }
+    TreeEntryInfo info{g_file_info_get_attribute_uint32(fileInfo, "unix::uid"),
+                       g_file_info_get_attribute_uint32(fileInfo, "unix::gid"),
+                       g_file_info_get_attribute_uint32(fileInfo, "unix::mode"),
+                       static_cast<uint64_t>(g_file_info_get_size(fileInfo))};
+    if (g_file_info_get_file_type(fileInfo) == G_FILE_TYPE_SYMBOLIC_LINK) {
+        info.symlinkTarget = g_file_info_get_symlink_target(fileInfo);
+    }
+    return info;
+}
+
+std::unique_ptr<FileContent> TreeReader::OpenContent(const ObjectId& file) {
+    OstreeRepo* r = repo();
+    return r == nullptr ? nullptr : FileContent::Open(r, file);
+}
+
+void TreeReader::Clear() {
+    lru.clear();
+    index.clear();
+    cachedBytes = 0;
+}
+
+size_t TreeReader::GetCachedBytes() const {
+    return cachedBytes;
+}
+
+std::shared_ptr<GVariant> TreeReader::get(OstreeObjectType type, const ObjectId& id) {
+    if (const auto cached = index.find(id); cached != index.end()) {
+        OSTREE_TUI_PROFILE_COUNT("treeCacheHits", 1);
+        lru.splice(lru.begin(), lru, cached->second);
+        return cached->second->second;
+    }
+
+    OSTREE_TUI_PROFILE_SCOPE("TreeReader::load");
+    OSTREE_TUI_PROFILE_COUNT("treeCacheMisses", 1);
+    OstreeRepo* r = repo();
+    GVariant* variant{nullptr};
+    if (r == nullptr ||
+        !ostree_repo_load_variant(r, type, ToChecksum(id).c_str(), &variant, nullptr)) {
+        return nullptr;
+    }
+    std::shared_ptr<GVariant> object(variant, VariantUnref{});
+
+    lru.emplace_front(id, object);
+    index.emplace(id, lru.begin());
+    cachedBytes += g_variant_get_size(variant);
+    // the most recent object always stays, even if it exceeds the capacity on its own
+    while (cachedBytes > capacity && lru.size() > 1) {
+        cachedBytes -= g_variant_get_size(lru.back().second.get());
+        index.erase(lru.back().first);
+        lru.pop_back();
+    }
+    return object;
+}
+
+}  // namespace cpplibostree
@@ -0,0 +1,103 @@
+/*_____________________________________________________________
+ | Tree Reader
+ |   On demand access to the file tree of commits, for the file
+ |   browser: dirtree & dirmeta objects are only loaded, once a
+ |   directory is expanded (or selected) & are kept decoded in
+ |   a LRU, bounded by their serialized size. Commits share most
+ |   of their subtrees, so browsing another commit mostly hits
+ |   the cache. File contents are opened on demand as well, see
+ |   FileContent.
+ |___________________________________________________________*/
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <ostree.h>
+
+#include "cpplibostree.hpp"
+#include "filecontent.hpp"
+#include "objectwalk.hpp"
+
+namespace cpplibostree {
+
+/// Root directory of a commit.
+struct TreeRoot {
+    ObjectId dirtree{};
+    ObjectId dirmeta{};
+};
+
+/// Ownership & permissions of a directory (dirmeta), or file.
+struct TreeEntryInfo {
+    uint32_t uid{0};
+    uint32_t gid{0};
+    uint32_t mode{0};
+    uint64_t size{0};           // files only
+    std::string symlinkTarget;  // symbolic links only
+};
+
+class TreeReader {
+   public:
+    static constexpr size_t DEFAULT_CAPACITY{64 * 1024 * 1024};
+
+    /**
+     * @param repoPath Path of the repository, opened on first access.
+     * @param capacityBytes Serialized size of the cached objects, before the least recently
+     * used ones are evicted.
+     */
+    explicit TreeReader(std::string repoPath, size_t capacityBytes = DEFAULT_CAPACITY);
+    ~TreeReader();
+    TreeReader(const TreeReader&) = delete;
+    TreeReader& operator=(const TreeReader&) = delete;
+
+    /// @return Root dirtree & dirmeta of a commit, nullopt if it could not be loaded.
+    [[nodiscard]] std::optional<TreeRoot> GetRoot(const std::string& commit);
+
+    /**
+     * @brief Gets a decoded dirtree, from the cache if possible.
+     *
+     * @param dirtree Checksum of the dirtree.
+     * @return Dirtree (OSTREE_TREE_GVARIANT_FORMAT), nullptr if it could not be loaded. Stays
+     * valid after it was evicted from the cache.
+     */
+    [[nodiscard]] std::shared_ptr<GVariant> GetDirtree(const ObjectId& dirtree);
+
+    /// @return Ownership & mode of a directory, nullopt if its dirmeta could not be loaded.
+    [[nodiscard]] std::optional<TreeEntryInfo> GetDirmeta(const ObjectId& dirmeta);
+
+    /// @return Ownership, mode & size of a file (only its header is read), nullopt on errors.
+    [[nodiscard]] std::optional<TreeEntryInfo> GetFileInfo(const ObjectId& file);
+
+    /// @return Windowed access to the content of a file, nullptr if it can't be opened.
+    [[nodiscard]] std::unique_ptr<FileContent> OpenContent(const ObjectId& file);
+
+    /// @brief Drops all cached objects (e.g. after objects were deleted).
+    void Clear();
+
+    /// @return Serialized size of all cached objects.
+    [[nodiscard]] size_t GetCachedBytes() const;
+
+   private:
+    /// @return Repository handle, nullptr if it could not be opened.
+    OstreeRepo* repo();
+
+    /// @brief Gets an object from the cache, or loads & caches it.
+    std::shared_ptr<GVariant> get(OstreeObjectType type, const ObjectId& id);
+
+    std::string repoPath;
+    OstreeRepo* handle{nullptr};
+    size_t capacity;
+    size_t cachedBytes{0};
+
+    using Entry = std::pair<ObjectId, std::shared_ptr<GVariant>>;
+    std::list<Entry> lru;  // most recently used first
+    std::unordered_map<ObjectId, std::list<Entry>::iterator, ObjectIdHash> index;
+};
+
+}  // namespace cpplibostree